@@ -0,0 +1,238 @@
+#include "ab_benchmark_dialog.h"
+#include "ui_ab_benchmark_dialog.h"
+
+#include <QHeaderView>
+#include <QJsonDocument>
+#include <QLocale>
+#include <QMessageBox>
+
+#include <cmath>
+
+#include "settings_manager.h"
+
+namespace {
+
+enum Column {
+    MetricColumn,
+    AColumn,
+    BColumn,
+    ChangeColumn,
+    ColumnCount
+};
+
+enum Target {
+    LocalTarget,
+    RemoteTarget
+};
+
+QString formatValue(AbBenchmark::Metric metric, double value)
+{
+    QLocale locale;
+    if (metric == AbBenchmark::Throughput)
+        return locale.formattedDataSize(qRound64(value)) + "/s";
+    return QString("%1 ms").arg(locale.toString(value, 'f', 1));
+}
+
+} // namespace
+
+AbBenchmarkDialog::AbBenchmarkDialog(ProfileStore *profileStore, CoreManager *coreManager,
+                                     RuleSetCache *ruleSetCache, QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::AbBenchmarkDialog)
+    , m_profileStore(profileStore)
+    , m_coreManager(coreManager)
+    , m_ruleSetCache(ruleSetCache)
+{
+    ui->setupUi(this);
+
+    m_benchmark = new AbBenchmark(this);
+    connect(m_benchmark, &AbBenchmark::progress, this, &AbBenchmarkDialog::showProgress);
+    connect(m_benchmark, &AbBenchmark::failed, this, &AbBenchmarkDialog::showFailure);
+    connect(m_benchmark, &AbBenchmark::finished, this, &AbBenchmarkDialog::showReport);
+
+    for (int i = 0; i < m_profileStore->count(); ++i) {
+        const Config &config = m_profileStore->at(i);
+        ui->profileAComboBox->addItem(config.name(), config.id());
+        ui->profileBComboBox->addItem(config.name(), config.id());
+    }
+    ui->profileAComboBox->setCurrentIndex(qMax(0, m_profileStore->indexOf(m_profileStore->selectedId())));
+    fillCores(ui->coreAComboBox);
+    fillCores(ui->coreBComboBox);
+
+    SettingsManager settingsManager;
+    ui->targetComboBox->addItem(tr("Local test server"));
+    ui->targetComboBox->setItemData(LocalTarget, tr("Measures the core itself. Configs that route "
+                                                    "private addresses directly never reach their outbounds."),
+                                    Qt::ToolTipRole);
+    // The throughput benchmark's target, once the user has set one
+    if (!settingsManager.benchmarkTarget().isEmpty()) {
+        ui->targetComboBox->addItem(settingsManager.benchmarkTarget());
+        ui->targetComboBox->setItemData(RemoteTarget, tr("Measures the whole path, including the outbound."),
+                                        Qt::ToolTipRole);
+    }
+
+    ui->resultTable->setColumnCount(ColumnCount);
+    ui->resultTable->setHorizontalHeaderLabels({tr("Metric"), tr("A"), tr("B"), tr("B vs A")});
+    ui->resultTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui->resultTable->setRowCount(AbBenchmark::MetricCount);
+    const QStringList metrics = {tr("Connection setup"), tr("Latency"), tr("Throughput")};
+    for (int row = 0; row < AbBenchmark::MetricCount; ++row) {
+        ui->resultTable->setItem(row, MetricColumn, new QTableWidgetItem(metrics.at(row)));
+        for (int column = AColumn; column < ColumnCount; ++column)
+            ui->resultTable->setItem(row, column, new QTableWidgetItem());
+    }
+
+    ui->statusLabel->setText(tr("Each round runs A, then B. Values are means with 95% confidence intervals."));
+    ui->runButton->setEnabled(m_profileStore->count() != 0);
+}
+
+AbBenchmarkDialog::~AbBenchmarkDialog()
+{
+    m_benchmark->cancel();
+    delete ui;
+}
+
+void AbBenchmarkDialog::on_runButton_clicked()
+{
+    if (m_benchmark->isRunning()) {
+        m_benchmark->cancel();
+        ui->statusLabel->setText(tr("Stopped."));
+        setRunning(false);
+        return;
+    }
+
+    AbBenchmark::Arm a;
+    AbBenchmark::Arm b;
+    if (!makeArm(ui->profileAComboBox, ui->coreAComboBox, &a)
+        || !makeArm(ui->profileBComboBox, ui->coreBComboBox, &b))
+        return;
+    a.name = "A (" + a.name + ")";
+    b.name = "B (" + b.name + ")";
+
+    for (int row = 0; row < AbBenchmark::MetricCount; ++row) {
+        for (int column = AColumn; column < ColumnCount; ++column) {
+            ui->resultTable->item(row, column)->setText(QString());
+            ui->resultTable->item(row, column)->setToolTip(QString());
+        }
+    }
+    m_benchmark->setRounds(ui->roundsSpinBox->value());
+    m_benchmark->setTarget(ui->targetComboBox->currentIndex() == RemoteTarget
+                               ? QUrl(ui->targetComboBox->currentText()) : QUrl());
+    setRunning(true);
+    m_benchmark->run(a, b);
+    if (!m_benchmark->isRunning())
+        setRunning(false);
+}
+
+void AbBenchmarkDialog::showProgress(const QString &message)
+{
+    ui->statusLabel->setText(message);
+}
+
+void AbBenchmarkDialog::showFailure(const QString &error)
+{
+    setRunning(false);
+    ui->statusLabel->setText(error);
+    QMessageBox::warning(this, tr("Warning"), error);
+}
+
+void AbBenchmarkDialog::showReport()
+{
+    setRunning(false);
+    for (int row = 0; row < AbBenchmark::MetricCount; ++row) {
+        auto metric = static_cast<AbBenchmark::Metric>(row);
+        const QList<double> samplesA = m_benchmark->samples(0, metric);
+        const QList<double> samplesB = m_benchmark->samples(1, metric);
+        AbBenchmark::Summary summaries[2] = {AbBenchmark::summarize(samplesA),
+                                             AbBenchmark::summarize(samplesB)};
+        for (int arm = 0; arm < 2; ++arm) {
+            const AbBenchmark::Summary &summary = summaries[arm];
+            QTableWidgetItem *item = ui->resultTable->item(row, AColumn + arm);
+            if (summary.count == 0) {
+                item->setText("-");
+                continue;
+            }
+            item->setText(QString("%1 ± %2").arg(formatValue(metric, summary.mean),
+                                                 formatValue(metric, summary.margin)));
+            QString tooltip = tr("%1 samples, standard deviation %2")
+                                  .arg(summary.count)
+                                  .arg(formatValue(metric, summary.deviation));
+            if (metric == AbBenchmark::SetupTime && summary.mean > 0)
+                tooltip += "\n" + tr("About %1 connections per second")
+                                      .arg(QLocale().toString(1000 / summary.mean, 'f', 1));
+            item->setToolTip(tooltip);
+        }
+
+        QTableWidgetItem *changeItem = ui->resultTable->item(row, ChangeColumn);
+        if (summaries[0].count < 2 || summaries[1].count < 2 || summaries[0].mean <= 0) {
+            changeItem->setText("-");
+            continue;
+        }
+        AbBenchmark::Summary difference = AbBenchmark::difference(samplesA, samplesB);
+        double change = 100 * difference.mean / summaries[0].mean;
+        double margin = 100 * difference.margin / summaries[0].mean;
+        changeItem->setText(QString("%1% ± %2%")
+                                .arg(QLocale().toString(change, 'f', 1), QLocale().toString(margin, 'f', 1)));
+
+        // Only call it when the interval of the difference excludes zero
+        bool significant = std::abs(difference.mean) > difference.margin;
+        bool better = metric == AbBenchmark::Throughput ? difference.mean > 0 : difference.mean < 0;
+        if (significant) {
+            changeItem->setForeground(better ? Qt::darkGreen : Qt::red);
+            changeItem->setToolTip(better ? tr("B is better") : tr("B is worse"));
+        } else {
+            changeItem->setForeground(palette().text());
+            changeItem->setToolTip(tr("No significant difference"));
+        }
+    }
+
+    QString status = tr("Done.");
+    if (m_benchmark->failures(0) + m_benchmark->failures(1) > 0)
+        status += " " + tr("Failed requests: %1 for A, %2 for B.")
+                            .arg(m_benchmark->failures(0))
+                            .arg(m_benchmark->failures(1));
+    ui->statusLabel->setText(status);
+}
+
+void AbBenchmarkDialog::fillCores(QComboBox *comboBox)
+{
+    comboBox->addItem(tr("Profile default"), QString());
+    const QList<CoreInfo> cores = m_coreManager->cores();
+    for (const CoreInfo &info : cores) {
+        if (info.isValid())
+            comboBox->addItem(info.bundled ? tr("%1 (bundled)").arg(info.version) : info.version, info.path);
+    }
+}
+
+bool AbBenchmarkDialog::makeArm(QComboBox *profileComboBox, QComboBox *coreComboBox, AbBenchmark::Arm *arm)
+{
+    QString id = profileComboBox->currentData().toString();
+    Config config = m_profileStore->profile(id);
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(m_profileStore->content(id), &error);
+    if (error.error != QJsonParseError::NoError || !document.isObject()) {
+        QMessageBox::warning(this, tr("Warning"), tr("Cannot read the profile %1.").arg(config.name()));
+        return false;
+    }
+
+    arm->name = config.name();
+    arm->config = m_ruleSetCache->rewrite(document.object());
+    arm->corePath = coreComboBox->currentData().toString();
+    if (arm->corePath.isEmpty())
+        arm->corePath = m_coreManager->corePath(config.coreVersion());
+    else
+        arm->name += ", sing-box " + coreComboBox->currentText();
+    return true;
+}
+
+void AbBenchmarkDialog::setRunning(bool running)
+{
+    ui->runButton->setText(running ? tr("Stop") : tr("Run"));
+    ui->runButton->setIcon(QIcon(running ? ":/images/stop.png" : ":/images/start.png"));
+    ui->profileAComboBox->setEnabled(!running);
+    ui->profileBComboBox->setEnabled(!running);
+    ui->coreAComboBox->setEnabled(!running);
+    ui->coreBComboBox->setEnabled(!running);
+    ui->roundsSpinBox->setEnabled(!running);
+    ui->targetComboBox->setEnabled(!running);
+}
@@ -0,0 +1,46 @@
+#ifndef AB_BENCHMARK_DIALOG_H
+#define AB_BENCHMARK_DIALOG_H
+
+#include <QDialog>
+
+#include "ab_benchmark.h"
+#include "core_manager.h"
+#include "profile_store.h"
+#include "rule_set_cache.h"
+
+QT_BEGIN_NAMESPACE
+class QComboBox;
+QT_END_NAMESPACE
+
+namespace Ui {
+class AbBenchmarkDialog;
+}
+
+class AbBenchmarkDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit AbBenchmarkDialog(ProfileStore *profileStore, CoreManager *coreManager,
+                               RuleSetCache *ruleSetCache, QWidget *parent = nullptr);
+    ~AbBenchmarkDialog();
+
+private slots:
+    void on_runButton_clicked();
+    void showProgress(const QString &message);
+    void showFailure(const QString &error);
+    void showReport();
+
+private:
+    void fillCores(QComboBox *comboBox);
+    bool makeArm(QComboBox *profileComboBox, QComboBox *coreComboBox, AbBenchmark::Arm *arm);
+    void setRunning(bool running);
+
+    Ui::AbBenchmarkDialog *ui;
+    ProfileStore *m_profileStore;
+    CoreManager *m_coreManager;
+    RuleSetCache *m_ruleSetCache;
+    AbBenchmark *m_benchmark;
+};
+
+#endif // AB_BENCHMARK_DIALOG_H
@@ -0,0 +1,179 @@
+#include "benchmark_dialog.h"
+#include "ui_benchmark_dialog.h"
+
+#include <QHeaderView>
+#include <QJsonArray>
+#include <QLocale>
+#include <QMessageBox>
+
+#include <algorithm>
+
+#include "clash_api.h"
+#include "outbound_selector.h"
+#include "settings_manager.h"
+
+namespace {
+
+enum Column {
+    OutboundColumn,
+    ThroughputColumn,
+    TtfbColumn,
+    JitterColumn,
+    FinishedColumn,
+    ColumnCount
+};
+
+} // namespace
+
+BenchmarkDialog::BenchmarkDialog(ClashApi *clashApi, const QJsonObject &config, const QString &profile,
+                                 QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::BenchmarkDialog)
+    , m_config(config)
+{
+    ui->setupUi(this);
+
+    m_benchmark = new ThroughputBenchmark(clashApi, this);
+    m_benchmark->setProfile(profile);
+    connect(m_benchmark, &ThroughputBenchmark::outboundStarted, this, &BenchmarkDialog::showOutboundStarted);
+    connect(m_benchmark, &ThroughputBenchmark::outboundFinished, this, &BenchmarkDialog::showResult);
+    connect(m_benchmark, &ThroughputBenchmark::finished, this, &BenchmarkDialog::showFinished);
+
+    SettingsManager settingsManager;
+    ui->targetEdit->setText(settingsManager.benchmarkTarget());
+    ui->targetEdit->setPlaceholderText(tr("URL of a large download"));
+
+    ui->resultTable->setColumnCount(ColumnCount);
+    ui->resultTable->setHorizontalHeaderLabels({tr("Outbound"), tr("Throughput"), tr("TTFB"),
+                                                tr("Jitter"), tr("Last run")});
+    ui->resultTable->horizontalHeader()->setSectionResizeMode(OutboundColumn, QHeaderView::Stretch);
+
+    // Members of the selector the route uses are the candidates
+    m_selector = OutboundSelector::defaultSelector(m_config);
+    const QJsonArray outbounds = m_config.value("outbounds").toArray();
+    for (const QJsonValue &value : outbounds) {
+        QJsonObject outbound = value.toObject();
+        if (outbound.value("tag").toString() != m_selector)
+            continue;
+        const QJsonArray members = outbound.value("outbounds").toArray();
+        ui->resultTable->setRowCount(members.size());
+        for (int row = 0; row < members.size(); ++row) {
+            ui->resultTable->setItem(row, OutboundColumn, new QTableWidgetItem(members.at(row).toString()));
+            for (int column = ThroughputColumn; column < ColumnCount; ++column)
+                ui->resultTable->setItem(row, column, new QTableWidgetItem());
+        }
+        break;
+    }
+
+    const QHash<QString, ThroughputBenchmark::Result> results = ThroughputBenchmark::loadResults(profile);
+    for (const ThroughputBenchmark::Result &result : results) {
+        if (rowOf(result.outbound) >= 0)
+            showResult(result);
+    }
+
+    if (m_selector.isEmpty())
+        ui->statusLabel->setText(tr("The config has no selector outbound"));
+    ui->runButton->setEnabled(!m_selector.isEmpty());
+}
+
+BenchmarkDialog::~BenchmarkDialog()
+{
+    m_benchmark->cancel();
+    delete ui;
+}
+
+void BenchmarkDialog::on_runButton_clicked()
+{
+    if (m_benchmark->isRunning()) {
+        m_benchmark->cancel();
+        return;
+    }
+
+    QUrl target = QUrl::fromUserInput(ui->targetEdit->text().trimmed());
+    if (!target.isValid() || target.scheme().isEmpty()) {
+        QMessageBox::warning(this, tr("Warning"), tr("Please enter a valid URL."));
+        return;
+    }
+    QNetworkProxy proxy = ThroughputBenchmark::localProxy(m_config);
+    if (proxy.type() == QNetworkProxy::NoProxy) {
+        QMessageBox::warning(this, tr("Warning"),
+                             tr("The config has no mixed, http or socks inbound to route the downloads through."));
+        return;
+    }
+
+    SettingsManager settingsManager;
+    settingsManager.setBenchmarkTarget(target.toString());
+
+    // Selected rows only, or every member when nothing is selected
+    QStringList outbounds;
+    QList<int> rows;
+    const QModelIndexList selected = ui->resultTable->selectionModel()->selectedRows();
+    for (const QModelIndex &index : selected)
+        rows.append(index.row());
+    if (rows.isEmpty()) {
+        for (int row = 0; row < ui->resultTable->rowCount(); ++row)
+            rows.append(row);
+    }
+    std::sort(rows.begin(), rows.end());
+    for (int row : std::as_const(rows))
+        outbounds.append(ui->resultTable->item(row, OutboundColumn)->text());
+
+    m_benchmark->setProxy(proxy);
+    m_benchmark->setTarget(target);
+    m_benchmark->setConnections(ui->connectionsSpinBox->value());
+    m_benchmark->setDuration(ui->durationSpinBox->value() * 1000);
+    m_benchmark->run(m_selector, outbounds);
+    setRunning(m_benchmark->isRunning());
+}
+
+void BenchmarkDialog::showOutboundStarted(const QString &outbound)
+{
+    ui->statusLabel->setText(tr("Testing %1...").arg(outbound));
+}
+
+void BenchmarkDialog::showResult(const ThroughputBenchmark::Result &result)
+{
+    int row = rowOf(result.outbound);
+    if (row < 0)
+        return;
+
+    QLocale locale;
+    bool failed = result.bytes == 0 && result.failures > 0;
+    ui->resultTable->item(row, ThroughputColumn)->setText(
+        failed ? tr("failed") : locale.formattedDataSize(qRound64(result.throughput)) + tr("/s"));
+    ui->resultTable->item(row, TtfbColumn)->setText(
+        result.ttfb >= 0 ? tr("%1 ms").arg(qRound(result.ttfb)) : QString());
+    ui->resultTable->item(row, JitterColumn)->setText(
+        result.ttfb >= 0 ? tr("%1 ms").arg(qRound(result.jitter)) : QString());
+    ui->resultTable->item(row, FinishedColumn)->setText(
+        locale.toString(result.finishedAt, QLocale::ShortFormat));
+    ui->resultTable->item(row, ThroughputColumn)->setToolTip(
+        tr("%1 transferred, %2 requests, %3 failed")
+            .arg(locale.formattedDataSize(result.bytes))
+            .arg(result.requests)
+            .arg(result.failures));
+}
+
+void BenchmarkDialog::showFinished()
+{
+    ui->statusLabel->setText(tr("Done"));
+    setRunning(false);
+}
+
+int BenchmarkDialog::rowOf(const QString &outbound) const
+{
+    for (int row = 0; row < ui->resultTable->rowCount(); ++row) {
+        if (ui->resultTable->item(row, OutboundColumn)->text() == outbound)
+            return row;
+    }
+    return -1;
+}
+
+void BenchmarkDialog::setRunning(bool running)
+{
+    ui->runButton->setText(running ? tr("Stop") : tr("Run"));
+    ui->runButton->setIcon(QIcon(running ? ":/images/stop.png" : ":/images/start.png"));
+    ui->targetEdit->setEnabled(!running);
+    ui->connectionsSpinBox->setEnabled(!running);
+    ui->durationSpinBox->setEnabled(!running);
+}
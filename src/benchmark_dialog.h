@@ -0,0 +1,40 @@
+#ifndef BENCHMARK_DIALOG_H
+#define BENCHMARK_DIALOG_H
+
+#include <QDialog>
+#include <QJsonObject>
+
+#include "throughput_benchmark.h"
+
+class ClashApi;
+
+namespace Ui {
+class BenchmarkDialog;
+}
+
+class BenchmarkDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    BenchmarkDialog(ClashApi *clashApi, const QJsonObject &config, const QString &profile,
+                    QWidget *parent = nullptr);
+    ~BenchmarkDialog();
+
+private slots:
+    void on_runButton_clicked();
+    void showOutboundStarted(const QString &outbound);
+    void showResult(const ThroughputBenchmark::Result &result);
+    void showFinished();
+
+private:
+    int rowOf(const QString &outbound) const;
+    void setRunning(bool running);
+
+    Ui::BenchmarkDialog *ui;
+    ThroughputBenchmark *m_benchmark;
+    QJsonObject m_config;
+    QString m_selector;
+};
+
+#endif // BENCHMARK_DIALOG_H
@@ -1,9 +1,20 @@
 #include "config.h"
 
+#include <QUuid>
+
 Config::Config(const QString &path, const QString &name)
-    : m_filePath{path}, m_name{name}
+    : m_id{QUuid::createUuid().toString(QUuid::WithoutBraces)}, m_filePath{path}, m_name{name}
+{}
+
+Config::Config(const QString &id, const QString &path, const QString &name)
+    : m_id{id}, m_filePath{path}, m_name{name}
 {}
 
+QString Config::id() const
+{
+    return m_id;
+}
+
 QString Config::filePath() const
 {
     return m_filePath;
@@ -24,3 +35,62 @@ void Config::setName(const QString &name)
     m_name = name;
 }
 
+QString Config::hash() const
+{
+    return m_hash;
+}
+
+qint64 Config::size() const
+{
+    return m_size;
+}
+
+int Config::outboundCount() const
+{
+    return m_outboundCount;
+}
+
+QDateTime Config::lastUsed() const
+{
+    return m_lastUsed;
+}
+
+int Config::lastLatency() const
+{
+    return m_lastLatency;
+}
+
+void Config::setHash(const QString &hash)
+{
+    m_hash = hash;
+}
+
+void Config::setSize(qint64 size)
+{
+    m_size = size;
+}
+
+void Config::setOutboundCount(int count)
+{
+    m_outboundCount = count;
+}
+
+void Config::setLastUsed(const QDateTime &lastUsed)
+{
+    m_lastUsed = lastUsed;
+}
+
+void Config::setLastLatency(int latency)
+{
+    m_lastLatency = latency;
+}
+
+QString Config::coreVersion() const
+{
+    return m_coreVersion;
+}
+
+void Config::setCoreVersion(const QString &version)
+{
+    m_coreVersion = version;
+}
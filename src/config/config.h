@@ -1,24 +1,53 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <QDateTime>
 #include <QString>
 
 class Config
 {
 public:
     explicit Config(const QString &path, const QString &name);
+    Config(const QString &id, const QString &path, const QString &name);
 
+    QString id() const;
     QString filePath() const;
     QString name() const;
 
     void setFilePath(const QString &path);
     void setName(const QString &name);
 
+    // Metadata kept in the profile index, so listing profiles
+    // does not need to open their files
+    QString hash() const;
+    qint64 size() const;
+    int outboundCount() const;
+    QDateTime lastUsed() const;
+    // Milliseconds, -1 if never measured
+    int lastLatency() const;
+
+    void setHash(const QString &hash);
+    void setSize(qint64 size);
+    void setOutboundCount(int count);
+    void setLastUsed(const QDateTime &lastUsed);
+    void setLastLatency(int latency);
+
+    // sing-box version the profile is pinned to, empty for the default core
+    QString coreVersion() const;
+    void setCoreVersion(const QString &version);
+
 signals:
 
 private:
+    QString m_id;
     QString m_filePath;
     QString m_name;
+    QString m_hash;
+    qint64 m_size = 0;
+    int m_outboundCount = 0;
+    QDateTime m_lastUsed;
+    int m_lastLatency = -1;
+    QString m_coreVersion;
 };
 
 #endif // CONFIG_H
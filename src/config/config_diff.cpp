@@ -0,0 +1,235 @@
+#include "config_diff.h"
+
+#include <QHash>
+#include <QJsonDocument>
+#include <QSet>
+
+namespace {
+
+// Tag used to match an entry, falls back to "type#index" for untagged entries
+QString entryKey(const QJsonObject &entry, int index)
+{
+    QString tag = entry.value("tag").toString();
+    if (!tag.isEmpty())
+        return tag;
+    return QString("%1#%2").arg(entry.value("type").toString("unknown")).arg(index);
+}
+
+QString ruleLabel(const QJsonObject &rule, int index)
+{
+    QString target = rule.value("outbound").toString();
+    if (target.isEmpty())
+        target = rule.value("action").toString("route");
+    return QString("#%1 => %2").arg(index).arg(target);
+}
+
+void appendSection(QStringList &log, const QString &name, const ConfigDiff::Section &section)
+{
+    for (const QString &key : section.added)
+        log.append(QString("+ %1 %2").arg(name, key));
+    for (const QString &key : section.removed)
+        log.append(QString("- %1 %2").arg(name, key));
+    for (const QString &key : section.modified)
+        log.append(QString("~ %1 %2").arg(name, key));
+}
+
+} // namespace
+
+bool ConfigDiff::Section::isEmpty() const
+{
+    return added.isEmpty() && removed.isEmpty() && modified.isEmpty();
+}
+
+int ConfigDiff::Section::count() const
+{
+    return added.size() + removed.size() + modified.size();
+}
+
+ConfigDiff ConfigDiff::compare(const QJsonObject &oldConfig, const QJsonObject &newConfig)
+{
+    ConfigDiff diff;
+    diff.inbounds = compareTagged(oldConfig.value("inbounds").toArray(),
+                                  newConfig.value("inbounds").toArray());
+    diff.outbounds = compareTagged(oldConfig.value("outbounds").toArray(),
+                                   newConfig.value("outbounds").toArray());
+
+    QJsonObject oldRoute = oldConfig.value("route").toObject();
+    QJsonObject newRoute = newConfig.value("route").toObject();
+    diff.ruleSets = compareTagged(oldRoute.value("rule_set").toArray(),
+                                  newRoute.value("rule_set").toArray());
+    diff.rules = compareRules(oldRoute.value("rules").toArray(),
+                              newRoute.value("rules").toArray(),
+                              &diff.rulesReordered);
+
+    // Remaining route keys, e.g. "final" or "auto_detect_interface"
+    QSet<QString> routeKeys;
+    for (auto it = oldRoute.constBegin(); it != oldRoute.constEnd(); ++it)
+        routeKeys.insert(it.key());
+    for (auto it = newRoute.constBegin(); it != newRoute.constEnd(); ++it)
+        routeKeys.insert(it.key());
+    routeKeys.remove("rules");
+    routeKeys.remove("rule_set");
+    for (const QString &key : routeKeys) {
+        if (oldRoute.value(key) != newRoute.value(key))
+            diff.otherChanges.append("route." + key);
+    }
+
+    // Remaining top-level sections, e.g. "log", "dns" or "experimental"
+    QSet<QString> keys;
+    for (auto it = oldConfig.constBegin(); it != oldConfig.constEnd(); ++it)
+        keys.insert(it.key());
+    for (auto it = newConfig.constBegin(); it != newConfig.constEnd(); ++it)
+        keys.insert(it.key());
+    keys.remove("inbounds");
+    keys.remove("outbounds");
+    keys.remove("route");
+    for (const QString &key : keys) {
+        if (oldConfig.value(key) != newConfig.value(key))
+            diff.otherChanges.append(key);
+    }
+    diff.otherChanges.sort();
+
+    return diff;
+}
+
+bool ConfigDiff::isEmpty() const
+{
+    return inbounds.isEmpty() && outbounds.isEmpty() && ruleSets.isEmpty()
+           && rules.isEmpty() && !rulesReordered && otherChanges.isEmpty();
+}
+
+bool ConfigDiff::requiresRestart() const
+{
+    return !isEmpty();
+}
+
+int ConfigDiff::changeCount() const
+{
+    return inbounds.count() + outbounds.count() + ruleSets.count() + rules.count()
+           + (rulesReordered ? 1 : 0) + otherChanges.size();
+}
+
+QString ConfigDiff::summary() const
+{
+    if (isEmpty())
+        return QString("no changes");
+
+    QStringList parts;
+    auto describe = [&parts](const QString &name, const Section &section) {
+        if (!section.isEmpty()) {
+            parts.append(QString("%1 +%2 -%3 ~%4").arg(name)
+                             .arg(section.added.size())
+                             .arg(section.removed.size())
+                             .arg(section.modified.size()));
+        }
+    };
+    describe("inbounds", inbounds);
+    describe("outbounds", outbounds);
+    describe("rule sets", ruleSets);
+    describe("rules", rules);
+    if (rulesReordered)
+        parts.append("rules reordered");
+    if (!otherChanges.isEmpty())
+        parts.append(otherChanges.join(", ") + " changed");
+    return parts.join(", ");
+}
+
+QStringList ConfigDiff::changeLog(int maxLines) const
+{
+    QStringList log;
+    appendSection(log, "inbound", inbounds);
+    appendSection(log, "outbound", outbounds);
+    appendSection(log, "rule_set", ruleSets);
+    appendSection(log, "rule", rules);
+    if (rulesReordered)
+        log.append("~ route rules reordered");
+    for (const QString &key : otherChanges)
+        log.append(QString("~ %1").arg(key));
+
+    if (maxLines > 0 && log.size() > maxLines) {
+        int remaining = log.size() - maxLines;
+        log = log.mid(0, maxLines);
+        log.append(QString("... and %1 more").arg(remaining));
+    }
+    return log;
+}
+
+ConfigDiff::Section ConfigDiff::compareTagged(const QJsonArray &oldArray, const QJsonArray &newArray)
+{
+    Section section;
+
+    QHash<QString, QJsonObject> oldEntries;
+    oldEntries.reserve(oldArray.size());
+    for (int i = 0; i < oldArray.size(); ++i) {
+        QJsonObject entry = oldArray.at(i).toObject();
+        oldEntries.insert(entryKey(entry, i), entry);
+    }
+
+    for (int i = 0; i < newArray.size(); ++i) {
+        QJsonObject entry = newArray.at(i).toObject();
+        QString key = entryKey(entry, i);
+        auto it = oldEntries.find(key);
+        if (it == oldEntries.end()) {
+            section.added.append(key);
+        } else {
+            if (it.value() != entry)
+                section.modified.append(key);
+            oldEntries.erase(it);
+        }
+    }
+
+    for (auto it = oldEntries.constBegin(); it != oldEntries.constEnd(); ++it)
+        section.removed.append(it.key());
+    section.removed.sort();
+
+    return section;
+}
+
+ConfigDiff::Section ConfigDiff::compareRules(const QJsonArray &oldArray, const QJsonArray &newArray,
+                                             bool *reordered)
+{
+    // Rules have no tag, so they are matched by their compact serialization.
+    // A changed rule shows up as one removal plus one addition.
+    Section section;
+
+    QList<QByteArray> oldKeys;
+    oldKeys.reserve(oldArray.size());
+    QHash<QByteArray, int> oldCounts;
+    for (const QJsonValue &value : oldArray) {
+        QByteArray key = QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact);
+        oldKeys.append(key);
+        oldCounts[key]++;
+    }
+
+    QList<QByteArray> commonNew;
+    QHash<QByteArray, int> newCounts;
+    for (int i = 0; i < newArray.size(); ++i) {
+        QJsonObject rule = newArray.at(i).toObject();
+        QByteArray key = QJsonDocument(rule).toJson(QJsonDocument::Compact);
+        newCounts[key]++;
+        auto it = oldCounts.find(key);
+        if (it != oldCounts.end() && it.value() > 0) {
+            it.value()--;
+            commonNew.append(key);
+        } else {
+            section.added.append(ruleLabel(rule, i));
+        }
+    }
+
+    QList<QByteArray> commonOld;
+    for (int i = 0; i < oldKeys.size(); ++i) {
+        auto it = newCounts.find(oldKeys.at(i));
+        if (it != newCounts.end() && it.value() > 0) {
+            it.value()--;
+            commonOld.append(oldKeys.at(i));
+        } else {
+            section.removed.append(ruleLabel(oldArray.at(i).toObject(), i));
+        }
+    }
+
+    // Rules are evaluated in order, so the same rules in a different
+    // order are a real change
+    *reordered = commonOld != commonNew;
+
+    return section;
+}
@@ -0,0 +1,51 @@
+#ifndef CONFIG_DIFF_H
+#define CONFIG_DIFF_H
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QStringList>
+
+// Structural diff between two parsed sing-box configurations.
+// Inbounds, outbounds and rule-sets are matched by their "tag",
+// route rules by their content, everything else by top-level key.
+class ConfigDiff
+{
+public:
+    struct Section
+    {
+        QStringList added;
+        QStringList removed;
+        QStringList modified;
+
+        bool isEmpty() const;
+        int count() const;
+    };
+
+    static ConfigDiff compare(const QJsonObject &oldConfig, const QJsonObject &newConfig);
+
+    bool isEmpty() const;
+    // sing-box cannot hot-reload its configuration, so any structural
+    // change needs a restart. Key order and formatting do not count.
+    bool requiresRestart() const;
+    int changeCount() const;
+
+    // One line summary such as "outbounds +1 -0 ~2, dns changed"
+    QString summary() const;
+    // Human readable change log, capped at maxLines entries
+    QStringList changeLog(int maxLines = 50) const;
+
+    Section inbounds;
+    Section outbounds;
+    Section ruleSets;
+    Section rules;
+    bool rulesReordered = false;
+    // Top-level keys (or "route.<key>") whose value changed
+    QStringList otherChanges;
+
+private:
+    static Section compareTagged(const QJsonArray &oldArray, const QJsonArray &newArray);
+    static Section compareRules(const QJsonArray &oldArray, const QJsonArray &newArray,
+                                bool *reordered);
+};
+
+#endif // CONFIG_DIFF_H
@@ -1,12 +1,12 @@
 #include "config_manager.h"
 
 #include <QCoreApplication>
+#include <QDir>
 #include <QFile>
 #include <QFileDialog>
-#include <QListWidget>
-#include <QSettings>
 #include <QStandardPaths>
 
+#include "config_snapshot.h"
 #include "settings_manager.h"
 
 ConfigManager::ConfigManager(QObject *parent)
@@ -15,10 +15,9 @@ ConfigManager::ConfigManager(QObject *parent)
     m_configEditor = new ConfigEditor();
     connect(m_configEditor, &ConfigEditor::configFileSaved, this, &ConfigManager::appendConfigList);
     connect(m_configEditor, &ConfigEditor::editedConfigFileSaved, this, &ConfigManager::updateConfigList);
-    getConfigFromSettings();
 
-    SettingsManager settingsManager;
-    m_configIndex = settingsManager.configIndex();
+    // Profile names, paths and metadata come from the index, no profile file is opened here
+    m_profileStore = new ProfileStore(this);
 }
 
 ConfigManager::~ConfigManager()
@@ -29,59 +28,35 @@ ConfigManager::~ConfigManager()
 void ConfigManager::addConfig()
 {
     m_configEditor->addFile();
-    if (m_configList.count() == 1)
+    if (m_profileStore->count() == 1)
         emit configChanged();
 }
 
 void ConfigManager::importConfig()
 {
     m_configEditor->openFile();
-    if (m_configList.count() == 1)
+    if (m_profileStore->count() == 1)
         emit configChanged();
 }
 
 void ConfigManager::editConfig(int index)
 {
-    if (index >= 0 && index < m_configList.size()) {
-        QString filePath = m_configList.at(index).filePath();
-        QString name = m_configList.at(index).name();
-        m_configEditor->openFile(index, filePath, name);
+    if (index >= 0 && index < m_profileStore->count()) {
+        const Config &config = m_profileStore->at(index);
+        m_configEditor->openFile(index, config.filePath(), config.name());
     }
 }
 
 void ConfigManager::removeConfig(int index)
 {
-    if (index >= 0 && index < m_configList.size()) {
-        QString filePath = m_configList.at(index).filePath();
-        QFile(filePath).remove();
-        m_configList.remove(index);
-        saveConfigToSettings();
-        int count = m_configList.count();
-        // Already deleted, get new configuration quantity
-        if (count != 0) {
-            // The previous item is deleted,
-            // and the selected configuration is moved forward by one item.
-            if (index < m_configIndex) {
-                switchConfig(m_configIndex - 1);
-            }
-            // Deleting the latter item,
-            // have no impact on the selected configuration
-            if (index > m_configIndex) {
-            }
-            // Delete the selected configuration,
-            // need to switch to other configurations
-            if (index == m_configIndex) {
-                // The deleted item is not the last one
-                if (index != count)
-                {
-                    switchConfig(m_configIndex);
-                } else { // Deleted the last one
-                    switchConfig(m_configIndex - 1);
-                }
-            }
-        } else {
-            // The configuration has been cleared,
-            // need other operations
+    if (index >= 0 && index < m_profileStore->count()) {
+        const Config config = m_profileStore->at(index);
+        bool selected = config.id() == m_profileStore->selectedId();
+        QFile(config.filePath()).remove();
+        ConfigSnapshot::remove(config.filePath());
+        // The store picks the neighbour when the selected profile goes away
+        m_profileStore->remove(config.id());
+        if (selected || m_profileStore->count() == 0) {
             emit configChanged();
         }
         emit configUpdated();
@@ -90,10 +65,16 @@ void ConfigManager::removeConfig(int index)
 
 void ConfigManager::switchConfig(int index)
 {
-    if (index >= 0 && index < m_configList.size()) {
-        SettingsManager settingsManager;
-        settingsManager.setConfigIndex(index);
-        m_configIndex = index;
+    if (index >= 0 && index < m_profileStore->count()) {
+        switchConfigById(m_profileStore->at(index).id());
+    }
+}
+
+void ConfigManager::switchConfigById(const QString &id)
+{
+    if (m_profileStore->contains(id)) {
+        m_profileStore->setSelectedId(id);
+        m_profileStore->markUsed(id);
 
         emit configChanged();
     }
@@ -102,44 +83,50 @@ void ConfigManager::switchConfig(int index)
 QStringList ConfigManager::configNames() const
 {
     QStringList names;
-    for (const auto &config : m_configList) {
-        names.append(config.name());
+    names.reserve(m_profileStore->count());
+    for (int i = 0; i < m_profileStore->count(); ++i) {
+        names.append(m_profileStore->at(i).name());
     }
     return names;
 }
 
 QString ConfigManager::configFilePath() const
 {
-    if (!m_configList.isEmpty()){
-        return m_configList.at(m_configIndex).filePath();
-    } else {
-        return QString();
-    }
+    return m_profileStore->profile(m_profileStore->selectedId()).filePath();
 }
 
 QString ConfigManager::configName() const
 {
-    if (!m_configList.isEmpty()){
-        return m_configList.at(m_configIndex).name();
-    } else {
-        return QString();
-    }
+    return m_profileStore->profile(m_profileStore->selectedId()).name();
+}
+
+QString ConfigManager::configId() const
+{
+    return m_profileStore->selectedId();
 }
 
 int ConfigManager::configIndex() const
 {
-    return m_configIndex;
+    return qMax(0, m_profileStore->indexOf(m_profileStore->selectedId()));
 }
 
 int ConfigManager::configCount() const
 {
-    return m_configList.count();
+    return m_profileStore->count();
+}
+
+ProfileStore *ConfigManager::profileStore() const
+{
+    return m_profileStore;
 }
 
 void ConfigManager::deleteAllConfig()
 {
-    m_configList.clear();
-    m_configIndex = 0;
+    for (int i = 0; i < m_profileStore->count(); ++i) {
+        QFile(m_profileStore->at(i).filePath()).remove();
+        ConfigSnapshot::remove(m_profileStore->at(i).filePath());
+    }
+    m_profileStore->clear();
 
     QString localPath = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
     QString directory = QString("%1/%2/config").arg(localPath)
@@ -150,7 +137,7 @@ void ConfigManager::deleteAllConfig()
     }
 
     SettingsManager settingsManager;
-    settingsManager.setConfigIndex(m_configIndex);
+    settingsManager.setConfigIndex(0);
     settingsManager.removeConfig();
 
     emit configUpdated();
@@ -160,44 +147,22 @@ void ConfigManager::deleteAllConfig()
 
 void ConfigManager::appendConfigList(const QString &filePath, const QString &name)
 {
-    m_configList.append(Config{filePath, name});
-    saveConfigToSettings();
+    m_profileStore->add(filePath, name);
     emit configUpdated();
 }
 
 void ConfigManager::updateConfigList(int index, const QString &filePath, const QString &name)
 {
-    if (index >= 0 && index < m_configList.size()) {
-        m_configList[index] = Config{filePath, name};
-    }
-    saveConfigToSettings();
-    emit configUpdated();
-}
-
-void ConfigManager::getConfigFromSettings()
-{
-    QSettings settings;
-    int size = settings.beginReadArray("Config");
-    for (int i = 0; i < size; ++i) {
-        settings.setArrayIndex(i);
-        QString filePath = settings.value("filePath").toString();
-        QString name = settings.value("name").toString();
-        m_configList.append(Config{filePath, name});
+    if (index >= 0 && index < m_profileStore->count()) {
+        QString id = m_profileStore->at(index).id();
+        // The snapshot is keyed by the path, one for the old file is never read again
+        QString oldFilePath = m_profileStore->at(index).filePath();
+        if (oldFilePath != filePath)
+            ConfigSnapshot::remove(oldFilePath);
+        m_profileStore->update(id, filePath, name);
+        if (id == m_profileStore->selectedId()) {
+            emit configChanged();
+        }
     }
-    settings.endArray();
-
     emit configUpdated();
 }
-
-void ConfigManager::saveConfigToSettings()
-{
-    QSettings settings;
-    settings.beginWriteArray("Config");
-    settings.remove("");
-    for (int i = 0; i < m_configList.size(); ++i) {
-        settings.setArrayIndex(i);
-        settings.setValue("filePath", m_configList.at(i).filePath());
-        settings.setValue("name", m_configList.at(i).name());
-    }
-    settings.endArray();
-}
@@ -5,6 +5,7 @@
 
 #include "config.h"
 #include "config_editor.h"
+#include "profile_store.h"
 
 class ConfigManager : public QObject
 {
@@ -18,13 +19,17 @@ public:
     void importConfig();
     void removeConfig(int index);
     void switchConfig(int index);
+    void switchConfigById(const QString &id);
 
     QStringList configNames() const;
     QString configFilePath() const;
     QString configName() const;
+    QString configId() const;
     int configIndex() const;
     int configCount() const;
 
+    ProfileStore *profileStore() const;
+
     void deleteAllConfig();
 
 signals:
@@ -36,13 +41,7 @@ private slots:
     void updateConfigList(int index, const QString &filePath, const QString &name);
 
 private:
-    // Read config list from registry
-    void getConfigFromSettings();
-    // Write config list to registry
-    void saveConfigToSettings();
-
-    int m_configIndex;
-    QList<Config> m_configList;
+    ProfileStore *m_profileStore;
     ConfigEditor *m_configEditor;
 };
 
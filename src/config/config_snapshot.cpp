@@ -0,0 +1,173 @@
+#include "config_snapshot.h"
+
+#include <QCborArray>
+#include <QCborMap>
+#include <QCborStreamReader>
+#include <QCborValue>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "config_validator.h"
+
+namespace {
+
+const char kMagic[] = "qsing-box-snapshot";
+const int kVersion = 1;
+
+// Identifies a core binary, so replacing it invalidates earlier checks
+QString coreId(const QString &corePath)
+{
+    if (corePath.isEmpty())
+        return QString();
+    QFileInfo info(corePath);
+    return QString("%1@%2").arg(info.absoluteFilePath())
+        .arg(info.lastModified().toMSecsSinceEpoch());
+}
+
+QCborMap sourceHeader(const QString &configFilePath, const QByteArray &hash)
+{
+    QCborMap source;
+    source.insert(QStringLiteral("size"), QFileInfo(configFilePath).size());
+    source.insert(QStringLiteral("sha256"), hash);
+    return source;
+}
+
+// Size and time can stay the same across an edit, only the hash is proof
+bool matchesSource(const QCborMap &header, const QByteArray &sourceHash)
+{
+    return !sourceHash.isEmpty() && header.value(QStringLiteral("sha256")).toByteArray() == sourceHash;
+}
+
+QByteArray readSnapshot(const QString &configFilePath)
+{
+    QFile file(ConfigSnapshot::snapshotPath(configFilePath));
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
+
+} // namespace
+
+QString ConfigSnapshot::snapshotPath(const QString &configFilePath)
+{
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/snapshot";
+    QByteArray key = QCryptographicHash::hash(QFileInfo(configFilePath).absoluteFilePath().toUtf8(),
+                                              QCryptographicHash::Sha1).toHex();
+    return QString("%1/%2.cbor").arg(directory, QString::fromLatin1(key));
+}
+
+bool ConfigSnapshot::save(const ConfigValidationResult &result, const QString &corePath)
+{
+    if (!result.valid || result.filePath.isEmpty())
+        return false;
+
+    QCborArray outbounds;
+    for (const QJsonValue &value : result.config.value("outbounds").toArray()) {
+        QJsonObject outbound = value.toObject();
+        outbounds.append(QCborArray{outbound.value("tag").toString(), outbound.value("type").toString()});
+    }
+    QCborMap index;
+    index.insert(QStringLiteral("inbounds"), result.config.value("inbounds").toArray().size());
+    index.insert(QStringLiteral("outbounds"), outbounds);
+
+    // Header and index come first, so loadIndex() can stop before the config
+    QCborMap snapshot;
+    snapshot.insert(QStringLiteral("magic"), QString::fromLatin1(kMagic));
+    snapshot.insert(QStringLiteral("version"), kVersion);
+    snapshot.insert(QStringLiteral("source"), sourceHeader(result.filePath, result.hash));
+    snapshot.insert(QStringLiteral("core"), result.checkedByCore ? coreId(corePath) : QString());
+    snapshot.insert(QStringLiteral("index"), index);
+    snapshot.insert(QStringLiteral("warnings"), QCborArray::fromStringList(result.warnings));
+    snapshot.insert(QStringLiteral("preview"), result.preview);
+    snapshot.insert(QStringLiteral("config"), QCborValue::fromJsonValue(result.config));
+
+    QString path = snapshotPath(result.filePath);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(snapshot.toCborValue().toCbor());
+    return file.commit();
+}
+
+bool ConfigSnapshot::load(const QString &configFilePath, const QByteArray &sourceHash,
+                          const QString &corePath, ConfigValidationResult *result)
+{
+    QByteArray data = readSnapshot(configFilePath);
+    if (data.isEmpty())
+        return false;
+
+    QCborMap snapshot = QCborValue::fromCbor(data).toMap();
+    if (snapshot.value(QStringLiteral("magic")).toString() != QLatin1String(kMagic)
+        || snapshot.value(QStringLiteral("version")).toInteger() != kVersion) {
+        return false;
+    }
+
+    QCborMap source = snapshot.value(QStringLiteral("source")).toMap();
+    if (!matchesSource(source, sourceHash))
+        return false;
+    // A config that still needs "sing-box check" by this core goes the slow way
+    if (!corePath.isEmpty() && snapshot.value(QStringLiteral("core")).toString() != coreId(corePath))
+        return false;
+
+    result->valid = true;
+    result->filePath = configFilePath;
+    result->hash = source.value(QStringLiteral("sha256")).toByteArray();
+    result->config = snapshot.value(QStringLiteral("config")).toMap().toJsonObject();
+    result->preview = snapshot.value(QStringLiteral("preview")).toString();
+    result->checkedByCore = !corePath.isEmpty();
+    result->fromSnapshot = true;
+    for (const QCborValue &warning : snapshot.value(QStringLiteral("warnings")).toArray())
+        result->warnings.append(warning.toString());
+    return !result->config.isEmpty();
+}
+
+bool ConfigSnapshot::loadIndex(const QString &configFilePath, const QByteArray &sourceHash, Index *index)
+{
+    // Streamed from the file, the config after the index is never read
+    QFile file(snapshotPath(configFilePath));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QCborStreamReader reader(&file);
+    if (!reader.isMap() || !reader.enterContainer())
+        return false;
+
+    bool sourceMatched = false;
+    while (reader.hasNext() && reader.lastError() == QCborError::NoError) {
+        QString key = QCborValue::fromCbor(reader).toString();
+        if (key == QLatin1String("config"))
+            break;
+        QCborValue value = QCborValue::fromCbor(reader);
+        if (key == QLatin1String("magic") && value.toString() != QLatin1String(kMagic)) {
+            return false;
+        } else if (key == QLatin1String("version") && value.toInteger() != kVersion) {
+            return false;
+        } else if (key == QLatin1String("source")) {
+            if (!matchesSource(value.toMap(), sourceHash))
+                return false;
+            index->hash = value.toMap().value(QStringLiteral("sha256")).toByteArray();
+            sourceMatched = true;
+        } else if (key == QLatin1String("index")) {
+            QCborMap map = value.toMap();
+            index->inboundCount = map.value(QStringLiteral("inbounds")).toInteger();
+            QCborArray outbounds = map.value(QStringLiteral("outbounds")).toArray();
+            index->outboundCount = outbounds.size();
+            index->outboundTags.clear();
+            for (const QCborValue &outbound : outbounds)
+                index->outboundTags.append(outbound.toArray().at(0).toString());
+        }
+    }
+    return sourceMatched;
+}
+
+void ConfigSnapshot::remove(const QString &configFilePath)
+{
+    QFile::remove(snapshotPath(configFilePath));
+}
@@ -0,0 +1,42 @@
+#ifndef CONFIG_SNAPSHOT_H
+#define CONFIG_SNAPSHOT_H
+
+#include <QJsonObject>
+#include <QStringList>
+
+struct ConfigValidationResult;
+
+// Binary (CBOR) snapshot of a validated config, stored next to the app
+// data and keyed by the path of the JSON file it was made from.
+// The header records size and SHA-256 of the source, a snapshot is only
+// used for the exact bytes it was made from. The JSON file stays the
+// source of truth for the core.
+class ConfigSnapshot
+{
+public:
+    struct Index
+    {
+        QByteArray hash;
+        int inboundCount = 0;
+        int outboundCount = 0;
+        QStringList outboundTags;
+    };
+
+    static QString snapshotPath(const QString &configFilePath);
+
+    // All of these are safe to call from any thread, but read files and
+    // belong on a worker.
+    // corePath is the binary that ran "sing-box check", empty if none did;
+    // a snapshot checked by another core is not loaded. sourceHash is the
+    // SHA-256 of the current content of configFilePath.
+    static bool save(const ConfigValidationResult &result, const QString &corePath);
+    static bool load(const QString &configFilePath, const QByteArray &sourceHash,
+                     const QString &corePath, ConfigValidationResult *result);
+
+    // Reads only the header and index, without decoding the config
+    static bool loadIndex(const QString &configFilePath, const QByteArray &sourceHash, Index *index);
+
+    static void remove(const QString &configFilePath);
+};
+
+#endif // CONFIG_SNAPSHOT_H
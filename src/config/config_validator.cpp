@@ -0,0 +1,464 @@
+#include "config_validator.h"
+
+#include <QCache>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QProcess>
+#include <QSet>
+#include <QTemporaryFile>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "config_snapshot.h"
+#include "subscription_converter.h"
+
+namespace {
+
+const int kMaxErrors = 20;
+const int kCoreCheckTimeout = 20000;
+// A few profiles and subscriptions worth of "sing-box check" results
+const int kMaxCachedChecks = 32;
+// The preview box is a few lines high, do not render megabytes into it
+const int kMaxPreviewSize = 256 * 1024;
+
+struct CoreCheckResult
+{
+    bool valid = false;
+    QString output;
+};
+
+// "sing-box check" results keyed by core path + content hash, least
+// recently used dropped first
+QCache<QByteArray, CoreCheckResult> coreCheckCache(kMaxCachedChecks);
+QMutex coreCheckCacheMutex;
+
+const QJsonObject &compiledSchema()
+{
+    static const QJsonObject schema = [] {
+        QFile file(":/schema/sing-box.schema.json");
+        if (!file.open(QIODevice::ReadOnly))
+            return QJsonObject();
+        return QJsonDocument::fromJson(file.readAll()).object();
+    }();
+    return schema;
+}
+
+bool matchesType(const QJsonValue &value, const QString &type)
+{
+    if (type == "object")
+        return value.isObject();
+    if (type == "array")
+        return value.isArray();
+    if (type == "string")
+        return value.isString();
+    if (type == "boolean")
+        return value.isBool();
+    if (type == "number")
+        return value.isDouble();
+    if (type == "integer")
+        return value.isDouble() && value.toDouble() == static_cast<qint64>(value.toDouble());
+    return true;
+}
+
+void addError(QStringList *errors, const QString &error)
+{
+    if (errors->size() < kMaxErrors)
+        errors->append(error);
+}
+
+// Subset of JSON Schema: type, enum, required, properties, items,
+// minimum, maximum, minLength, plus "x-type-schemas" which picks an
+// extra schema by the value of an object's "type" member.
+void validateValue(const QJsonValue &value, const QJsonObject &schema,
+                   const QString &path, QStringList *errors)
+{
+    if (schema.contains("type")) {
+        QJsonValue typeValue = schema.value("type");
+        QStringList types;
+        if (typeValue.isArray()) {
+            for (const QJsonValue &type : typeValue.toArray())
+                types.append(type.toString());
+        } else {
+            types.append(typeValue.toString());
+        }
+        bool matched = false;
+        for (const QString &type : types) {
+            if (matchesType(value, type)) {
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) {
+            addError(errors, QString("%1: expected %2").arg(path, types.join(" or ")));
+            return;
+        }
+    }
+
+    if (schema.contains("enum") && !schema.value("enum").toArray().contains(value)) {
+        addError(errors, QString("%1: unsupported value \"%2\"").arg(path, value.toVariant().toString()));
+    }
+
+    if (value.isDouble()) {
+        if (schema.contains("minimum") && value.toDouble() < schema.value("minimum").toDouble())
+            addError(errors, QString("%1: must be at least %2").arg(path).arg(schema.value("minimum").toDouble()));
+        if (schema.contains("maximum") && value.toDouble() > schema.value("maximum").toDouble())
+            addError(errors, QString("%1: must be at most %2").arg(path).arg(schema.value("maximum").toDouble()));
+    }
+
+    if (value.isString() && schema.contains("minLength")
+        && value.toString().size() < schema.value("minLength").toInt()) {
+        addError(errors, QString("%1: must not be empty").arg(path));
+    }
+
+    if (value.isObject()) {
+        QJsonObject object = value.toObject();
+        for (const QJsonValue &key : schema.value("required").toArray()) {
+            if (!object.contains(key.toString()))
+                addError(errors, QString("%1: missing \"%2\"").arg(path, key.toString()));
+        }
+        QJsonObject properties = schema.value("properties").toObject();
+        for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+            if (object.contains(it.key())) {
+                validateValue(object.value(it.key()), it.value().toObject(),
+                              path + "." + it.key(), errors);
+            }
+        }
+        QJsonObject typeSchemas = schema.value("x-type-schemas").toObject();
+        QString type = object.value("type").toString();
+        if (!type.isEmpty() && typeSchemas.contains(type))
+            validateValue(value, typeSchemas.value(type).toObject(), path, errors);
+    }
+
+    if (value.isArray() && schema.contains("items")) {
+        QJsonArray array = value.toArray();
+        QJsonObject itemSchema = schema.value("items").toObject();
+        for (int i = 0; i < array.size(); ++i) {
+            QString itemPath = QString("%1[%2]").arg(path).arg(i);
+            QString tag = array.at(i).toObject().value("tag").toString();
+            if (!tag.isEmpty())
+                itemPath += QString("(%1)").arg(tag);
+            validateValue(array.at(i), itemSchema, itemPath, errors);
+        }
+    }
+}
+
+QSet<QString> collectTags(const QJsonArray &array, const QString &section, QStringList *errors)
+{
+    QSet<QString> tags;
+    for (const QJsonValue &value : array) {
+        QString tag = value.toObject().value("tag").toString();
+        if (tag.isEmpty())
+            continue;
+        if (tags.contains(tag))
+            addError(errors, QString("%1: duplicate tag \"%2\"").arg(section, tag));
+        tags.insert(tag);
+    }
+    return tags;
+}
+
+QStringList stringList(const QJsonValue &value)
+{
+    QStringList list;
+    if (value.isString()) {
+        list.append(value.toString());
+    } else {
+        for (const QJsonValue &item : value.toArray())
+            list.append(item.toString());
+    }
+    return list;
+}
+
+void checkReference(const QSet<QString> &tags, const QString &tag, const QString &path,
+                    QStringList *errors)
+{
+    if (!tag.isEmpty() && !tags.contains(tag))
+        addError(errors, QString("%1: unknown tag \"%2\"").arg(path, tag));
+}
+
+void checkRuleReferences(const QJsonArray &rules, const QString &path,
+                         const QSet<QString> &targets, const QString &targetKey,
+                         const QSet<QString> &inbounds, const QSet<QString> &ruleSets,
+                         QStringList *errors)
+{
+    for (int i = 0; i < rules.size(); ++i) {
+        QJsonObject rule = rules.at(i).toObject();
+        QString rulePath = QString("%1[%2]").arg(path).arg(i);
+        checkReference(targets, rule.value(targetKey).toString(), rulePath + "." + targetKey, errors);
+        for (const QString &tag : stringList(rule.value("inbound")))
+            checkReference(inbounds, tag, rulePath + ".inbound", errors);
+        for (const QString &tag : stringList(rule.value("rule_set")))
+            checkReference(ruleSets, tag, rulePath + ".rule_set", errors);
+        // Logical rules nest their sub rules
+        if (rule.contains("rules")) {
+            checkRuleReferences(rule.value("rules").toArray(), rulePath + ".rules",
+                                targets, targetKey, inbounds, ruleSets, errors);
+        }
+    }
+}
+
+// Checks that cannot be expressed in the schema: duplicate tags and
+// references to inbounds, outbounds, rule-sets or DNS servers that do not exist
+void validateReferences(const QJsonObject &config, QStringList *errors)
+{
+    QJsonArray outbounds = config.value("outbounds").toArray();
+    QJsonObject route = config.value("route").toObject();
+    QJsonObject dns = config.value("dns").toObject();
+
+    QSet<QString> inboundTags = collectTags(config.value("inbounds").toArray(), "inbounds", errors);
+    QSet<QString> outboundTags = collectTags(outbounds, "outbounds", errors);
+    // Endpoints (e.g. WireGuard) can be used like outbounds
+    outboundTags.unite(collectTags(config.value("endpoints").toArray(), "endpoints", errors));
+    QSet<QString> ruleSetTags = collectTags(route.value("rule_set").toArray(), "route.rule_set", errors);
+    QSet<QString> dnsServerTags = collectTags(dns.value("servers").toArray(), "dns.servers", errors);
+
+    for (int i = 0; i < outbounds.size(); ++i) {
+        QJsonObject outbound = outbounds.at(i).toObject();
+        QString path = QString("outbounds[%1](%2)").arg(i).arg(outbound.value("tag").toString());
+        checkReference(outboundTags, outbound.value("detour").toString(), path + ".detour", errors);
+        QString type = outbound.value("type").toString();
+        if (type == "selector" || type == "urltest") {
+            QStringList members = stringList(outbound.value("outbounds"));
+            if (members.isEmpty())
+                addError(errors, QString("%1.outbounds: must not be empty").arg(path));
+            for (const QString &member : members)
+                checkReference(outboundTags, member, path + ".outbounds", errors);
+            if (outbound.contains("default") && !members.contains(outbound.value("default").toString())) {
+                addError(errors, QString("%1.default: \"%2\" is not a member")
+                                     .arg(path, outbound.value("default").toString()));
+            }
+        }
+    }
+
+    checkRuleReferences(route.value("rules").toArray(), "route.rules", outboundTags, "outbound",
+                        inboundTags, ruleSetTags, errors);
+    checkReference(outboundTags, route.value("final").toString(), "route.final", errors);
+
+    QJsonArray servers = dns.value("servers").toArray();
+    for (int i = 0; i < servers.size(); ++i) {
+        checkReference(outboundTags, servers.at(i).toObject().value("detour").toString(),
+                       QString("dns.servers[%1].detour").arg(i), errors);
+    }
+    checkRuleReferences(dns.value("rules").toArray(), "dns.rules", dnsServerTags, "server",
+                        inboundTags, ruleSetTags, errors);
+    checkReference(dnsServerTags, dns.value("final").toString(), "dns.final", errors);
+}
+
+// False if the core could not give an answer, output says why
+bool runCoreCheck(const QByteArray &content, const QString &corePath, CoreCheckResult *result)
+{
+    QTemporaryFile file(QDir::tempPath() + "/qsing-box-check-XXXXXX.json");
+    if (!file.open()) {
+        result->output = QString("Cannot create temporary file for sing-box check");
+        return false;
+    }
+    file.write(content);
+    file.flush();
+
+    // Same working directory as "sing-box run", so relative paths resolve identically.
+    // Cores may live elsewhere, the run directory is always next to qsing-box.
+    QString workingDirectory = QCoreApplication::applicationDirPath();
+    QProcess process;
+    process.setWorkingDirectory(workingDirectory);
+    process.start(corePath, QStringList() << "check" << "-c" << file.fileName()
+                                          << "-D" << workingDirectory << "--disable-color");
+    if (!process.waitForFinished(kCoreCheckTimeout)) {
+        process.kill();
+        process.waitForFinished();
+        result->output = QString("sing-box check did not finish in time");
+        return false;
+    }
+    result->valid = process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+    result->output = QString::fromUtf8(process.readAllStandardError()).trimmed();
+    return true;
+}
+
+} // namespace
+
+ConfigValidator::ConfigValidator(QObject *parent)
+    : QObject{parent}
+{}
+
+void ConfigValidator::setCorePath(const QString &corePath)
+{
+    m_corePath = corePath;
+}
+
+QString ConfigValidator::corePath() const
+{
+    return m_corePath;
+}
+
+quint64 ConfigValidator::validateFile(const QString &filePath)
+{
+    return startValidation(filePath, QByteArray());
+}
+
+quint64 ConfigValidator::validateData(const QByteArray &content)
+{
+    return startValidation(QString(), content);
+}
+
+quint64 ConfigValidator::startValidation(const QString &filePath, const QByteArray &content)
+{
+    quint64 requestId = ++m_lastRequestId;
+    QString corePath = m_corePath;
+
+    auto *watcher = new QFutureWatcher<ConfigValidationResult>(this);
+    connect(watcher, &QFutureWatcher<ConfigValidationResult>::finished, this, [this, watcher]() {
+        emit validationFinished(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([this, requestId, filePath, content, corePath]() {
+        QElapsedTimer clock;
+        clock.start();
+        ConfigValidationResult result;
+        if (filePath.isEmpty()) {
+            // Downloaded subscriptions may be share links or Clash YAML
+            SubscriptionConverter::Format format = SubscriptionConverter::detect(content);
+            if (format == SubscriptionConverter::ShareLinks || format == SubscriptionConverter::ClashYaml) {
+                QByteArray converted;
+                QStringList warnings;
+                QString error;
+                if (SubscriptionConverter::convert(content, &converted, &warnings, &error)) {
+                    result = validate(converted, corePath);
+                    result.warnings = warnings + result.warnings;
+                } else {
+                    result.content = content;
+                    result.errors.append(error);
+                }
+            } else {
+                result = validate(content, corePath);
+            }
+        } else {
+            // Read on the worker too, large files must not block the GUI
+            QFile file(filePath);
+            if (!file.open(QIODevice::ReadOnly)) {
+                result.errors.append(QString("Cannot read config file %1").arg(filePath));
+                result.filePath = filePath;
+            } else {
+                QByteArray source = file.readAll();
+                QByteArray hash = QCryptographicHash::hash(source, QCryptographicHash::Sha256);
+                ConfigSnapshot::Index index;
+                if (ConfigSnapshot::loadIndex(filePath, hash, &index)) {
+                    int outboundCount = index.outboundCount;
+                    QMetaObject::invokeMethod(this, [this, requestId, outboundCount]() {
+                        emit snapshotFound(requestId, outboundCount);
+                    }, Qt::QueuedConnection);
+                }
+                if (!ConfigSnapshot::load(filePath, hash, corePath, &result)) {
+                    result = validate(source, corePath);
+                    result.filePath = filePath;
+                    // Next time this file is loaded from the snapshot without parsing
+                    if (result.valid)
+                        ConfigSnapshot::save(result, corePath);
+                }
+                result.size = source.size();
+            }
+        }
+        result.requestId = requestId;
+        if (filePath.isEmpty())
+            result.size = content.size();
+        result.elapsed = clock.elapsed();
+        return result;
+    }));
+
+    return requestId;
+}
+
+void ConfigValidator::saveSnapshot(const ConfigValidationResult &result)
+{
+    QString corePath = m_corePath;
+    QThreadPool::globalInstance()->start([result, corePath]() {
+        ConfigSnapshot::save(result, corePath);
+    });
+}
+
+ConfigValidationResult ConfigValidator::validate(const QByteArray &content, const QString &corePath)
+{
+    ConfigValidationResult result;
+    result.content = content;
+    result.hash = QCryptographicHash::hash(content, QCryptographicHash::Sha256);
+
+    if (content.trimmed().isEmpty()) {
+        result.errors.append(QString("Configuration file is empty"));
+        return result;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(content, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        result.errors.append(QString("Invalid JSON at offset %1: %2")
+                                 .arg(parseError.offset).arg(parseError.errorString()));
+        return result;
+    }
+    if (!jsonDoc.isObject()) {
+        result.errors.append(QString("Configuration is not a JSON object"));
+        return result;
+    }
+
+    result.config = jsonDoc.object();
+    if (!result.config.contains("inbounds") && !result.config.contains("outbounds")) {
+        result.errors.append(QString("Missing required 'inbounds' or 'outbounds' sections"));
+        return result;
+    }
+
+    validateValue(result.config, compiledSchema(), "config", &result.errors);
+    validateReferences(result.config, &result.errors);
+    if (!result.errors.isEmpty())
+        return result;
+
+    if (!corePath.isEmpty()) {
+        if (!QFile::exists(corePath)) {
+            result.warnings.append(QString("sing-box core not found, skipped core check"));
+        } else {
+            QByteArray cacheKey = corePath.toUtf8() + '\0' + result.hash;
+            CoreCheckResult check;
+            bool checked = false;
+            {
+                QMutexLocker locker(&coreCheckCacheMutex);
+                if (const CoreCheckResult *cached = coreCheckCache.object(cacheKey)) {
+                    check = *cached;
+                    checked = true;
+                }
+            }
+            if (!checked) {
+                checked = runCoreCheck(content, corePath, &check);
+                if (checked) {
+                    QMutexLocker locker(&coreCheckCacheMutex);
+                    coreCheckCache.insert(cacheKey, new CoreCheckResult(check));
+                }
+            }
+            result.checkedByCore = checked;
+            if (!checked) {
+                // Applied on the schema check alone, the core may still reject it
+                result.warnings.append(QString("%1, config not checked by sing-box").arg(check.output));
+            } else if (!check.valid) {
+                result.errors.append(check.output.isEmpty() ? QString("sing-box check failed")
+                                                            : check.output);
+                return result;
+            } else if (!check.output.isEmpty()) {
+                result.warnings.append(check.output);
+            }
+        }
+    }
+
+    QByteArray preview = jsonDoc.toJson(QJsonDocument::Indented);
+    if (preview.size() > kMaxPreviewSize) {
+        // Do not cut a UTF-8 sequence in half
+        qsizetype end = kMaxPreviewSize;
+        while (end > 0 && (uchar(preview.at(end)) & 0xc0) == 0x80)
+            --end;
+        preview.truncate(end);
+        preview.append("\n... (preview truncated)");
+    }
+    result.preview = QString::fromUtf8(preview);
+    result.valid = true;
+    return result;
+}
@@ -0,0 +1,67 @@
+#ifndef CONFIG_VALIDATOR_H
+#define CONFIG_VALIDATOR_H
+
+#include <QJsonObject>
+#include <QObject>
+#include <QStringList>
+
+struct ConfigValidationResult
+{
+    quint64 requestId = 0;
+    bool valid = false;
+    // Source file, empty when validating downloaded data
+    QString filePath;
+    QByteArray content;
+    // SHA-256 of content
+    QByteArray hash;
+    QJsonObject config;
+    // Indented JSON for the preview, built off the GUI thread
+    QString preview;
+    QStringList errors;
+    QStringList warnings;
+    bool checkedByCore = false;
+    // Loaded from a binary snapshot, content is empty in that case
+    bool fromSnapshot = false;
+    // Bytes of the source and ms spent on the worker thread
+    qint64 size = 0;
+    qint64 elapsed = 0;
+};
+
+// Validates sing-box configurations on a worker thread.
+// Every config is parsed, checked against the compiled-in schema and
+// for dangling tag references, then optionally run through
+// "sing-box check". Core check results are cached by content hash, and
+// validated files get a binary snapshot so reloading them skips parsing.
+class ConfigValidator : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConfigValidator(QObject *parent = nullptr);
+
+    // Empty path disables the "sing-box check" stage
+    void setCorePath(const QString &corePath);
+    QString corePath() const;
+
+    // Both return the request id reported back in validationFinished()
+    quint64 validateFile(const QString &filePath);
+    quint64 validateData(const QByteArray &content);
+
+    // Snapshot a valid result whose content was just written to result.filePath
+    void saveSnapshot(const ConfigValidationResult &result);
+
+    // Synchronous validation, safe to call from any thread
+    static ConfigValidationResult validate(const QByteArray &content, const QString &corePath);
+
+signals:
+    // A file request found an up to date snapshot, sent before it is decoded
+    void snapshotFound(quint64 requestId, int outboundCount);
+    void validationFinished(const ConfigValidationResult &result);
+
+private:
+    quint64 startValidation(const QString &filePath, const QByteArray &content);
+
+    QString m_corePath;
+    quint64 m_lastRequestId = 0;
+};
+
+#endif // CONFIG_VALIDATOR_H
@@ -0,0 +1,116 @@
+#include "config_watcher.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+namespace {
+
+// Quiet time after the last write before a file is read
+const int kDebounceInterval = 300;
+
+} // namespace
+
+ConfigWatcher::ConfigWatcher(QObject *parent)
+    : QObject{parent}
+{
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &ConfigWatcher::onFileChanged);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &ConfigWatcher::onDirectoryChanged);
+
+    m_debounceTimer = new QTimer(this);
+    m_debounceTimer->setSingleShot(true);
+    m_debounceTimer->setInterval(kDebounceInterval);
+    connect(m_debounceTimer, &QTimer::timeout, this, &ConfigWatcher::checkPending);
+}
+
+void ConfigWatcher::setFiles(const QStringList &filePaths)
+{
+    QStringList files;
+    QStringList directories;
+    for (const QString &filePath : filePaths) {
+        if (filePath.isEmpty())
+            continue;
+        QString absolutePath = QFileInfo(filePath).absoluteFilePath();
+        files.append(absolutePath);
+        QString directory = QFileInfo(absolutePath).absolutePath();
+        if (!directories.contains(directory))
+            directories.append(directory);
+    }
+    if (files == m_files)
+        return;
+    m_files = files;
+
+    if (!m_watcher->files().isEmpty())
+        m_watcher->removePaths(m_watcher->files());
+    if (!m_watcher->directories().isEmpty())
+        m_watcher->removePaths(m_watcher->directories());
+    // Missing files are picked up through their directory once created
+    for (const QString &file : std::as_const(m_files)) {
+        if (QFile::exists(file))
+            m_watcher->addPath(file);
+    }
+    for (const QString &directory : std::as_const(directories)) {
+        if (QDir(directory).exists())
+            m_watcher->addPath(directory);
+    }
+
+    for (auto it = m_hashes.begin(); it != m_hashes.end();) {
+        if (m_files.contains(it.key()))
+            ++it;
+        else
+            it = m_hashes.erase(it);
+    }
+}
+
+void ConfigWatcher::setContentHash(const QString &filePath, const QByteArray &hash)
+{
+    if (!filePath.isEmpty())
+        m_hashes.insert(QFileInfo(filePath).absoluteFilePath(), hash);
+}
+
+void ConfigWatcher::onFileChanged(const QString &filePath)
+{
+    m_pending.insert(filePath);
+    m_debounceTimer->start();
+}
+
+void ConfigWatcher::onDirectoryChanged(const QString &directory)
+{
+    // Something in the directory was added, removed or renamed; only the
+    // watched files in it are looked at
+    QDir dir(directory);
+    for (const QString &file : std::as_const(m_files)) {
+        if (QFileInfo(file).absolutePath() == dir.absolutePath())
+            m_pending.insert(file);
+    }
+    m_debounceTimer->start();
+}
+
+void ConfigWatcher::checkPending()
+{
+    const QSet<QString> pending = m_pending;
+    m_pending.clear();
+
+    for (const QString &filePath : pending) {
+        if (!m_files.contains(filePath))
+            continue;
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly))
+            continue; // Deleted, or still locked by the writer
+        // A replaced file is a new inode, watch it again
+        if (!m_watcher->files().contains(filePath))
+            m_watcher->addPath(filePath);
+
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        hash.addData(&file);
+        QByteArray result = hash.result();
+        if (m_hashes.value(filePath) == result)
+            continue;
+        m_hashes.insert(filePath, result);
+        emit fileChanged(filePath);
+    }
+}
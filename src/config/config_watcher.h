@@ -0,0 +1,46 @@
+#ifndef CONFIG_WATCHER_H
+#define CONFIG_WATCHER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QFileSystemWatcher;
+class QTimer;
+QT_END_NAMESPACE
+
+// Reports config files changed by other programs. The directories are
+// watched too, since editors and QSaveFile replace a file by renaming,
+// which drops the watch on the file itself. Bursts of writes are merged,
+// and a change is only reported when the SHA-256 of the content differs
+// from the last one seen or set with setContentHash().
+class ConfigWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConfigWatcher(QObject *parent = nullptr);
+
+    void setFiles(const QStringList &filePaths);
+    // Content the app already knows about, e.g. what it just loaded or wrote
+    void setContentHash(const QString &filePath, const QByteArray &hash);
+
+signals:
+    void fileChanged(const QString &filePath);
+
+private slots:
+    void onFileChanged(const QString &filePath);
+    void onDirectoryChanged(const QString &directory);
+    void checkPending();
+
+private:
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_debounceTimer;
+    QStringList m_files;
+    QHash<QString, QByteArray> m_hashes;
+    QSet<QString> m_pending;
+};
+
+#endif // CONFIG_WATCHER_H
@@ -0,0 +1,66 @@
+#include "profile_list_model.h"
+
+#include <QFont>
+#include <QLocale>
+
+#include "profile_store.h"
+
+ProfileListModel::ProfileListModel(ProfileStore *store, QObject *parent)
+    : QAbstractListModel{parent}
+    , m_store{store}
+{
+    connect(m_store, &ProfileStore::profilesChanged, this, [this]() {
+        beginResetModel();
+        endResetModel();
+    });
+    connect(m_store, &ProfileStore::profileUpdated, this, &ProfileListModel::onProfileUpdated);
+}
+
+int ProfileListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_store->count();
+}
+
+QVariant ProfileListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_store->count())
+        return QVariant();
+
+    const Config &config = m_store->at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return config.name();
+    case Qt::ToolTipRole: {
+        QString tooltip = tr("%1 outbounds, %2")
+                              .arg(config.outboundCount())
+                              .arg(QLocale().formattedDataSize(config.size()));
+        if (config.lastLatency() >= 0)
+            tooltip += tr(", last latency %1 ms").arg(config.lastLatency());
+        if (!config.coreVersion().isEmpty())
+            tooltip += tr("\nsing-box %1").arg(config.coreVersion());
+        if (config.lastUsed().isValid())
+            tooltip += tr("\nLast used %1").arg(QLocale().toString(config.lastUsed(), QLocale::ShortFormat));
+        tooltip += "\n" + config.filePath();
+        return tooltip;
+    }
+    case Qt::FontRole:
+        if (config.id() == m_store->selectedId()) {
+            QFont font;
+            font.setBold(true);
+            return font;
+        }
+        return QVariant();
+    case IdRole:
+        return config.id();
+    case SelectedRole:
+        return config.id() == m_store->selectedId();
+    default:
+        return QVariant();
+    }
+}
+
+void ProfileListModel::onProfileUpdated(int row)
+{
+    QModelIndex modelIndex = index(row);
+    emit dataChanged(modelIndex, modelIndex);
+}
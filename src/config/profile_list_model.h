@@ -0,0 +1,30 @@
+#ifndef PROFILE_LIST_MODEL_H
+#define PROFILE_LIST_MODEL_H
+
+#include <QAbstractListModel>
+
+class ProfileStore;
+
+// List model over a ProfileStore, built only from the index metadata
+class ProfileListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Role {
+        IdRole = Qt::UserRole + 1,
+        SelectedRole
+    };
+
+    explicit ProfileListModel(ProfileStore *store, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private slots:
+    void onProfileUpdated(int row);
+
+private:
+    ProfileStore *m_store;
+};
+
+#endif // PROFILE_LIST_MODEL_H
@@ -0,0 +1,309 @@
+#include "profile_store.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+
+#include "config_validator.h"
+#include "settings_store.h"
+
+namespace {
+
+const int kIndexVersion = 1;
+const int kSaveDelay = 200;
+
+QJsonObject toJson(const Config &config)
+{
+    QJsonObject object;
+    object.insert("id", config.id());
+    object.insert("name", config.name());
+    object.insert("filePath", config.filePath());
+    object.insert("hash", config.hash());
+    object.insert("size", config.size());
+    object.insert("outboundCount", config.outboundCount());
+    if (config.lastUsed().isValid())
+        object.insert("lastUsed", config.lastUsed().toString(Qt::ISODate));
+    object.insert("lastLatency", config.lastLatency());
+    if (!config.coreVersion().isEmpty())
+        object.insert("coreVersion", config.coreVersion());
+    return object;
+}
+
+Config fromJson(const QJsonObject &object)
+{
+    Config config(object.value("id").toString(), object.value("filePath").toString(),
+                  object.value("name").toString());
+    config.setHash(object.value("hash").toString());
+    config.setSize(object.value("size").toInteger());
+    config.setOutboundCount(object.value("outboundCount").toInt());
+    config.setLastUsed(QDateTime::fromString(object.value("lastUsed").toString(), Qt::ISODate));
+    config.setLastLatency(object.value("lastLatency").toInt(-1));
+    config.setCoreVersion(object.value("coreVersion").toString());
+    return config;
+}
+
+} // namespace
+
+ProfileStore::ProfileStore(QObject *parent)
+    : QObject{parent}
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(appDataPath);
+    m_indexFilePath = appDataPath + "/profiles.json";
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(kSaveDelay);
+    connect(m_saveTimer, &QTimer::timeout, this, &ProfileStore::sync);
+
+    if (QFile::exists(m_indexFilePath)) {
+        load();
+    } else {
+        migrateFromSettings();
+    }
+}
+
+ProfileStore::~ProfileStore()
+{
+    if (m_saveTimer->isActive())
+        sync();
+}
+
+int ProfileStore::count() const
+{
+    return m_profiles.size();
+}
+
+const Config &ProfileStore::at(int index) const
+{
+    return m_profiles.at(index);
+}
+
+int ProfileStore::indexOf(const QString &id) const
+{
+    return m_positions.value(id, -1);
+}
+
+bool ProfileStore::contains(const QString &id) const
+{
+    return m_positions.contains(id);
+}
+
+Config ProfileStore::profile(const QString &id) const
+{
+    int index = indexOf(id);
+    return index >= 0 ? m_profiles.at(index) : Config(QString(), QString(), QString());
+}
+
+QString ProfileStore::selectedId() const
+{
+    return m_selectedId;
+}
+
+void ProfileStore::setSelectedId(const QString &id)
+{
+    if (m_selectedId == id)
+        return;
+    int previous = indexOf(m_selectedId);
+    m_selectedId = id;
+    scheduleSave();
+    if (previous >= 0)
+        emit profileUpdated(previous);
+    if (indexOf(id) >= 0)
+        emit profileUpdated(indexOf(id));
+}
+
+QString ProfileStore::add(const QString &filePath, const QString &name)
+{
+    Config config(filePath, name);
+    readMetadata(config);
+    m_profiles.append(config);
+    m_positions.insert(config.id(), m_profiles.size() - 1);
+    if (m_selectedId.isEmpty())
+        m_selectedId = config.id();
+    scheduleSave();
+    emit profilesChanged();
+    return config.id();
+}
+
+void ProfileStore::update(const QString &id, const QString &filePath, const QString &name)
+{
+    int index = indexOf(id);
+    if (index < 0)
+        return;
+    Config &config = m_profiles[index];
+    config.setFilePath(filePath);
+    config.setName(name);
+    readMetadata(config);
+    scheduleSave();
+    emit profileUpdated(index);
+}
+
+void ProfileStore::remove(const QString &id)
+{
+    int index = indexOf(id);
+    if (index < 0)
+        return;
+    m_profiles.removeAt(index);
+    m_positions.remove(id);
+    rebuildPositions(index);
+    if (m_selectedId == id) {
+        // Select the neighbour, the same way the old list did
+        int next = qMin(index, m_profiles.size() - 1);
+        m_selectedId = next >= 0 ? m_profiles.at(next).id() : QString();
+    }
+    scheduleSave();
+    emit profilesChanged();
+}
+
+void ProfileStore::clear()
+{
+    m_profiles.clear();
+    m_positions.clear();
+    m_selectedId.clear();
+    scheduleSave();
+    emit profilesChanged();
+}
+
+void ProfileStore::updateMetadata(const QString &id, const ConfigValidationResult &result)
+{
+    int index = indexOf(id);
+    if (index < 0 || !result.valid)
+        return;
+    Config &config = m_profiles[index];
+    config.setHash(QString::fromLatin1(result.hash.toHex()));
+    config.setSize(QFileInfo(config.filePath()).size());
+    config.setOutboundCount(result.config.value("outbounds").toArray().size());
+    scheduleSave();
+    emit profileUpdated(index);
+}
+
+void ProfileStore::markUsed(const QString &id)
+{
+    int index = indexOf(id);
+    if (index < 0)
+        return;
+    m_profiles[index].setLastUsed(QDateTime::currentDateTime());
+    scheduleSave();
+    emit profileUpdated(index);
+}
+
+void ProfileStore::setLastLatency(const QString &id, int latency)
+{
+    int index = indexOf(id);
+    if (index < 0)
+        return;
+    m_profiles[index].setLastLatency(latency);
+    scheduleSave();
+    emit profileUpdated(index);
+}
+
+void ProfileStore::setCoreVersion(const QString &id, const QString &version)
+{
+    int index = indexOf(id);
+    if (index < 0 || m_profiles.at(index).coreVersion() == version)
+        return;
+    m_profiles[index].setCoreVersion(version);
+    scheduleSave();
+    emit profileUpdated(index);
+}
+
+QByteArray ProfileStore::content(const QString &id) const
+{
+    QFile file(profile(id).filePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
+
+void ProfileStore::sync()
+{
+    m_saveTimer->stop();
+
+    QJsonArray profiles;
+    for (const Config &config : std::as_const(m_profiles))
+        profiles.append(toJson(config));
+
+    QJsonObject index;
+    index.insert("version", kIndexVersion);
+    index.insert("selected", m_selectedId);
+    index.insert("profiles", profiles);
+
+    QSaveFile file(m_indexFilePath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(index).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
+
+void ProfileStore::load()
+{
+    QFile file(m_indexFilePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QJsonObject index = QJsonDocument::fromJson(file.readAll()).object();
+    const QJsonArray profiles = index.value("profiles").toArray();
+    m_profiles.reserve(profiles.size());
+    for (const QJsonValue &value : profiles) {
+        Config config = fromJson(value.toObject());
+        if (config.id().isEmpty() || m_positions.contains(config.id()))
+            continue;
+        m_positions.insert(config.id(), m_profiles.size());
+        m_profiles.append(config);
+    }
+    m_selectedId = index.value("selected").toString();
+    if (!m_positions.contains(m_selectedId))
+        m_selectedId = m_profiles.isEmpty() ? QString() : m_profiles.first().id();
+}
+
+void ProfileStore::migrateFromSettings()
+{
+    SettingsStore *store = SettingsStore::instance();
+    int size = store->value("Config/size").toInt();
+    int selectedIndex = store->value("configIndex").toInt();
+    for (int i = 1; i <= size; ++i) {
+        Config config(store->value(QString("Config/%1/filePath").arg(i)).toString(),
+                      store->value(QString("Config/%1/name").arg(i)).toString());
+        readMetadata(config);
+        m_positions.insert(config.id(), m_profiles.size());
+        m_profiles.append(config);
+    }
+    if (selectedIndex >= 0 && selectedIndex < m_profiles.size())
+        m_selectedId = m_profiles.at(selectedIndex).id();
+    else if (!m_profiles.isEmpty())
+        m_selectedId = m_profiles.first().id();
+
+    sync();
+    store->remove("Config");
+}
+
+void ProfileStore::readMetadata(Config &config) const
+{
+    QFile file(config.filePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    QByteArray content = file.readAll();
+    config.setSize(content.size());
+    config.setHash(QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Sha256).toHex()));
+    config.setOutboundCount(QJsonDocument::fromJson(content).object().value("outbounds").toArray().size());
+}
+
+void ProfileStore::rebuildPositions(int from)
+{
+    for (int i = from; i < m_profiles.size(); ++i)
+        m_positions.insert(m_profiles.at(i).id(), i);
+}
+
+void ProfileStore::scheduleSave()
+{
+    if (!m_saveTimer->isActive())
+        m_saveTimer->start();
+}
@@ -0,0 +1,74 @@
+#ifndef PROFILE_STORE_H
+#define PROFILE_STORE_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+#include "config.h"
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+struct ConfigValidationResult;
+
+// Local profiles with stable ids. Names, paths and metadata live in an
+// index file (AppData/profiles.json), so listing and switching never
+// opens the profile files; their content is read only when asked for.
+class ProfileStore : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ProfileStore(QObject *parent = nullptr);
+    ~ProfileStore();
+
+    int count() const;
+    // Display order
+    const Config &at(int index) const;
+    // -1 if the id is unknown
+    int indexOf(const QString &id) const;
+    bool contains(const QString &id) const;
+    Config profile(const QString &id) const;
+
+    QString selectedId() const;
+    void setSelectedId(const QString &id);
+
+    // Reads the file once to fill in the metadata, returns the new id
+    QString add(const QString &filePath, const QString &name);
+    void update(const QString &id, const QString &filePath, const QString &name);
+    void remove(const QString &id);
+    void clear();
+
+    // Refresh metadata from a validation of the profile's file
+    void updateMetadata(const QString &id, const ConfigValidationResult &result);
+    void markUsed(const QString &id);
+    void setLastLatency(const QString &id, int latency);
+    void setCoreVersion(const QString &id, const QString &version);
+
+    // Loads the profile file on demand
+    QByteArray content(const QString &id) const;
+
+    // Write pending index changes now
+    void sync();
+
+signals:
+    void profilesChanged();
+    void profileUpdated(int index);
+
+private:
+    void load();
+    // One time import of the profile list kept in settings by older versions
+    void migrateFromSettings();
+    void readMetadata(Config &config) const;
+    void rebuildPositions(int from = 0);
+    void scheduleSave();
+
+    QString m_indexFilePath;
+    QList<Config> m_profiles;
+    QHash<QString, int> m_positions;
+    QString m_selectedId;
+    QTimer *m_saveTimer;
+};
+
+#endif // PROFILE_STORE_H
@@ -0,0 +1,564 @@
+#include "route_evaluator.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QQueue>
+#include <QSet>
+#include <QUrl>
+#include <QtConcurrent>
+
+#include <array>
+
+namespace {
+
+const int kMaxRuleDepth = 16;
+
+// Parts of a rule that say what to do, not what to match
+const QSet<QString> kActionKeys = {
+    "type", "mode", "outbound", "action", "override_address", "override_port", "network_strategy",
+    "fallback_delay", "udp_disable_domain_unmapping", "udp_connect", "udp_timeout", "method",
+    "no_drop", "sniffer", "timeout", "server", "strategy"};
+
+// Strings or numbers, alone or in an array
+QStringList toStringList(const QJsonValue &value)
+{
+    QStringList values;
+    const QJsonArray array = value.isArray() ? value.toArray() : QJsonArray{value};
+    for (const QJsonValue &item : array) {
+        if (item.isDouble())
+            values.append(QString::number(item.toInteger()));
+        else if (item.isString())
+            values.append(item.toString());
+    }
+    return values;
+}
+
+QString normalizeDomain(const QString &domain)
+{
+    QString result = domain.trimmed().toLower();
+    while (result.endsWith('.'))
+        result.chop(1);
+    return result;
+}
+
+// Address bytes in network order, 4 for IPv4 and 16 for IPv6
+int addressBits(const QHostAddress &address, std::array<quint8, 16> *bytes)
+{
+    bool isIpv4 = false;
+    quint32 ipv4 = address.toIPv4Address(&isIpv4);
+    if (isIpv4) {
+        for (int i = 0; i < 4; ++i)
+            (*bytes)[i] = quint8(ipv4 >> (24 - 8 * i));
+        return 32;
+    }
+    Q_IPV6ADDR ipv6 = address.toIPv6Address();
+    for (int i = 0; i < 16; ++i)
+        (*bytes)[i] = ipv6[i];
+    return 128;
+}
+
+int bitAt(const std::array<quint8, 16> &bytes, int index)
+{
+    return (bytes[index / 8] >> (7 - index % 8)) & 1;
+}
+
+bool isPrivateAddress(const QHostAddress &address)
+{
+    return address.isPrivateUse() || address.isLoopback() || address.isLinkLocal();
+}
+
+} // namespace
+
+RouteEvaluator::RouteEvaluator(const QJsonObject &config)
+{
+    m_trie.append(TrieNode());
+    m_keywords.append(KeywordState());
+    m_radix[0].append(RadixNode());
+    m_radix[1].append(RadixNode());
+
+    QJsonObject route = config.value("route").toObject();
+    const QJsonArray ruleSets = route.value("rule_set").toArray();
+    for (const QJsonValue &value : ruleSets) {
+        QJsonObject ruleSet = value.toObject();
+        m_ruleSets.insert(ruleSet.value("tag").toString(), ruleSet);
+    }
+
+    const QJsonArray rules = route.value("rules").toArray();
+    for (const QJsonValue &value : rules) {
+        QJsonObject object = value.toObject();
+        Rule rule;
+        QStringList fields;
+        rule.node = addRule(object, 0, &rule.unsupported, &fields);
+        rule.action = object.value("action").toString("route");
+        rule.outbound = object.value("outbound").toString();
+        rule.description = fields.join(", ");
+        m_rules.append(rule);
+    }
+    buildKeywordAutomaton();
+
+    // Without route.final the first outbound takes the rest, and without
+    // outbounds sing-box connects directly
+    m_final = route.value("final").toString();
+    QJsonArray outbounds = config.value("outbounds").toArray();
+    if (m_final.isEmpty() && !outbounds.isEmpty())
+        m_final = outbounds.first().toObject().value("tag").toString();
+    if (m_final.isEmpty())
+        m_final = "direct";
+}
+
+RouteEvaluator::~RouteEvaluator() = default;
+
+RouteQuery RouteEvaluator::parseQuery(const QString &input)
+{
+    RouteQuery query;
+    QString text = input.trimmed();
+    QString host;
+
+    if (text.contains("://")) {
+        QUrl url(text);
+        QString scheme = url.scheme().toLower();
+        int defaultPort = scheme == "https" ? 443 : scheme == "http" ? 80 : 0;
+        if (scheme == "udp")
+            query.network = "udp";
+        host = url.host();
+        query.port = url.port(defaultPort);
+    } else if (text.startsWith('[')) {
+        qsizetype close = text.indexOf(']');
+        host = text.mid(1, close - 1);
+        if (close >= 0 && text.mid(close + 1).startsWith(':'))
+            query.port = text.mid(close + 2).toInt();
+    } else if (text.count(':') == 1) {
+        host = text.section(':', 0, 0);
+        query.port = text.section(':', 1).toInt();
+    } else {
+        host = text;
+    }
+
+    QHostAddress address;
+    if (address.setAddress(host))
+        query.address = address;
+    else
+        query.domain = normalizeDomain(host);
+    return query;
+}
+
+RouteMatch RouteEvaluator::evaluate(const RouteQuery &query) const
+{
+    RouteMatch match;
+    Hits hits(m_leaves.size(), 0);
+    collectHits(query, &hits);
+
+    for (int i = 0; i < m_rules.size(); ++i) {
+        const Rule &rule = m_rules.at(i);
+        if (!rule.unsupported.isEmpty()) {
+            match.skippedRules.append(i);
+            continue;
+        }
+        if (!matchesNode(rule.node, query, hits))
+            continue;
+        // These change the connection and go on to the next rule
+        if (rule.action == "sniff" || rule.action == "resolve" || rule.action == "route-options")
+            continue;
+        match.ruleIndex = i;
+        match.outbound = rule.action == "route" ? rule.outbound : rule.action;
+        return match;
+    }
+    match.outbound = m_final;
+    return match;
+}
+
+RouteMatch RouteEvaluator::evaluate(const QString &input) const
+{
+    return evaluate(parseQuery(input));
+}
+
+QList<RouteMatch> RouteEvaluator::evaluateAll(const QStringList &inputs) const
+{
+    return QtConcurrent::blockingMapped<QList<RouteMatch>>(inputs, [this](const QString &input) {
+        return evaluate(input);
+    });
+}
+
+int RouteEvaluator::ruleCount() const
+{
+    return m_rules.size();
+}
+
+QString RouteEvaluator::describeRule(int ruleIndex) const
+{
+    if (ruleIndex < 0 || ruleIndex >= m_rules.size())
+        return QString("final");
+    const Rule &rule = m_rules.at(ruleIndex);
+    if (!rule.unsupported.isEmpty())
+        return QString("%1, not evaluated: %2").arg(rule.description, rule.unsupported.join(", "));
+    return rule.description;
+}
+
+QString RouteEvaluator::finalOutbound() const
+{
+    return m_final;
+}
+
+int RouteEvaluator::addRule(const QJsonObject &rule, int depth, QStringList *unsupported,
+                            QStringList *fields)
+{
+    Node node;
+    if (rule.value("type").toString() == "logical") {
+        QString mode = rule.value("mode").toString("and");
+        node.type = mode == "or" ? Node::Or : Node::And;
+        node.invert = rule.value("invert").toBool();
+        const QJsonArray children = rule.value("rules").toArray();
+        fields->append(QString("%1 of %2 rules").arg(mode).arg(children.size()));
+        if (depth >= kMaxRuleDepth) {
+            unsupported->append(QString("nesting"));
+        } else {
+            QStringList childFields;
+            for (const QJsonValue &child : children)
+                node.children.append(addRule(child.toObject(), depth + 1, unsupported, &childFields));
+        }
+    } else {
+        node.leaf = addLeaf(rule, unsupported, fields);
+    }
+    m_nodes.append(node);
+    return m_nodes.size() - 1;
+}
+
+int RouteEvaluator::addLeaf(const QJsonObject &rule, QStringList *unsupported, QStringList *fields)
+{
+    // Reserved first, rule-sets add their own leaves while this one is built
+    int index = m_leaves.size();
+    m_leaves.append(Leaf());
+    Leaf leaf;
+
+    for (auto it = rule.constBegin(); it != rule.constEnd(); ++it) {
+        const QString &key = it.key();
+        if (kActionKeys.contains(key))
+            continue;
+        QStringList values = toStringList(it.value());
+
+        if (key == "domain") {
+            for (const QString &value : values)
+                m_exactDomains[normalizeDomain(value)].append(index);
+            leaf.hasDestination = true;
+        } else if (key == "domain_suffix") {
+            for (const QString &value : values)
+                addSuffix(value, index);
+            leaf.hasDestination = true;
+        } else if (key == "domain_keyword") {
+            for (const QString &value : values)
+                addKeyword(value, index);
+            leaf.hasDestination = true;
+        } else if (key == "domain_regex") {
+            // The core uses Go's RE2, a pattern PCRE cannot read keeps the
+            // rule from being evaluated rather than never matching
+            for (const QString &value : values) {
+                QRegularExpression regex(value);
+                if (!regex.isValid()) {
+                    unsupported->append(QString("domain_regex %1").arg(value));
+                    continue;
+                }
+                leaf.regexes.append(m_regexes.size());
+                m_regexes.append(regex);
+            }
+            leaf.hasDestination = true;
+        } else if (key == "ip_cidr") {
+            for (const QString &value : values)
+                addCidr(value, index);
+            leaf.hasDestination = true;
+        } else if (key == "ip_is_private") {
+            leaf.privateAddress = it.value().toBool();
+            leaf.hasDestination = true;
+        } else if (key == "port") {
+            for (const QString &value : values)
+                leaf.ports.append(qMakePair(value.toInt(), value.toInt()));
+        } else if (key == "port_range") {
+            // "1000:2000", ":3000" or "4000:"
+            for (const QString &value : values) {
+                QString from = value.section(':', 0, 0);
+                QString to = value.section(':', 1);
+                leaf.ports.append(qMakePair(from.isEmpty() ? 0 : from.toInt(),
+                                            to.isEmpty() ? 65535 : to.toInt()));
+            }
+        } else if (key == "network") {
+            leaf.networks = values;
+        } else if (key == "rule_set") {
+            for (const QString &value : values)
+                leaf.ruleSets.append(ruleSetNodes(value, unsupported));
+        } else if (key == "invert") {
+            leaf.invert = it.value().toBool();
+            continue;
+        } else {
+            unsupported->append(key);
+        }
+
+        if (values.size() > 1)
+            fields->append(QString("%1 (%2)").arg(key).arg(values.size()));
+        else
+            fields->append(key);
+    }
+
+    m_leaves[index] = leaf;
+    return index;
+}
+
+QList<int> RouteEvaluator::ruleSetNodes(const QString &tag, QStringList *unsupported)
+{
+    auto cached = m_ruleSetNodes.constFind(tag);
+    if (cached != m_ruleSetNodes.constEnd()) {
+        unsupported->append(m_ruleSetUnsupported.value(tag));
+        return *cached;
+    }
+
+    QJsonObject ruleSet = m_ruleSets.value(tag);
+    QString type = ruleSet.value("type").toString();
+    QJsonArray rules;
+    QStringList setUnsupported;
+    if (type == "inline") {
+        rules = ruleSet.value("rules").toArray();
+    } else if (type == "local" && ruleSet.value("format").toString() != "binary"
+               && !ruleSet.value("path").toString().endsWith(".srs")) {
+        QFile file(ruleSet.value("path").toString());
+        if (file.open(QIODevice::ReadOnly))
+            rules = QJsonDocument::fromJson(file.readAll()).object().value("rules").toArray();
+        else
+            setUnsupported.append(QString("rule_set %1").arg(tag));
+    } else {
+        setUnsupported.append(QString("rule_set %1").arg(tag));
+    }
+
+    // Cached before the rules are added, a set never refers to itself
+    QList<int> nodes;
+    m_ruleSetNodes.insert(tag, nodes);
+    QStringList fields;
+    for (const QJsonValue &value : std::as_const(rules))
+        nodes.append(addRule(value.toObject(), 1, &setUnsupported, &fields));
+    m_ruleSetNodes.insert(tag, nodes);
+    m_ruleSetUnsupported.insert(tag, setUnsupported);
+    unsupported->append(setUnsupported);
+    return nodes;
+}
+
+void RouteEvaluator::addSuffix(const QString &suffix, int leaf)
+{
+    QString value = normalizeDomain(suffix);
+    bool subdomainsOnly = value.startsWith('.');
+    const QStringList labels = value.split('.', Qt::SkipEmptyParts);
+
+    int node = 0;
+    for (qsizetype i = labels.size() - 1; i >= 0; --i) {
+        int child = m_trie.at(node).children.value(labels.at(i), -1);
+        if (child < 0) {
+            child = m_trie.size();
+            m_trie.append(TrieNode());
+            m_trie[node].children.insert(labels.at(i), child);
+        }
+        node = child;
+    }
+    if (subdomainsOnly)
+        m_trie[node].subdomainLeaves.append(leaf);
+    else
+        m_trie[node].suffixLeaves.append(leaf);
+}
+
+void RouteEvaluator::addKeyword(const QString &keyword, int leaf)
+{
+    QString value = keyword.toLower();
+    if (value.isEmpty())
+        return;
+
+    int state = 0;
+    for (QChar c : std::as_const(value)) {
+        int next = m_keywords.at(state).next.value(c, -1);
+        if (next < 0) {
+            next = m_keywords.size();
+            m_keywords.append(KeywordState());
+            m_keywords[state].next.insert(c, next);
+        }
+        state = next;
+    }
+    m_keywords[state].leaves.append(leaf);
+}
+
+void RouteEvaluator::addCidr(const QString &cidr, int leaf)
+{
+    QString value = cidr.trimmed();
+    QPair<QHostAddress, int> subnet;
+    if (value.contains('/')) {
+        subnet = QHostAddress::parseSubnet(value);
+    } else {
+        subnet.first = QHostAddress(value);
+        subnet.second = subnet.first.protocol() == QAbstractSocket::IPv4Protocol ? 32 : 128;
+    }
+    if (subnet.first.isNull() || subnet.second < 0)
+        return;
+
+    std::array<quint8, 16> bytes{};
+    int bits = addressBits(subnet.first, &bytes);
+    QList<RadixNode> &tree = m_radix[bits == 32 ? 0 : 1];
+    int length = qMin(subnet.second, bits);
+
+    int node = 0;
+    for (int i = 0; i < length; ++i) {
+        int bit = bitAt(bytes, i);
+        int child = tree.at(node).children[bit];
+        if (child < 0) {
+            child = tree.size();
+            tree.append(RadixNode());
+            tree[node].children[bit] = child;
+        }
+        node = child;
+    }
+    tree[node].leaves.append(leaf);
+}
+
+void RouteEvaluator::buildKeywordAutomaton()
+{
+    // Breadth first, so the failure state of a parent is always known
+    QQueue<int> queue;
+    for (auto it = m_keywords.at(0).next.constBegin(); it != m_keywords.at(0).next.constEnd(); ++it) {
+        m_keywords[it.value()].fail = 0;
+        queue.enqueue(it.value());
+    }
+    while (!queue.isEmpty()) {
+        int state = queue.dequeue();
+        const QHash<QChar, int> next = m_keywords.at(state).next;
+        for (auto it = next.constBegin(); it != next.constEnd(); ++it) {
+            int fail = m_keywords.at(state).fail;
+            while (fail != 0 && !m_keywords.at(fail).next.contains(it.key()))
+                fail = m_keywords.at(fail).fail;
+            int target = m_keywords.at(fail).next.value(it.key(), 0);
+            m_keywords[it.value()].fail = target;
+            // A state also reports every keyword that ends in its suffix
+            m_keywords[it.value()].leaves.append(m_keywords.at(target).leaves);
+            queue.enqueue(it.value());
+        }
+    }
+}
+
+void RouteEvaluator::collectHits(const RouteQuery &query, Hits *hits) const
+{
+    auto mark = [hits](const QList<int> &leaves) {
+        for (int leaf : leaves)
+            (*hits)[leaf] = 1;
+    };
+
+    if (!query.domain.isEmpty()) {
+        auto exact = m_exactDomains.constFind(query.domain);
+        if (exact != m_exactDomains.constEnd())
+            mark(*exact);
+
+        const QStringList labels = query.domain.split('.', Qt::SkipEmptyParts);
+        int node = 0;
+        for (qsizetype i = labels.size() - 1; i >= 0; --i) {
+            node = m_trie.at(node).children.value(labels.at(i), -1);
+            if (node < 0)
+                break;
+            mark(m_trie.at(node).suffixLeaves);
+            if (i > 0)
+                mark(m_trie.at(node).subdomainLeaves);
+        }
+
+        if (m_keywords.size() > 1) {
+            int state = 0;
+            for (QChar c : query.domain) {
+                while (state != 0 && !m_keywords.at(state).next.contains(c))
+                    state = m_keywords.at(state).fail;
+                state = m_keywords.at(state).next.value(c, 0);
+                mark(m_keywords.at(state).leaves);
+            }
+        }
+    }
+
+    if (!query.address.isNull()) {
+        std::array<quint8, 16> bytes{};
+        int bits = addressBits(query.address, &bytes);
+        const QList<RadixNode> &tree = m_radix[bits == 32 ? 0 : 1];
+        int node = 0;
+        for (int i = 0;; ++i) {
+            mark(tree.at(node).leaves);
+            if (i == bits)
+                break;
+            node = tree.at(node).children[bitAt(bytes, i)];
+            if (node < 0)
+                break;
+        }
+    }
+}
+
+bool RouteEvaluator::matchesNode(int nodeIndex, const RouteQuery &query, const Hits &hits) const
+{
+    const Node &node = m_nodes.at(nodeIndex);
+    bool matched;
+    if (node.type == Node::LeafNode) {
+        matched = matchesLeaf(node.leaf, query, hits);
+    } else if (node.type == Node::And) {
+        matched = true;
+        for (int child : node.children) {
+            if (!matchesNode(child, query, hits)) {
+                matched = false;
+                break;
+            }
+        }
+    } else {
+        matched = false;
+        for (int child : node.children) {
+            if (matchesNode(child, query, hits)) {
+                matched = true;
+                break;
+            }
+        }
+    }
+    return matched != node.invert;
+}
+
+bool RouteEvaluator::matchesLeaf(int leafIndex, const RouteQuery &query, const Hits &hits) const
+{
+    const Leaf &leaf = m_leaves.at(leafIndex);
+    bool matched = true;
+
+    // Domain and address fields of a rule match if any of them does
+    if (leaf.hasDestination) {
+        bool destination = hits[leafIndex];
+        if (!destination && leaf.privateAddress && !query.address.isNull())
+            destination = isPrivateAddress(query.address);
+        if (!destination && !query.domain.isEmpty()) {
+            for (int regex : leaf.regexes) {
+                if (m_regexes.at(regex).match(query.domain).hasMatch()) {
+                    destination = true;
+                    break;
+                }
+            }
+        }
+        matched = destination;
+    }
+
+    if (matched && !leaf.ports.isEmpty()) {
+        matched = false;
+        for (const QPair<int, int> &range : leaf.ports) {
+            if (query.port >= range.first && query.port <= range.second && query.port > 0) {
+                matched = true;
+                break;
+            }
+        }
+    }
+
+    if (matched && !leaf.networks.isEmpty())
+        matched = leaf.networks.contains(query.network);
+
+    // Like the core, the rule_set item matches if any rule of any of the
+    // listed sets does
+    if (matched && !leaf.ruleSets.isEmpty()) {
+        matched = false;
+        for (qsizetype i = 0; !matched && i < leaf.ruleSets.size(); ++i) {
+            for (int node : leaf.ruleSets.at(i)) {
+                if (matchesNode(node, query, hits)) {
+                    matched = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    return matched != leaf.invert;
+}
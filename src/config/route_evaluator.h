@@ -0,0 +1,148 @@
+#ifndef ROUTE_EVALUATOR_H
+#define ROUTE_EVALUATOR_H
+
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QList>
+#include <QRegularExpression>
+#include <QStringList>
+
+#include <vector>
+
+struct RouteQuery
+{
+    QString domain;
+    QHostAddress address;
+    int port = 0;
+    QString network = "tcp";
+};
+
+struct RouteMatch
+{
+    // Index into route.rules, -1 when route.final applies
+    int ruleIndex = -1;
+    QString outbound;
+    // Rules before the match that need facts an offline query does not
+    // have, e.g. inbound or process name; the core might stop at one
+    QList<int> skippedRules;
+};
+
+// Answers "which rule and outbound handle this destination" from
+// route.rules without the core or the network. All rules, including the
+// headless rules of inline and local source rule-sets, are compiled into
+// shared matchers: a label trie for domain and domain_suffix, one
+// Aho-Corasick automaton for domain_keyword and a binary radix tree per
+// address family for ip_cidr. A query walks each of them once and then
+// checks the rules in order. Domains are not resolved, so ip_cidr only
+// matches IP queries. Evaluation is read only and safe from any thread.
+class RouteEvaluator
+{
+public:
+    explicit RouteEvaluator(const QJsonObject &config);
+    ~RouteEvaluator();
+
+    // Accepts a domain, an IP, host:port, [v6]:port or a URL
+    static RouteQuery parseQuery(const QString &input);
+
+    RouteMatch evaluate(const RouteQuery &query) const;
+    RouteMatch evaluate(const QString &input) const;
+    // Splits the inputs over all cores
+    QList<RouteMatch> evaluateAll(const QStringList &inputs) const;
+
+    int ruleCount() const;
+    // Short description of a rule, e.g. "domain_suffix (1200), port (2)"
+    QString describeRule(int ruleIndex) const;
+    QString finalOutbound() const;
+
+private:
+    struct Leaf
+    {
+        bool invert = false;
+        bool hasDestination = false;
+        bool privateAddress = false;
+        QList<int> regexes;
+        QList<QPair<int, int>> ports;
+        QStringList networks;
+        // Rule nodes of each rule-set the rule lists
+        QList<QList<int>> ruleSets;
+    };
+
+    struct Node
+    {
+        enum Type {
+            LeafNode,
+            And,
+            Or
+        };
+        Type type = LeafNode;
+        int leaf = -1;
+        bool invert = false;
+        QList<int> children;
+    };
+
+    struct Rule
+    {
+        int node = -1;
+        QString action;
+        QString outbound;
+        QStringList unsupported;
+        QString description;
+    };
+
+    struct TrieNode
+    {
+        QHash<QString, int> children;
+        // domain_suffix "example.com" matches the node and below,
+        // ".example.com" only below
+        QList<int> suffixLeaves;
+        QList<int> subdomainLeaves;
+    };
+
+    struct KeywordState
+    {
+        QHash<QChar, int> next;
+        int fail = 0;
+        QList<int> leaves;
+    };
+
+    struct RadixNode
+    {
+        int children[2] = {-1, -1};
+        QList<int> leaves;
+    };
+
+    // Per query scratch: which leaves have their destination group matched
+    using Hits = std::vector<char>;
+
+    int addRule(const QJsonObject &rule, int depth, QStringList *unsupported, QStringList *fields);
+    int addLeaf(const QJsonObject &rule, QStringList *unsupported, QStringList *fields);
+    QList<int> ruleSetNodes(const QString &tag, QStringList *unsupported);
+    void addSuffix(const QString &suffix, int leaf);
+    void addKeyword(const QString &keyword, int leaf);
+    void addCidr(const QString &cidr, int leaf);
+    void buildKeywordAutomaton();
+
+    void collectHits(const RouteQuery &query, Hits *hits) const;
+    bool matchesNode(int node, const RouteQuery &query, const Hits &hits) const;
+    bool matchesLeaf(int leaf, const RouteQuery &query, const Hits &hits) const;
+
+    QHash<QString, QJsonObject> m_ruleSets;
+    QHash<QString, QList<int>> m_ruleSetNodes;
+    // What keeps rules using a rule-set from being evaluated, e.g. a
+    // remote or binary set, which cannot be read offline
+    QHash<QString, QStringList> m_ruleSetUnsupported;
+
+    QList<Leaf> m_leaves;
+    QList<Node> m_nodes;
+    QList<Rule> m_rules;
+    QString m_final;
+
+    QHash<QString, QList<int>> m_exactDomains;
+    QList<TrieNode> m_trie;
+    QList<KeywordState> m_keywords;
+    QList<RadixNode> m_radix[2];
+    QList<QRegularExpression> m_regexes;
+};
+
+#endif // ROUTE_EVALUATOR_H
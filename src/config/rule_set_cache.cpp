@@ -0,0 +1,508 @@
+#include "rule_set_cache.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+#include <QTimer>
+#include <QUrl>
+#include <QtConcurrent>
+
+namespace {
+
+const qint64 kDefaultUpdateInterval = 24 * 60 * 60;
+// How often stale entries are looked for
+const int kRefreshCheckInterval = 60 * 60 * 1000;
+
+// Inline rules with fewer list entries are cheap enough to parse
+const qsizetype kMinInlineEntries = 1000;
+const int kCompileTimeout = 60000;
+// Files only other profiles use are kept this long
+const qint64 kUnusedRetention = 30LL * 24 * 60 * 60;
+const char kInlinePrefix[] = "inline-";
+
+// Match fields a headless rule in a rule-set can hold
+const QSet<QString> kHeadlessKeys = {
+    "domain", "domain_suffix", "domain_keyword", "domain_regex", "ip_cidr", "source_ip_cidr",
+    "port", "port_range", "source_port", "source_port_range", "network", "process_name",
+    "process_path", "package_name", "invert"};
+// Everything of a route rule that is not a match field
+const QSet<QString> kActionKeys = {
+    "type", "outbound", "action", "override_address", "override_port", "network_strategy",
+    "fallback_delay", "udp_disable_domain_unmapping", "udp_connect", "udp_timeout", "method",
+    "no_drop", "sniffer", "timeout", "server", "strategy"};
+
+const char kDefaultGeoIpUrl[] = "https://github.com/SagerNet/sing-geoip/releases/latest/download/geoip.db";
+const char kDefaultGeositeUrl[] = "https://github.com/SagerNet/sing-geosite/releases/latest/download/geosite.db";
+
+// Parses Go style durations as used by sing-box, e.g. "1d", "12h", "1h30m"
+qint64 parseDuration(const QString &text, qint64 fallback)
+{
+    static const QRegularExpression part("(\\d+)([dhms])");
+    qint64 seconds = 0;
+    auto it = part.globalMatch(text);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        qint64 value = match.captured(1).toLongLong();
+        QChar unit = match.captured(2).at(0);
+        if (unit == 'd')
+            seconds += value * 24 * 60 * 60;
+        else if (unit == 'h')
+            seconds += value * 60 * 60;
+        else if (unit == 'm')
+            seconds += value * 60;
+        else
+            seconds += value;
+    }
+    return seconds > 0 ? seconds : fallback;
+}
+
+QString suffixForRuleSet(const QJsonObject &ruleSet)
+{
+    QString format = ruleSet.value("format").toString();
+    if (format == "source")
+        return "json";
+    if (format == "binary")
+        return "srs";
+    return QFileInfo(QUrl(ruleSet.value("url").toString()).path()).suffix() == "json" ? "json" : "srs";
+}
+
+// Runs on a worker, the core needs a few seconds for large lists
+bool compileRuleSet(const QString &corePath, const QJsonObject &headlessRule, const QString &outputPath)
+{
+    QTemporaryFile source(QDir::tempPath() + "/qsing-box-rule-XXXXXX.json");
+    if (!source.open())
+        return false;
+    QJsonObject document;
+    document.insert("version", 1);
+    document.insert("rules", QJsonArray{headlessRule});
+    source.write(QJsonDocument(document).toJson(QJsonDocument::Compact));
+    source.close();
+
+    // Renamed into place once complete, the launch config never sees a partial file
+    QString partialPath = outputPath + ".part";
+    QProcess process;
+    process.start(corePath, QStringList() << "rule-set" << "compile" << "--output" << partialPath
+                                          << source.fileName());
+    if (!process.waitForFinished(kCompileTimeout)) {
+        process.kill();
+        process.waitForFinished();
+        QFile::remove(partialPath);
+        return false;
+    }
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        QFile::remove(partialPath);
+        return false;
+    }
+    QFile::remove(outputPath);
+    return QFile::rename(partialPath, outputPath);
+}
+
+} // namespace
+
+RuleSetCache::RuleSetCache(QObject *parent)
+    : QObject{parent}
+{
+    m_directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/rule-set";
+    QDir().mkpath(m_directory);
+    loadIndex();
+
+    m_networkManager = new QNetworkAccessManager(this);
+
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setInterval(kRefreshCheckInterval);
+    connect(m_refreshTimer, &QTimer::timeout, this, &RuleSetCache::refreshStale);
+    m_refreshTimer->start();
+}
+
+void RuleSetCache::refresh(const QJsonObject &config)
+{
+    m_config = config;
+    prune();
+    refreshStale();
+    compileInlineRules();
+}
+
+void RuleSetCache::setCorePath(const QString &corePath)
+{
+    if (m_corePath == corePath)
+        return;
+    m_corePath = corePath;
+    // Another core may support what this one refused
+    m_failedCompiles.clear();
+    compileInlineRules();
+}
+
+QJsonObject RuleSetCache::rewrite(const QJsonObject &config) const
+{
+    QJsonObject route = config.value("route").toObject();
+    if (route.isEmpty())
+        return config;
+
+    QJsonArray ruleSets = route.value("rule_set").toArray();
+    for (int i = 0; i < ruleSets.size(); ++i) {
+        QJsonObject ruleSet = ruleSets.at(i).toObject();
+        if (ruleSet.value("type").toString() != "remote")
+            continue;
+        QString path = cachedFilePath(ruleSet.value("url").toString());
+        if (path.isEmpty())
+            continue;
+        QJsonObject local;
+        local.insert("type", "local");
+        local.insert("tag", ruleSet.value("tag"));
+        local.insert("format", suffixForRuleSet(ruleSet) == "json" ? "source" : "binary");
+        local.insert("path", path);
+        ruleSets.replace(i, local);
+    }
+
+    // Large inline rules match through their compiled rule-set instead
+    QJsonArray rules = route.value("rules").toArray();
+    QSet<QString> inlineTags;
+    bool rulesChanged = false;
+    for (int i = 0; i < rules.size(); ++i) {
+        QJsonObject rule = rules.at(i).toObject();
+        QJsonObject headlessRule = compilableRule(rule);
+        if (headlessRule.isEmpty())
+            continue;
+        QString hash = ruleHash(headlessRule);
+        QString path = compiledFilePath(hash);
+        if (!QFile::exists(path))
+            continue;
+
+        QString tag = "qsing-box-" + QString(kInlinePrefix) + hash.left(16);
+        for (auto it = headlessRule.constBegin(); it != headlessRule.constEnd(); ++it)
+            rule.remove(it.key());
+        rule.insert("rule_set", tag);
+        rules.replace(i, rule);
+        rulesChanged = true;
+
+        // Identical rules share one rule-set
+        if (!inlineTags.contains(tag)) {
+            inlineTags.insert(tag);
+            QJsonObject local;
+            local.insert("type", "local");
+            local.insert("tag", tag);
+            local.insert("format", "binary");
+            local.insert("path", path);
+            ruleSets.append(local);
+        }
+    }
+    if (rulesChanged)
+        route.insert("rules", rules);
+    if (route.contains("rule_set") || !ruleSets.isEmpty())
+        route.insert("rule_set", ruleSets);
+
+    // Legacy geo databases, the core only downloads them when "path" is missing
+    for (const QString &key : {QString("geoip"), QString("geosite")}) {
+        if (!route.contains(key))
+            continue;
+        QJsonObject geo = route.value(key).toObject();
+        if (geo.contains("path"))
+            continue;
+        QString url = geo.value("download_url").toString(
+            key == "geoip" ? kDefaultGeoIpUrl : kDefaultGeositeUrl);
+        QString path = cachedFilePath(url);
+        if (!path.isEmpty()) {
+            geo.insert("path", path);
+            route.insert(key, geo);
+        }
+    }
+
+    QJsonObject result = config;
+    result.insert("route", route);
+    return result;
+}
+
+QString RuleSetCache::cacheDirectory() const
+{
+    return m_directory;
+}
+
+void RuleSetCache::refreshStale()
+{
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    for (const Source &source : collectSources(m_config)) {
+        auto it = m_entries.constFind(source.url);
+        bool missing = it == m_entries.constEnd() || cachedFilePath(source.url).isEmpty();
+        if (missing || it->checkedAt.secsTo(now) >= source.updateInterval)
+            fetch(source);
+    }
+}
+
+void RuleSetCache::fetch(const Source &source)
+{
+    if (m_pendingUrls.contains(source.url))
+        return;
+
+    QNetworkRequest request{QUrl(source.url)};
+    request.setHeader(QNetworkRequest::UserAgentHeader, "qsing-box/" + QString(PROJECT_VERSION));
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    auto it = m_entries.constFind(source.url);
+    if (it != m_entries.constEnd() && !cachedFilePath(source.url).isEmpty()) {
+        // Conditional request, an unchanged rule-set costs one empty 304
+        if (!it->etag.isEmpty())
+            request.setRawHeader("If-None-Match", it->etag);
+        if (!it->lastModified.isEmpty())
+            request.setRawHeader("If-Modified-Since", it->lastModified);
+    }
+
+    m_pendingUrls.insert(source.url);
+    QNetworkReply *reply = m_networkManager->get(request);
+    reply->setProperty("url", source.url);
+    reply->setProperty("suffix", source.suffix);
+    connect(reply, &QNetworkReply::finished, this, &RuleSetCache::onDownloadFinished);
+}
+
+void RuleSetCache::onDownloadFinished()
+{
+    auto *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply)
+        return;
+    reply->deleteLater();
+
+    QString url = reply->property("url").toString();
+    m_pendingUrls.remove(url);
+    if (reply->error() != QNetworkReply::NoError) {
+        // Keep the old file, the next check retries
+        return;
+    }
+
+    Entry &entry = m_entries[url];
+    entry.checkedAt = QDateTime::currentDateTimeUtc();
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 304) {
+        saveIndex();
+        return;
+    }
+
+    QByteArray content = reply->readAll();
+    if (content.isEmpty()) {
+        saveIndex();
+        return;
+    }
+
+    QString hash = QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Sha256).toHex());
+    QString suffix = reply->property("suffix").toString();
+    QString filePath = QString("%1/%2").arg(m_directory, cacheFileName(url, suffix));
+    bool changed = entry.hash != hash || entry.suffix != suffix || !QFile::exists(filePath);
+    if (changed) {
+        // Renamed over the old file, the core never reads a partial one
+        QSaveFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size() || !file.commit())
+            return;
+    }
+
+    entry.hash = hash;
+    entry.suffix = suffix;
+    entry.etag = reply->rawHeader("ETag");
+    entry.lastModified = reply->rawHeader("Last-Modified");
+    saveIndex();
+
+    if (changed) {
+        prune();
+        emit cacheUpdated();
+    }
+}
+
+QList<RuleSetCache::Source> RuleSetCache::collectSources(const QJsonObject &config)
+{
+    QList<Source> sources;
+    QJsonObject route = config.value("route").toObject();
+
+    for (const QJsonValue &value : route.value("rule_set").toArray()) {
+        QJsonObject ruleSet = value.toObject();
+        QString url = ruleSet.value("url").toString();
+        if (ruleSet.value("type").toString() != "remote" || url.isEmpty())
+            continue;
+        sources.append(Source{url, suffixForRuleSet(ruleSet),
+                              parseDuration(ruleSet.value("update_interval").toString(),
+                                            kDefaultUpdateInterval)});
+    }
+
+    for (const QString &key : {QString("geoip"), QString("geosite")}) {
+        if (!route.contains(key))
+            continue;
+        QJsonObject geo = route.value(key).toObject();
+        if (geo.contains("path"))
+            continue;
+        QString url = geo.value("download_url").toString(
+            key == "geoip" ? kDefaultGeoIpUrl : kDefaultGeositeUrl);
+        sources.append(Source{url, "db", kDefaultUpdateInterval});
+    }
+
+    return sources;
+}
+
+QJsonObject RuleSetCache::compilableRule(const QJsonObject &rule)
+{
+    // Logical rules and rules with fields a rule-set cannot hold stay inline
+    if (rule.value("type").toString("default") != "default")
+        return QJsonObject();
+
+    QJsonObject headlessRule;
+    qsizetype entries = 0;
+    for (auto it = rule.constBegin(); it != rule.constEnd(); ++it) {
+        if (kActionKeys.contains(it.key()))
+            continue;
+        if (!kHeadlessKeys.contains(it.key()))
+            return QJsonObject();
+        headlessRule.insert(it.key(), it.value());
+        if (it.value().isArray())
+            entries += it.value().toArray().size();
+    }
+    return entries >= kMinInlineEntries ? headlessRule : QJsonObject();
+}
+
+QString RuleSetCache::ruleHash(const QJsonObject &headlessRule)
+{
+    // Object keys are sorted, equal rules always serialize the same
+    QByteArray content = QJsonDocument(headlessRule).toJson(QJsonDocument::Compact);
+    return QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Sha256).toHex());
+}
+
+QString RuleSetCache::compiledFilePath(const QString &hash) const
+{
+    return QString("%1/%2%3.srs").arg(m_directory, QString(kInlinePrefix), hash);
+}
+
+void RuleSetCache::compileInlineRules()
+{
+    if (m_corePath.isEmpty())
+        return;
+
+    const QJsonArray rules = m_config.value("route").toObject().value("rules").toArray();
+    for (const QJsonValue &value : rules) {
+        QJsonObject headlessRule = compilableRule(value.toObject());
+        if (headlessRule.isEmpty())
+            continue;
+        QString hash = ruleHash(headlessRule);
+        QString path = compiledFilePath(hash);
+        if (QFile::exists(path) || m_compiling.contains(hash) || m_failedCompiles.contains(hash))
+            continue;
+
+        m_compiling.insert(hash);
+        auto *watcher = new QFutureWatcher<bool>(this);
+        connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, hash]() {
+            watcher->deleteLater();
+            m_compiling.remove(hash);
+            if (!watcher->result()) {
+                // Older cores have no rule-set support, the rule stays inline
+                m_failedCompiles.insert(hash);
+                return;
+            }
+            prune();
+            emit cacheUpdated();
+        });
+        watcher->setFuture(QtConcurrent::run(compileRuleSet, m_corePath, headlessRule, path));
+    }
+}
+
+QString RuleSetCache::cachedFilePath(const QString &url) const
+{
+    auto it = m_entries.constFind(url);
+    if (it == m_entries.constEnd() || it->hash.isEmpty())
+        return QString();
+    QString filePath = QString("%1/%2").arg(m_directory, cacheFileName(url, it->suffix));
+    return QFile::exists(filePath) ? filePath : QString();
+}
+
+QString RuleSetCache::cacheFileName(const QString &url, const QString &suffix)
+{
+    // Named after the URL, not the content, so updates keep the path
+    QByteArray hash = QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha256).toHex();
+    return QString("%1.%2").arg(QString::fromLatin1(hash), suffix);
+}
+
+void RuleSetCache::loadIndex()
+{
+    QFile file(m_directory + "/index.json");
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QJsonObject entries = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        QJsonObject object = it.value().toObject();
+        Entry entry;
+        entry.hash = object.value("hash").toString();
+        entry.suffix = object.value("suffix").toString();
+        entry.etag = object.value("etag").toString().toLatin1();
+        entry.lastModified = object.value("lastModified").toString().toLatin1();
+        entry.checkedAt = QDateTime::fromString(object.value("checkedAt").toString(), Qt::ISODate);
+        m_entries.insert(it.key(), entry);
+    }
+}
+
+void RuleSetCache::saveIndex() const
+{
+    QJsonObject entries;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        QJsonObject object;
+        object.insert("hash", it->hash);
+        object.insert("suffix", it->suffix);
+        object.insert("etag", QString::fromLatin1(it->etag));
+        object.insert("lastModified", QString::fromLatin1(it->lastModified));
+        object.insert("checkedAt", it->checkedAt.toString(Qt::ISODate));
+        entries.insert(it.key(), object);
+    }
+
+    QSaveFile file(m_directory + "/index.json");
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(entries).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
+
+void RuleSetCache::prune()
+{
+    // Forget URLs the current config does not use and no other profile
+    // has asked for in a long time
+    QSet<QString> used;
+    for (const Source &source : collectSources(m_config))
+        used.insert(source.url);
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    bool forgotten = false;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (!used.contains(it.key()) && it->checkedAt.secsTo(now) >= kUnusedRetention) {
+            it = m_entries.erase(it);
+            forgotten = true;
+        } else {
+            ++it;
+        }
+    }
+    if (forgotten)
+        saveIndex();
+
+    // Remove cached files no URL points to anymore
+    QSet<QString> referenced;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+        referenced.insert(cacheFileName(it.key(), it->suffix));
+    const QJsonArray rules = m_config.value("route").toObject().value("rules").toArray();
+    for (const QJsonValue &value : rules) {
+        QJsonObject headlessRule = compilableRule(value.toObject());
+        if (!headlessRule.isEmpty())
+            referenced.insert(QFileInfo(compiledFilePath(ruleHash(headlessRule))).fileName());
+    }
+
+    QDir dir(m_directory);
+    const QFileInfoList files = dir.entryInfoList({"*.srs", "*.json", "*.db", "*.part"}, QDir::Files);
+    for (const QFileInfo &file : files) {
+        QString fileName = file.fileName();
+        if (fileName == "index.json" || referenced.contains(fileName))
+            continue;
+        // Compiled inline rules are not in the index, another profile may use them
+        if (fileName.startsWith(kInlinePrefix) && file.lastModified().secsTo(now) < kUnusedRetention)
+            continue;
+        dir.remove(fileName);
+    }
+}
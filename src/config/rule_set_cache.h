@@ -0,0 +1,92 @@
+#ifndef RULE_SET_CACHE_H
+#define RULE_SET_CACHE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QSet>
+
+QT_BEGIN_NAMESPACE
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+QT_END_NAMESPACE
+
+// Local cache of the remote rule-sets and the legacy GeoIP/Geosite
+// databases referenced by a config. Entries are refreshed in the
+// background with conditional requests, and the launch config points the
+// core at the cached files so it never downloads at startup. Every URL
+// keeps one file that refreshes replace atomically, so the path in the
+// launch config stays valid and the core reloads local rule-sets in place.
+// Large inline rules of route.rules are compiled into binary rule-sets
+// with "sing-box rule-set compile" and referenced the same way.
+class RuleSetCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit RuleSetCache(QObject *parent = nullptr);
+
+    // Remember the config and fetch whatever is missing or stale
+    void refresh(const QJsonObject &config);
+    // Replace remote entries that have a cached file with local ones
+    QJsonObject rewrite(const QJsonObject &config) const;
+
+    // Core used to compile inline rules, nothing is compiled without one
+    void setCorePath(const QString &corePath);
+
+    QString cacheDirectory() const;
+
+signals:
+    // A cached file was added or replaced
+    void cacheUpdated();
+
+private slots:
+    void onDownloadFinished();
+    void refreshStale();
+
+private:
+    struct Entry
+    {
+        // SHA-256 of the content, to tell whether a download changed it
+        QString hash;
+        QString suffix;
+        QByteArray etag;
+        QByteArray lastModified;
+        QDateTime checkedAt;
+    };
+
+    struct Source
+    {
+        QString url;
+        QString suffix;
+        // Seconds between conditional refreshes
+        qint64 updateInterval;
+    };
+
+    static QList<Source> collectSources(const QJsonObject &config);
+    static QJsonObject compilableRule(const QJsonObject &rule);
+    static QString ruleHash(const QJsonObject &headlessRule);
+    QString compiledFilePath(const QString &hash) const;
+    void compileInlineRules();
+    QString cachedFilePath(const QString &url) const;
+    static QString cacheFileName(const QString &url, const QString &suffix);
+    void fetch(const Source &source);
+    void loadIndex();
+    void saveIndex() const;
+    void prune();
+
+    QString m_directory;
+    QHash<QString, Entry> m_entries;
+    QSet<QString> m_pendingUrls;
+    QJsonObject m_config;
+    QString m_corePath;
+    // Hashes being compiled and those the core refused
+    QSet<QString> m_compiling;
+    QSet<QString> m_failedCompiles;
+
+    QNetworkAccessManager *m_networkManager;
+    QTimer *m_refreshTimer;
+};
+
+#endif // RULE_SET_CACHE_H
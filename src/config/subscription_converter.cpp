@@ -0,0 +1,970 @@
+#include "subscription_converter.h"
+
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QList>
+#include <QRegularExpression>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QVariant>
+#include <QtConcurrent>
+
+namespace {
+
+const int kMaxWarnings = 20;
+const quint16 kMixedPort = 2080;
+const char kTestUrl[] = "https://www.gstatic.com/generate_204";
+
+// Everything the supported protocols need, filled from a link or a Clash
+// proxy and then written out as one sing-box outbound
+struct Node
+{
+    QString type; // sing-box outbound type
+    QString tag;
+    QString server;
+    int port = 0;
+
+    QString uuid;
+    QString password;
+    QString method; // shadowsocks method or vmess security
+    int alterId = 0;
+    QString flow;
+    QString plugin;
+    QString pluginOptions;
+    QString obfs;
+    QString obfsPassword;
+    int upMbps = 0;
+    int downMbps = 0;
+
+    bool tls = false;
+    QString serverName;
+    bool insecure = false;
+    QStringList alpn;
+    QString fingerprint;
+    QString realityKey;
+    QString shortId;
+
+    QString network; // ws, grpc, http, httpupgrade, empty for raw TCP
+    QString host;
+    QString path;
+    QString serviceName;
+};
+
+struct Converted
+{
+    QJsonObject outbound;
+    QString error;
+};
+
+QJsonObject toOutbound(const Node &node, QString *error)
+{
+    if (node.server.isEmpty() || node.port <= 0 || node.port > 65535) {
+        *error = QString("%1: missing server or port").arg(node.tag);
+        return QJsonObject();
+    }
+
+    QJsonObject outbound;
+    outbound.insert("type", node.type);
+    outbound.insert("tag", node.tag);
+    outbound.insert("server", node.server);
+    outbound.insert("server_port", node.port);
+
+    if (node.type == "shadowsocks") {
+        if (node.method.isEmpty()) {
+            *error = QString("%1: missing cipher").arg(node.tag);
+            return QJsonObject();
+        }
+        outbound.insert("method", node.method);
+        outbound.insert("password", node.password);
+        if (!node.plugin.isEmpty()) {
+            outbound.insert("plugin", node.plugin);
+            outbound.insert("plugin_opts", node.pluginOptions);
+        }
+        return outbound;
+    }
+
+    if (node.type == "vmess" || node.type == "vless") {
+        if (node.uuid.isEmpty()) {
+            *error = QString("%1: missing uuid").arg(node.tag);
+            return QJsonObject();
+        }
+        outbound.insert("uuid", node.uuid);
+        if (node.type == "vmess") {
+            outbound.insert("security", node.method.isEmpty() ? QString("auto") : node.method);
+            outbound.insert("alter_id", node.alterId);
+        } else {
+            if (!node.flow.isEmpty())
+                outbound.insert("flow", node.flow);
+            outbound.insert("packet_encoding", "xudp");
+        }
+    } else if (node.type == "trojan" || node.type == "hysteria2") {
+        outbound.insert("password", node.password);
+    }
+
+    if (node.type == "hysteria2") {
+        if (!node.obfs.isEmpty()) {
+            QJsonObject obfs;
+            obfs.insert("type", node.obfs);
+            obfs.insert("password", node.obfsPassword);
+            outbound.insert("obfs", obfs);
+        }
+        if (node.upMbps > 0)
+            outbound.insert("up_mbps", node.upMbps);
+        if (node.downMbps > 0)
+            outbound.insert("down_mbps", node.downMbps);
+    }
+
+    if (node.tls || node.type == "hysteria2") {
+        QJsonObject tls;
+        tls.insert("enabled", true);
+        if (!node.serverName.isEmpty())
+            tls.insert("server_name", node.serverName);
+        if (node.insecure)
+            tls.insert("insecure", true);
+        if (!node.alpn.isEmpty())
+            tls.insert("alpn", QJsonArray::fromStringList(node.alpn));
+        // Reality only works with a uTLS fingerprint
+        QString fingerprint = node.fingerprint;
+        if (fingerprint.isEmpty() && !node.realityKey.isEmpty())
+            fingerprint = "chrome";
+        if (!fingerprint.isEmpty()) {
+            QJsonObject utls;
+            utls.insert("enabled", true);
+            utls.insert("fingerprint", fingerprint);
+            tls.insert("utls", utls);
+        }
+        if (!node.realityKey.isEmpty()) {
+            QJsonObject reality;
+            reality.insert("enabled", true);
+            reality.insert("public_key", node.realityKey);
+            reality.insert("short_id", node.shortId);
+            tls.insert("reality", reality);
+        }
+        outbound.insert("tls", tls);
+    }
+
+    if (node.network.isEmpty() || node.network == "tcp" || node.type == "hysteria2")
+        return outbound;
+
+    QJsonObject transport;
+    if (node.network == "ws") {
+        transport.insert("type", "ws");
+        QString path = node.path.isEmpty() ? QString("/") : node.path;
+        // Early data is announced in the path by Xray style links, ?ed=2048
+        QUrl pathUrl(path);
+        QUrlQuery pathQuery(pathUrl);
+        if (pathQuery.hasQueryItem("ed")) {
+            transport.insert("max_early_data", pathQuery.queryItemValue("ed").toInt());
+            transport.insert("early_data_header_name", "Sec-WebSocket-Protocol");
+            pathQuery.removeQueryItem("ed");
+            pathUrl.setQuery(pathQuery);
+            path = pathUrl.toString();
+        }
+        transport.insert("path", path);
+        if (!node.host.isEmpty())
+            transport.insert("headers", QJsonObject{{"Host", node.host}});
+    } else if (node.network == "grpc") {
+        transport.insert("type", "grpc");
+        transport.insert("service_name", node.serviceName.isEmpty() ? node.path : node.serviceName);
+    } else if (node.network == "http" || node.network == "h2") {
+        transport.insert("type", "http");
+        if (!node.host.isEmpty())
+            transport.insert("host", QJsonArray::fromStringList(node.host.split(',', Qt::SkipEmptyParts)));
+        if (!node.path.isEmpty())
+            transport.insert("path", node.path);
+    } else if (node.network == "httpupgrade") {
+        transport.insert("type", "httpupgrade");
+        if (!node.host.isEmpty())
+            transport.insert("host", node.host);
+        if (!node.path.isEmpty())
+            transport.insert("path", node.path);
+    } else {
+        *error = QString("%1: transport \"%2\" is not supported").arg(node.tag, node.network);
+        return QJsonObject();
+    }
+    outbound.insert("transport", transport);
+    return outbound;
+}
+
+// Standard or URL-safe alphabet, padding optional, whitespace ignored
+QByteArray decodeBase64(const QByteArray &data, bool *ok)
+{
+    QByteArray compact;
+    compact.reserve(data.size());
+    for (char c : data) {
+        if (c == '-')
+            compact.append('+');
+        else if (c == '_')
+            compact.append('/');
+        else if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+            compact.append(c);
+    }
+    while (compact.size() % 4 != 0)
+        compact.append('=');
+    auto result = QByteArray::fromBase64Encoding(compact, QByteArray::AbortOnBase64DecodingErrors);
+    *ok = bool(result);
+    return result.decoded;
+}
+
+bool isTrue(const QString &value)
+{
+    return value == "1" || value.compare("true", Qt::CaseInsensitive) == 0;
+}
+
+int parseMbps(const QString &value)
+{
+    static const QRegularExpression number("^\\s*(\\d+)");
+    QRegularExpressionMatch match = number.match(value);
+    return match.hasMatch() ? match.captured(1).toInt() : 0;
+}
+
+QString defaultTag(const Node &node)
+{
+    return QString("%1:%2").arg(node.server).arg(node.port);
+}
+
+// Query parameters shared by vless://, trojan:// and hysteria2:// links
+void readLinkQuery(const QUrlQuery &query, Node *node)
+{
+    auto value = [&query](const char *key) {
+        return query.queryItemValue(key, QUrl::FullyDecoded);
+    };
+    QString security = value("security");
+    if (security == "tls" || security == "reality" || security == "xtls")
+        node->tls = true;
+    else if (security == "none")
+        node->tls = false;
+    node->serverName = value("sni");
+    if (node->serverName.isEmpty())
+        node->serverName = value("peer");
+    node->insecure = isTrue(value("allowInsecure")) || isTrue(value("insecure"));
+    node->alpn = value("alpn").split(',', Qt::SkipEmptyParts);
+    node->fingerprint = value("fp");
+    node->realityKey = value("pbk");
+    node->shortId = value("sid");
+    node->flow = value("flow");
+
+    node->network = value("type");
+    node->host = value("host");
+    node->path = value("path");
+    node->serviceName = value("serviceName");
+    if (node->network == "grpc" && node->serviceName.isEmpty())
+        node->serviceName = node->path;
+}
+
+bool parseVmess(const QString &link, Node *node, QString *error)
+{
+    bool ok = false;
+    QByteArray json = decodeBase64(link.mid(8).toLatin1(), &ok);
+    QJsonObject object = ok ? QJsonDocument::fromJson(json).object() : QJsonObject();
+    if (object.isEmpty()) {
+        *error = "vmess link is not base64 JSON";
+        return false;
+    }
+    // Numbers appear both as strings and numbers
+    auto text = [&object](const char *key) {
+        QJsonValue value = object.value(key);
+        return value.isDouble() ? QString::number(value.toInteger()) : value.toString();
+    };
+
+    node->type = "vmess";
+    node->tag = text("ps");
+    node->server = text("add");
+    node->port = text("port").toInt();
+    node->uuid = text("id");
+    node->alterId = text("aid").toInt();
+    node->method = text("scy");
+    node->tls = text("tls") == "tls";
+    node->serverName = text("sni");
+    if (node->serverName.isEmpty() && node->tls)
+        node->serverName = text("host");
+    node->alpn = text("alpn").split(',', Qt::SkipEmptyParts);
+    node->fingerprint = text("fp");
+    node->insecure = isTrue(text("allowInsecure"));
+    node->network = text("net");
+    node->host = text("host");
+    node->path = text("path");
+    // "type" is the header type of raw TCP, http camouflage is not supported
+    if (node->network == "tcp" && text("type") == "http") {
+        *error = QString("%1: http header camouflage is not supported").arg(node->tag);
+        return false;
+    }
+    if (node->network == "grpc")
+        node->serviceName = node->path;
+    return true;
+}
+
+bool parseShadowsocks(const QString &link, Node *node, QString *error)
+{
+    node->type = "shadowsocks";
+    QString rest = link.mid(5);
+    qsizetype hash = rest.indexOf('#');
+    if (hash >= 0) {
+        node->tag = QUrl::fromPercentEncoding(rest.mid(hash + 1).toUtf8());
+        rest.truncate(hash);
+    }
+
+    // Legacy form: the whole method:password@host:port is base64
+    if (!rest.contains('@')) {
+        qsizetype query = rest.indexOf('?');
+        bool ok = false;
+        QByteArray decoded = decodeBase64(rest.left(query >= 0 ? query : rest.size()).toLatin1(), &ok);
+        if (!ok || !decoded.contains('@')) {
+            *error = "ss link cannot be decoded";
+            return false;
+        }
+        rest = QString::fromUtf8(decoded) + (query >= 0 ? rest.mid(query) : QString());
+    }
+
+    QUrl url("ss://" + rest);
+    if (!url.isValid() || url.host().isEmpty()) {
+        *error = "ss link has no server";
+        return false;
+    }
+    node->server = url.host();
+    node->port = url.port();
+
+    // SIP002 puts base64(method:password) in the user info, 2022 methods
+    // use percent encoded method:password instead
+    QString userInfo = url.userInfo(QUrl::FullyDecoded);
+    if (!userInfo.contains(':')) {
+        bool ok = false;
+        userInfo = QString::fromUtf8(decodeBase64(url.userName(QUrl::FullyEncoded).toLatin1(), &ok));
+    }
+    qsizetype colon = userInfo.indexOf(':');
+    if (colon < 0) {
+        *error = "ss link has no method and password";
+        return false;
+    }
+    node->method = userInfo.left(colon);
+    node->password = userInfo.mid(colon + 1);
+
+    QString plugin = QUrlQuery(url).queryItemValue("plugin", QUrl::FullyDecoded);
+    if (!plugin.isEmpty()) {
+        qsizetype semicolon = plugin.indexOf(';');
+        node->plugin = plugin.left(semicolon);
+        node->pluginOptions = semicolon >= 0 ? plugin.mid(semicolon + 1) : QString();
+        if (node->plugin == "simple-obfs")
+            node->plugin = "obfs-local";
+    }
+    return true;
+}
+
+bool parseUrlLink(const QString &link, const QString &scheme, Node *node, QString *error)
+{
+    QUrl url(link);
+    if (!url.isValid() || url.host().isEmpty()) {
+        *error = QString("%1 link has no server").arg(scheme);
+        return false;
+    }
+    node->server = url.host();
+    node->port = url.port(443);
+    node->tag = url.fragment(QUrl::FullyDecoded);
+    readLinkQuery(QUrlQuery(url), node);
+
+    if (scheme == "vless") {
+        node->type = "vless";
+        node->uuid = url.userName(QUrl::FullyDecoded);
+    } else if (scheme == "trojan") {
+        node->type = "trojan";
+        node->password = url.userName(QUrl::FullyDecoded);
+        // TLS unless explicitly turned off
+        node->tls = QUrlQuery(url).queryItemValue("security") != "none";
+    } else if (scheme == "vmess") {
+        // The AEAD form of newer clients, laid out like vless
+        node->type = "vmess";
+        node->uuid = url.userName(QUrl::FullyDecoded);
+        node->method = QUrlQuery(url).queryItemValue("encryption");
+    } else {
+        node->type = "hysteria2";
+        node->password = url.userInfo(QUrl::FullyDecoded);
+        QUrlQuery query(url);
+        node->obfs = query.queryItemValue("obfs");
+        node->obfsPassword = query.queryItemValue("obfs-password", QUrl::FullyDecoded);
+        node->upMbps = parseMbps(query.queryItemValue("upmbps"));
+        node->downMbps = parseMbps(query.queryItemValue("downmbps"));
+        node->network.clear();
+    }
+    return true;
+}
+
+Converted convertLink(const QString &link)
+{
+    Converted converted;
+    Node node;
+    QString scheme = link.section("://", 0, 0).toLower();
+    bool ok = false;
+    if (scheme == "vmess" && !link.contains('@'))
+        ok = parseVmess(link, &node, &converted.error);
+    else if (scheme == "ss")
+        ok = parseShadowsocks(link, &node, &converted.error);
+    else if (scheme == "vless" || scheme == "trojan" || scheme == "vmess")
+        ok = parseUrlLink(link, scheme, &node, &converted.error);
+    else if (scheme == "hysteria2" || scheme == "hy2")
+        ok = parseUrlLink(link, "hysteria2", &node, &converted.error);
+    else
+        converted.error = QString("unsupported link type %1://").arg(scheme);
+    if (!ok)
+        return converted;
+
+    if (node.tag.trimmed().isEmpty())
+        node.tag = defaultTag(node);
+    node.tag = node.tag.trimmed();
+    converted.outbound = toOutbound(node, &converted.error);
+    return converted;
+}
+
+// Subset of YAML that covers Clash proxy lists: block mappings and
+// sequences, flow mappings and sequences, quoted and plain scalars.
+// Anchors, tags and multi-document files are not supported.
+class YamlReader
+{
+public:
+    struct Line
+    {
+        int indent;
+        QString text;
+    };
+
+    explicit YamlReader(const QList<Line> &lines)
+        : m_lines(lines)
+    {}
+
+    QVariant read()
+    {
+        m_index = 0;
+        if (m_lines.isEmpty())
+            return QVariant();
+        return readBlock(m_lines.first().indent);
+    }
+
+    // Non-empty lines of the top level key, comments removed
+    static QList<Line> section(const QString &text, const QString &key)
+    {
+        QList<Line> lines;
+        bool inside = false;
+        const QStringList rawLines = text.split('\n');
+        for (const QString &rawLine : rawLines) {
+            QString line = stripComment(rawLine);
+            if (line.trimmed().isEmpty())
+                continue;
+            int indent = 0;
+            while (indent < line.size() && line.at(indent) == ' ')
+                ++indent;
+            if (indent == 0 && !line.startsWith('-')) {
+                if (inside)
+                    break;
+                inside = line.startsWith(key + ":");
+                continue;
+            }
+            if (inside)
+                lines.append(Line{indent, line.mid(indent).trimmed()});
+        }
+        return lines;
+    }
+
+private:
+    static QString stripComment(const QString &line)
+    {
+        QChar quote;
+        for (qsizetype i = 0; i < line.size(); ++i) {
+            QChar c = line.at(i);
+            if (!quote.isNull()) {
+                if (c == quote)
+                    quote = QChar();
+            } else if (c == '"' || c == '\'') {
+                quote = c;
+            } else if (c == '#' && (i == 0 || line.at(i - 1).isSpace())) {
+                return line.left(i);
+            }
+        }
+        return line;
+    }
+
+    static bool isSequenceItem(const QString &text)
+    {
+        return text == "-" || text.startsWith("- ");
+    }
+
+    // Position of the ':' that ends a mapping key, -1 if there is none
+    static qsizetype keyEnd(const QString &text)
+    {
+        QChar quote;
+        for (qsizetype i = 0; i < text.size(); ++i) {
+            QChar c = text.at(i);
+            if (!quote.isNull()) {
+                if (c == quote)
+                    quote = QChar();
+            } else if ((c == '"' || c == '\'') && i == 0) {
+                quote = c;
+            } else if (c == '{' || c == '[') {
+                return -1;
+            } else if (c == ':' && (i + 1 == text.size() || text.at(i + 1) == ' ')) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static QString unquote(const QString &text)
+    {
+        QString value = text.trimmed();
+        if (value.size() >= 2 && value.startsWith('\'') && value.endsWith('\''))
+            return value.mid(1, value.size() - 2).replace("''", "'");
+        if (value.size() >= 2 && value.startsWith('"') && value.endsWith('"')) {
+            QString result;
+            for (qsizetype i = 1; i < value.size() - 1; ++i) {
+                QChar c = value.at(i);
+                if (c == '\\' && i + 1 < value.size() - 1) {
+                    QChar next = value.at(++i);
+                    result += next == 'n' ? QChar('\n') : next == 't' ? QChar('\t') : next;
+                } else {
+                    result += c;
+                }
+            }
+            return result;
+        }
+        return value;
+    }
+
+    static QVariant readScalarOrFlow(const QString &text)
+    {
+        if (text.startsWith('{') || text.startsWith('[')) {
+            qsizetype position = 0;
+            return readFlow(text, &position);
+        }
+        return unquote(text);
+    }
+
+    static void skipSpaces(const QString &text, qsizetype *position)
+    {
+        while (*position < text.size() && text.at(*position).isSpace())
+            ++*position;
+    }
+
+    static QString readFlowScalar(const QString &text, qsizetype *position, bool key)
+    {
+        skipSpaces(text, position);
+        qsizetype start = *position;
+        if (start < text.size() && (text.at(start) == '"' || text.at(start) == '\'')) {
+            QChar quote = text.at(start);
+            qsizetype i = start + 1;
+            while (i < text.size()) {
+                if (text.at(i) == '\\' && quote == '"') {
+                    i += 2;
+                    continue;
+                }
+                if (text.at(i) == quote) {
+                    // '' is an escaped quote in single quoted scalars
+                    if (quote == '\'' && i + 1 < text.size() && text.at(i + 1) == '\'') {
+                        i += 2;
+                        continue;
+                    }
+                    break;
+                }
+                ++i;
+            }
+            *position = qMin(i + 1, text.size());
+            return unquote(text.mid(start, *position - start));
+        }
+        qsizetype i = start;
+        while (i < text.size()) {
+            QChar c = text.at(i);
+            if (c == ',' || c == '}' || c == ']')
+                break;
+            if (key && c == ':' && (i + 1 == text.size() || text.at(i + 1) == ' '))
+                break;
+            ++i;
+        }
+        *position = i;
+        return text.mid(start, i - start).trimmed();
+    }
+
+    static QVariant readFlow(const QString &text, qsizetype *position)
+    {
+        skipSpaces(text, position);
+        if (*position >= text.size())
+            return QVariant();
+
+        QChar open = text.at(*position);
+        if (open != '{' && open != '[')
+            return readFlowScalar(text, position, false);
+        ++*position;
+
+        QVariantMap map;
+        QVariantList list;
+        QChar close = open == '{' ? '}' : ']';
+        while (*position < text.size()) {
+            skipSpaces(text, position);
+            if (*position >= text.size())
+                break;
+            QChar c = text.at(*position);
+            // A stray bracket of the other kind ends the collection too
+            if (c == close || c == '}' || c == ']') {
+                ++*position;
+                break;
+            }
+            if (c == ',') {
+                ++*position;
+                continue;
+            }
+            qsizetype start = *position;
+            if (open == '{') {
+                QString key = readFlowScalar(text, position, true);
+                skipSpaces(text, position);
+                if (*position < text.size() && text.at(*position) == ':')
+                    ++*position;
+                map.insert(key, readFlow(text, position));
+            } else {
+                list.append(readFlow(text, position));
+            }
+            // Malformed input must not keep the loop in place
+            if (*position == start)
+                break;
+        }
+        if (open == '{')
+            return map;
+        return list;
+    }
+
+    QVariant readBlock(int indent)
+    {
+        if (m_index >= m_lines.size())
+            return QVariant();
+        if (isSequenceItem(m_lines.at(m_index).text))
+            return readSequence(indent);
+        return readMapping(indent);
+    }
+
+    QVariant readSequence(int indent)
+    {
+        QVariantList list;
+        while (m_index < m_lines.size() && m_lines.at(m_index).indent == indent
+               && isSequenceItem(m_lines.at(m_index).text)) {
+            QString text = m_lines.at(m_index).text;
+            QString item = text.mid(1).trimmed();
+            if (item.isEmpty()) {
+                ++m_index;
+                if (m_index < m_lines.size() && m_lines.at(m_index).indent > indent)
+                    list.append(readBlock(m_lines.at(m_index).indent));
+                else
+                    list.append(QVariant());
+            } else if (keyEnd(item) >= 0 || isSequenceItem(item)) {
+                // "- key: value" starts a mapping indented to the key
+                int column = indent + text.indexOf(item);
+                m_lines[m_index] = Line{column, item};
+                list.append(readBlock(column));
+            } else {
+                list.append(readScalarOrFlow(item));
+                ++m_index;
+            }
+        }
+        return list;
+    }
+
+    QVariant readMapping(int indent)
+    {
+        QVariantMap map;
+        while (m_index < m_lines.size() && m_lines.at(m_index).indent == indent
+               && !isSequenceItem(m_lines.at(m_index).text)) {
+            QString text = m_lines.at(m_index).text;
+            qsizetype end = keyEnd(text);
+            ++m_index;
+            if (end < 0)
+                continue;
+            QString key = unquote(text.left(end));
+            QString rest = text.mid(end + 1).trimmed();
+
+            if (rest == "|" || rest == ">" || rest == "|-" || rest == ">-") {
+                QStringList parts;
+                while (m_index < m_lines.size() && m_lines.at(m_index).indent > indent)
+                    parts.append(m_lines.at(m_index++).text);
+                map.insert(key, parts.join(rest.startsWith('|') ? "\n" : " "));
+            } else if (!rest.isEmpty()) {
+                map.insert(key, readScalarOrFlow(rest));
+            } else if (m_index < m_lines.size() && m_lines.at(m_index).indent > indent) {
+                map.insert(key, readBlock(m_lines.at(m_index).indent));
+            } else if (m_index < m_lines.size() && m_lines.at(m_index).indent == indent
+                       && isSequenceItem(m_lines.at(m_index).text)) {
+                // Sequences may sit at the indentation of their key
+                map.insert(key, readSequence(indent));
+            } else {
+                map.insert(key, QVariant());
+            }
+        }
+        return map;
+    }
+
+    QList<Line> m_lines;
+    int m_index = 0;
+};
+
+QString firstString(const QVariant &value)
+{
+    if (value.typeId() == QMetaType::QVariantList)
+        return value.toList().value(0).toString();
+    return value.toString();
+}
+
+Converted convertClashProxy(const QVariant &value)
+{
+    Converted converted;
+    QVariantMap proxy = value.toMap();
+    QString type = proxy.value("type").toString();
+
+    Node node;
+    node.tag = proxy.value("name").toString().trimmed();
+    node.server = proxy.value("server").toString();
+    node.port = proxy.value("port").toInt();
+    if (node.tag.isEmpty())
+        node.tag = defaultTag(node);
+
+    node.tls = isTrue(proxy.value("tls").toString());
+    node.serverName = proxy.value("servername").toString();
+    if (node.serverName.isEmpty())
+        node.serverName = proxy.value("sni").toString();
+    node.insecure = isTrue(proxy.value("skip-cert-verify").toString());
+    node.fingerprint = proxy.value("client-fingerprint").toString();
+    const QVariantList alpn = proxy.value("alpn").toList();
+    for (const QVariant &protocol : alpn)
+        node.alpn.append(protocol.toString());
+
+    node.network = proxy.value("network").toString();
+    QVariantMap wsOptions = proxy.value("ws-opts").toMap();
+    QVariantMap h2Options = proxy.value("h2-opts").toMap();
+    QVariantMap httpOptions = proxy.value("http-opts").toMap();
+    if (node.network == "ws") {
+        node.path = wsOptions.value("path").toString();
+        node.host = wsOptions.value("headers").toMap().value("Host").toString();
+        int earlyData = wsOptions.value("max-early-data").toInt();
+        if (earlyData > 0)
+            node.path += QString(node.path.contains('?') ? "&ed=%1" : "?ed=%1").arg(earlyData);
+    } else if (node.network == "h2") {
+        node.path = h2Options.value("path").toString();
+        QStringList hosts;
+        const QVariantList hostList = h2Options.value("host").toList();
+        for (const QVariant &host : hostList)
+            hosts.append(host.toString());
+        node.host = hosts.join(',');
+    } else if (node.network == "http") {
+        node.path = firstString(httpOptions.value("path"));
+        node.host = firstString(httpOptions.value("headers").toMap().value("Host"));
+    } else if (node.network == "grpc") {
+        node.serviceName = proxy.value("grpc-opts").toMap().value("grpc-service-name").toString();
+    }
+
+    if (type == "ss") {
+        node.type = "shadowsocks";
+        node.method = proxy.value("cipher").toString();
+        node.password = proxy.value("password").toString();
+        node.network.clear();
+        QString plugin = proxy.value("plugin").toString();
+        QVariantMap pluginOptions = proxy.value("plugin-opts").toMap();
+        if (plugin == "obfs") {
+            node.plugin = "obfs-local";
+            node.pluginOptions = QString("obfs=%1;obfs-host=%2")
+                                     .arg(pluginOptions.value("mode").toString(),
+                                          pluginOptions.value("host").toString());
+        } else if (plugin == "v2ray-plugin") {
+            QStringList options{"mode=" + pluginOptions.value("mode", "websocket").toString()};
+            if (isTrue(pluginOptions.value("tls").toString()))
+                options.append("tls");
+            if (!pluginOptions.value("host").toString().isEmpty())
+                options.append("host=" + pluginOptions.value("host").toString());
+            if (!pluginOptions.value("path").toString().isEmpty())
+                options.append("path=" + pluginOptions.value("path").toString());
+            node.plugin = "v2ray-plugin";
+            node.pluginOptions = options.join(';');
+        } else if (!plugin.isEmpty()) {
+            converted.error = QString("%1: plugin \"%2\" is not supported").arg(node.tag, plugin);
+            return converted;
+        }
+    } else if (type == "vmess") {
+        node.type = "vmess";
+        node.uuid = proxy.value("uuid").toString();
+        node.alterId = proxy.value("alterId").toInt();
+        node.method = proxy.value("cipher").toString();
+    } else if (type == "vless") {
+        node.type = "vless";
+        node.uuid = proxy.value("uuid").toString();
+        node.flow = proxy.value("flow").toString();
+        QVariantMap reality = proxy.value("reality-opts").toMap();
+        node.realityKey = reality.value("public-key").toString();
+        node.shortId = reality.value("short-id").toString();
+    } else if (type == "trojan") {
+        node.type = "trojan";
+        node.password = proxy.value("password").toString();
+        node.tls = true;
+    } else if (type == "hysteria2") {
+        node.type = "hysteria2";
+        node.password = proxy.value("password").toString();
+        node.obfs = proxy.value("obfs").toString();
+        node.obfsPassword = proxy.value("obfs-password").toString();
+        node.upMbps = parseMbps(proxy.value("up").toString());
+        node.downMbps = parseMbps(proxy.value("down").toString());
+    } else {
+        converted.error = QString("%1: type \"%2\" is not supported").arg(node.tag, type);
+        return converted;
+    }
+
+    converted.outbound = toOutbound(node, &converted.error);
+    return converted;
+}
+
+bool looksLikeLinks(const QByteArray &data)
+{
+    static const QRegularExpression scheme("^(vmess|vless|trojan|ss|hysteria2|hy2)://",
+                                           QRegularExpression::MultilineOption);
+    return scheme.match(QString::fromUtf8(data.left(64 * 1024))).hasMatch();
+}
+
+bool looksLikeClash(const QByteArray &data)
+{
+    return data.startsWith("proxies:") || data.contains("\nproxies:");
+}
+
+QJsonObject buildConfig(const QList<QJsonObject> &nodes)
+{
+    QJsonArray outbounds;
+    QStringList tags;
+    for (const QJsonObject &node : nodes)
+        tags.append(node.value("tag").toString());
+
+    QJsonObject selector;
+    selector.insert("type", "selector");
+    selector.insert("tag", "proxy");
+    selector.insert("outbounds", QJsonArray::fromStringList(QStringList{"auto"} + tags));
+    selector.insert("default", "auto");
+    outbounds.append(selector);
+
+    QJsonObject urltest;
+    urltest.insert("type", "urltest");
+    urltest.insert("tag", "auto");
+    urltest.insert("outbounds", QJsonArray::fromStringList(tags));
+    urltest.insert("url", kTestUrl);
+    outbounds.append(urltest);
+
+    for (const QJsonObject &node : nodes)
+        outbounds.append(node);
+    outbounds.append(QJsonObject{{"type", "direct"}, {"tag", "direct"}});
+
+    QJsonObject inbound;
+    inbound.insert("type", "mixed");
+    inbound.insert("tag", "mixed-in");
+    inbound.insert("listen", "127.0.0.1");
+    inbound.insert("listen_port", kMixedPort);
+    inbound.insert("set_system_proxy", true);
+
+    QJsonObject route;
+    route.insert("rules", QJsonArray{QJsonObject{{"ip_is_private", true}, {"outbound", "direct"}}});
+    route.insert("final", "proxy");
+    route.insert("auto_detect_interface", true);
+
+    QJsonObject config;
+    config.insert("log", QJsonObject{{"level", "info"}});
+    config.insert("inbounds", QJsonArray{inbound});
+    config.insert("outbounds", outbounds);
+    config.insert("route", route);
+    return config;
+}
+
+} // namespace
+
+SubscriptionConverter::Format SubscriptionConverter::detect(const QByteArray &data)
+{
+    QByteArray trimmed = data.trimmed();
+    if (trimmed.startsWith('{'))
+        return SingBox;
+    if (looksLikeLinks(trimmed))
+        return ShareLinks;
+    if (looksLikeClash(trimmed))
+        return ClashYaml;
+
+    bool ok = false;
+    QByteArray decoded = decodeBase64(trimmed, &ok);
+    if (ok && looksLikeLinks(decoded))
+        return ShareLinks;
+    return Unknown;
+}
+
+bool SubscriptionConverter::convert(const QByteArray &data, QByteArray *config, QStringList *warnings,
+                                    QString *error)
+{
+    QByteArray trimmed = data.trimmed();
+    QList<Converted> results;
+
+    switch (detect(trimmed)) {
+    case ShareLinks: {
+        QByteArray text = trimmed;
+        if (!looksLikeLinks(text)) {
+            bool ok = false;
+            text = decodeBase64(trimmed, &ok);
+        }
+        QStringList links;
+        const QList<QByteArray> lines = text.split('\n');
+        for (const QByteArray &line : lines) {
+            QString link = QString::fromUtf8(line.trimmed());
+            if (link.contains("://"))
+                links.append(link);
+        }
+        // Every link is independent, decode them on all cores
+        results = QtConcurrent::blockingMapped<QList<Converted>>(links, convertLink);
+        break;
+    }
+    case ClashYaml: {
+        QVariantList proxies = YamlReader(YamlReader::section(QString::fromUtf8(trimmed), "proxies"))
+                                   .read()
+                                   .toList();
+        results = QtConcurrent::blockingMapped<QList<Converted>>(proxies, convertClashProxy);
+        break;
+    }
+    case SingBox:
+        *config = data;
+        return true;
+    case Unknown:
+        *error = "Unknown subscription format, expected sing-box JSON, share links or Clash YAML";
+        return false;
+    }
+
+    // Tags must be unique, later duplicates get a number. The outbounds
+    // buildConfig() adds are taken already, a node named "proxy" must not
+    // shadow the selector
+    QList<QJsonObject> nodes;
+    QHash<QString, int> tagCounts{{"proxy", 1}, {"auto", 1}, {"direct", 1}};
+    for (Converted &result : results) {
+        if (result.outbound.isEmpty()) {
+            if (warnings->size() < kMaxWarnings)
+                warnings->append(QString("Skipped %1").arg(result.error));
+            continue;
+        }
+        QString tag = result.outbound.value("tag").toString();
+        int count = ++tagCounts[tag];
+        if (count > 1) {
+            while (tagCounts.contains(QString("%1 %2").arg(tag).arg(count)))
+                ++count;
+            tag = QString("%1 %2").arg(tag).arg(count);
+            tagCounts.insert(tag, 1);
+            result.outbound.insert("tag", tag);
+        }
+        nodes.append(result.outbound);
+    }
+    if (nodes.isEmpty()) {
+        *error = results.isEmpty() ? QString("The subscription contains no nodes")
+                                   : QString("No node could be converted: %1").arg(results.first().error);
+        return false;
+    }
+
+    int skipped = results.size() - nodes.size();
+    warnings->prepend(skipped > 0 ? QString("Converted %1 nodes, skipped %2").arg(nodes.size()).arg(skipped)
+                                  : QString("Converted %1 nodes").arg(nodes.size()));
+    *config = QJsonDocument(buildConfig(nodes)).toJson(QJsonDocument::Indented);
+    return true;
+}
+
+QJsonObject SubscriptionConverter::outboundFromLink(const QString &link, QString *error)
+{
+    Converted converted = convertLink(link.trimmed());
+    *error = converted.error;
+    return converted.outbound;
+}
@@ -0,0 +1,34 @@
+#ifndef SUBSCRIPTION_CONVERTER_H
+#define SUBSCRIPTION_CONVERTER_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QStringList>
+
+// Turns subscriptions that are not sing-box JSON into a sing-box config:
+// lists of vmess://, vless://, trojan://, ss:// and hysteria2:// links,
+// plain or base64 encoded as a whole, and the proxies of a Clash YAML
+// file. Nodes are decoded in parallel and put behind a "proxy" selector
+// with an "auto" urltest, on a mixed inbound at 127.0.0.1:2080.
+class SubscriptionConverter
+{
+public:
+    enum Format {
+        SingBox,
+        ShareLinks,
+        ClashYaml,
+        Unknown
+    };
+
+    static Format detect(const QByteArray &data);
+
+    // Safe to call from any thread. Nodes that cannot be converted are
+    // skipped and reported in warnings; false when none is left.
+    static bool convert(const QByteArray &data, QByteArray *config, QStringList *warnings,
+                        QString *error);
+
+    // One sing-box outbound from a share link, empty with error set on failure
+    static QJsonObject outboundFromLink(const QString &link, QString *error);
+};
+
+#endif // SUBSCRIPTION_CONVERTER_H
@@ -0,0 +1,101 @@
+#include "connection_stats_dialog.h"
+#include "ui_connection_stats_dialog.h"
+
+#include <QHeaderView>
+#include <QLocale>
+#include <QTimer>
+
+#include "log_table.h"
+#include "outbound_health.h"
+
+namespace {
+
+const int kTopCount = 50;
+const int kRefreshInterval = 2000;
+
+enum Column {
+    KeyColumn,
+    ConnectionsColumn,
+    FailuresColumn,
+    FailureRateColumn,
+    SetupColumn,
+    HealthColumn,
+    ColumnCount
+};
+
+} // namespace
+
+ConnectionStatsDialog::ConnectionStatsDialog(const LogTable *logTable, const OutboundHealth *health,
+                                             QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::ConnectionStatsDialog)
+    , m_logTable(logTable)
+    , m_health(health)
+{
+    ui->setupUi(this);
+
+    ui->statsTable->setColumnCount(ColumnCount);
+    ui->statsTable->setHorizontalHeaderLabels(
+        {tr("Name"), tr("Connections"), tr("Failures"), tr("Failure rate"), tr("Median setup"),
+         tr("Health (5 min)")});
+    ui->statsTable->horizontalHeader()->setSectionResizeMode(KeyColumn, QHeaderView::Stretch);
+
+    connect(ui->groupComboBox, &QComboBox::currentIndexChanged, this, &ConnectionStatsDialog::refresh);
+
+    // The table only grows while the core runs, a cheap pass every few seconds
+    QTimer *refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(kRefreshInterval);
+    connect(refreshTimer, &QTimer::timeout, this, &ConnectionStatsDialog::refresh);
+    refreshTimer->start();
+
+    refresh();
+}
+
+ConnectionStatsDialog::~ConnectionStatsDialog()
+{
+    delete ui;
+}
+
+void ConnectionStatsDialog::refresh()
+{
+    auto field = static_cast<LogTable::Field>(ui->groupComboBox->currentIndex());
+    const QList<LogTable::Group> groups = m_logTable->group(field);
+
+    // Health is tracked per outbound only
+    ui->statsTable->setColumnHidden(HealthColumn, field != LogTable::Outbound);
+
+    QLocale locale;
+    int rows = qMin<int>(groups.size(), kTopCount);
+    ui->statsTable->setRowCount(rows);
+    for (int row = 0; row < rows; ++row) {
+        const LogTable::Group &group = groups.at(row);
+        ui->statsTable->setItem(row, KeyColumn, new QTableWidgetItem(group.key));
+        ui->statsTable->setItem(row, ConnectionsColumn, new QTableWidgetItem(locale.toString(group.connections)));
+        ui->statsTable->setItem(row, FailuresColumn, new QTableWidgetItem(locale.toString(group.failures)));
+        ui->statsTable->setItem(row, FailureRateColumn,
+                                new QTableWidgetItem(locale.toString(100.0 * group.failures / group.connections, 'f', 1)
+                                                     + "%"));
+        ui->statsTable->setItem(row, SetupColumn,
+                                new QTableWidgetItem(group.medianSetup < 0 ? QString("-")
+                                                                           : tr("%1 ms").arg(group.medianSetup)));
+
+        if (field != LogTable::Outbound)
+            continue;
+        OutboundHealth::Health health = m_health->health(group.key);
+        QTableWidgetItem *healthItem = new QTableWidgetItem(health.score < 0 ? QString("-")
+                                                                             : QString("%1%").arg(health.score));
+        QString toolTip = tr("%1 of %2 connections failed in the last 5 minutes")
+                              .arg(health.failures)
+                              .arg(health.attempts);
+        if (health.medianSetup >= 0)
+            toolTip += "\n" + tr("Setup: median %1 ms, 90th percentile %2 ms")
+                                  .arg(health.medianSetup)
+                                  .arg(health.slowSetup);
+        healthItem->setToolTip(toolTip);
+        ui->statsTable->setItem(row, HealthColumn, healthItem);
+    }
+
+    ui->totalLabel->setText(tr("%1 connections in the last %2 log lines")
+                                .arg(locale.toString(m_logTable->connectionCount()),
+                                     locale.toString(m_logTable->size())));
+}
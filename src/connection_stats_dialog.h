@@ -0,0 +1,30 @@
+#ifndef CONNECTION_STATS_DIALOG_H
+#define CONNECTION_STATS_DIALOG_H
+
+#include <QDialog>
+
+class LogTable;
+class OutboundHealth;
+
+namespace Ui {
+class ConnectionStatsDialog;
+}
+
+class ConnectionStatsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    ConnectionStatsDialog(const LogTable *logTable, const OutboundHealth *health, QWidget *parent = nullptr);
+    ~ConnectionStatsDialog();
+
+private slots:
+    void refresh();
+
+private:
+    Ui::ConnectionStatsDialog *ui;
+    const LogTable *m_logTable;
+    const OutboundHealth *m_health;
+};
+
+#endif // CONNECTION_STATS_DIALOG_H
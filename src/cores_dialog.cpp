@@ -0,0 +1,168 @@
+#include "cores_dialog.h"
+#include "ui_cores_dialog.h"
+
+#include <QDir>
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QMessageBox>
+
+namespace {
+
+enum Column {
+    VersionColumn,
+    TagsColumn,
+    LocationColumn,
+    StateColumn,
+    ColumnCount
+};
+
+} // namespace
+
+CoresDialog::CoresDialog(CoreManager *coreManager, ProfileStore *profileStore,
+                         const QString &profileId, QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::CoresDialog)
+    , m_coreManager(coreManager)
+    , m_profileStore(profileStore)
+    , m_profileId(profileId)
+{
+    ui->setupUi(this);
+
+    ui->coreTable->setColumnCount(ColumnCount);
+    ui->coreTable->setHorizontalHeaderLabels({tr("Version"), tr("Tags"), tr("Location"), tr("State")});
+    ui->coreTable->horizontalHeader()->setSectionResizeMode(TagsColumn, QHeaderView::Stretch);
+
+    connect(m_coreManager, &CoreManager::coresChanged, this, &CoresDialog::updateTable);
+    connect(m_coreManager, &CoreManager::defaultVersionChanged, this, &CoresDialog::updateTable);
+    connect(m_coreManager, &CoreManager::installFinished, this, &CoresDialog::showInstallResult);
+    connect(m_profileStore, &ProfileStore::profileUpdated, this, &CoresDialog::updateTable);
+    connect(ui->coreTable, &QTableWidget::itemSelectionChanged, this, &CoresDialog::enableButtons);
+
+    if (m_profileId.isEmpty())
+        ui->profileLabel->setText(tr("No profile selected."));
+    else
+        ui->profileLabel->setText(tr("Selected profile: %1").arg(m_profileStore->profile(m_profileId).name()));
+
+    updateTable();
+}
+
+CoresDialog::~CoresDialog()
+{
+    delete ui;
+}
+
+void CoresDialog::on_addButton_clicked()
+{
+    QString filePath = QFileDialog::getOpenFileName(this, tr("Add sing-box core"), QDir::homePath(),
+                                                    CoreManager::binaryName());
+    if (filePath.isEmpty())
+        return;
+
+    m_coreManager->install(filePath);
+    enableButtons();
+}
+
+void CoresDialog::showInstallResult(const QString &version, const QString &error)
+{
+    Q_UNUSED(version)
+    enableButtons();
+    if (!error.isEmpty())
+        QMessageBox::warning(this, tr("Warning"), error);
+}
+
+void CoresDialog::on_removeButton_clicked()
+{
+    QString version = selectedVersion();
+    if (version == pinnedVersion()) {
+        QMessageBox::warning(this, tr("Warning"), tr("The selected profile is pinned to sing-box %1.").arg(version));
+        return;
+    }
+    if (QMessageBox::question(this, tr("Question"), tr("Remove sing-box %1?").arg(version))
+        != QMessageBox::Yes)
+        return;
+
+    QString error;
+    if (!m_coreManager->remove(version, &error))
+        QMessageBox::warning(this, tr("Warning"), error);
+}
+
+void CoresDialog::on_defaultButton_clicked()
+{
+    emit switchRequested(selectedVersion(), false);
+}
+
+void CoresDialog::on_pinButton_clicked()
+{
+    emit switchRequested(selectedVersion(), true);
+}
+
+void CoresDialog::on_unpinButton_clicked()
+{
+    emit switchRequested(QString(), true);
+}
+
+void CoresDialog::updateTable()
+{
+    QString current = selectedVersion();
+    QString defaultVersion = m_coreManager->defaultVersion();
+    QString pinned = pinnedVersion();
+    const QList<CoreInfo> cores = m_coreManager->cores();
+
+    ui->coreTable->setRowCount(cores.size());
+    for (int row = 0; row < cores.size(); ++row) {
+        const CoreInfo &info = cores.at(row);
+        QString version = info.isValid() ? info.version : tr("unknown");
+        QStringList states;
+        if (info.bundled)
+            states.append(tr("bundled"));
+        if ((info.bundled && defaultVersion.isEmpty()) || (!info.bundled && info.version == defaultVersion))
+            states.append(tr("default"));
+        if (!pinned.isEmpty() && info.version == pinned && !info.bundled)
+            states.append(tr("pinned"));
+
+        auto *versionItem = new QTableWidgetItem(version);
+        // The bundled core is addressed by an empty version
+        versionItem->setData(Qt::UserRole, info.bundled ? QString() : info.version);
+        versionItem->setData(Qt::UserRole + 1, info.bundled);
+        ui->coreTable->setItem(row, VersionColumn, versionItem);
+        ui->coreTable->setItem(row, TagsColumn, new QTableWidgetItem(info.tags.join(", ")));
+        ui->coreTable->item(row, TagsColumn)->setToolTip(info.environment);
+        ui->coreTable->setItem(row, LocationColumn,
+                               new QTableWidgetItem(QDir::toNativeSeparators(info.path)));
+        ui->coreTable->setItem(row, StateColumn, new QTableWidgetItem(states.join(", ")));
+
+        if (!current.isNull() && versionItem->data(Qt::UserRole).toString() == current)
+            ui->coreTable->selectRow(row);
+    }
+    ui->coreTable->resizeColumnToContents(VersionColumn);
+    enableButtons();
+}
+
+void CoresDialog::enableButtons()
+{
+    QList<QTableWidgetItem *> items = ui->coreTable->selectedItems();
+    bool selected = !items.isEmpty();
+    bool bundled = selected
+                   && ui->coreTable->item(items.first()->row(), VersionColumn)->data(Qt::UserRole + 1).toBool();
+    // One binary is checked and copied at a time
+    ui->addButton->setEnabled(!m_coreManager->isInstalling());
+    ui->removeButton->setEnabled(selected && !bundled);
+    ui->defaultButton->setEnabled(selected);
+    ui->pinButton->setEnabled(selected && !bundled && !m_profileId.isEmpty());
+    ui->unpinButton->setEnabled(!pinnedVersion().isEmpty());
+}
+
+QString CoresDialog::selectedVersion() const
+{
+    QList<QTableWidgetItem *> items = ui->coreTable->selectedItems();
+    if (items.isEmpty())
+        return QString();
+    return ui->coreTable->item(items.first()->row(), VersionColumn)->data(Qt::UserRole).toString();
+}
+
+QString CoresDialog::pinnedVersion() const
+{
+    if (m_profileId.isEmpty())
+        return QString();
+    return m_profileStore->profile(m_profileId).coreVersion();
+}
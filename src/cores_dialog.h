@@ -0,0 +1,47 @@
+#ifndef CORES_DIALOG_H
+#define CORES_DIALOG_H
+
+#include <QDialog>
+
+#include "core_manager.h"
+#include "profile_store.h"
+
+namespace Ui {
+class CoresDialog;
+}
+
+class CoresDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit CoresDialog(CoreManager *coreManager, ProfileStore *profileStore,
+                         const QString &profileId, QWidget *parent = nullptr);
+    ~CoresDialog();
+
+signals:
+    // Use version by default, or pin it to the selected profile.
+    // An empty version means the bundled core.
+    void switchRequested(const QString &version, bool pin);
+
+private slots:
+    void on_addButton_clicked();
+    void on_removeButton_clicked();
+    void on_defaultButton_clicked();
+    void on_pinButton_clicked();
+    void on_unpinButton_clicked();
+    void showInstallResult(const QString &version, const QString &error);
+    void updateTable();
+    void enableButtons();
+
+private:
+    QString selectedVersion() const;
+    QString pinnedVersion() const;
+
+    Ui::CoresDialog *ui;
+    CoreManager *m_coreManager;
+    ProfileStore *m_profileStore;
+    QString m_profileId;
+};
+
+#endif // CORES_DIALOG_H
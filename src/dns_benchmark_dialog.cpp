@@ -0,0 +1,168 @@
+#include "dns_benchmark_dialog.h"
+#include "ui_dns_benchmark_dialog.h"
+
+#include <QHeaderView>
+#include <QMessageBox>
+
+#include <algorithm>
+
+#include "settings_manager.h"
+
+namespace {
+
+enum Column {
+    ServerColumn,
+    AddressColumn,
+    P50Column,
+    P95Column,
+    P99Column,
+    FailureColumn,
+    ColumnCount
+};
+
+// Servers failing more often than this are never moved to the front
+const double kMaxFailureRate = 0.2;
+
+QString formatLatency(double latency)
+{
+    return latency >= 0 ? QString("%1 ms").arg(qRound(latency)) : QString("-");
+}
+
+} // namespace
+
+DnsBenchmarkDialog::DnsBenchmarkDialog(const QJsonObject &config, const QString &profile, QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::DnsBenchmarkDialog)
+    , m_profile{profile}
+{
+    ui->setupUi(this);
+
+    m_benchmark = new DnsBenchmark(this);
+    connect(m_benchmark, &DnsBenchmark::serverStarted, this, &DnsBenchmarkDialog::showServerStarted);
+    connect(m_benchmark, &DnsBenchmark::serverFinished, this, &DnsBenchmarkDialog::showResult);
+    connect(m_benchmark, &DnsBenchmark::finished, this, &DnsBenchmarkDialog::showFinished);
+
+    m_servers = DnsBenchmark::servers(config);
+    m_hasFinal = !config.value("dns").toObject().value("final").toString().isEmpty();
+
+    ui->resultTable->setColumnCount(ColumnCount);
+    ui->resultTable->setHorizontalHeaderLabels({tr("Server"), tr("Address"), tr("p50"), tr("p95"),
+                                                tr("p99"), tr("Failures")});
+    ui->resultTable->horizontalHeader()->setSectionResizeMode(AddressColumn, QHeaderView::Stretch);
+    ui->resultTable->setRowCount(m_servers.size());
+    for (int row = 0; row < m_servers.size(); ++row) {
+        const DnsServer &server = m_servers.at(row);
+        ui->resultTable->setItem(row, ServerColumn, new QTableWidgetItem(server.tag));
+        ui->resultTable->setItem(row, AddressColumn, new QTableWidgetItem(server.address));
+        for (int column = P50Column; column < ColumnCount; ++column)
+            ui->resultTable->setItem(row, column, new QTableWidgetItem());
+        if (!server.detour.isEmpty())
+            ui->resultTable->item(row, FailureColumn)->setText(tr("via %1, not tested").arg(server.detour));
+        else if (server.protocol == DnsServer::Unsupported)
+            ui->resultTable->item(row, FailureColumn)->setText(tr("not tested"));
+    }
+
+    SettingsManager settingsManager;
+    QStringList order = settingsManager.dnsServerOrder(m_profile);
+    if (!order.isEmpty())
+        ui->statusLabel->setText(tr("The launch config puts %1 first.").arg(order.join(", ")));
+    ui->runButton->setEnabled(!m_servers.isEmpty());
+    ui->applyOrderButton->setEnabled(false);
+    ui->resetOrderButton->setEnabled(!order.isEmpty());
+}
+
+DnsBenchmarkDialog::~DnsBenchmarkDialog()
+{
+    m_benchmark->cancel();
+    delete ui;
+}
+
+void DnsBenchmarkDialog::on_runButton_clicked()
+{
+    if (m_benchmark->isRunning()) {
+        m_benchmark->cancel();
+        return;
+    }
+    m_results.clear();
+    m_benchmark->setQueryCount(ui->queriesSpinBox->value());
+    m_benchmark->run(m_servers);
+    setRunning(m_benchmark->isRunning());
+}
+
+void DnsBenchmarkDialog::on_applyOrderButton_clicked()
+{
+    // Answered servers by median latency, unreliable ones keep their place
+    QList<DnsBenchmark::Result> results;
+    for (const DnsBenchmark::Result &result : std::as_const(m_results)) {
+        if (result.p50 >= 0 && result.failureRate() <= kMaxFailureRate)
+            results.append(result);
+    }
+    std::sort(results.begin(), results.end(), [](const DnsBenchmark::Result &a, const DnsBenchmark::Result &b) {
+        return a.p50 < b.p50;
+    });
+    QStringList order;
+    for (const DnsBenchmark::Result &result : std::as_const(results))
+        order.append(result.tag);
+
+    SettingsManager settingsManager;
+    settingsManager.setDnsServerOrder(m_profile, order);
+    ui->resetOrderButton->setEnabled(!order.isEmpty());
+
+    QString message = tr("The servers will be reordered the next time the proxy starts.");
+    if (m_hasFinal)
+        message += "\n" + tr("This config names its default resolver in dns.final, "
+                             "which the order does not change.");
+    QMessageBox::information(this, tr("Information"), message);
+}
+
+void DnsBenchmarkDialog::on_resetOrderButton_clicked()
+{
+    SettingsManager settingsManager;
+    settingsManager.setDnsServerOrder(m_profile, QStringList());
+    ui->resetOrderButton->setEnabled(false);
+    ui->statusLabel->setText(tr("The launch config keeps the order of the config."));
+}
+
+void DnsBenchmarkDialog::showServerStarted(const QString &tag)
+{
+    ui->statusLabel->setText(tr("Querying %1...").arg(tag));
+}
+
+void DnsBenchmarkDialog::showResult(const DnsBenchmark::Result &result)
+{
+    int row = rowOf(result.tag);
+    if (row < 0 || result.sent == 0)
+        return;
+    m_results.insert(result.tag, result);
+    ui->resultTable->item(row, P50Column)->setText(formatLatency(result.p50));
+    ui->resultTable->item(row, P95Column)->setText(formatLatency(result.p95));
+    ui->resultTable->item(row, P99Column)->setText(formatLatency(result.p99));
+    ui->resultTable->item(row, FailureColumn)->setText(
+        QString("%1%").arg(qRound(result.failureRate() * 100)));
+    ui->resultTable->item(row, FailureColumn)->setToolTip(
+        tr("%1 of %2 queries failed").arg(result.failures).arg(result.sent));
+}
+
+void DnsBenchmarkDialog::showFinished()
+{
+    ui->statusLabel->setText(tr("Done. Queries are sent directly, servers with a detour are left out."));
+    ui->applyOrderButton->setEnabled(!m_results.isEmpty());
+    setRunning(false);
+}
+
+int DnsBenchmarkDialog::rowOf(const QString &tag) const
+{
+    for (int row = 0; row < m_servers.size(); ++row) {
+        if (m_servers.at(row).tag == tag)
+            return row;
+    }
+    return -1;
+}
+
+void DnsBenchmarkDialog::setRunning(bool running)
+{
+    ui->runButton->setText(running ? tr("Stop") : tr("Run"));
+    ui->runButton->setIcon(QIcon(running ? ":/images/stop.png" : ":/images/start.png"));
+    ui->queriesSpinBox->setEnabled(!running);
+    ui->applyOrderButton->setEnabled(!running && !m_results.isEmpty());
+}
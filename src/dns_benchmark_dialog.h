@@ -0,0 +1,43 @@
+#ifndef DNS_BENCHMARK_DIALOG_H
+#define DNS_BENCHMARK_DIALOG_H
+
+#include <QDialog>
+#include <QHash>
+#include <QJsonObject>
+
+#include "dns_benchmark.h"
+
+namespace Ui {
+class DnsBenchmarkDialog;
+}
+
+class DnsBenchmarkDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    // The order applies to the profile the config belongs to
+    DnsBenchmarkDialog(const QJsonObject &config, const QString &profile, QWidget *parent = nullptr);
+    ~DnsBenchmarkDialog();
+
+private slots:
+    void on_runButton_clicked();
+    void on_applyOrderButton_clicked();
+    void on_resetOrderButton_clicked();
+    void showServerStarted(const QString &tag);
+    void showResult(const DnsBenchmark::Result &result);
+    void showFinished();
+
+private:
+    int rowOf(const QString &tag) const;
+    void setRunning(bool running);
+
+    Ui::DnsBenchmarkDialog *ui;
+    DnsBenchmark *m_benchmark;
+    QList<DnsServer> m_servers;
+    QHash<QString, DnsBenchmark::Result> m_results;
+    bool m_hasFinal;
+    QString m_profile;
+};
+
+#endif // DNS_BENCHMARK_DIALOG_H
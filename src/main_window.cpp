@@ -1,29 +1,46 @@
 #include "main_window.h"
 #include "ui_main_window.h"
 
+#include <QCoreApplication>
 #include <QLabel>
+#include <QLocale>
+#include <QMenu>
 #include <QMessageBox>
 #include <QRegularExpression>
 #include <QScrollBar>
 #include <QString>
-#include <QSettings>
 #include <QStandardPaths>
 #include <QDir>
+#include <QFutureWatcher>
 #include <QUrl>
 #include <QNetworkRequest>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QDateTime>
 #include <QFile>
+#include <QSaveFile>
 #include <QListWidget>
-#include <QSslConfiguration>
 #include <QSslSocket>
 #include <QTextEdit>
 #include <QProcessEnvironment>
+#include <QtConcurrent>
 
+#include "ab_benchmark_dialog.h"
 #include "about_dialog.h"
 #include "ansi_color_text.h"
+#include "benchmark_dialog.h"
+#include "connection_stats_dialog.h"
+#include "cores_dialog.h"
+#include "dns_benchmark.h"
+#include "dns_benchmark_dialog.h"
+#include "metrics.h"
+#include "profiles_dialog.h"
+#include "route_test_dialog.h"
 #include "settings_dialog.h"
+#include "settings_manager.h"
+#include "settings_store.h"
+#include "subscription_tls_dialog.h"
+#include "traffic_dialog.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -40,6 +57,10 @@ MainWindow::MainWindow(QWidget *parent)
     m_versionLabel->setText("v" + QString(PROJECT_VERSION));
     m_versionLabel->setIndent(8);
     ui->statusbar->addWidget(m_versionLabel);
+    m_logLabel = new QLabel(this);
+    ui->statusbar->addPermanentWidget(m_logLabel);
+    m_resourceLabel = new QLabel(this);
+    ui->statusbar->addPermanentWidget(m_resourceLabel);
     ui->statusLabel->setPixmap(QPixmap(":/images/status_disabled.png").
                                scaled(QSize(48, 48)));
 
@@ -53,6 +74,23 @@ MainWindow::MainWindow(QWidget *parent)
     connect(m_proxyManager, &ProxyManager::proxyProcessReadyReadStandardError, this,
             &MainWindow::displayProxyOutput);
 
+    // A debug or trace log must not keep the GUI busy
+    SettingsManager settingsManager;
+    m_logGovernor = new LogGovernor(this);
+    m_logGovernor->setLimit(settingsManager.logLineLimit());
+    connect(m_logGovernor, &LogGovernor::throttlingChanged, this, &MainWindow::showLogThrottling);
+
+    m_coreManager = new CoreManager(this);
+
+    m_configValidator = new ConfigValidator(this);
+    connect(m_configValidator, &ConfigValidator::validationFinished, this,
+            &MainWindow::onConfigValidationFinished);
+    connect(m_configValidator, &ConfigValidator::snapshotFound, this,
+            [this](quint64 requestId, int outboundCount) {
+        if (requestId == m_configValidationId)
+            updateConfigStatus(tr("Status: Loading config (%1 outbounds)...").arg(outboundCount));
+    });
+
     m_configManager = new ConfigManager(this);
     connect(m_configManager, &ConfigManager::configUpdated, this,
             &MainWindow::updateConfigList);
@@ -60,24 +98,92 @@ MainWindow::MainWindow(QWidget *parent)
             &MainWindow::changeSelectedConfig);
 
     // Initialize subscription functionality
-    m_networkManager = new QNetworkAccessManager(this);
     m_currentReply = nullptr;
-    
-    // Configure SSL for better compatibility
-    QSslConfiguration sslConfig = QSslConfiguration::defaultConfiguration();
-    sslConfig.setPeerVerifyMode(QSslSocket::VerifyNone); // For testing - consider VerifyPeer for production
-    QSslConfiguration::setDefaultConfiguration(sslConfig);
+
+    // Certificates are verified per request, see SubscriptionTls
+    m_subscriptionTls = new SubscriptionTls(this);
+    m_subscriptionFetcher = new SubscriptionFetcher(m_subscriptionTls, this);
+    m_subscriptionFetcher->setUserAgent("qsing-box/" PROJECT_VERSION);
     
     // Setup update timer for 1-minute intervals
     m_updateTimer = new QTimer(this);
     m_updateTimer->setSingleShot(false);
     m_updateTimer->setInterval(60000); // 1 minute
     connect(m_updateTimer, &QTimer::timeout, this, &MainWindow::updateSubscriptionConfig);
+    m_subscriptionFetcher->setPollInterval(m_updateTimer->interval());
+
+    m_connectivityMonitor = new ConnectivityMonitor(this);
+    connect(m_connectivityMonitor, &ConnectivityMonitor::wentOffline, this, &MainWindow::pauseWhileOffline);
+    connect(m_connectivityMonitor, &ConnectivityMonitor::networkChanged, this,
+            &MainWindow::recoverFromNetworkChange);
     
     // Setup config file path
     QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     QDir().mkpath(appDataPath);
     m_configFilePath = appDataPath + "/subscription_config.json";
+    m_launchConfigFilePath = appDataPath + "/launch_config.json";
+
+    m_ruleSetCache = new RuleSetCache(this);
+    m_ruleSetUpdateTimer = new QTimer(this);
+    m_ruleSetUpdateTimer->setSingleShot(true);
+    m_ruleSetUpdateTimer->setInterval(5000);
+    connect(m_ruleSetUpdateTimer, &QTimer::timeout, this, &MainWindow::noteRuleSetUpdate);
+    connect(m_ruleSetCache, &RuleSetCache::cacheUpdated, m_ruleSetUpdateTimer,
+            QOverload<>::of(&QTimer::start));
+
+    // Configs written by other programs apply without switching profiles
+    m_configWatcher = new ConfigWatcher(this);
+    connect(m_configWatcher, &ConfigWatcher::fileChanged, this, &MainWindow::reloadChangedConfig);
+    connect(m_configManager->profileStore(), &ProfileStore::profilesChanged, this,
+            &MainWindow::updateWatchedFiles);
+    updateWatchedFiles();
+
+    m_clashApi = new ClashApi(this);
+    m_outboundSelector = new OutboundSelector(m_clashApi, this);
+    // Members failing real traffic lose ground without extra probes
+    m_outboundSelector->setPassiveFailureRate([this](const QString &member) {
+        return m_outboundHealth.failureRate(member);
+    });
+    m_trafficAccounting = new TrafficAccounting(m_clashApi, this);
+
+    m_resourceMonitor = new ResourceMonitor(this);
+    connect(m_resourceMonitor, &ResourceMonitor::sampled, this, &MainWindow::showResourceSample);
+    connect(m_resourceMonitor, &ResourceMonitor::memoryGrowing, this, &MainWindow::warnMemoryGrowing);
+    connect(m_outboundSelector, &OutboundSelector::switched, this,
+            [this](const QString &selector, const QString &from, const QString &to) {
+        ui->outputEdit->appendPlainText(tr("%1: switched from %2 to %3").arg(selector, from, to));
+    });
+    connect(m_outboundSelector, &OutboundSelector::roundFinished, this, [this]() {
+        // Shown in the profile list, only for a profile that is running
+        if (m_configManager->configCount() == 0)
+            return;
+        QString id = m_configManager->configId();
+        ProfileStore *profiles = m_configManager->profileStore();
+        double latency = m_outboundSelector->stats(m_outboundSelector->current()).latency;
+        if (latency >= 0 && QFileInfo(profiles->profile(id).filePath()) == QFileInfo(m_activeConfigPath))
+            profiles->setLastLatency(id, qRound(latency));
+    });
+
+    m_hotStandby = new HotStandby(m_clashApi, this);
+    connect(m_hotStandby, &HotStandby::message, this, [this](const QString &text) {
+        ui->outputEdit->appendPlainText(text);
+    });
+    connect(m_hotStandby, &HotStandby::tookOver, this, [this](const QString &reason) {
+        QString message = tr("%1, traffic moved to hot standby %2.").arg(reason, m_hotStandby->name());
+        ui->outputEdit->appendPlainText(message);
+        m_trayIcon->showMessage(tr("Warning"), message);
+    });
+    connect(m_hotStandby, &HotStandby::handedBack, this, [this]() {
+        ui->outputEdit->appendPlainText(tr("Traffic moved back from hot standby %1.").arg(m_hotStandby->name()));
+    });
+
+    m_metricsServer = new MetricsServer(this);
+    connect(m_metricsServer, &MetricsServer::failed, this, [this](const QString &error) {
+        ui->outputEdit->appendPlainText(tr("Metrics server on port %1 failed: %2")
+                                            .arg(m_metricsServer->port())
+                                            .arg(error));
+    });
+    m_metricsServer->setPort(settingsManager.metricsPort());
     
     // Initialize config preview
     ui->configPreviewEdit->setPlainText("No configuration downloaded yet");
@@ -88,6 +194,16 @@ MainWindow::MainWindow(QWidget *parent)
     // Initialize configuration
     changeSelectedConfig();
 
+    m_toolsMenu = new QMenu(this);
+    m_toolsMenu->addAction(tr("Throughput benchmark..."), this, &MainWindow::openThroughputBenchmark);
+    m_toolsMenu->addAction(tr("Traffic..."), this, &MainWindow::openTrafficDashboard);
+    m_toolsMenu->addAction(tr("DNS benchmark..."), this, &MainWindow::openDnsBenchmark);
+    m_toolsMenu->addAction(tr("sing-box cores..."), this, &MainWindow::openCores);
+    m_toolsMenu->addAction(tr("Compare profiles..."), this, &MainWindow::openProfileComparison);
+    m_toolsMenu->addAction(tr("Route test..."), this, &MainWindow::openRouteTest);
+    m_toolsMenu->addAction(tr("Connection stats..."), this, &MainWindow::openConnectionStats);
+    ui->toolsButton->setMenu(m_toolsMenu);
+
     m_trayIcon = new TrayIcon(this);
     connect(m_trayIcon, &TrayIcon::disableProxyActionTriggered, this, &MainWindow::stopProxy);
     connect(m_trayIcon, &TrayIcon::enableProxyActionTriggered, this, &MainWindow::startProxy);
@@ -105,13 +221,31 @@ MainWindow::~MainWindow()
 
 void MainWindow::startProxy()
 {
+    if (m_configValidationId != 0) {
+        // Started before the selected config was validated, e.g. on autorun
+        m_startAfterValidation = true;
+        return;
+    }
+    prepareLaunchConfig();
+    m_logGovernor->reset();
+    m_coreStartClock.start();
+    m_coreReady = false;
     m_proxyManager->startProxy();
+    if (m_proxyManager->proxyProcessState() != QProcess::NotRunning)
+        ++Metrics::instance()->coreStarts;
     ui->outputEdit->clear();
 }
 
 void MainWindow::stopProxy()
 {
+    m_stoppingProxy = true;
     m_proxyManager->stopProxy();
+    m_stoppingProxy = false;
+    // Stopping the proxy also stops traffic through the standby
+    if (m_hotStandby->state() == HotStandby::Serving) {
+        m_hotStandby->stopServing();
+        m_proxyManager->clearSystemProxy();
+    }
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
@@ -138,6 +272,17 @@ void MainWindow::on_settingsButton_clicked()
 {
     SettingsDialog settingsDialog(m_configManager, this);
     settingsDialog.exec();
+    SettingsManager settingsManager;
+    m_logGovernor->setLimit(settingsManager.logLineLimit());
+    m_metricsServer->setPort(settingsManager.metricsPort());
+    if (m_proxyManager->proxyProcessState() == QProcess::Running)
+        updateHotStandby();
+}
+
+void MainWindow::on_profilesButton_clicked()
+{
+    ProfilesDialog profilesDialog(m_configManager, this);
+    profilesDialog.exec();
 }
 
 void MainWindow::on_aboutButton_clicked()
@@ -146,6 +291,145 @@ void MainWindow::on_aboutButton_clicked()
     aboutDialog.exec();
 }
 
+void MainWindow::openThroughputBenchmark()
+{
+    if (!ensureCoreRunning())
+        return;
+    // The benchmark drives the selector itself
+    m_outboundSelector->stop();
+    BenchmarkDialog benchmarkDialog(m_clashApi, m_activeConfig, activeProfileKey(), this);
+    benchmarkDialog.exec();
+    if (m_proxyManager->proxyProcessState() == QProcess::Running)
+        startOutboundSelector();
+}
+
+void MainWindow::openTrafficDashboard()
+{
+    TrafficDialog trafficDialog(m_trafficAccounting, this);
+    trafficDialog.exec();
+}
+
+void MainWindow::openConnectionStats()
+{
+    ConnectionStatsDialog connectionStatsDialog(&m_logTable, &m_outboundHealth, this);
+    connectionStatsDialog.exec();
+}
+
+void MainWindow::openDnsBenchmark()
+{
+    DnsBenchmarkDialog dnsBenchmarkDialog(m_activeConfig, activeProfileKey(), this);
+    dnsBenchmarkDialog.exec();
+}
+
+void MainWindow::openCores()
+{
+    CoresDialog coresDialog(m_coreManager, m_configManager->profileStore(),
+                            m_configManager->configId(), this);
+    connect(&coresDialog, &CoresDialog::switchRequested, this, &MainWindow::switchCore);
+    coresDialog.exec();
+}
+
+void MainWindow::openProfileComparison()
+{
+    // Both arms listen on the ports of their configs, the proxy has to make room
+    bool running = m_proxyManager->proxyProcessState() == QProcess::Running;
+    if (running) {
+        if (QMessageBox::question(this, tr("Question"),
+                                  tr("The proxy is stopped during the comparison. Continue?"))
+            != QMessageBox::Yes)
+            return;
+        stopProxy();
+    }
+    // The standby would compete with the arms for CPU and bandwidth, it
+    // comes back with the proxy
+    m_hotStandby->stop();
+    AbBenchmarkDialog abBenchmarkDialog(m_configManager->profileStore(), m_coreManager,
+                                        m_ruleSetCache, this);
+    abBenchmarkDialog.exec();
+    if (running)
+        startProxy();
+}
+
+void MainWindow::openRouteTest()
+{
+    RouteTestDialog routeTestDialog(m_activeConfig, this);
+    routeTestDialog.exec();
+}
+
+void MainWindow::switchCore(const QString &version, bool pin)
+{
+    QString profileId = m_configManager->configId();
+    if (pin && profileId.isEmpty())
+        return;
+
+    QString targetPath;
+    if (!version.isEmpty())
+        targetPath = m_coreManager->core(version).path;
+    else if (pin)
+        targetPath = m_coreManager->corePath();
+    else
+        targetPath = QCoreApplication::applicationDirPath() + "/" + CoreManager::binaryName();
+    QString name = version.isEmpty() ? tr("the default core") : tr("sing-box %1").arg(version);
+
+    auto apply = [this, version, pin, profileId, name]() {
+        if (pin)
+            m_configManager->profileStore()->setCoreVersion(profileId, version);
+        else
+            m_coreManager->setDefaultVersion(version);
+        updateCorePath();
+        bool running = m_proxyManager->proxyProcessState() == QProcess::Running;
+        if (running) {
+            stopProxy();
+            startProxy();
+        }
+        ui->outputEdit->appendPlainText(running ? tr("Restarted with %1.").arg(name)
+                                                : tr("Using %1.").arg(name));
+    };
+
+    if (m_activeConfig.isEmpty()) {
+        apply();
+        return;
+    }
+
+    // Make sure the new core accepts the active config before switching to it
+    QByteArray content = QJsonDocument(m_activeConfig).toJson(QJsonDocument::Compact);
+    auto *watcher = new QFutureWatcher<ConfigValidationResult>(this);
+    connect(watcher, &QFutureWatcher<ConfigValidationResult>::finished, this,
+            [this, watcher, apply, name]() {
+        watcher->deleteLater();
+        ConfigValidationResult result = watcher->result();
+        if (!result.valid) {
+            QMessageBox::warning(this, tr("Warning"),
+                                 tr("The current config does not work with %1:\n%2")
+                                     .arg(name, result.errors.join("\n")));
+            return;
+        }
+        apply();
+    });
+    watcher->setFuture(QtConcurrent::run(&ConfigValidator::validate, content, targetPath));
+}
+
+void MainWindow::showResourceSample(const ResourceSample &sample)
+{
+    QLocale locale;
+    m_resourceLabel->setText(tr("CPU %1%  RAM %2")
+                                 .arg(locale.toString(sample.cpu, 'f', 1),
+                                      locale.formattedDataSize(sample.residentBytes)));
+    m_resourceLabel->setToolTip(tr("sing-box: %1 threads, %2 handles")
+                                    .arg(sample.threads)
+                                    .arg(sample.handles));
+    Metrics::instance()->coreCpu = qRound(sample.cpu * 10);
+    Metrics::instance()->coreResidentBytes = sample.residentBytes;
+}
+
+void MainWindow::warnMemoryGrowing(qint64 bytesPerMinute)
+{
+    QString message = tr("sing-box memory has been growing by %1 per minute for the last 10 minutes.")
+                          .arg(QLocale().formattedDataSize(bytesPerMinute));
+    ui->outputEdit->appendPlainText(message);
+    m_trayIcon->showMessage(tr("Warning"), message);
+}
+
 // Old profile management methods - no longer used
 void MainWindow::on_addButton_clicked()
 {
@@ -180,7 +464,21 @@ void MainWindow::enableButton(int currentRow)
 
 void MainWindow::displayProxyOutput()
 {
-    QByteArray outputData = m_proxyManager->readProxyProcessAllStandardError();
+    QByteArray rawData = m_proxyManager->readProxyProcessAllStandardError();
+    Metrics *metrics = Metrics::instance();
+    if (!m_coreReady && rawData.contains("sing-box started")) {
+        m_coreReady = true;
+        metrics->coreReadyTime = m_coreStartClock.elapsed();
+    }
+    // Every line the core wrote, whether the governor keeps it or not
+    metrics->logLines += rawData.count('\n');
+    // Dropped lines are never decoded, colored or parsed into the table
+    QByteArray outputData = m_logGovernor->filter(rawData);
+    metrics->logLineRate = m_logGovernor->lineRate();
+    metrics->logLineRateTime = QDateTime::currentMSecsSinceEpoch();
+    if (outputData.isEmpty())
+        return;
+    feedLogTable(outputData);
     QString outputText = QString::fromUtf8(outputData);
     // Parsing ANSI colors and dispalys
     AnsiColorText::appendAnsiColorText(ui->outputEdit, outputText);
@@ -189,6 +487,37 @@ void MainWindow::displayProxyOutput()
     scrollBar->setValue(scrollBar->maximum());
 }
 
+void MainWindow::feedLogTable(const QByteArray &data)
+{
+    int lines = m_logTable.feed(data);
+    // Attempts are info lines. While the governor drops them, the errors
+    // would be counted against too few attempts and inflate the rate.
+    if (m_logGovernor->minimumLevel() <= LogGovernor::Info)
+        m_outboundHealth.consume(m_logTable, lines);
+}
+
+void MainWindow::showLogThrottling(bool throttling)
+{
+    if (!throttling) {
+        m_logLabel->clear();
+        ui->outputEdit->appendPlainText(tr("sing-box log rate is back to normal, %1 lines were hidden.")
+                                            .arg(m_logGovernor->droppedLines()));
+        return;
+    }
+
+    QString level = LogGovernor::levelName(m_logGovernor->minimumLevel());
+    m_logLabel->setText(tr("Log throttled"));
+    m_logLabel->setToolTip(tr("Only %1 and more severe lines of the core are shown").arg(level));
+    ui->outputEdit->appendPlainText(tr("sing-box logs too many lines, only %1 and more severe lines are shown.")
+                                        .arg(level));
+
+    SettingsManager settingsManager;
+    if (settingsManager.lowerLogLevelWhenThrottled() && !m_capLogLevel) {
+        m_capLogLevel = true;
+        ui->outputEdit->appendPlainText(tr("The core will log at info level from its next start."));
+    }
+}
+
 void MainWindow::updateConfigList()
 {
     // No longer used - config list UI removed in favor of subscription
@@ -205,7 +534,33 @@ void MainWindow::changeProxy(int newState)
         ui->startButton->setEnabled(false);
         ui->stopButton->setEnabled(true);
         emit proxyChanged(true);
+        if (m_clashApi->isAvailable()) {
+            startOutboundSelector();
+            m_trafficAccounting->start();
+        } else {
+            ui->outputEdit->appendPlainText(
+                tr("This sing-box has no Clash API (with_clash_api), auto-select, "
+                   "traffic accounting and hot standby are off."));
+        }
+        m_resourceMonitor->start(m_proxyManager->proxyProcessId());
+        updateHotStandby();
+        Metrics::instance()->coreUp = 1;
     } else if (newState == QProcess::NotRunning) {
+        Metrics *metrics = Metrics::instance();
+        if (metrics->coreUp.exchange(0) == 1 && !m_stoppingProxy)
+            ++metrics->coreCrashes;
+        metrics->coreCpu = 0;
+        metrics->coreResidentBytes = 0;
+        m_outboundSelector->stop();
+        m_trafficAccounting->stop();
+        m_resourceMonitor->stop();
+        m_resourceLabel->clear();
+        QByteArray lastOutput = m_logGovernor->flush();
+        if (!lastOutput.isEmpty()) {
+            feedLogTable(lastOutput);
+            AnsiColorText::appendAnsiColorText(ui->outputEdit, QString::fromUtf8(lastOutput));
+        }
+        m_clashApi->setController(QString(), QString());
         m_trayIcon->setIcon(QIcon(":/images/app.ico"));
         setWindowIcon(QIcon(":/images/app.ico"));
         ui->statusLabel->setPixmap(QPixmap(":/images/status_disabled.png").
@@ -213,7 +568,12 @@ void MainWindow::changeProxy(int newState)
         ui->startButton->setEnabled(true);
         ui->stopButton->setEnabled(false);
         emit proxyChanged(false);
-        m_proxyManager->clearSystemProxy();
+        m_hotStandby->clearPrimary();
+        // A core that exits on its own hands its traffic to the standby
+        if (m_stoppingProxy || !m_hotStandby->takeOver(tr("sing-box exited"))) {
+            m_hotStandby->stopServing();
+            m_proxyManager->clearSystemProxy();
+        }
     }
 }
 
@@ -230,96 +590,289 @@ void MainWindow::showMainWindow(int reason)
     }
 }
 
+QString MainWindow::selectedConfigFilePath() const
+{
+    // Use subscription config if available, otherwise the selected local config
+    if (!m_subscriptionUrl.isEmpty() && QFile::exists(m_configFilePath))
+        return m_configFilePath;
+    if (m_configManager->configCount() != 0)
+        return m_configManager->configFilePath();
+    return QString();
+}
+
 void MainWindow::changeSelectedConfig()
 {
-    // Use subscription config if available and valid
-    if (!m_subscriptionUrl.isEmpty() && QFile::exists(m_configFilePath)) {
-        // Verify the config file has content and is valid JSON
-        QFile file(m_configFilePath);
-        if (file.open(QIODevice::ReadOnly)) {
-            QByteArray content = file.readAll();
-            file.close();
-            
-            if (!content.isEmpty()) {
-                // Validate JSON structure
-                QJsonParseError error;
-                QJsonDocument jsonDoc = QJsonDocument::fromJson(content, &error);
-                
-                if (error.error == QJsonParseError::NoError && jsonDoc.isObject()) {
-                    QJsonObject config = jsonDoc.object();
-                    
-                    // Check for essential sing-box config elements
-                    if (config.contains("inbounds") || config.contains("outbounds")) {
-                        ui->configStatusLabel->setText(tr("Status: Using subscription config"));
-                        m_proxyManager->setConfigFilePath(m_configFilePath);
-                        
-                        // Load and display config preview
-                        QString configText = jsonDoc.toJson(QJsonDocument::Indented);
-                        ui->configPreviewEdit->setPlainText(configText);
-                        
-                        if (m_proxyManager->proxyProcessState() == QProcess::Running) {
-                            stopProxy();
-                            startProxy();
-                        }
-                        return;
-                    } else {
-                        // Valid JSON but not a proper sing-box config
-                        ui->configStatusLabel->setText(tr("Status: Invalid config - missing inbounds/outbounds"));
-                        ui->configPreviewEdit->setPlainText("Error: Configuration appears to be invalid.\nMissing required 'inbounds' or 'outbounds' sections.");
-                        if (m_proxyManager->proxyProcessState() == QProcess::Running) {
-                            stopProxy();
-                        }
-                        return;
-                    }
-                } else {
-                    // Invalid JSON
-                    ui->configStatusLabel->setText(tr("Status: Invalid JSON config"));
-                    ui->configPreviewEdit->setPlainText(QString("Error: Invalid JSON configuration.\nParse error: %1").arg(error.errorString()));
-                    if (m_proxyManager->proxyProcessState() == QProcess::Running) {
-                        stopProxy();
-                    }
-                    return;
-                }
-            } else {
-                // Empty file
-                ui->configStatusLabel->setText(tr("Status: Empty config file"));
-                ui->configPreviewEdit->setPlainText("Error: Configuration file is empty");
-                if (m_proxyManager->proxyProcessState() == QProcess::Running) {
-                    stopProxy();
-                }
-                return;
-            }
-        } else {
-            // Cannot read file
-            ui->configStatusLabel->setText(tr("Status: Cannot read config file"));
-            ui->configPreviewEdit->setPlainText("Error: Cannot read configuration file");
-            if (m_proxyManager->proxyProcessState() == QProcess::Running) {
-                stopProxy();
-            }
-            return;
-        }
-    }
-    
-    // Fallback to local configs or show no config available
-    if (m_configManager->configCount() == 0) {
+    QString filePath = selectedConfigFilePath();
+    if (filePath.isEmpty()) {
+        m_configValidationId = 0;
+        m_activeConfig = QJsonObject();
+        m_activeConfigPath.clear();
         ui->configStatusLabel->setText(tr("Status: No configuration available"));
         ui->configPreviewEdit->setPlainText("No configuration available.\nPlease enter a subscription URL or import a configuration file.");
         if (m_proxyManager->proxyProcessState() == QProcess::Running)
         {
             stopProxy();
         }
-    } else {
-        QString name = m_configManager->configName();
-        int index = m_configManager->configIndex();
-        ui->configStatusLabel->setText(QString("Status: Using local config: %1").arg(name));
-        ui->configPreviewEdit->setPlainText("Using local configuration file");
-        m_proxyManager->setConfigFilePath(m_configManager->configFilePath());
-        if (m_proxyManager->proxyProcessState() == QProcess::Running)
-        {
-            stopProxy();
+        return;
+    }
+
+    // Parsing and checking run on a worker thread,
+    // the result arrives in onConfigValidationFinished()
+    updateCorePath();
+    m_configValidationId = m_configValidator->validateFile(filePath);
+    updateConfigStatus(tr("Status: Validating config..."));
+}
+
+void MainWindow::reloadChangedConfig(const QString &filePath)
+{
+    // Other profiles are read when they are switched to
+    if (QFileInfo(filePath) != QFileInfo(selectedConfigFilePath()))
+        return;
+    ui->outputEdit->appendPlainText(tr("%1 changed on disk, reloading.").arg(QDir::toNativeSeparators(filePath)));
+    changeSelectedConfig();
+}
+
+void MainWindow::updateWatchedFiles()
+{
+    QStringList filePaths{m_configFilePath};
+    ProfileStore *profileStore = m_configManager->profileStore();
+    for (int i = 0; i < profileStore->count(); ++i)
+        filePaths.append(profileStore->at(i).filePath());
+    m_configWatcher->setFiles(filePaths);
+}
+
+void MainWindow::onConfigValidationFinished(const ConfigValidationResult &result)
+{
+    if (result.requestId == m_downloadValidationId) {
+        m_downloadValidationId = 0;
+        applyDownloadedConfig(result);
+    } else if (result.requestId == m_configValidationId) {
+        m_configValidationId = 0;
+        bool startPending = m_startAfterValidation;
+        m_startAfterValidation = false;
+        if (!result.valid) {
+            // Keep whatever the core is running now
+            updateConfigStatus(tr("Status: Invalid config, keeping the current one"));
+            ui->configPreviewEdit->setPlainText(QString("Error: Configuration is invalid.\n%1")
+                                                    .arg(result.errors.join("\n")));
+            return;
+        }
+        if (result.filePath == m_configFilePath) {
+            applyConfig(result, tr("Status: Using subscription config"));
+        } else {
+            m_configManager->profileStore()->updateMetadata(m_configManager->configId(), result);
+            applyConfig(result, QString("Status: Using local config: %1")
+                                    .arg(m_configManager->configName()));
+        }
+        if (startPending && m_proxyManager->proxyProcessState() == QProcess::NotRunning) {
             startProxy();
         }
     }
+    // Otherwise a newer request superseded this one
+}
+
+void MainWindow::applyConfig(const ConfigValidationResult &result, const QString &status)
+{
+    m_activeConfig = result.config;
+    m_activeConfigPath = result.filePath;
+    m_configWatcher->setContentHash(result.filePath, result.hash);
+    m_ruleSetCache->refresh(m_activeConfig);
+    ui->configStatusLabel->setText(status);
+    ui->configPreviewEdit->setPlainText(result.preview);
+    Metrics::instance()->configBytes = result.size;
+    Metrics::instance()->configParseTime = result.elapsed;
+    for (const QString &warning : result.warnings) {
+        ui->outputEdit->appendPlainText(tr("Config warning: %1").arg(warning));
+    }
+
+    if (m_proxyManager->proxyProcessState() == QProcess::Running) {
+        stopProxy();
+        startProxy();
+    }
+}
+
+void MainWindow::applyDownloadedConfig(const ConfigValidationResult &result)
+{
+    Metrics *metrics = Metrics::instance();
+    if (!result.valid) {
+        // A bad download never replaces the running config
+        ++metrics->fetchesRejected;
+        updateConfigStatus(tr("Error: Downloaded config is invalid: %1").arg(result.errors.value(0)));
+        ui->configPreviewEdit->setPlainText(QString("Error: Downloaded configuration is invalid.\n%1")
+                                                .arg(result.errors.join("\n")));
+        return;
+    }
+
+    // Compare with the running config, most refreshes change nothing
+    ConfigDiff diff = ConfigDiff::compare(m_activeConfig, result.config);
+    if (!m_activeConfig.isEmpty() && !diff.requiresRestart()
+        && QFile::exists(m_configFilePath)) {
+        ++metrics->fetchesUnchanged;
+        m_subscriptionFetcher->commit(QUrl(m_subscriptionUrl));
+        updateConfigStatus(tr("Config unchanged. Last check: %1")
+                          .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")));
+        return;
+    }
+
+    // Save to file
+    QFile file(m_configFilePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(result.content) != result.content.size()) {
+        ++metrics->fetchesRejected;
+        updateConfigStatus(tr("Error: Failed to save config file"));
+        ui->configPreviewEdit->setPlainText("Error: Failed to save config file");
+        return;
+    }
+    file.close();
+    ++metrics->fetchesUpdated;
+
+    ConfigValidationResult saved = result;
+    saved.filePath = m_configFilePath;
+    m_configValidator->saveSnapshot(saved);
+    applyConfig(saved, tr("Config updated successfully (%1). Last update: %2")
+                           .arg(diff.summary())
+                           .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")));
+    showConfigChangeLog(diff);
+    // Only now may the server answer 304 for this body
+    m_subscriptionFetcher->commit(QUrl(m_subscriptionUrl));
+}
+
+void MainWindow::prepareLaunchConfig()
+{
+    if (m_activeConfig.isEmpty()) {
+        m_clashApi->setControllerFromConfig(QJsonObject());
+        m_proxyManager->setConfigFilePath(m_activeConfigPath);
+        m_launchRoute = QJsonValue();
+        return;
+    }
+
+    // The core runs a generated copy, the subscription or local file stays untouched
+    QJsonObject launchConfig = m_ruleSetCache->rewrite(m_activeConfig);
+    m_launchRoute = launchConfig.value("route");
+    // A core built without with_clash_api refuses to start with a controller
+    if (m_coreManager->supportsClashApi(m_proxyManager->corePath()))
+        ClashApi::ensureController(launchConfig);
+    SettingsManager settingsManager;
+    DnsBenchmark::reorderServers(launchConfig, settingsManager.dnsServerOrder(activeProfileKey()));
+    if (m_capLogLevel) {
+        // The log was throttled before, do not produce the lines in the first place
+        QJsonObject log = launchConfig.value("log").toObject();
+        QString level = log.value("level").toString();
+        if (level == "trace" || level == "debug") {
+            log.insert("level", "info");
+            launchConfig.insert("log", log);
+        }
+    }
+    m_clashApi->setControllerFromConfig(launchConfig);
+
+    QSaveFile file(m_launchConfigFilePath);
+    if (file.open(QIODevice::WriteOnly)
+        && file.write(QJsonDocument(launchConfig).toJson(QJsonDocument::Compact)) > 0
+        && file.commit()) {
+        m_proxyManager->setConfigFilePath(m_launchConfigFilePath);
+    } else {
+        m_proxyManager->setConfigFilePath(m_activeConfigPath);
+    }
+}
+
+void MainWindow::noteRuleSetUpdate()
+{
+    if (m_proxyManager->proxyProcessState() != QProcess::Running || m_activeConfig.isEmpty())
+        return;
+    // A refreshed file is replaced in place and reloaded by the core. Only
+    // a rule-set cached for the first time changes the route, restarting
+    // for it would drop every connection just to skip one download.
+    QJsonValue route = m_ruleSetCache->rewrite(m_activeConfig).value("route");
+    if (route == m_launchRoute)
+        return;
+    m_launchRoute = route;
+    ui->outputEdit->appendPlainText(tr("Rule-sets were cached, sing-box uses the local copies from its next start."));
+}
+
+void MainWindow::startOutboundSelector()
+{
+    SettingsManager settingsManager;
+    if (!settingsManager.autoSelectOutbound())
+        return;
+    m_outboundSelector->setSelector(OutboundSelector::defaultSelector(m_activeConfig));
+    m_outboundSelector->setConfig(m_activeConfig);
+    m_outboundSelector->setMargin(settingsManager.autoSelectMargin());
+    m_outboundSelector->start();
+}
+
+void MainWindow::updateHotStandby()
+{
+    SettingsManager settingsManager;
+    QString id = settingsManager.hotStandbyProfile();
+    ProfileStore *profiles = m_configManager->profileStore();
+    if (id.isEmpty() || !profiles->contains(id)) {
+        m_hotStandby->stop();
+        return;
+    }
+
+    // Both cores are health checked through their Clash API, the message
+    // about the primary core was shown when it started
+    if (!m_clashApi->isAvailable()) {
+        m_hotStandby->stop();
+        return;
+    }
+
+    if (m_hotStandby->state() == HotStandby::Stopped || id != m_hotStandbyId) {
+        QJsonObject config = QJsonDocument::fromJson(profiles->content(id)).object();
+        Config profile = profiles->profile(id);
+        if (config.isEmpty()) {
+            ui->outputEdit->appendPlainText(tr("Cannot read hot standby profile %1.").arg(profile.name()));
+            m_hotStandby->stop();
+            return;
+        }
+        QString corePath = m_coreManager->corePath(profile.coreVersion());
+        if (!m_coreManager->supportsClashApi(corePath)) {
+            ui->outputEdit->appendPlainText(tr("Hot standby %1 is off, its sing-box has no Clash API (with_clash_api).")
+                                                .arg(profile.name()));
+            m_hotStandby->stop();
+            return;
+        }
+        m_hotStandbyId = id;
+        m_hotStandby->start(profile.name(), m_ruleSetCache->rewrite(config), corePath);
+    }
+    m_hotStandby->setPrimary(m_activeConfig);
+}
+
+QString MainWindow::activeProfileKey() const
+{
+    if (m_activeConfigPath == m_configFilePath || m_configManager->configCount() == 0)
+        return QStringLiteral("subscription");
+    return m_configManager->configId();
+}
+
+bool MainWindow::ensureCoreRunning()
+{
+    if (m_proxyManager->proxyProcessState() != QProcess::Running) {
+        QMessageBox::information(this, tr("Information"), tr("Start the proxy first."));
+        return false;
+    }
+    if (!m_clashApi->isAvailable()) {
+        QMessageBox::information(this, tr("Information"),
+                                 tr("The running sing-box has no Clash API (with_clash_api)."));
+        return false;
+    }
+    return true;
+}
+
+void MainWindow::updateValidatorCorePath()
+{
+    SettingsManager settingsManager;
+    m_configValidator->setCorePath(settingsManager.checkConfigWithCore()
+                                       ? m_proxyManager->corePath() : QString());
+}
+
+void MainWindow::updateCorePath()
+{
+    QString pinnedVersion;
+    if (m_configManager->configCount() != 0)
+        pinnedVersion = m_configManager->profileStore()->profile(m_configManager->configId()).coreVersion();
+    m_proxyManager->setCorePath(m_coreManager->corePath(pinnedVersion));
+    m_ruleSetCache->setCorePath(m_proxyManager->corePath());
+    updateValidatorCorePath();
 }
 
 // New subscription slot implementations
@@ -339,6 +892,7 @@ void MainWindow::on_saveUrlButton_clicked()
     
     m_subscriptionUrl = url;
     saveSubscriptionUrl();
+    loadSubscriptionTls();
     
     // Start the timer and fetch config immediately
     updateConfigStatus(tr("Saving URL and fetching config..."));
@@ -359,24 +913,41 @@ void MainWindow::on_updateConfigButton_clicked()
     updateSubscriptionConfig();
 }
 
+void MainWindow::on_tlsButton_clicked()
+{
+    // The settings belong to the subscription's host
+    if (m_subscriptionUrl.isEmpty()) {
+        QMessageBox::information(this, tr("Information"), tr("Save a subscription URL first."));
+        return;
+    }
+    SubscriptionTlsDialog subscriptionTlsDialog(m_subscriptionTls, m_subscriptionUrl, this);
+    subscriptionTlsDialog.exec();
+}
+
 void MainWindow::updateSubscriptionConfig()
 {
     if (m_subscriptionUrl.isEmpty()) {
         return;
     }
-    
-    if (m_currentReply) {
-        m_currentReply->abort();
-        m_currentReply->deleteLater();
-        m_currentReply = nullptr;
+    if (!m_connectivityMonitor->isOnline()) {
+        updateConfigStatus(tr("Offline, the subscription is checked once the network is back"));
+        return;
     }
     
     QUrl url(m_subscriptionUrl);
-    QNetworkRequest request(url);
-    request.setHeader(QNetworkRequest::UserAgentHeader, "qsing-box/" + QString(PROJECT_VERSION));
-    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    if (m_currentReply) {
+        // Aborting would drop the connection the next poll wants to reuse,
+        // the transfer timeout ends a stuck request anyway
+        if (m_currentReply->request().url() == url)
+            return;
+        abortDownload();
+    }
+    // Without the file a 304 would leave nothing to load
+    if (!QFile::exists(m_configFilePath))
+        m_subscriptionFetcher->forget(url);
     
-    m_currentReply = m_networkManager->get(request);
+    m_currentReply = m_subscriptionFetcher->get(url);
+    m_fetchClock.start();
     connect(m_currentReply, &QNetworkReply::finished, this, &MainWindow::onConfigDownloadFinished);
     connect(m_currentReply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::errorOccurred),
             this, &MainWindow::onConfigDownloadError);
@@ -390,61 +961,30 @@ void MainWindow::onConfigDownloadFinished()
         return;
     }
     
+    Metrics *metrics = Metrics::instance();
     if (m_currentReply->error() == QNetworkReply::NoError) {
+        ++metrics->fetches;
+        metrics->fetchTimeSum += m_fetchClock.elapsed();
+        // A downloaded body is counted once applyDownloadedConfig() decides on it
+        if (SubscriptionFetcher::isNotModified(m_currentReply))
+            ++metrics->fetchesNotModified;
+    }
+
+    if (m_currentReply->error() == QNetworkReply::NoError
+        && SubscriptionFetcher::isNotModified(m_currentReply)) {
+        updateConfigStatus(tr("Status: Up to date (checked %1)")
+                               .arg(QDateTime::currentDateTime().toString("hh:mm:ss")));
+    } else if (m_currentReply->error() == QNetworkReply::NoError) {
         QByteArray configData = m_currentReply->readAll();
+        metrics->fetchBytes += configData.size();
         
         if (!configData.isEmpty()) {
-            // Validate downloaded config
-            QJsonParseError error;
-            QJsonDocument jsonDoc = QJsonDocument::fromJson(configData, &error);
-            
-            if (error.error != QJsonParseError::NoError) {
-                updateConfigStatus(tr("Error: Downloaded config is not valid JSON"));
-                ui->configPreviewEdit->setPlainText(QString("Error: Invalid JSON downloaded.\nParse error: %1\n\nRaw content:\n%2")
-                                                  .arg(error.errorString())
-                                                  .arg(QString::fromUtf8(configData)));
-                m_currentReply->deleteLater();
-                m_currentReply = nullptr;
-                return;
-            }
-            
-            if (!jsonDoc.isObject()) {
-                updateConfigStatus(tr("Error: Downloaded config is not a JSON object"));
-                ui->configPreviewEdit->setPlainText("Error: Downloaded config is not a valid JSON object");
-                m_currentReply->deleteLater();
-                m_currentReply = nullptr;
-                return;
-            }
-            
-            QJsonObject config = jsonDoc.object();
-            if (!config.contains("inbounds") && !config.contains("outbounds")) {
-                updateConfigStatus(tr("Error: Downloaded config missing required sections"));
-                ui->configPreviewEdit->setPlainText("Error: Downloaded configuration is missing required 'inbounds' or 'outbounds' sections.\nThis doesn't appear to be a valid sing-box configuration.");
-                m_currentReply->deleteLater();
-                m_currentReply = nullptr;
-                return;
-            }
-            
-            // Config is valid, display preview
-            QString configText = jsonDoc.toJson(QJsonDocument::Indented);
-            ui->configPreviewEdit->setPlainText(configText);
-            
-            // Save to file
-            QFile file(m_configFilePath);
-            if (file.open(QIODevice::WriteOnly)) {
-                file.write(configData);
-                file.close();
-                
-                updateConfigStatus(tr("Config updated successfully. Last update: %1")
-                                  .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")));
-                
-                // Update proxy config if running
-                changeSelectedConfig();
-            } else {
-                updateConfigStatus(tr("Error: Failed to save config file"));
-                ui->configPreviewEdit->setPlainText("Error: Failed to save config file");
-            }
+            // Validated off the GUI thread, applied in onConfigValidationFinished()
+            updateValidatorCorePath();
+            m_downloadValidationId = m_configValidator->validateData(configData);
+            updateConfigStatus(tr("Validating downloaded config..."));
         } else {
+            ++metrics->fetchesRejected;
             updateConfigStatus(tr("Error: Empty config received"));
             ui->configPreviewEdit->setPlainText("Error: Empty config received from subscription URL");
         }
@@ -457,10 +997,17 @@ void MainWindow::onConfigDownloadFinished()
 void MainWindow::onConfigDownloadError(QNetworkReply::NetworkError error)
 {
     if (m_currentReply) {
+        ++Metrics::instance()->fetches;
+        ++Metrics::instance()->fetchesFailed;
+        Metrics::instance()->fetchTimeSum += m_fetchClock.elapsed();
         QString errorString = m_currentReply->errorString();
         
         // Provide specific error handling for TLS issues
-        if (error == QNetworkReply::SslHandshakeFailedError || 
+        if (!m_subscriptionTls->lastError().isEmpty()) {
+            updateConfigStatus(tr("TLS Error: %1").arg(m_subscriptionTls->lastError()));
+            ui->configPreviewEdit->setPlainText(QString("TLS Error: %1\n\nCheck the pinned keys under TLS...")
+                                                    .arg(m_subscriptionTls->lastError()));
+        } else if (error == QNetworkReply::SslHandshakeFailedError || 
             errorString.contains("tls initialization failed", Qt::CaseInsensitive) ||
             errorString.contains("ssl", Qt::CaseInsensitive)) {
             
@@ -478,11 +1025,60 @@ void MainWindow::onConfigDownloadError(QNetworkReply::NetworkError error)
     }
 }
 
+void MainWindow::abortDownload()
+{
+    if (!m_currentReply)
+        return;
+    // Cleared first, abort() emits the error and finished signals right away
+    QNetworkReply *reply = m_currentReply;
+    m_currentReply = nullptr;
+    reply->abort();
+    reply->deleteLater();
+}
+
+void MainWindow::pauseWhileOffline()
+{
+    m_updateTimer->stop();
+    abortDownload();
+    ui->outputEdit->appendPlainText(tr("Network is unreachable, subscription updates are paused."));
+    if (!m_subscriptionUrl.isEmpty())
+        updateConfigStatus(tr("Offline, subscription updates paused"));
+}
+
+void MainWindow::recoverFromNetworkChange(const QString &reason)
+{
+    ui->outputEdit->appendPlainText(tr("Network changed: %1.").arg(reason));
+
+    // Pooled connections belong to the old network
+    abortDownload();
+    m_subscriptionFetcher->dropConnections();
+    if (!m_subscriptionUrl.isEmpty()) {
+        // Conditional, costs one 304 when nothing changed
+        updateSubscriptionConfig();
+        m_updateTimer->start();
+    }
+
+    SettingsManager settingsManager;
+    if (!settingsManager.dropConnectionsOnNetworkChange()
+        || m_proxyManager->proxyProcessState() != QProcess::Running)
+        return;
+    if (m_clashApi->isAvailable()) {
+        // Much faster than a restart and the system proxy stays in place
+        QNetworkReply *reply = m_clashApi->closeConnections();
+        connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
+        ui->outputEdit->appendPlainText(tr("Closed the core's open connections."));
+    } else {
+        stopProxy();
+        startProxy();
+        ui->outputEdit->appendPlainText(tr("Restarted the core to drop stale connections."));
+    }
+}
+
 void MainWindow::loadSubscriptionUrl()
 {
-    QSettings settings;
-    m_subscriptionUrl = settings.value("subscription/url", "").toString();
+    m_subscriptionUrl = SettingsStore::instance()->value("subscription/url", "").toString();
     ui->subscriptionUrlEdit->setText(m_subscriptionUrl);
+    loadSubscriptionTls();
     
     if (!m_subscriptionUrl.isEmpty()) {
         updateConfigStatus(tr("Subscription URL loaded. Fetching config..."));
@@ -496,9 +1092,20 @@ void MainWindow::loadSubscriptionUrl()
 
 void MainWindow::saveSubscriptionUrl()
 {
-    QSettings settings;
-    settings.setValue("subscription/url", m_subscriptionUrl);
-    settings.sync();
+    SettingsStore::instance()->setValue("subscription/url", m_subscriptionUrl);
+}
+
+void MainWindow::loadSubscriptionTls()
+{
+    QString host = QUrl(m_subscriptionUrl).host();
+    if (host.isEmpty())
+        return;
+    SettingsManager settingsManager;
+    SubscriptionTls::Options options;
+    options.verify = settingsManager.subscriptionVerifyTls(host);
+    options.pins = settingsManager.subscriptionPins(host);
+    options.caFile = settingsManager.subscriptionCaFile(host);
+    m_subscriptionTls->setOptions(host, options);
 }
 
 void MainWindow::updateConfigStatus(const QString &message)
@@ -506,6 +1113,18 @@ void MainWindow::updateConfigStatus(const QString &message)
     ui->configStatusLabel->setText(message);
 }
 
+void MainWindow::showConfigChangeLog(const ConfigDiff &diff)
+{
+    QStringList changeLog = diff.changeLog();
+    ui->configStatusLabel->setToolTip(changeLog.join("\n"));
+
+    // Restarting the core clears the log view, so append afterwards
+    ui->outputEdit->appendPlainText(tr("Subscription config changed: %1").arg(diff.summary()));
+    for (const QString &line : changeLog) {
+        ui->outputEdit->appendPlainText("  " + line);
+    }
+}
+
 bool MainWindow::isValidUrl(const QString &url)
 {
     QUrl qurl(url);
@@ -1,18 +1,37 @@
 #ifndef MAIN_WINDOW_H
 #define MAIN_WINDOW_H
 
+#include <QElapsedTimer>
+#include <QJsonObject>
 #include <QMainWindow>
 #include <QProcess>
 #include <QTimer>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 
+#include "clash_api.h"
+#include "config_diff.h"
 #include "config_manager.h"
+#include "config_validator.h"
+#include "config_watcher.h"
+#include "connectivity_monitor.h"
+#include "core_manager.h"
+#include "hot_standby.h"
+#include "log_governor.h"
+#include "log_table.h"
+#include "metrics_server.h"
+#include "outbound_health.h"
+#include "outbound_selector.h"
+#include "rule_set_cache.h"
+#include "subscription_fetcher.h"
+#include "subscription_tls.h"
 #include "proxy_manager.h"
+#include "resource_monitor.h"
+#include "traffic_accounting.h"
 #include "tray_icon.h"
 
 QT_BEGIN_NAMESPACE
 class QLabel;
+class QMenu;
 
 namespace Ui {
 class MainWindow;
@@ -41,7 +60,20 @@ private slots:
     void on_startButton_clicked();
     void on_stopButton_clicked();
     void on_settingsButton_clicked();
+    void on_profilesButton_clicked();
     void on_aboutButton_clicked();
+    void openThroughputBenchmark();
+    void openTrafficDashboard();
+    void openDnsBenchmark();
+    void openCores();
+    void openProfileComparison();
+    void openRouteTest();
+    void openConnectionStats();
+    // Check the active config with another core, then use it by default
+    // or pin it to the selected profile
+    void switchCore(const QString &version, bool pin);
+    void showResourceSample(const ResourceSample &sample);
+    void warnMemoryGrowing(qint64 bytesPerMinute);
     void on_addButton_clicked();
     void on_editButton_clicked();
     void on_deleteButton_clicked();
@@ -51,10 +83,12 @@ private slots:
     // New subscription slots
     void on_saveUrlButton_clicked();
     void on_updateConfigButton_clicked();
+    void on_tlsButton_clicked();
 
     void enableButton(int currentRow);
 
     void displayProxyOutput();
+    void showLogThrottling(bool throttling);
     void updateConfigList();
 
     // when the state of the proxy has changed,
@@ -64,32 +98,105 @@ private slots:
     // Click on the system tray, then execute this slot function
     void showMainWindow(int reason);
     void changeSelectedConfig();
+    // The active config file was changed by another program
+    void reloadChangedConfig(const QString &filePath);
+    void updateWatchedFiles();
 
     // Subscription functionality
     void updateSubscriptionConfig();
     void onConfigDownloadFinished();
     void onConfigDownloadError(QNetworkReply::NetworkError error);
+    void onConfigValidationFinished(const ConfigValidationResult &result);
+    void pauseWhileOffline();
+    // Open connections may be dead after a network change or sleep
+    void recoverFromNetworkChange(const QString &reason);
+    // Tell when newly cached rule-sets will reach the core on its next start
+    void noteRuleSetUpdate();
 
 private:
+    // Subscription config if there is one, otherwise the selected profile
+    QString selectedConfigFilePath() const;
+    void abortDownload();
     void loadSubscriptionUrl();
     void saveSubscriptionUrl();
+    // Hands the TLS settings of the subscription's host to m_subscriptionTls
+    void loadSubscriptionTls();
     void updateConfigStatus(const QString &message);
+    void showConfigChangeLog(const ConfigDiff &diff);
+    void applyConfig(const ConfigValidationResult &result, const QString &status);
+    void applyDownloadedConfig(const ConfigValidationResult &result);
+    void updateValidatorCorePath();
+    // Point the proxy manager at the core of the selected profile
+    void updateCorePath();
+    // Write the config the core actually runs and point the proxy manager at it
+    void prepareLaunchConfig();
+    void startOutboundSelector();
+    // Parses the log lines the governor kept for the connection table and
+    // outbound health
+    void feedLogTable(const QByteArray &data);
+    // Start, switch or stop the standby core to match the settings
+    void updateHotStandby();
+    // Profile id of the active config, "subscription" for the subscription,
+    // for results kept per profile
+    QString activeProfileKey() const;
+    // Tools talk to the running core, false after telling the user it is not
+    bool ensureCoreRunning();
     bool isValidUrl(const QString &url);
     QString checkOpenSSLStatus();
 
     Ui::MainWindow *ui;
     QLabel *m_versionLabel;
+    QLabel *m_resourceLabel;
+    QLabel *m_logLabel;
+    QMenu *m_toolsMenu;
 
     TrayIcon *m_trayIcon;
     ConfigManager *m_configManager;
     ProxyManager *m_proxyManager;
+    CoreManager *m_coreManager;
+    ConfigValidator *m_configValidator;
+    // Pending validation requests, 0 when idle
+    quint64 m_configValidationId = 0;
+    quint64 m_downloadValidationId = 0;
+    bool m_startAfterValidation = false;
+    RuleSetCache *m_ruleSetCache;
+    ConfigWatcher *m_configWatcher;
+    ConnectivityMonitor *m_connectivityMonitor;
+    ClashApi *m_clashApi;
+    OutboundSelector *m_outboundSelector;
+    TrafficAccounting *m_trafficAccounting;
+    ResourceMonitor *m_resourceMonitor;
+    LogGovernor *m_logGovernor;
+    // Every core log line as a record, shown or not
+    LogTable m_logTable;
+    OutboundHealth m_outboundHealth;
+    // Set once a throttled core should run at info level from its next start
+    bool m_capLogLevel = false;
+    HotStandby *m_hotStandby;
+    QString m_hotStandbyId;
+    // Set while the core is stopped on purpose, an exit otherwise is a failure
+    bool m_stoppingProxy = false;
+    MetricsServer *m_metricsServer;
+    // Time to ready of the current core, stopped once it is known
+    QElapsedTimer m_coreStartClock;
+    bool m_coreReady = false;
+    QElapsedTimer m_fetchClock;
 
     // Subscription functionality
     QTimer *m_updateTimer;
-    QNetworkAccessManager *m_networkManager;
+    SubscriptionFetcher *m_subscriptionFetcher;
+    SubscriptionTls *m_subscriptionTls;
     QNetworkReply *m_currentReply;
     QString m_subscriptionUrl;
     QString m_configFilePath;
+    QString m_launchConfigFilePath;
+    // Route of the launch config, to tell whether a rule-set update concerns the core
+    QJsonValue m_launchRoute;
+    // Several rule-sets cached together are noted once
+    QTimer *m_ruleSetUpdateTimer;
+    // Parsed config the core is currently using and the file it came from
+    QJsonObject m_activeConfig;
+    QString m_activeConfigPath;
 };
 
 #endif // MAIN_WINDOW_H
@@ -0,0 +1,107 @@
+#include "connectivity_monitor.h"
+
+#include <QNetworkInformation>
+#include <QTimer>
+
+namespace {
+
+// Quiet time after the last change before it is reported
+const int kSettleInterval = 2000;
+const int kHeartbeatInterval = 5000;
+// A heartbeat this late means the machine was suspended
+const qint64 kSleepThreshold = 30000;
+
+bool isReachable(QNetworkInformation::Reachability reachability)
+{
+    // Local or site reachability still lets a proxy on the LAN work
+    return reachability != QNetworkInformation::Reachability::Disconnected;
+}
+
+} // namespace
+
+ConnectivityMonitor::ConnectivityMonitor(QObject *parent)
+    : QObject{parent}
+{
+    m_settleTimer = new QTimer(this);
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(kSettleInterval);
+    connect(m_settleTimer, &QTimer::timeout, this, &ConnectivityMonitor::settle);
+
+    m_heartbeatTimer = new QTimer(this);
+    m_heartbeatTimer->setInterval(kHeartbeatInterval);
+    connect(m_heartbeatTimer, &QTimer::timeout, this, &ConnectivityMonitor::checkHeartbeat);
+    m_lastHeartbeat = QDateTime::currentDateTimeUtc();
+    m_heartbeatTimer->start();
+
+    if (!QNetworkInformation::loadDefaultBackend()
+        || !QNetworkInformation::instance()->supports(QNetworkInformation::Feature::Reachability)) {
+        qDebug() << "No network information backend, network changes are not followed";
+        return;
+    }
+
+    QNetworkInformation *information = QNetworkInformation::instance();
+    m_online = information->reachability() == QNetworkInformation::Reachability::Unknown
+               || isReachable(information->reachability());
+    connect(information, &QNetworkInformation::reachabilityChanged, this,
+            &ConnectivityMonitor::onReachabilityChanged);
+    connect(information, &QNetworkInformation::transportMediumChanged, this,
+            &ConnectivityMonitor::onTransportMediumChanged);
+}
+
+bool ConnectivityMonitor::isOnline() const
+{
+    return m_online;
+}
+
+void ConnectivityMonitor::onReachabilityChanged()
+{
+    QNetworkInformation::Reachability reachability = QNetworkInformation::instance()->reachability();
+    if (reachability == QNetworkInformation::Reachability::Unknown)
+        return;
+
+    bool online = isReachable(reachability);
+    if (online == m_online) {
+        // e.g. Online to Site while a VPN comes up
+        schedule(QString("reachability changed"));
+        return;
+    }
+    m_online = online;
+    if (!online) {
+        // Reported at once, so nothing is attempted while offline
+        m_settleTimer->stop();
+        m_reasons.clear();
+        emit wentOffline();
+        return;
+    }
+    schedule(QString("network is back"));
+}
+
+void ConnectivityMonitor::onTransportMediumChanged()
+{
+    schedule(QString("switched to another network"));
+}
+
+void ConnectivityMonitor::checkHeartbeat()
+{
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    qint64 elapsed = m_lastHeartbeat.msecsTo(now);
+    m_lastHeartbeat = now;
+    if (elapsed > kHeartbeatInterval + kSleepThreshold)
+        schedule(QString("resumed from sleep"));
+}
+
+void ConnectivityMonitor::settle()
+{
+    if (!m_online || m_reasons.isEmpty())
+        return;
+    QString reason = m_reasons.join(", ");
+    m_reasons.clear();
+    emit networkChanged(reason);
+}
+
+void ConnectivityMonitor::schedule(const QString &reason)
+{
+    if (!m_reasons.contains(reason))
+        m_reasons.append(reason);
+    m_settleTimer->start();
+}
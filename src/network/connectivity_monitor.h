@@ -0,0 +1,47 @@
+#ifndef CONNECTIVITY_MONITOR_H
+#define CONNECTIVITY_MONITOR_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+// Follows reachability and the transport medium through
+// QNetworkInformation, and notices a resume from sleep by a heartbeat
+// timer that fired far too late. Flapping during a Wi-Fi switch or VPN
+// reconnect is merged into one networkChanged() once things settle.
+class ConnectivityMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConnectivityMonitor(QObject *parent = nullptr);
+
+    // True when the platform has no reachability information
+    bool isOnline() const;
+
+signals:
+    void wentOffline();
+    // Back online, on another network or awake again; open connections
+    // may be dead. reason is meant for the log.
+    void networkChanged(const QString &reason);
+
+private slots:
+    void onReachabilityChanged();
+    void onTransportMediumChanged();
+    void checkHeartbeat();
+    void settle();
+
+private:
+    void schedule(const QString &reason);
+
+    bool m_online = true;
+    QTimer *m_settleTimer;
+    QTimer *m_heartbeatTimer;
+    QDateTime m_lastHeartbeat;
+    QStringList m_reasons;
+};
+
+#endif // CONNECTIVITY_MONITOR_H
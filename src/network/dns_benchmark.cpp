@@ -0,0 +1,477 @@
+#include "dns_benchmark.h"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QNetworkAccessManager>
+#include <QNetworkProxy>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QSslSocket>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QUrl>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace {
+
+const int kDefaultQueryCount = 50;
+const int kDefaultConcurrency = 8;
+const int kDefaultTimeout = 2000;
+
+quint16 defaultPort(DnsServer::Protocol protocol)
+{
+    switch (protocol) {
+    case DnsServer::Tls:
+        return 853;
+    case DnsServer::Https:
+        return 443;
+    default:
+        return 53;
+    }
+}
+
+DnsServer::Protocol protocolOf(const QString &name)
+{
+    if (name == "udp")
+        return DnsServer::Udp;
+    if (name == "tcp")
+        return DnsServer::Tcp;
+    if (name == "tls")
+        return DnsServer::Tls;
+    if (name == "https")
+        return DnsServer::Https;
+    return DnsServer::Unsupported;
+}
+
+// Recursive A query for the name
+QByteArray buildQuery(quint16 id, const QString &domain)
+{
+    QByteArray query;
+    query.reserve(32 + domain.size());
+    char header[12] = {};
+    qToBigEndian<quint16>(id, header);
+    header[2] = 0x01; // RD
+    header[5] = 0x01; // QDCOUNT = 1
+    query.append(header, sizeof(header));
+    const QList<QByteArray> labels = QUrl::toAce(domain).split('.');
+    for (const QByteArray &label : labels) {
+        if (label.isEmpty() || label.size() > 63)
+            continue;
+        query.append(char(label.size()));
+        query.append(label);
+    }
+    query.append('\0');
+    query.append("\x00\x01\x00\x01", 4); // QTYPE A, QCLASS IN
+    return query;
+}
+
+double percentile(const QList<qint64> &sorted, double fraction)
+{
+    if (sorted.isEmpty())
+        return -1;
+    int index = qBound(0, int(std::ceil(fraction * sorted.size())) - 1, int(sorted.size()) - 1);
+    return sorted.at(index);
+}
+
+// Sends the queries of one in-flight slot to a server, one after another.
+// Stream transports keep their connection between queries, so only the
+// first query of a slot pays for the handshake.
+class DnsProbe : public QObject
+{
+public:
+    DnsProbe(const DnsServer &server, QNetworkAccessManager *networkManager, int timeout,
+             std::function<bool(QString *)> takeQuery, std::function<void(bool, qint64)> report,
+             std::function<void()> done, QObject *parent)
+        : QObject{parent}
+        , m_server{server}
+        , m_networkManager{networkManager}
+        , m_takeQuery{std::move(takeQuery)}
+        , m_report{std::move(report)}
+        , m_done{std::move(done)}
+    {
+        m_timer = new QTimer(this);
+        m_timer->setSingleShot(true);
+        m_timer->setInterval(timeout);
+        connect(m_timer, &QTimer::timeout, this, &DnsProbe::fail);
+
+        if (m_server.protocol == DnsServer::Udp) {
+            m_udpSocket = new QUdpSocket(this);
+            m_udpSocket->setProxy(QNetworkProxy::NoProxy);
+            connect(m_udpSocket, &QUdpSocket::connected, this, &DnsProbe::writePending);
+            connect(m_udpSocket, &QUdpSocket::readyRead, this, [this]() {
+                while (m_udpSocket->hasPendingDatagrams())
+                    answer(m_udpSocket->receiveDatagram().data());
+            });
+            connect(m_udpSocket, &QUdpSocket::errorOccurred, this, &DnsProbe::fail);
+        } else if (m_server.protocol == DnsServer::Tcp || m_server.protocol == DnsServer::Tls) {
+            m_streamSocket = new QSslSocket(this);
+            m_streamSocket->setProxy(QNetworkProxy::NoProxy);
+            if (m_server.protocol == DnsServer::Tls)
+                connect(m_streamSocket, &QSslSocket::encrypted, this, &DnsProbe::writePending);
+            else
+                connect(m_streamSocket, &QSslSocket::connected, this, &DnsProbe::writePending);
+            connect(m_streamSocket, &QSslSocket::readyRead, this, &DnsProbe::readStream);
+            connect(m_streamSocket, &QSslSocket::errorOccurred, this, &DnsProbe::fail);
+        }
+    }
+
+    ~DnsProbe()
+    {
+        QNetworkReply *reply = m_reply;
+        m_reply = nullptr;
+        if (reply)
+            reply->abort();
+    }
+
+    void next()
+    {
+        QString domain;
+        if (!m_takeQuery(&domain)) {
+            m_done();
+            return;
+        }
+        m_id = static_cast<quint16>(QRandomGenerator::global()->generate());
+        m_query = buildQuery(m_id, domain);
+        m_inFlight = true;
+        m_clock.start();
+        m_timer->start();
+        send();
+    }
+
+private:
+    void send()
+    {
+        switch (m_server.protocol) {
+        case DnsServer::Udp:
+            if (m_udpSocket->state() == QAbstractSocket::ConnectedState)
+                writePending();
+            else if (m_udpSocket->state() == QAbstractSocket::UnconnectedState)
+                m_udpSocket->connectToHost(m_server.host, m_server.port);
+            break;
+        case DnsServer::Tcp:
+            if (m_streamSocket->state() == QAbstractSocket::ConnectedState)
+                writePending();
+            else if (m_streamSocket->state() == QAbstractSocket::UnconnectedState)
+                m_streamSocket->connectToHost(m_server.host, m_server.port);
+            break;
+        case DnsServer::Tls:
+            if (m_streamSocket->isEncrypted())
+                writePending();
+            else if (m_streamSocket->state() == QAbstractSocket::UnconnectedState)
+                m_streamSocket->connectToHostEncrypted(
+                    m_server.host, m_server.port,
+                    m_server.serverName.isEmpty() ? m_server.host : m_server.serverName);
+            break;
+        case DnsServer::Https: {
+            QUrl url;
+            url.setScheme("https");
+            url.setHost(m_server.host);
+            url.setPort(m_server.port);
+            url.setPath(m_server.path);
+            QNetworkRequest request(url);
+            request.setHeader(QNetworkRequest::ContentTypeHeader, "application/dns-message");
+            request.setRawHeader("Accept", "application/dns-message");
+            QNetworkReply *reply = m_networkManager->post(request, m_query);
+            m_reply = reply;
+            connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+                reply->deleteLater();
+                if (reply != m_reply)
+                    return;
+                m_reply = nullptr;
+                if (reply->error() != QNetworkReply::NoError)
+                    fail();
+                else
+                    answer(reply->readAll());
+            });
+            break;
+        }
+        case DnsServer::Unsupported:
+            fail();
+            break;
+        }
+    }
+
+    void writePending()
+    {
+        if (!m_inFlight)
+            return;
+        if (m_server.protocol == DnsServer::Udp) {
+            m_udpSocket->write(m_query);
+            return;
+        }
+        // DNS over a stream is prefixed with the message length
+        char length[2];
+        qToBigEndian<quint16>(static_cast<quint16>(m_query.size()), length);
+        m_streamSocket->write(length, sizeof(length));
+        m_streamSocket->write(m_query);
+    }
+
+    void readStream()
+    {
+        m_buffer.append(m_streamSocket->readAll());
+        while (m_buffer.size() >= 2) {
+            quint16 length = qFromBigEndian<quint16>(m_buffer.constData());
+            if (m_buffer.size() < 2 + length)
+                break;
+            QByteArray message = m_buffer.mid(2, length);
+            m_buffer.remove(0, 2 + length);
+            answer(message);
+        }
+    }
+
+    void answer(const QByteArray &message)
+    {
+        // Late answers to queries that already timed out are dropped
+        if (!m_inFlight || message.size() < 12 || qFromBigEndian<quint16>(message.constData()) != m_id)
+            return;
+        m_inFlight = false;
+        m_timer->stop();
+        bool response = message.at(2) & 0x80;
+        int rcode = message.at(3) & 0x0f;
+        // NXDOMAIN is still an answer, SERVFAIL and REFUSED are not
+        bool ok = response && (rcode == 0 || rcode == 3);
+        m_report(ok, m_clock.elapsed());
+        QTimer::singleShot(0, this, &DnsProbe::next);
+    }
+
+    void fail()
+    {
+        if (!m_inFlight)
+            return;
+        m_inFlight = false;
+        m_timer->stop();
+        m_report(false, m_clock.elapsed());
+        if (m_streamSocket) {
+            m_streamSocket->abort();
+            m_buffer.clear();
+        }
+        if (m_reply) {
+            QNetworkReply *reply = m_reply;
+            m_reply = nullptr;
+            reply->abort();
+        }
+        QTimer::singleShot(0, this, &DnsProbe::next);
+    }
+
+    DnsServer m_server;
+    QNetworkAccessManager *m_networkManager;
+    std::function<bool(QString *)> m_takeQuery;
+    std::function<void(bool, qint64)> m_report;
+    std::function<void()> m_done;
+
+    QTimer *m_timer;
+    QUdpSocket *m_udpSocket = nullptr;
+    QSslSocket *m_streamSocket = nullptr;
+    QNetworkReply *m_reply = nullptr;
+    QByteArray m_buffer;
+
+    bool m_inFlight = false;
+    quint16 m_id = 0;
+    QByteArray m_query;
+    QElapsedTimer m_clock;
+};
+
+} // namespace
+
+DnsBenchmark::DnsBenchmark(QObject *parent)
+    : QObject{parent}
+    , m_queryCount{kDefaultQueryCount}
+    , m_concurrency{kDefaultConcurrency}
+    , m_timeout{kDefaultTimeout}
+    , m_domains{"www.google.com", "www.youtube.com", "github.com", "www.cloudflare.com",
+                "www.wikipedia.org", "www.apple.com", "www.microsoft.com", "www.amazon.com"}
+{
+    m_networkManager = new QNetworkAccessManager(this);
+    m_networkManager->setProxy(QNetworkProxy::NoProxy);
+}
+
+DnsBenchmark::~DnsBenchmark()
+{
+    qDeleteAll(m_probes);
+}
+
+QList<DnsServer> DnsBenchmark::servers(const QJsonObject &config)
+{
+    QList<DnsServer> servers;
+    const QJsonArray array = config.value("dns").toObject().value("servers").toArray();
+    for (const QJsonValue &value : array) {
+        QJsonObject object = value.toObject();
+        DnsServer server;
+        server.tag = object.value("tag").toString();
+        server.detour = object.value("detour").toString();
+
+        if (object.contains("address")) {
+            server.address = object.value("address").toString();
+            if (server.address.contains("://")) {
+                QUrl url(server.address);
+                server.protocol = protocolOf(url.scheme());
+                server.host = url.host();
+                server.port = static_cast<quint16>(url.port(defaultPort(server.protocol)));
+                server.path = url.path();
+            } else if (server.address != "local" && server.address != "fakeip") {
+                // A bare address is plain UDP
+                server.protocol = DnsServer::Udp;
+                server.host = server.address;
+                server.port = defaultPort(server.protocol);
+            }
+        } else {
+            server.protocol = protocolOf(object.value("type").toString());
+            server.host = object.value("server").toString();
+            server.port = static_cast<quint16>(object.value("server_port").toInt(defaultPort(server.protocol)));
+            server.path = object.value("path").toString();
+            server.serverName = object.value("tls").toObject().value("server_name").toString();
+            server.address = server.host.isEmpty()
+                                 ? object.value("type").toString()
+                                 : QString("%1://%2").arg(object.value("type").toString(), server.host);
+        }
+
+        if (server.protocol == DnsServer::Https && server.path.isEmpty())
+            server.path = "/dns-query";
+        if (server.host.isEmpty())
+            server.protocol = DnsServer::Unsupported;
+        servers.append(server);
+    }
+    return servers;
+}
+
+void DnsBenchmark::reorderServers(QJsonObject &config, const QStringList &order)
+{
+    QJsonObject dns = config.value("dns").toObject();
+    const QJsonArray servers = dns.value("servers").toArray();
+    if (order.isEmpty() || servers.size() < 2)
+        return;
+
+    QJsonArray reordered;
+    QList<bool> moved(servers.size(), false);
+    for (const QString &tag : order) {
+        for (int i = 0; i < servers.size(); ++i) {
+            QJsonObject server = servers.at(i).toObject();
+            if (!moved.at(i) && server.value("tag").toString() == tag && !server.contains("detour")) {
+                reordered.append(servers.at(i));
+                moved[i] = true;
+                break;
+            }
+        }
+    }
+    for (int i = 0; i < servers.size(); ++i) {
+        if (!moved.at(i))
+            reordered.append(servers.at(i));
+    }
+
+    dns.insert("servers", reordered);
+    config.insert("dns", dns);
+}
+
+void DnsBenchmark::setQueryCount(int count)
+{
+    m_queryCount = qMax(1, count);
+}
+
+void DnsBenchmark::setConcurrency(int concurrency)
+{
+    m_concurrency = qMax(1, concurrency);
+}
+
+void DnsBenchmark::setTimeout(int milliseconds)
+{
+    m_timeout = qMax(100, milliseconds);
+}
+
+void DnsBenchmark::setDomains(const QStringList &domains)
+{
+    if (!domains.isEmpty())
+        m_domains = domains;
+}
+
+void DnsBenchmark::run(const QList<DnsServer> &servers)
+{
+    if (m_running || servers.isEmpty())
+        return;
+    m_running = true;
+    m_queue = servers;
+    nextServer();
+}
+
+void DnsBenchmark::cancel()
+{
+    if (!m_running)
+        return;
+    m_queue.clear();
+    qDeleteAll(m_probes);
+    m_probes.clear();
+    m_activeProbes = 0;
+    m_running = false;
+    emit finished();
+}
+
+bool DnsBenchmark::isRunning() const
+{
+    return m_running;
+}
+
+void DnsBenchmark::nextServer()
+{
+    m_server = DnsServer();
+    while (!m_queue.isEmpty()) {
+        m_server = m_queue.takeFirst();
+        m_result = Result();
+        m_result.tag = m_server.tag;
+        if (m_server.isTestable())
+            break;
+        emit serverFinished(m_result);
+    }
+    if (!m_server.isTestable()) {
+        m_running = false;
+        emit finished();
+        return;
+    }
+
+    emit serverStarted(m_server.tag);
+    m_queued = 0;
+    m_latencies.clear();
+    m_activeProbes = qMin(m_concurrency, m_queryCount);
+
+    auto takeQuery = [this](QString *domain) {
+        if (m_queued >= m_queryCount)
+            return false;
+        *domain = m_domains.at(m_queued % m_domains.size());
+        ++m_queued;
+        ++m_result.sent;
+        return true;
+    };
+    auto report = [this](bool ok, qint64 latency) {
+        if (ok)
+            m_latencies.append(latency);
+        else
+            ++m_result.failures;
+    };
+    for (int i = 0; i < m_activeProbes; ++i) {
+        auto *probe = new DnsProbe(m_server, m_networkManager, m_timeout, takeQuery, report,
+                                   [this]() { probeFinished(); }, this);
+        m_probes.append(probe);
+        probe->next();
+    }
+}
+
+void DnsBenchmark::probeFinished()
+{
+    if (--m_activeProbes > 0)
+        return;
+
+    // The probes are still on the stack, let them unwind first
+    for (QObject *probe : std::as_const(m_probes))
+        probe->deleteLater();
+    m_probes.clear();
+
+    std::sort(m_latencies.begin(), m_latencies.end());
+    m_result.p50 = percentile(m_latencies, 0.50);
+    m_result.p95 = percentile(m_latencies, 0.95);
+    m_result.p99 = percentile(m_latencies, 0.99);
+    emit serverFinished(m_result);
+    nextServer();
+}
@@ -0,0 +1,103 @@
+#ifndef DNS_BENCHMARK_H
+#define DNS_BENCHMARK_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+QT_BEGIN_NAMESPACE
+class QNetworkAccessManager;
+QT_END_NAMESPACE
+
+// A resolver from the config's dns.servers, in either the legacy
+// "address" form or the typed form of newer sing-box releases
+struct DnsServer
+{
+    enum Protocol {
+        Udp,
+        Tcp,
+        Tls,
+        Https,
+        Unsupported
+    };
+
+    QString tag;
+    QString address;
+    Protocol protocol = Unsupported;
+    QString host;
+    quint16 port = 0;
+    QString path;
+    QString serverName;
+    // Outbound the core sends the queries through
+    QString detour;
+
+    // Queried directly, a detour would make the numbers meaningless
+    bool isTestable() const { return protocol != Unsupported && detour.isEmpty(); }
+};
+
+// Fires batches of A queries at resolvers, a few in flight at a time, and
+// reports latency percentiles and failure rates. Queries go out directly,
+// so servers with a detour are skipped.
+class DnsBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    struct Result
+    {
+        QString tag;
+        int sent = 0;
+        int failures = 0;
+        // Latency percentiles of answered queries in ms, -1 without answers
+        double p50 = -1;
+        double p95 = -1;
+        double p99 = -1;
+
+        double failureRate() const { return sent > 0 ? double(failures) / sent : 0; }
+    };
+
+    explicit DnsBenchmark(QObject *parent = nullptr);
+    ~DnsBenchmark();
+
+    static QList<DnsServer> servers(const QJsonObject &config);
+    // Moves the servers named in order to the front of dns.servers. The
+    // first server is the default resolver unless dns.final names one.
+    // Servers with a detour were never measured and keep their place.
+    static void reorderServers(QJsonObject &config, const QStringList &order);
+
+    void setQueryCount(int count);
+    void setConcurrency(int concurrency);
+    void setTimeout(int milliseconds);
+    void setDomains(const QStringList &domains);
+
+    // Benchmarks the servers one after another
+    void run(const QList<DnsServer> &servers);
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    void serverStarted(const QString &tag);
+    void serverFinished(const DnsBenchmark::Result &result);
+    void finished();
+
+private:
+    void nextServer();
+    void probeFinished();
+
+    QNetworkAccessManager *m_networkManager;
+    int m_queryCount;
+    int m_concurrency;
+    int m_timeout;
+    QStringList m_domains;
+
+    bool m_running = false;
+    QList<DnsServer> m_queue;
+    DnsServer m_server;
+    int m_queued = 0;
+    int m_activeProbes = 0;
+    Result m_result;
+    QList<qint64> m_latencies;
+    QList<QObject *> m_probes;
+};
+
+#endif // DNS_BENCHMARK_H
@@ -0,0 +1,146 @@
+#include "local_http_target.h"
+
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+namespace {
+
+const qint64 kChunkSize = 64 * 1024;
+// Keep this much queued so the socket never runs dry
+const qint64 kWriteWatermark = 4 * kChunkSize;
+const qint64 kMaxBody = qint64(1) << 32;
+const int kMaxHeaderSize = 16 * 1024;
+
+} // namespace
+
+LocalHttpTarget::LocalHttpTarget(QObject *parent)
+    : QObject{parent}
+{
+    m_server = new QTcpServer(this);
+    connect(m_server, &QTcpServer::newConnection, this, &LocalHttpTarget::acceptConnections);
+}
+
+bool LocalHttpTarget::listen()
+{
+    if (m_server->isListening())
+        return true;
+    return m_server->listen(QHostAddress::LocalHost);
+}
+
+void LocalHttpTarget::close()
+{
+    m_server->close();
+    const QList<QTcpSocket *> sockets = m_connections.keys();
+    for (QTcpSocket *socket : sockets)
+        socket->abort();
+}
+
+bool LocalHttpTarget::isListening() const
+{
+    return m_server->isListening();
+}
+
+QUrl LocalHttpTarget::url(const QString &path) const
+{
+    return QUrl(QString("http://127.0.0.1:%1%2").arg(m_server->serverPort()).arg(path));
+}
+
+void LocalHttpTarget::acceptConnections()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        m_connections.insert(socket, Connection());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            readRequests(socket);
+        });
+        connect(socket, &QTcpSocket::bytesWritten, this, [this, socket]() {
+            if (writeBody(socket))
+                readRequests(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_connections.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void LocalHttpTarget::readRequests(QTcpSocket *socket)
+{
+    // One response at a time, pipelined requests wait for the body
+    for (;;) {
+        auto it = m_connections.find(socket);
+        if (it == m_connections.end() || it->remaining > 0)
+            return;
+        it->buffer.append(socket->readAll());
+        if (it->skip > 0) {
+            qint64 size = qMin<qint64>(it->skip, it->buffer.size());
+            it->buffer.remove(0, size);
+            it->skip -= size;
+            if (it->skip > 0)
+                return;
+        }
+        qsizetype end = it->buffer.indexOf("\r\n\r\n");
+        if (end < 0) {
+            if (it->buffer.size() > kMaxHeaderSize)
+                socket->abort();
+            return;
+        }
+        QByteArray head = it->buffer.left(end);
+        it->buffer.remove(0, end + 4);
+
+        // Through an HTTP proxy the target is an absolute URL
+        QList<QByteArray> requestLine = head.left(head.indexOf("\r\n")).split(' ');
+        QByteArray path = requestLine.value(1);
+        qsizetype schemeEnd = path.indexOf("://");
+        if (schemeEnd >= 0) {
+            qsizetype slash = path.indexOf('/', schemeEnd + 3);
+            path = slash >= 0 ? path.mid(slash) : QByteArray("/");
+        }
+        bool headOnly = requestLine.value(0) == "HEAD";
+        QByteArray lowerHead = head.toLower();
+        it->closeAfterResponse = lowerHead.contains("\r\nconnection: close");
+        // Bodies are not used, e.g. a PUT of the clash API stub in tests
+        qsizetype lengthAt = lowerHead.indexOf("\r\ncontent-length:");
+        if (lengthAt >= 0) {
+            qsizetype valueAt = lengthAt + 17;
+            qsizetype lineEnd = lowerHead.indexOf("\r\n", valueAt);
+            it->skip = qBound<qint64>(0, head.mid(valueAt, lineEnd < 0 ? -1 : lineEnd - valueAt)
+                                             .trimmed().toLongLong(), kMaxBody);
+        }
+
+        qint64 length = 2;
+        if (path.startsWith("/bytes/"))
+            length = qBound<qint64>(0, path.mid(7).toLongLong(), kMaxBody);
+
+        QByteArray response = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n"
+                              "Content-Length: " + QByteArray::number(length) + "\r\n";
+        if (it->closeAfterResponse)
+            response += "Connection: close\r\n";
+        response += "\r\n";
+        socket->write(response);
+        it->remaining = headOnly ? 0 : length;
+        if (!writeBody(socket))
+            return;
+    }
+}
+
+bool LocalHttpTarget::writeBody(QTcpSocket *socket)
+{
+    auto it = m_connections.find(socket);
+    if (it == m_connections.end())
+        return false;
+
+    static const QByteArray chunk(kChunkSize, 'x');
+    while (it->remaining > 0 && socket->bytesToWrite() < kWriteWatermark) {
+        qint64 size = qMin(it->remaining, kChunkSize);
+        socket->write(chunk.constData(), size);
+        it->remaining -= size;
+    }
+    if (it->remaining > 0)
+        return false;
+    if (it->closeAfterResponse) {
+        socket->disconnectFromHost();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef LOCAL_HTTP_TARGET_H
+#define LOCAL_HTTP_TARGET_H
+
+#include <QHash>
+#include <QObject>
+#include <QUrl>
+
+QT_BEGIN_NAMESPACE
+class QTcpServer;
+class QTcpSocket;
+QT_END_NAMESPACE
+
+// Minimal HTTP/1.1 server on the loopback interface for benchmarks.
+// GET /bytes/<n> answers with n bytes, anything else with a two byte
+// body. Connections are kept alive unless the client asks otherwise.
+class LocalHttpTarget : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LocalHttpTarget(QObject *parent = nullptr);
+
+    bool listen();
+    void close();
+    bool isListening() const;
+    // http://127.0.0.1:<port><path>
+    QUrl url(const QString &path = QStringLiteral("/")) const;
+
+private slots:
+    void acceptConnections();
+
+private:
+    struct Connection
+    {
+        QByteArray buffer;
+        // Body bytes still to be written
+        qint64 remaining = 0;
+        // Request body bytes still to be read and dropped
+        qint64 skip = 0;
+        bool closeAfterResponse = false;
+    };
+
+    void readRequests(QTcpSocket *socket);
+    // True once the response is complete and the connection stays open
+    bool writeBody(QTcpSocket *socket);
+
+    QTcpServer *m_server;
+    QHash<QTcpSocket *, Connection> m_connections;
+};
+
+#endif // LOCAL_HTTP_TARGET_H
@@ -0,0 +1,91 @@
+#include "metrics.h"
+
+#include <QDateTime>
+
+namespace {
+
+// Two governor windows without output
+constexpr qint64 kRateTimeout = 2000;
+
+class Writer
+{
+public:
+    explicit Writer(QByteArray *text)
+        : m_text(text)
+    {
+    }
+
+    void family(const char *name, const char *type, const char *help)
+    {
+        m_text->append("# TYPE ").append(name).append(' ').append(type).append('\n');
+        m_text->append("# HELP ").append(name).append(' ').append(help).append('\n');
+    }
+
+    void sample(const char *name, const char *suffix, double value, const char *labels = nullptr)
+    {
+        m_text->append(name).append(suffix);
+        if (labels)
+            m_text->append('{').append(labels).append('}');
+        m_text->append(' ').append(QByteArray::number(value, 'g', 12)).append('\n');
+    }
+
+private:
+    QByteArray *m_text;
+};
+
+} // namespace
+
+Metrics *Metrics::instance()
+{
+    static Metrics metrics;
+    return &metrics;
+}
+
+QByteArray Metrics::render() const
+{
+    QByteArray text;
+    Writer writer(&text);
+
+    writer.family("qsingbox_core_up", "gauge", "Whether the sing-box core is running.");
+    writer.sample("qsingbox_core_up", "", coreUp.load());
+    writer.family("qsingbox_core_starts", "counter", "Core starts.");
+    writer.sample("qsingbox_core_starts", "_total", coreStarts.load());
+    writer.family("qsingbox_core_crashes", "counter", "Core exits that were not asked for.");
+    writer.sample("qsingbox_core_crashes", "_total", coreCrashes.load());
+    writer.family("qsingbox_core_ready_seconds", "gauge", "Time from the last start until the core was ready.");
+    if (qint64 readyTime = coreReadyTime.load(); readyTime >= 0)
+        writer.sample("qsingbox_core_ready_seconds", "", readyTime / 1000.0);
+    writer.family("qsingbox_core_cpu_ratio", "gauge", "CPU used by the core, share of all cores.");
+    writer.sample("qsingbox_core_cpu_ratio", "", coreCpu.load() / 1000.0);
+    writer.family("qsingbox_core_resident_bytes", "gauge", "Resident memory of the core.");
+    writer.sample("qsingbox_core_resident_bytes", "", coreResidentBytes.load());
+
+    writer.family("qsingbox_subscription_fetches", "counter", "Subscription fetches by result.");
+    writer.sample("qsingbox_subscription_fetches", "_total", fetchesUpdated.load(), "result=\"updated\"");
+    writer.sample("qsingbox_subscription_fetches", "_total", fetchesNotModified.load(), "result=\"not_modified\"");
+    writer.sample("qsingbox_subscription_fetches", "_total", fetchesUnchanged.load(), "result=\"unchanged\"");
+    writer.sample("qsingbox_subscription_fetches", "_total", fetchesRejected.load(), "result=\"rejected\"");
+    writer.sample("qsingbox_subscription_fetches", "_total", fetchesFailed.load(), "result=\"failed\"");
+    writer.family("qsingbox_subscription_fetch_seconds", "summary", "Time to fetch the subscription.");
+    writer.sample("qsingbox_subscription_fetch_seconds", "_count", fetches.load());
+    writer.sample("qsingbox_subscription_fetch_seconds", "_sum", fetchTimeSum.load() / 1000.0);
+    writer.family("qsingbox_subscription_received_bytes", "counter", "Subscription body bytes received.");
+    writer.sample("qsingbox_subscription_received_bytes", "_total", fetchBytes.load());
+
+    writer.family("qsingbox_config_bytes", "gauge", "Size of the active config.");
+    writer.sample("qsingbox_config_bytes", "", configBytes.load());
+    writer.family("qsingbox_config_parse_seconds", "gauge", "Time to parse and check the active config.");
+    if (qint64 parseTime = configParseTime.load(); parseTime >= 0)
+        writer.sample("qsingbox_config_parse_seconds", "", parseTime / 1000.0);
+
+    writer.family("qsingbox_log_lines", "counter", "Core log lines, including the ones the governor dropped.");
+    writer.sample("qsingbox_log_lines", "_total", logLines.load());
+    // The rate is only measured while output arrives, a quiet core reads 0
+    qint64 lineRate = QDateTime::currentMSecsSinceEpoch() - logLineRateTime.load() > kRateTimeout
+        ? 0 : logLineRate.load();
+    writer.family("qsingbox_log_lines_per_second", "gauge", "Core log lines over the last second.");
+    writer.sample("qsingbox_log_lines_per_second", "", lineRate);
+
+    text.append("# EOF\n");
+    return text;
+}
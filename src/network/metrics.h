@@ -0,0 +1,50 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QByteArray>
+
+#include <atomic>
+
+// Numbers for the metrics endpoint. Plain atomics, written on the paths
+// that produce them and read by the server thread without any locking.
+// Times are in ms, -1 until known.
+class Metrics
+{
+public:
+    static Metrics *instance();
+
+    std::atomic<int> coreUp{0};
+    std::atomic<qint64> coreStarts{0};
+    // Exits nobody asked for
+    std::atomic<qint64> coreCrashes{0};
+    // From starting the core to its "sing-box started" line
+    std::atomic<qint64> coreReadyTime{-1};
+    // Tenths of a percent of all cores
+    std::atomic<qint64> coreCpu{0};
+    std::atomic<qint64> coreResidentBytes{0};
+
+    // Fetches that ended, counted once the body is known to be applied or not
+    std::atomic<qint64> fetches{0};
+    std::atomic<qint64> fetchesUpdated{0};
+    std::atomic<qint64> fetchesNotModified{0};
+    // Downloaded but identical to the running config
+    std::atomic<qint64> fetchesUnchanged{0};
+    // Downloaded but empty, invalid or not saved
+    std::atomic<qint64> fetchesRejected{0};
+    std::atomic<qint64> fetchesFailed{0};
+    std::atomic<qint64> fetchTimeSum{0};
+    std::atomic<qint64> fetchBytes{0};
+
+    std::atomic<qint64> configBytes{0};
+    std::atomic<qint64> configParseTime{-1};
+
+    std::atomic<qint64> logLines{0};
+    std::atomic<qint64> logLineRate{0};
+    // ms since epoch when logLineRate was measured, the rate reads 0 once stale
+    std::atomic<qint64> logLineRateTime{0};
+
+    // OpenMetrics text exposition
+    QByteArray render() const;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,150 @@
+#include "metrics_server.h"
+
+#include "metrics.h"
+
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+namespace {
+
+const int kMaxRequestSize = 8 * 1024;
+// A scraper that connects and says nothing is dropped
+const int kRequestTimeout = 5000;
+
+// Lives on the server thread, no Q_OBJECT needed for lambda connections
+class Listener : public QObject
+{
+public:
+    Listener(quint16 port, MetricsServer *owner)
+        : m_port(port)
+        , m_owner(owner)
+    {
+    }
+
+    void start()
+    {
+        m_server = new QTcpServer(this);
+        connect(m_server, &QTcpServer::newConnection, this, [this]() {
+            acceptConnections();
+        });
+        if (!m_server->listen(QHostAddress::LocalHost, m_port)) {
+            QString error = m_server->errorString();
+            MetricsServer *owner = m_owner;
+            QMetaObject::invokeMethod(owner, [owner, error]() {
+                emit owner->failed(error);
+            }, Qt::QueuedConnection);
+        }
+    }
+
+private:
+    void acceptConnections()
+    {
+        while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                answer(socket);
+            });
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            QTimer::singleShot(kRequestTimeout, socket, [socket]() {
+                socket->abort();
+            });
+        }
+    }
+
+    void answer(QTcpSocket *socket)
+    {
+        // The request stays in the socket until it is complete
+        QByteArray request = socket->peek(kMaxRequestSize);
+        qsizetype headEnd = request.indexOf("\r\n\r\n");
+        if (headEnd < 0) {
+            if (request.size() >= kMaxRequestSize)
+                socket->abort();
+            return;
+        }
+        socket->read(headEnd + 4);
+        disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+
+        QList<QByteArray> requestLine = request.left(request.indexOf("\r\n")).split(' ');
+        QByteArray method = requestLine.value(0);
+        QByteArray path = requestLine.value(1);
+        qsizetype query = path.indexOf('?');
+        if (query >= 0)
+            path.truncate(query);
+
+        QByteArray status = "200 OK";
+        QByteArray contentType = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+        QByteArray body;
+        if (path != "/metrics") {
+            status = "404 Not Found";
+            contentType = "text/plain; charset=utf-8";
+        } else if (method != "GET" && method != "HEAD") {
+            status = "405 Method Not Allowed";
+            contentType = "text/plain; charset=utf-8";
+        } else {
+            body = Metrics::instance()->render();
+        }
+
+        QByteArray response = "HTTP/1.1 " + status + "\r\nContent-Type: " + contentType
+                              + "\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\n";
+        if (status.startsWith("405"))
+            response += "Allow: GET, HEAD\r\n";
+        response += "Connection: close\r\n\r\n";
+        if (method != "HEAD")
+            response += body;
+        socket->write(response);
+        socket->disconnectFromHost();
+    }
+
+    quint16 m_port;
+    MetricsServer *m_owner;
+    QTcpServer *m_server = nullptr;
+};
+
+} // namespace
+
+MetricsServer::MetricsServer(QObject *parent)
+    : QObject{parent}
+{}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+void MetricsServer::setPort(quint16 port)
+{
+    if (port == m_port)
+        return;
+    stop();
+    m_port = port;
+    if (m_port == 0)
+        return;
+
+    m_thread = new QThread(this);
+    m_thread->setObjectName("MetricsServer");
+    Listener *listener = new Listener(m_port, this);
+    listener->moveToThread(m_thread);
+    connect(m_thread, &QThread::started, listener, [listener]() {
+        listener->start();
+    });
+    connect(m_thread, &QThread::finished, listener, &QObject::deleteLater);
+    m_thread->start();
+}
+
+quint16 MetricsServer::port() const
+{
+    return m_port;
+}
+
+void MetricsServer::stop()
+{
+    if (!m_thread)
+        return;
+    m_thread->quit();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+    m_port = 0;
+}
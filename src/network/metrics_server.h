@@ -0,0 +1,34 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <QObject>
+
+QT_BEGIN_NAMESPACE
+class QThread;
+QT_END_NAMESPACE
+
+// Serves Metrics in the OpenMetrics text format on
+// http://127.0.0.1:<port>/metrics. The socket lives on its own thread, so a
+// scrape never waits for the GUI and the GUI never waits for a scrape.
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MetricsServer(QObject *parent = nullptr);
+    ~MetricsServer();
+
+    // 0 stops serving
+    void setPort(quint16 port);
+    quint16 port() const;
+
+signals:
+    void failed(const QString &error);
+
+private:
+    void stop();
+
+    QThread *m_thread = nullptr;
+    quint16 m_port = 0;
+};
+
+#endif // METRICS_SERVER_H
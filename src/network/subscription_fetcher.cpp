@@ -0,0 +1,100 @@
+#include "subscription_fetcher.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+#include "subscription_tls.h"
+
+namespace {
+
+// Holding a connection longer than this costs the server more than a
+// new handshake costs us
+const int kMaxKeepAlive = 10 * 60;
+// Slack for timer jitter and a slow previous poll
+const int kKeepAliveSlack = 15;
+const int kTransferTimeout = 30000;
+
+} // namespace
+
+SubscriptionFetcher::SubscriptionFetcher(SubscriptionTls *subscriptionTls, QObject *parent)
+    : QObject{parent}
+    , m_subscriptionTls{subscriptionTls}
+{
+    m_networkManager = new QNetworkAccessManager(this);
+    // Pins are only checked on a new handshake, a pooled connection would skip them
+    connect(m_subscriptionTls, &SubscriptionTls::trustChanged, this, &SubscriptionFetcher::dropConnections);
+}
+
+void SubscriptionFetcher::setPollInterval(int milliseconds)
+{
+    int seconds = milliseconds / 1000 + kKeepAliveSlack;
+    m_keepAlive = seconds <= kMaxKeepAlive ? seconds : 0;
+}
+
+void SubscriptionFetcher::setUserAgent(const QByteArray &userAgent)
+{
+    m_userAgent = userAgent;
+}
+
+QNetworkReply *SubscriptionFetcher::get(const QUrl &url)
+{
+    QNetworkRequest request(url);
+    if (!m_userAgent.isEmpty())
+        request.setHeader(QNetworkRequest::UserAgentHeader, m_userAgent);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    if (m_keepAlive > 0)
+        request.setAttribute(QNetworkRequest::ConnectionCacheExpiryTimeoutSecondsAttribute, m_keepAlive);
+    request.setTransferTimeout(kTransferTimeout);
+
+    auto it = m_validators.constFind(url);
+    if (it != m_validators.constEnd()) {
+        if (!it->etag.isEmpty())
+            request.setRawHeader("If-None-Match", it->etag);
+        if (!it->lastModified.isEmpty())
+            request.setRawHeader("If-Modified-Since", it->lastModified);
+    }
+    m_subscriptionTls->prepare(&request);
+
+    QNetworkReply *reply = m_networkManager->get(request);
+    m_subscriptionTls->watch(reply);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, url]() {
+        int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (reply->error() != QNetworkReply::NoError || status != 200)
+            return;
+        Validators validators;
+        validators.etag = reply->rawHeader("ETag");
+        validators.lastModified = reply->rawHeader("Last-Modified");
+        m_pending.insert(url, validators);
+    });
+    return reply;
+}
+
+void SubscriptionFetcher::commit(const QUrl &url)
+{
+    auto it = m_pending.constFind(url);
+    if (it == m_pending.constEnd())
+        return;
+    if (it->etag.isEmpty() && it->lastModified.isEmpty())
+        m_validators.remove(url);
+    else
+        m_validators.insert(url, it.value());
+    m_pending.erase(it);
+}
+
+void SubscriptionFetcher::forget(const QUrl &url)
+{
+    m_validators.remove(url);
+    m_pending.remove(url);
+}
+
+void SubscriptionFetcher::dropConnections()
+{
+    m_networkManager->clearConnectionCache();
+}
+
+bool SubscriptionFetcher::isNotModified(QNetworkReply *reply)
+{
+    return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304;
+}
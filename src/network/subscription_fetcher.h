@@ -0,0 +1,59 @@
+#ifndef SUBSCRIPTION_FETCHER_H
+#define SUBSCRIPTION_FETCHER_H
+
+#include <QHash>
+#include <QObject>
+#include <QUrl>
+
+class SubscriptionTls;
+
+QT_BEGIN_NAMESPACE
+class QNetworkAccessManager;
+class QNetworkReply;
+QT_END_NAMESPACE
+
+// Downloads subscriptions through one QNetworkAccessManager, so every URL
+// on a host shares its connection: multiplexed over HTTP/2 when the server
+// negotiates it, kept alive until the next poll otherwise. The validators
+// of the last applied download are sent along, an unchanged subscription
+// answers 304 without a body.
+class SubscriptionFetcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SubscriptionFetcher(SubscriptionTls *subscriptionTls, QObject *parent = nullptr);
+
+    // Idle connections are held long enough to reach the next poll,
+    // unless polls are too far apart to be worth it
+    void setPollInterval(int milliseconds);
+    void setUserAgent(const QByteArray &userAgent);
+
+    QNetworkReply *get(const QUrl &url);
+    // Sends the validators of the last download of url from now on. Call
+    // once its body is validated and saved, a 304 must never stand for a
+    // body that was rejected.
+    void commit(const QUrl &url);
+    // The next get() downloads the body even if nothing changed
+    void forget(const QUrl &url);
+    // Idle connections went out on a network that is gone
+    void dropConnections();
+
+    static bool isNotModified(QNetworkReply *reply);
+
+private:
+    struct Validators
+    {
+        QByteArray etag;
+        QByteArray lastModified;
+    };
+
+    QNetworkAccessManager *m_networkManager;
+    SubscriptionTls *m_subscriptionTls;
+    int m_keepAlive = 0; // seconds, 0 for Qt's default
+    QByteArray m_userAgent;
+    QHash<QUrl, Validators> m_validators;
+    // Validators of downloads not committed yet
+    QHash<QUrl, Validators> m_pending;
+};
+
+#endif // SUBSCRIPTION_FETCHER_H
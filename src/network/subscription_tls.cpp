@@ -0,0 +1,221 @@
+#include "subscription_tls.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QSslConfiguration>
+#include <QSslKey>
+#include <QSslSocket>
+#include <QStandardPaths>
+
+namespace {
+
+// Used when the server gives no lifetime hint
+const qint64 kDefaultTicketLifetime = 2 * 60 * 60;
+// Servers rarely honour longer tickets
+const qint64 kMaxTicketLifetime = 7 * 24 * 60 * 60;
+
+} // namespace
+
+SubscriptionTls::SubscriptionTls(QObject *parent)
+    : QObject{parent}
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(appDataPath);
+    m_filePath = appDataPath + "/tls_sessions.json";
+    load();
+}
+
+SubscriptionTls::Options SubscriptionTls::options(const QString &host) const
+{
+    return m_options.value(host);
+}
+
+void SubscriptionTls::setOptions(const QString &host, const Options &options)
+{
+    Options previous = m_options.value(host);
+    bool trustChanged = options.verify != previous.verify || options.pins != previous.pins
+                        || options.caFile != previous.caFile;
+    m_options.insert(host, options);
+
+    QString error;
+    if (options.caFile.isEmpty())
+        m_caCertificates.remove(host);
+    else
+        m_caCertificates.insert(host, loadCertificates(options.caFile, &error));
+
+    // A resumed session skips the certificate check, so a ticket from
+    // before the change must not stand in for it
+    if (!trustChanged)
+        return;
+    bool removed = false;
+    for (auto it = m_sessions.begin(); it != m_sessions.end();) {
+        if (it.key().section(':', 0, -2) == host) {
+            it = m_sessions.erase(it);
+            removed = true;
+        } else {
+            ++it;
+        }
+    }
+    if (removed)
+        save();
+    emit trustChanged(host);
+}
+
+void SubscriptionTls::prepare(QNetworkRequest *request) const
+{
+    QString host = request->url().host();
+    Options options = m_options.value(host);
+    QSslConfiguration sslConfig = QSslConfiguration::defaultConfiguration();
+    sslConfig.setPeerVerifyMode(options.verify ? QSslSocket::VerifyPeer : QSslSocket::VerifyNone);
+    QList<QSslCertificate> caCertificates = m_caCertificates.value(host);
+    if (!caCertificates.isEmpty())
+        sslConfig.addCaCertificates(caCertificates);
+    sslConfig.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+
+    // The pins are checked against the chain of a full handshake
+    auto it = m_sessions.constFind(sessionKey(request->url()));
+    if (options.pins.isEmpty() && it != m_sessions.constEnd()
+        && it->expires > QDateTime::currentMSecsSinceEpoch())
+        sslConfig.setSessionTicket(it->ticket);
+    request->setSslConfiguration(sslConfig);
+}
+
+void SubscriptionTls::watch(QNetworkReply *reply)
+{
+    m_lastError.clear();
+    QString key = sessionKey(reply->url());
+    QStringList pins = m_options.value(reply->url().host()).pins;
+
+    connect(reply, &QNetworkReply::encrypted, this, [this, reply, key, pins]() {
+        QSslConfiguration sslConfig = reply->sslConfiguration();
+        QList<QSslCertificate> chain = sslConfig.peerCertificateChain();
+        if (chain.isEmpty() && !sslConfig.peerCertificate().isNull())
+            chain.append(sslConfig.peerCertificate());
+        if (!chain.isEmpty())
+            m_sessions[key].publicKey = publicKeyHash(chain.first());
+
+        if (pins.isEmpty())
+            return;
+        for (const QSslCertificate &certificate : std::as_const(chain)) {
+            if (pins.contains(publicKeyHash(certificate)))
+                return;
+        }
+        // No chain to check is a failure as well, never a pass
+        if (chain.isEmpty())
+            m_lastError = tr("%1 presented no certificate to check the pinned public keys against.")
+                              .arg(reply->url().host());
+        else
+            m_lastError = tr("The certificate of %1 does not match the pinned public keys.")
+                              .arg(reply->url().host());
+        reply->abort();
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, key]() {
+        QByteArray ticket = reply->sslConfiguration().sessionTicket();
+        if (reply->error() != QNetworkReply::NoError || ticket.isEmpty())
+            return;
+        Session &session = m_sessions[key];
+        if (session.ticket == ticket)
+            return;
+
+        qint64 lifetime = reply->sslConfiguration().sessionTicketLifeTimeHint();
+        if (lifetime <= 0)
+            lifetime = kDefaultTicketLifetime;
+        session.ticket = ticket;
+        session.expires = QDateTime::currentMSecsSinceEpoch() + qMin(lifetime, kMaxTicketLifetime) * 1000;
+        save();
+    });
+}
+
+QString SubscriptionTls::lastError() const
+{
+    return m_lastError;
+}
+
+QString SubscriptionTls::lastPublicKey(const QString &host) const
+{
+    for (auto it = m_sessions.constBegin(); it != m_sessions.constEnd(); ++it) {
+        if (it.key().section(':', 0, -2) == host)
+            return it->publicKey;
+    }
+    return QString();
+}
+
+QString SubscriptionTls::publicKeyHash(const QSslCertificate &certificate)
+{
+    // The DER of a public key is its SubjectPublicKeyInfo
+    QByteArray spki = certificate.publicKey().toDer();
+    return QString::fromLatin1(QCryptographicHash::hash(spki, QCryptographicHash::Sha256).toBase64());
+}
+
+QList<QSslCertificate> SubscriptionTls::loadCertificates(const QString &filePath, QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = tr("Cannot open %1.").arg(QDir::toNativeSeparators(filePath));
+        return QList<QSslCertificate>();
+    }
+    QByteArray data = file.readAll();
+    QList<QSslCertificate> certificates = QSslCertificate::fromData(data, QSsl::Pem);
+    if (certificates.isEmpty())
+        certificates = QSslCertificate::fromData(data, QSsl::Der);
+    if (certificates.isEmpty())
+        *error = tr("%1 contains no certificates.").arg(QDir::toNativeSeparators(filePath));
+    return certificates;
+}
+
+bool SubscriptionTls::isValidPin(const QString &pin)
+{
+    auto result = QByteArray::fromBase64Encoding(pin.toLatin1(), QByteArray::AbortOnBase64DecodingErrors);
+    return result && result.decoded.size() == 32;
+}
+
+QString SubscriptionTls::sessionKey(const QUrl &url)
+{
+    return QString("%1:%2").arg(url.host()).arg(url.port(443));
+}
+
+void SubscriptionTls::load()
+{
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const QJsonObject sessions = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = sessions.constBegin(); it != sessions.constEnd(); ++it) {
+        QJsonObject object = it.value().toObject();
+        Session session;
+        session.ticket = QByteArray::fromBase64(object.value("ticket").toString().toLatin1());
+        session.expires = object.value("expires").toInteger();
+        session.publicKey = object.value("publicKey").toString();
+        if (session.expires <= now)
+            session.ticket.clear();
+        m_sessions.insert(it.key(), session);
+    }
+}
+
+void SubscriptionTls::save() const
+{
+    QJsonObject sessions;
+    for (auto it = m_sessions.constBegin(); it != m_sessions.constEnd(); ++it) {
+        QJsonObject object;
+        object.insert("ticket", QString::fromLatin1(it->ticket.toBase64()));
+        object.insert("expires", it->expires);
+        object.insert("publicKey", it->publicKey);
+        sessions.insert(it.key(), object);
+    }
+
+    QSaveFile file(m_filePath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(sessions).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
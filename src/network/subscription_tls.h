@@ -0,0 +1,83 @@
+#ifndef SUBSCRIPTION_TLS_H
+#define SUBSCRIPTION_TLS_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSslCertificate>
+#include <QStringList>
+#include <QUrl>
+
+QT_BEGIN_NAMESPACE
+class QNetworkReply;
+class QNetworkRequest;
+QT_END_NAMESPACE
+
+// TLS for subscription downloads. Servers are verified unless turned off
+// for their host, optionally against an extra CA and pinned public keys.
+// Session tickets are kept per host in AppData/tls_sessions.json, so the
+// periodic refreshes and the first one after a restart resume the session
+// instead of doing a full handshake. Pinned hosts always do a full
+// handshake, a resumed session has no certificates to check.
+class SubscriptionTls : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options
+    {
+        bool verify = true;
+        // Base64 SHA-256 of the SubjectPublicKeyInfo, any certificate of
+        // the chain may match
+        QStringList pins;
+        QString caFile;
+    };
+
+    explicit SubscriptionTls(QObject *parent = nullptr);
+
+    // Options of a host, the defaults for hosts never set
+    Options options(const QString &host) const;
+    // Cached sessions of the host are dropped when its trust settings
+    // change, and trustChanged() is emitted
+    void setOptions(const QString &host, const Options &options);
+
+    // Sets the TLS configuration and a cached session on a request
+    void prepare(QNetworkRequest *request) const;
+    // Checks the pins once the reply is encrypted and aborts it on a
+    // mismatch, then caches the session of a successful reply
+    void watch(QNetworkReply *reply);
+    // Why the last watched reply was aborted, empty if it was not
+    QString lastError() const;
+
+    // Public key hash of the leaf certificate the host presented last
+    QString lastPublicKey(const QString &host) const;
+
+    static QString publicKeyHash(const QSslCertificate &certificate);
+    // PEM or DER certificates, empty with error set when none can be read
+    static QList<QSslCertificate> loadCertificates(const QString &filePath, QString *error);
+    static bool isValidPin(const QString &pin);
+
+signals:
+    // Verify, pins or CA of host changed. Open connections were checked
+    // against the old settings and must not be reused.
+    void trustChanged(const QString &host);
+
+private:
+    struct Session
+    {
+        QByteArray ticket;
+        qint64 expires = 0; // ms since epoch
+        QString publicKey;
+    };
+
+    static QString sessionKey(const QUrl &url);
+    void load();
+    void save() const;
+
+    QHash<QString, Options> m_options;
+    QHash<QString, QList<QSslCertificate>> m_caCertificates;
+    QString m_filePath;
+    QHash<QString, Session> m_sessions;
+    QString m_lastError;
+};
+
+#endif // SUBSCRIPTION_TLS_H
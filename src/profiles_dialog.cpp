@@ -0,0 +1,96 @@
+#include "profiles_dialog.h"
+#include "ui_profiles_dialog.h"
+
+#include <QMessageBox>
+#include <QSortFilterProxyModel>
+
+#include "profile_list_model.h"
+
+ProfilesDialog::ProfilesDialog(ConfigManager *configManager, QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::ProfilesDialog)
+    , m_configManager(configManager)
+{
+    ui->setupUi(this);
+
+    m_model = new ProfileListModel(m_configManager->profileStore(), this);
+    m_filterModel = new QSortFilterProxyModel(this);
+    m_filterModel->setSourceModel(m_model);
+    m_filterModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
+    ui->profileView->setModel(m_filterModel);
+
+    connect(ui->filterEdit, &QLineEdit::textChanged,
+            m_filterModel, &QSortFilterProxyModel::setFilterFixedString);
+    connect(ui->profileView->selectionModel(), &QItemSelectionModel::currentChanged,
+            this, &ProfilesDialog::updateButtons);
+    connect(ui->profileView, &QListView::doubleClicked,
+            this, &ProfilesDialog::on_switchButton_clicked);
+
+    int selected = m_configManager->profileStore()->indexOf(m_configManager->configId());
+    if (selected >= 0) {
+        ui->profileView->setCurrentIndex(m_filterModel->mapFromSource(m_model->index(selected)));
+    }
+    updateButtons();
+}
+
+ProfilesDialog::~ProfilesDialog()
+{
+    delete ui;
+}
+
+void ProfilesDialog::on_switchButton_clicked()
+{
+    int row = currentRow();
+    if (row >= 0) {
+        m_configManager->switchConfig(row);
+    }
+}
+
+void ProfilesDialog::on_addButton_clicked()
+{
+    m_configManager->addConfig();
+}
+
+void ProfilesDialog::on_importButton_clicked()
+{
+    m_configManager->importConfig();
+}
+
+void ProfilesDialog::on_editButton_clicked()
+{
+    int row = currentRow();
+    if (row >= 0) {
+        m_configManager->editConfig(row);
+    }
+}
+
+void ProfilesDialog::on_deleteButton_clicked()
+{
+    int row = currentRow();
+    if (row < 0) {
+        return;
+    }
+    int ret = QMessageBox::warning(this,
+                                   tr("Warning"),
+                                   tr("Delete profile \"%1\"?")
+                                       .arg(m_configManager->profileStore()->at(row).name()),
+                                   QMessageBox::Ok | QMessageBox::No
+                                   );
+    if (ret == QMessageBox::Ok) {
+        m_configManager->removeConfig(row);
+    }
+}
+
+void ProfilesDialog::updateButtons()
+{
+    bool hasCurrent = currentRow() >= 0;
+    ui->switchButton->setEnabled(hasCurrent);
+    ui->editButton->setEnabled(hasCurrent);
+    ui->deleteButton->setEnabled(hasCurrent);
+}
+
+int ProfilesDialog::currentRow() const
+{
+    QModelIndex index = m_filterModel->mapToSource(ui->profileView->currentIndex());
+    return index.isValid() ? index.row() : -1;
+}
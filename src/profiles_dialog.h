@@ -0,0 +1,44 @@
+#ifndef PROFILES_DIALOG_H
+#define PROFILES_DIALOG_H
+
+#include <QDialog>
+
+#include "config_manager.h"
+
+QT_BEGIN_NAMESPACE
+class QSortFilterProxyModel;
+QT_END_NAMESPACE
+
+class ProfileListModel;
+
+namespace Ui {
+class ProfilesDialog;
+}
+
+class ProfilesDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit ProfilesDialog(ConfigManager *configManager, QWidget *parent = nullptr);
+    ~ProfilesDialog();
+
+private slots:
+    void on_switchButton_clicked();
+    void on_addButton_clicked();
+    void on_importButton_clicked();
+    void on_editButton_clicked();
+    void on_deleteButton_clicked();
+    void updateButtons();
+
+private:
+    // Row in the profile store of the current item, -1 if none
+    int currentRow() const;
+
+    Ui::ProfilesDialog *ui;
+    ConfigManager *m_configManager;
+    ProfileListModel *m_model;
+    QSortFilterProxyModel *m_filterModel;
+};
+
+#endif // PROFILES_DIALOG_H
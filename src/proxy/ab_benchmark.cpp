@@ -0,0 +1,414 @@
+#include "ab_benchmark.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+#include <cmath>
+
+#include "config_isolation.h"
+#include "local_http_target.h"
+#include "proxy_manager.h"
+#include "throughput_benchmark.h"
+
+namespace {
+
+const int kDefaultRounds = 3;
+const int kStartTimeout = 15000;
+const int kProbeInterval = 200;
+// Give the previous core time to release its ports
+const int kRestartDelay = 500;
+const int kRequestTimeout = 15000;
+
+const int kWarmupRequests = 2;
+const int kSetupRequests = 20;
+const int kLatencyRequests = 30;
+const int kDownloads = 3;
+const qint64 kLocalDownloadSize = 64 * 1024 * 1024;
+
+// Two-sided 95% critical values of Student's t for 1 to 30 degrees of freedom
+const double kTCritical[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+double tCritical(double degrees)
+{
+    if (degrees < 1)
+        return kTCritical[0];
+    if (degrees <= 30)
+        return kTCritical[int(degrees) - 1];
+    return 1.96 + 2.4 / degrees;
+}
+
+QString configFilePath()
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(appDataPath);
+    return appDataPath + "/ab_benchmark.json";
+}
+
+} // namespace
+
+AbBenchmark::AbBenchmark(QObject *parent)
+    : QObject{parent}
+    , m_rounds{kDefaultRounds}
+{
+    m_proxyManager = new ProxyManager(this);
+    connect(m_proxyManager, &ProxyManager::proxyProcessStateChanged, this,
+            &AbBenchmark::onProcessStateChanged);
+    m_targetThread = new QThread(this);
+    m_localTarget = new LocalHttpTarget;
+    m_localTarget->moveToThread(m_targetThread);
+    connect(m_targetThread, &QThread::finished, m_localTarget, &QObject::deleteLater);
+    m_targetThread->start();
+
+    m_readyTimer = new QTimer(this);
+    m_readyTimer->setInterval(kProbeInterval);
+    connect(m_readyTimer, &QTimer::timeout, this, &AbBenchmark::checkInbound);
+}
+
+AbBenchmark::~AbBenchmark()
+{
+    cancel();
+    m_targetThread->quit();
+    m_targetThread->wait();
+}
+
+void AbBenchmark::setRounds(int rounds)
+{
+    m_rounds = qMax(1, rounds);
+}
+
+void AbBenchmark::setTarget(const QUrl &target)
+{
+    m_target = target;
+}
+
+void AbBenchmark::run(const Arm &a, const Arm &b)
+{
+    if (m_running)
+        return;
+
+    m_arms[0] = a;
+    m_arms[1] = b;
+    for (int arm = 0; arm < 2; ++arm) {
+        for (QList<double> &samples : m_samples[arm])
+            samples.clear();
+        m_failures[arm] = 0;
+        if (ThroughputBenchmark::localProxy(m_arms[arm].config).type() == QNetworkProxy::NoProxy) {
+            emit failed(tr("%1 has no mixed, http or socks inbound to measure through.")
+                            .arg(m_arms[arm].name));
+            return;
+        }
+    }
+    if (m_target.isEmpty()) {
+        QMetaObject::invokeMethod(
+            m_localTarget, [this]() { return m_localTarget->listen() ? m_localTarget->url() : QUrl(); },
+            Qt::BlockingQueuedConnection, &m_localUrl);
+        if (m_localUrl.isEmpty()) {
+            emit failed(tr("Cannot start the local test server."));
+            return;
+        }
+    }
+
+    m_running = true;
+    m_step = 0;
+    startArm();
+}
+
+void AbBenchmark::cancel()
+{
+    if (!m_running)
+        return;
+    ++m_generation;
+    m_running = false;
+    m_stage = Idle;
+    m_readyTimer->stop();
+    stopCore();
+    QMetaObject::invokeMethod(m_localTarget, &LocalHttpTarget::close, Qt::QueuedConnection);
+}
+
+bool AbBenchmark::isRunning() const
+{
+    return m_running;
+}
+
+QList<double> AbBenchmark::samples(int arm, Metric metric) const
+{
+    return m_samples[arm][metric];
+}
+
+int AbBenchmark::failures(int arm) const
+{
+    return m_failures[arm];
+}
+
+AbBenchmark::Summary AbBenchmark::summarize(const QList<double> &samples)
+{
+    Summary summary;
+    summary.count = samples.size();
+    if (samples.isEmpty())
+        return summary;
+    for (double sample : samples)
+        summary.mean += sample;
+    summary.mean /= samples.size();
+    if (samples.size() < 2)
+        return summary;
+
+    double squares = 0;
+    for (double sample : samples)
+        squares += (sample - summary.mean) * (sample - summary.mean);
+    summary.deviation = std::sqrt(squares / (samples.size() - 1));
+    summary.margin = tCritical(samples.size() - 1) * summary.deviation / std::sqrt(double(samples.size()));
+    return summary;
+}
+
+AbBenchmark::Summary AbBenchmark::difference(const QList<double> &a, const QList<double> &b)
+{
+    Summary summaryA = summarize(a);
+    Summary summaryB = summarize(b);
+    Summary summary;
+    summary.count = qMin(summaryA.count, summaryB.count);
+    summary.mean = summaryB.mean - summaryA.mean;
+    if (summaryA.count < 2 || summaryB.count < 2)
+        return summary;
+
+    double varianceA = summaryA.deviation * summaryA.deviation / summaryA.count;
+    double varianceB = summaryB.deviation * summaryB.deviation / summaryB.count;
+    double variance = varianceA + varianceB;
+    if (variance <= 0)
+        return summary;
+    // Welch-Satterthwaite degrees of freedom
+    double degrees = variance * variance
+                     / (varianceA * varianceA / (summaryA.count - 1)
+                        + varianceB * varianceB / (summaryB.count - 1));
+    summary.deviation = std::sqrt(variance);
+    summary.margin = tCritical(degrees) * summary.deviation;
+    return summary;
+}
+
+void AbBenchmark::checkInbound()
+{
+    if (m_stage != Starting)
+        return;
+    if (m_startClock.elapsed() > kStartTimeout) {
+        fail(tr("%1 did not open its inbound in time.").arg(m_arms[m_step % 2].name));
+        return;
+    }
+    if (m_probe)
+        return;
+
+    // The core is ready once its local inbound accepts connections
+    m_probe = new QTcpSocket(this);
+    m_probe->setProxy(QNetworkProxy::NoProxy);
+    QTcpSocket *probe = m_probe;
+    connect(probe, &QTcpSocket::connected, this, [this, probe]() {
+        probe->abort();
+        probe->deleteLater();
+        m_probe = nullptr;
+        if (m_stage == Starting) {
+            m_readyTimer->stop();
+            m_networkManager = new QNetworkAccessManager(this);
+            m_networkManager->setProxy(m_proxy);
+            startStage(Warmup, kWarmupRequests);
+        }
+    });
+    connect(probe, &QTcpSocket::errorOccurred, this, [this, probe]() {
+        probe->deleteLater();
+        if (m_probe == probe)
+            m_probe = nullptr;
+    });
+    probe->connectToHost(m_proxy.hostName(), m_proxy.port());
+}
+
+void AbBenchmark::onProcessStateChanged(int newState)
+{
+    if (newState != QProcess::NotRunning || m_stage == Idle)
+        return;
+    fail(tr("sing-box exited while running %1. Check the config with the selected core.")
+             .arg(m_arms[m_step % 2].name));
+}
+
+void AbBenchmark::startArm()
+{
+    const Arm &arm = m_arms[m_step % 2];
+    // ProxyManager would stop on a modal warning
+    if (!QFile::exists(arm.corePath)) {
+        fail(tr("Cannot find sing-box at %1 for %2.").arg(QDir::toNativeSeparators(arm.corePath), arm.name));
+        return;
+    }
+    emit progress(tr("Round %1 of %2: starting %3...").arg(m_step / 2 + 1).arg(m_rounds).arg(arm.name));
+
+    QSaveFile file(configFilePath());
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(QJsonDocument(ConfigIsolation::isolate(arm.config)).toJson(QJsonDocument::Compact)) <= 0
+        || !file.commit()) {
+        fail(tr("Cannot write %1.").arg(QDir::toNativeSeparators(configFilePath())));
+        return;
+    }
+
+    m_proxy = ThroughputBenchmark::localProxy(arm.config);
+    m_proxyManager->setCorePath(arm.corePath);
+    m_proxyManager->setConfigFilePath(configFilePath());
+    m_stage = Starting;
+    m_proxyManager->startProxy();
+    if (m_proxyManager->proxyProcessState() == QProcess::NotRunning) {
+        fail(tr("Cannot start sing-box for %1.").arg(arm.name));
+        return;
+    }
+    m_startClock.start();
+    m_readyTimer->start();
+}
+
+void AbBenchmark::startStage(Stage stage, int count)
+{
+    static const char *const messages[] = {
+        "", "",
+        QT_TR_NOOP("Round %1 of %2: warming up %3..."),
+        QT_TR_NOOP("Round %1 of %2: opening connections through %3..."),
+        QT_TR_NOOP("Round %1 of %2: measuring latency of %3..."),
+        QT_TR_NOOP("Round %1 of %2: downloading through %3...")
+    };
+    m_stage = stage;
+    m_remaining = count;
+    emit progress(tr(messages[stage]).arg(m_step / 2 + 1).arg(m_rounds).arg(m_arms[m_step % 2].name));
+    startRequest();
+}
+
+void AbBenchmark::startRequest()
+{
+    QNetworkRequest request(m_stage == Download ? largeUrl() : smallUrl());
+    request.setTransferTimeout(kRequestTimeout);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+
+    // Setup requests get a manager of their own so nothing is reused
+    QNetworkAccessManager *manager = m_networkManager;
+    bool ownManager = m_stage == Setup;
+    if (ownManager) {
+        manager = new QNetworkAccessManager(this);
+        manager->setProxy(m_proxy);
+        request.setRawHeader("Connection", "close");
+    }
+
+    m_bytes = 0;
+    m_requestClock.start();
+    QNetworkReply *reply = (m_stage == Download || m_target.isEmpty()) ? manager->get(request)
+                                                                       : manager->head(request);
+    quint64 generation = m_generation;
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply, generation]() {
+        // Count and drop, the body is never kept
+        QByteArray data = reply->readAll();
+        if (generation == m_generation)
+            m_bytes += data.size();
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply, manager, ownManager, generation]() {
+        reply->deleteLater();
+        if (ownManager)
+            manager->deleteLater();
+        if (generation != m_generation)
+            return;
+        m_bytes += reply->readAll().size();
+        finishRequest(reply->error() == QNetworkReply::NoError ? QString() : reply->errorString());
+    });
+}
+
+void AbBenchmark::finishRequest(const QString &error)
+{
+    int arm = m_step % 2;
+    double elapsed = m_requestClock.nsecsElapsed() / 1e6;
+
+    if (!error.isEmpty()) {
+        if (m_stage == Warmup) {
+            fail(tr("No response through %1: %2").arg(m_arms[arm].name, error));
+            return;
+        }
+        ++m_failures[arm];
+    } else if (m_stage == Setup) {
+        m_samples[arm][SetupTime].append(elapsed);
+    } else if (m_stage == Measure) {
+        m_samples[arm][Latency].append(elapsed);
+    } else if (m_stage == Download && elapsed > 0) {
+        m_samples[arm][Throughput].append(m_bytes / (elapsed / 1000));
+    }
+
+    if (--m_remaining > 0) {
+        startRequest();
+        return;
+    }
+    switch (m_stage) {
+    case Warmup:
+        startStage(Setup, kSetupRequests);
+        break;
+    case Setup:
+        startStage(Measure, kLatencyRequests);
+        break;
+    case Measure:
+        startStage(Download, kDownloads);
+        break;
+    default:
+        finishArm();
+    }
+}
+
+void AbBenchmark::finishArm()
+{
+    m_stage = Idle;
+    stopCore();
+    if (++m_step == m_rounds * 2) {
+        m_running = false;
+        QMetaObject::invokeMethod(m_localTarget, &LocalHttpTarget::close, Qt::QueuedConnection);
+        emit finished();
+        return;
+    }
+
+    quint64 generation = m_generation;
+    QTimer::singleShot(kRestartDelay, this, [this, generation]() {
+        if (generation == m_generation)
+            startArm();
+    });
+}
+
+void AbBenchmark::fail(const QString &error)
+{
+    cancel();
+    emit failed(error);
+}
+
+void AbBenchmark::stopCore()
+{
+    if (m_probe) {
+        m_probe->abort();
+        m_probe->deleteLater();
+        m_probe = nullptr;
+    }
+    // Called from reply handlers, the manager must outlive them
+    if (m_networkManager)
+        m_networkManager->deleteLater();
+    m_networkManager = nullptr;
+    m_proxyManager->stopProxy();
+}
+
+QUrl AbBenchmark::smallUrl() const
+{
+    return m_target.isEmpty() ? m_localUrl : m_target;
+}
+
+QUrl AbBenchmark::largeUrl() const
+{
+    if (!m_target.isEmpty())
+        return m_target;
+    QUrl url = m_localUrl;
+    url.setPath(QString("/bytes/%1").arg(kLocalDownloadSize));
+    return url;
+}
@@ -0,0 +1,128 @@
+#ifndef AB_BENCHMARK_H
+#define AB_BENCHMARK_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QNetworkProxy>
+#include <QObject>
+#include <QUrl>
+
+class LocalHttpTarget;
+class ProxyManager;
+
+QT_BEGIN_NAMESPACE
+class QNetworkAccessManager;
+class QTcpSocket;
+class QThread;
+class QTimer;
+QT_END_NAMESPACE
+
+// Compares two configs or cores by running the same workload through each
+// of them in turn. Every round starts arm A, measures it, stops it and
+// does the same for arm B, so slow drift of the network hits both arms.
+// The core runs in a process of its own, the proxy must not be running.
+// The local test server runs on a thread of its own, so its writes do not
+// queue behind the GUI and the measuring code.
+class AbBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    struct Arm
+    {
+        QString name;
+        QJsonObject config;
+        QString corePath;
+    };
+
+    enum Metric {
+        SetupTime,  // ms for a new connection and one request
+        Latency,    // ms for a request on a kept-alive connection
+        Throughput, // bytes per second of a bulk download
+        MetricCount
+    };
+
+    struct Summary
+    {
+        int count = 0;
+        double mean = 0;
+        double deviation = 0;
+        // Half width of the 95% confidence interval of the mean
+        double margin = 0;
+    };
+
+    explicit AbBenchmark(QObject *parent = nullptr);
+    ~AbBenchmark();
+
+    void setRounds(int rounds);
+    // Empty runs the workload against a server on the loopback interface
+    void setTarget(const QUrl &target);
+
+    void run(const Arm &a, const Arm &b);
+    void cancel();
+    bool isRunning() const;
+
+    QList<double> samples(int arm, Metric metric) const;
+    int failures(int arm) const;
+
+    static Summary summarize(const QList<double> &samples);
+    // 95% confidence interval of mean(b) - mean(a), Welch's t-test
+    static Summary difference(const QList<double> &a, const QList<double> &b);
+
+signals:
+    void progress(const QString &message);
+    void failed(const QString &error);
+    void finished();
+
+private slots:
+    void checkInbound();
+    void onProcessStateChanged(int newState);
+
+private:
+    enum Stage {
+        Idle,
+        Starting,
+        Warmup,
+        Setup,
+        Measure,
+        Download
+    };
+
+    void startArm();
+    void startStage(Stage stage, int count);
+    void startRequest();
+    // Empty error for a successful request
+    void finishRequest(const QString &error);
+    void finishArm();
+    void fail(const QString &error);
+    void stopCore();
+    QUrl smallUrl() const;
+    QUrl largeUrl() const;
+
+    ProxyManager *m_proxyManager;
+    // Lives on m_targetThread, only reached through queued calls
+    LocalHttpTarget *m_localTarget;
+    QThread *m_targetThread;
+    QUrl m_localUrl;
+    QTimer *m_readyTimer;
+    QTcpSocket *m_probe = nullptr;
+    QElapsedTimer m_startClock;
+
+    int m_rounds;
+    QUrl m_target;
+    Arm m_arms[2];
+    bool m_running = false;
+    int m_step = 0;
+    Stage m_stage = Idle;
+    int m_remaining = 0;
+    quint64 m_generation = 0;
+
+    QNetworkProxy m_proxy;
+    QNetworkAccessManager *m_networkManager = nullptr;
+    QElapsedTimer m_requestClock;
+    qint64 m_bytes = 0;
+    QList<double> m_samples[2][MetricCount];
+    int m_failures[2] = {0, 0};
+};
+
+#endif // AB_BENCHMARK_H
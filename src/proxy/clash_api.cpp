@@ -0,0 +1,117 @@
+#include "clash_api.h"
+
+#include <QJsonDocument>
+#include <QNetworkAccessManager>
+#include <QNetworkProxy>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QUrl>
+
+ClashApi::ClashApi(QObject *parent)
+    : QObject{parent}
+{
+    m_networkManager = new QNetworkAccessManager(this);
+    m_networkManager->setProxy(QNetworkProxy::NoProxy);
+}
+
+void ClashApi::ensureController(QJsonObject &config)
+{
+    QJsonObject experimental = config.value("experimental").toObject();
+    QJsonObject clashApi = experimental.value("clash_api").toObject();
+    if (!clashApi.value("external_controller").toString().isEmpty())
+        return;
+
+    // Let the OS pick a free loopback port
+    QTcpServer server;
+    if (!server.listen(QHostAddress::LocalHost, 0))
+        return;
+    quint16 port = server.serverPort();
+    server.close();
+
+    QByteArray secret(16, Qt::Uninitialized);
+    QRandomGenerator::global()->fillRange(reinterpret_cast<quint32 *>(secret.data()),
+                                         secret.size() / sizeof(quint32));
+
+    clashApi.insert("external_controller", QString("127.0.0.1:%1").arg(port));
+    clashApi.insert("secret", QString::fromLatin1(secret.toHex()));
+    experimental.insert("clash_api", clashApi);
+    config.insert("experimental", experimental);
+}
+
+void ClashApi::setControllerFromConfig(const QJsonObject &config)
+{
+    QJsonObject clashApi = config.value("experimental").toObject().value("clash_api").toObject();
+    QString address = clashApi.value("external_controller").toString();
+    // Listening on all interfaces is reachable through loopback
+    if (address.startsWith(':'))
+        address.prepend("127.0.0.1");
+    address.replace("0.0.0.0:", "127.0.0.1:");
+    address.replace("[::]:", "127.0.0.1:");
+    setController(address, clashApi.value("secret").toString());
+}
+
+void ClashApi::setController(const QString &address, const QString &secret)
+{
+    m_address = address;
+    m_secret = secret;
+}
+
+bool ClashApi::isAvailable() const
+{
+    return !m_address.isEmpty();
+}
+
+QNetworkReply *ClashApi::get(const QString &path)
+{
+    return send("GET", path, QByteArray());
+}
+
+QNetworkReply *ClashApi::put(const QString &path, const QJsonObject &body)
+{
+    return send("PUT", path, QJsonDocument(body).toJson(QJsonDocument::Compact));
+}
+
+QNetworkReply *ClashApi::proxy(const QString &name)
+{
+    return get("/proxies/" + QString::fromUtf8(QUrl::toPercentEncoding(name)));
+}
+
+QNetworkReply *ClashApi::delay(const QString &name, const QString &url, int timeout)
+{
+    // Single arg() call, percent-encoded values must not be taken for placeholders
+    return get(QString("/proxies/%1/delay?timeout=%2&url=%3")
+                   .arg(QString::fromUtf8(QUrl::toPercentEncoding(name)),
+                        QString::number(timeout),
+                        QString::fromUtf8(QUrl::toPercentEncoding(url))));
+}
+
+QNetworkReply *ClashApi::selectProxy(const QString &selector, const QString &name)
+{
+    QJsonObject body;
+    body.insert("name", name);
+    return put("/proxies/" + QString::fromUtf8(QUrl::toPercentEncoding(selector)), body);
+}
+
+QNetworkReply *ClashApi::closeConnections()
+{
+    return send("DELETE", "/connections", QByteArray());
+}
+
+QJsonObject ClashApi::readObject(QNetworkReply *reply)
+{
+    if (reply->error() != QNetworkReply::NoError)
+        return QJsonObject();
+    return QJsonDocument::fromJson(reply->readAll()).object();
+}
+
+QNetworkReply *ClashApi::send(const QByteArray &verb, const QString &path, const QByteArray &body)
+{
+    QNetworkRequest request(QUrl::fromEncoded(QString("http://%1%2").arg(m_address, path).toUtf8()));
+    if (!m_secret.isEmpty())
+        request.setRawHeader("Authorization", "Bearer " + m_secret.toUtf8());
+    if (!body.isEmpty())
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    return m_networkManager->sendCustomRequest(request, verb, body);
+}
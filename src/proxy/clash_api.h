@@ -0,0 +1,49 @@
+#ifndef CLASH_API_H
+#define CLASH_API_H
+
+#include <QJsonObject>
+#include <QObject>
+
+QT_BEGIN_NAMESPACE
+class QNetworkAccessManager;
+class QNetworkReply;
+QT_END_NAMESPACE
+
+// Client for the Clash compatible API served by the running core
+// (experimental.clash_api). Requests bypass any proxy, since the system
+// proxy usually points at the core itself.
+class ClashApi : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ClashApi(QObject *parent = nullptr);
+
+    // Makes sure the config serves the API on loopback, adding a
+    // controller on a free port with a random secret when it has none
+    static void ensureController(QJsonObject &config);
+    // Reads the controller address and secret from a config
+    void setControllerFromConfig(const QJsonObject &config);
+    void setController(const QString &address, const QString &secret);
+    bool isAvailable() const;
+
+    // Callers own the replies and delete them once finished
+    QNetworkReply *get(const QString &path);
+    QNetworkReply *put(const QString &path, const QJsonObject &body);
+    QNetworkReply *proxy(const QString &name);
+    QNetworkReply *delay(const QString &name, const QString &url, int timeout);
+    QNetworkReply *selectProxy(const QString &selector, const QString &name);
+    // Closes every open connection, new ones go out on the current network
+    QNetworkReply *closeConnections();
+
+    // Body of a finished reply, empty on error
+    static QJsonObject readObject(QNetworkReply *reply);
+
+private:
+    QNetworkReply *send(const QByteArray &verb, const QString &path, const QByteArray &body);
+
+    QNetworkAccessManager *m_networkManager;
+    QString m_address;
+    QString m_secret;
+};
+
+#endif // CLASH_API_H
@@ -0,0 +1,74 @@
+#include "config_isolation.h"
+
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QTcpServer>
+
+#include "clash_api.h"
+
+namespace {
+
+quint16 freePort()
+{
+    QTcpServer server;
+    if (!server.listen(QHostAddress::LocalHost, 0))
+        return 0;
+    quint16 port = server.serverPort();
+    server.close();
+    return port;
+}
+
+} // namespace
+
+QJsonObject ConfigIsolation::isolate(const QJsonObject &config)
+{
+    QJsonObject isolated = config;
+    QJsonArray inbounds;
+    const QJsonArray original = config.value("inbounds").toArray();
+    for (const QJsonValue &value : original) {
+        QJsonObject inbound = value.toObject();
+        if (inbound.value("type").toString() == "tun")
+            continue;
+        inbound.remove("set_system_proxy");
+        inbounds.append(inbound);
+    }
+    isolated.insert("inbounds", inbounds);
+    return isolated;
+}
+
+QJsonObject ConfigIsolation::relocate(const QJsonObject &config, const QString &cacheFilePath)
+{
+    QJsonObject relocated = isolate(config);
+
+    QJsonArray inbounds = relocated.value("inbounds").toArray();
+    for (int i = 0; i < inbounds.size(); ++i) {
+        QJsonObject inbound = inbounds.at(i).toObject();
+        if (!inbound.contains("listen_port"))
+            continue;
+        inbound.insert("listen_port", freePort());
+        inbounds.replace(i, inbound);
+    }
+    relocated.insert("inbounds", inbounds);
+
+    // Two cores cannot share a log file or a cache database
+    QJsonObject log = relocated.value("log").toObject();
+    if (log.contains("output")) {
+        log.remove("output");
+        relocated.insert("log", log);
+    }
+
+    QJsonObject experimental = relocated.value("experimental").toObject();
+    QJsonObject cacheFile = experimental.value("cache_file").toObject();
+    if (cacheFile.value("enabled").toBool()) {
+        cacheFile.insert("path", cacheFilePath);
+        experimental.insert("cache_file", cacheFile);
+    }
+    // Keep settings like default_mode, but serve on a port of its own
+    QJsonObject clashApi = experimental.value("clash_api").toObject();
+    clashApi.remove("external_controller");
+    clashApi.remove("secret");
+    experimental.insert("clash_api", clashApi);
+    relocated.insert("experimental", experimental);
+    ClashApi::ensureController(relocated);
+    return relocated;
+}
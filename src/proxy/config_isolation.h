@@ -0,0 +1,19 @@
+#ifndef CONFIG_ISOLATION_H
+#define CONFIG_ISOLATION_H
+
+#include <QJsonObject>
+#include <QString>
+
+// Rewrites a config for a core that runs next to, or instead of, the proxy
+// without touching the system: the A/B comparison and the hot standby.
+class ConfigIsolation
+{
+public:
+    // Drops TUN inbounds and the system proxy
+    static QJsonObject isolate(const QJsonObject &config);
+    // Also moves every listen port, the Clash API, the log file and the
+    // cache file out of the way of a core running the original config
+    static QJsonObject relocate(const QJsonObject &config, const QString &cacheFilePath);
+};
+
+#endif // CONFIG_ISOLATION_H
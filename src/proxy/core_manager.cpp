@@ -0,0 +1,335 @@
+#include "core_manager.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVersionNumber>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+#include "settings_manager.h"
+
+namespace {
+
+const int kVersionTimeout = 5000;
+
+QJsonObject toJson(const CoreInfo &info, const QFileInfo &file)
+{
+    QJsonObject object;
+    object.insert("size", file.size());
+    object.insert("modified", file.lastModified().toMSecsSinceEpoch());
+    object.insert("version", info.version);
+    object.insert("tags", QJsonArray::fromStringList(info.tags));
+    object.insert("environment", info.environment);
+    return object;
+}
+
+} // namespace
+
+CoreManager::CoreManager(QObject *parent)
+    : QObject{parent}
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    m_directory = appDataPath + "/cores";
+    m_cacheFilePath = appDataPath + "/cores.json";
+    QDir().mkpath(m_directory);
+
+    QFile file(m_cacheFilePath);
+    if (file.open(QIODevice::ReadOnly))
+        m_cache = QJsonDocument::fromJson(file.readAll()).object();
+
+    refresh();
+}
+
+QList<CoreInfo> CoreManager::cores() const
+{
+    return m_cores;
+}
+
+CoreInfo CoreManager::core(const QString &version) const
+{
+    for (const CoreInfo &info : m_cores) {
+        if (info.version == version)
+            return info;
+    }
+    return CoreInfo();
+}
+
+void CoreManager::refresh()
+{
+    // The running scan would miss what changed in the meantime, list what
+    // is known now and scan again once it is done
+    if (m_detecting) {
+        m_refreshAgain = true;
+        updateCores();
+        return;
+    }
+
+    QStringList paths;
+    QString bundledPath = QCoreApplication::applicationDirPath() + "/" + binaryName();
+    if (QFile::exists(bundledPath))
+        paths.append(bundledPath);
+    const QStringList versions = QDir(m_directory).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &version : versions) {
+        QString path = QString("%1/%2/%3").arg(m_directory, version, binaryName());
+        if (QFile::exists(path))
+            paths.append(path);
+    }
+
+    QStringList unknown;
+    for (const QString &path : std::as_const(paths)) {
+        if (!cachedInfo(path).isValid())
+            unknown.append(path);
+    }
+    updateCores();
+    if (unknown.isEmpty())
+        return;
+
+    m_detecting = true;
+    auto *watcher = new QFutureWatcher<QList<CoreInfo>>(this);
+    connect(watcher, &QFutureWatcher<QList<CoreInfo>>::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        m_detecting = false;
+        // Failures are not cached, the binary may just have been busy
+        bool cacheChanged = false;
+        const QList<CoreInfo> detected = watcher->result();
+        for (const CoreInfo &info : detected) {
+            if (info.isValid()) {
+                m_cache.insert(info.path, toJson(info, QFileInfo(info.path)));
+                cacheChanged = true;
+            }
+        }
+        if (cacheChanged)
+            saveCache();
+        if (m_refreshAgain) {
+            m_refreshAgain = false;
+            refresh();
+        } else if (cacheChanged) {
+            updateCores();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([unknown]() {
+        QList<CoreInfo> detected;
+        for (const QString &path : unknown)
+            detected.append(detect(path));
+        return detected;
+    }));
+}
+
+QString CoreManager::defaultVersion() const
+{
+    SettingsManager settingsManager;
+    return settingsManager.coreVersion();
+}
+
+void CoreManager::setDefaultVersion(const QString &version)
+{
+    SettingsManager settingsManager;
+    if (settingsManager.coreVersion() == version)
+        return;
+    settingsManager.setCoreVersion(version);
+    emit defaultVersionChanged(version);
+}
+
+QString CoreManager::corePath(const QString &pinnedVersion) const
+{
+    CoreInfo info = core(pinnedVersion);
+    if (!info.isValid())
+        info = core(defaultVersion());
+    if (info.isValid())
+        return info.path;
+    return QCoreApplication::applicationDirPath() + "/" + binaryName();
+}
+
+bool CoreManager::supportsClashApi(const QString &path) const
+{
+    CoreInfo info = cachedInfo(path);
+    return !info.isValid() || info.tags.isEmpty() || info.tags.contains("with_clash_api");
+}
+
+void CoreManager::install(const QString &binaryPath)
+{
+    if (m_installing)
+        return;
+    m_installing = true;
+
+    struct Installed
+    {
+        CoreInfo info;
+        QString error;
+    };
+    auto *watcher = new QFutureWatcher<Installed>(this);
+    connect(watcher, &QFutureWatcher<Installed>::finished, this, [this, watcher]() {
+        watcher->deleteLater();
+        m_installing = false;
+        Installed installed = watcher->result();
+        if (installed.error.isEmpty()) {
+            // Known already, no need to run the copy again
+            m_cache.insert(installed.info.path, toJson(installed.info, QFileInfo(installed.info.path)));
+            saveCache();
+            refresh();
+        }
+        emit installFinished(installed.info.version, installed.error);
+    });
+    // "sing-box version" and copying the binary both take a while
+    watcher->setFuture(QtConcurrent::run([directory = m_directory, binaryPath]() {
+        Installed installed;
+        installed.info = detect(binaryPath);
+        if (!installed.info.isValid()) {
+            installed.error = tr("%1 does not look like a sing-box binary.").arg(QDir::toNativeSeparators(binaryPath));
+            return installed;
+        }
+
+        QString versionDirectory = directory + "/" + installed.info.version;
+        QString target = versionDirectory + "/" + binaryName();
+        if (QFile::exists(target)) {
+            installed.error = tr("sing-box %1 is already installed.").arg(installed.info.version);
+            return installed;
+        }
+        if (!QDir().mkpath(versionDirectory) || !QFile::copy(binaryPath, target)) {
+            installed.error = tr("Cannot copy %1 to %2.").arg(QDir::toNativeSeparators(binaryPath),
+                                                              QDir::toNativeSeparators(versionDirectory));
+            return installed;
+        }
+        installed.info.path = target;
+        return installed;
+    }));
+}
+
+bool CoreManager::isInstalling() const
+{
+    return m_installing;
+}
+
+bool CoreManager::remove(const QString &version, QString *error)
+{
+    CoreInfo info = core(version);
+    if (!info.isValid()) {
+        *error = tr("sing-box %1 is not installed.").arg(version);
+        return false;
+    }
+    if (info.bundled) {
+        *error = tr("The bundled core cannot be removed.");
+        return false;
+    }
+    if (!QDir(QFileInfo(info.path).absolutePath()).removeRecursively()) {
+        *error = tr("Cannot remove %1, it may still be running.").arg(QDir::toNativeSeparators(info.path));
+        return false;
+    }
+    if (defaultVersion() == version)
+        setDefaultVersion(QString());
+    refresh();
+    return true;
+}
+
+CoreInfo CoreManager::detect(const QString &path)
+{
+    CoreInfo info;
+    info.path = path;
+
+    QProcess process;
+    process.start(path, QStringList() << "version");
+    if (!process.waitForFinished(kVersionTimeout)) {
+        process.kill();
+        process.waitForFinished();
+        return info;
+    }
+
+    // sing-box version 1.9.3
+    //
+    // Environment: go1.22.4 windows/amd64
+    // Tags: with_gvisor,with_quic,...
+    const QStringList lines = QString::fromUtf8(process.readAllStandardOutput()).split('\n');
+    for (const QString &rawLine : lines) {
+        QString line = rawLine.trimmed();
+        if (line.startsWith("sing-box version "))
+            info.version = line.mid(17).trimmed();
+        else if (line.startsWith("Environment:"))
+            info.environment = line.mid(12).trimmed();
+        else if (line.startsWith("Tags:"))
+            info.tags = line.mid(5).trimmed().split(',', Qt::SkipEmptyParts);
+    }
+    return info;
+}
+
+QString CoreManager::binaryName()
+{
+#ifdef Q_OS_WIN
+    return QStringLiteral("sing-box.exe");
+#else
+    return QStringLiteral("sing-box");
+#endif
+}
+
+CoreInfo CoreManager::cachedInfo(const QString &path) const
+{
+    CoreInfo info;
+    info.path = path;
+    QFileInfo file(path);
+    QJsonObject cached = m_cache.value(path).toObject();
+    if (cached.value("size").toInteger() != file.size()
+        || cached.value("modified").toInteger() != file.lastModified().toMSecsSinceEpoch())
+        return info;
+
+    info.version = cached.value("version").toString();
+    info.environment = cached.value("environment").toString();
+    const QJsonArray tags = cached.value("tags").toArray();
+    for (const QJsonValue &tag : tags)
+        info.tags.append(tag.toString());
+    return info;
+}
+
+void CoreManager::updateCores()
+{
+    QList<CoreInfo> cores;
+    QString bundledPath = QCoreApplication::applicationDirPath() + "/" + binaryName();
+    if (QFile::exists(bundledPath)) {
+        CoreInfo info = cachedInfo(bundledPath);
+        info.bundled = true;
+        cores.append(info);
+    }
+
+    QList<CoreInfo> installed;
+    const QStringList versions = QDir(m_directory).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &version : versions) {
+        CoreInfo info = cachedInfo(QString("%1/%2/%3").arg(m_directory, version, binaryName()));
+        if (info.isValid())
+            installed.append(info);
+    }
+    std::sort(installed.begin(), installed.end(), [](const CoreInfo &a, const CoreInfo &b) {
+        return QVersionNumber::fromString(a.version) > QVersionNumber::fromString(b.version);
+    });
+    cores.append(installed);
+
+    // Forget binaries that are gone
+    bool cacheChanged = false;
+    for (const QString &path : m_cache.keys()) {
+        if (!QFile::exists(path)) {
+            m_cache.remove(path);
+            cacheChanged = true;
+        }
+    }
+    if (cacheChanged)
+        saveCache();
+
+    m_cores = cores;
+    emit coresChanged();
+}
+
+void CoreManager::saveCache() const
+{
+    QSaveFile file(m_cacheFilePath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(m_cache).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef CORE_MANAGER_H
+#define CORE_MANAGER_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+struct CoreInfo
+{
+    QString version;
+    QString path;
+    // Build tags reported by "sing-box version", e.g. with_quic
+    QStringList tags;
+    QString environment;
+    // The binary shipped next to qsing-box.exe
+    bool bundled = false;
+
+    bool isValid() const { return !version.isEmpty(); }
+};
+
+// Keeps sing-box binaries side by side in AppData/cores/<version>/. The
+// output of "sing-box version" is cached per binary, keyed by its size and
+// modification time, so the binaries only run once, and on a worker thread.
+class CoreManager : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CoreManager(QObject *parent = nullptr);
+
+    // Bundled core first, then the installed versions, newest first
+    QList<CoreInfo> cores() const;
+    CoreInfo core(const QString &version) const;
+    // Rescans the cores directory. Binaries not in the cache are listed once
+    // they have been run, coresChanged() fires again then.
+    void refresh();
+
+    QString defaultVersion() const;
+    void setDefaultVersion(const QString &version);
+    // Binary for a profile pinned to version, falling back to the default
+    // core and then to the bundled one
+    QString corePath(const QString &pinnedVersion = QString()) const;
+
+    // Whether the binary serves the Clash API, going by its build tags.
+    // Binaries not run yet, or reporting no tags, are assumed to.
+    bool supportsClashApi(const QString &path) const;
+
+    // Runs the binary on a worker and copies it into the cores directory,
+    // installFinished() reports the outcome
+    void install(const QString &binaryPath);
+    bool isInstalling() const;
+    bool remove(const QString &version, QString *error);
+
+    // Runs "sing-box version", blocking for at most a few seconds
+    static CoreInfo detect(const QString &path);
+    static QString binaryName();
+
+signals:
+    void coresChanged();
+    void defaultVersionChanged(const QString &version);
+    // error is empty when the core was installed
+    void installFinished(const QString &version, const QString &error);
+
+private:
+    // Cached info of a binary, invalid when it has not been run yet
+    CoreInfo cachedInfo(const QString &path) const;
+    // Rebuilds the list from the cache
+    void updateCores();
+    void saveCache() const;
+
+    QString m_directory;
+    QString m_cacheFilePath;
+    QJsonObject m_cache;
+    QList<CoreInfo> m_cores;
+    bool m_detecting = false;
+    bool m_refreshAgain = false;
+    bool m_installing = false;
+};
+
+#endif // CORE_MANAGER_H
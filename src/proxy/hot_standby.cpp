@@ -0,0 +1,404 @@
+#include "hot_standby.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QNetworkProxy>
+#include <QNetworkReply>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include "clash_api.h"
+#include "config_isolation.h"
+#include "outbound_selector.h"
+#include "proxy_manager.h"
+#include "throughput_benchmark.h"
+#include "windows_proxy.h"
+
+namespace {
+
+const int kStartTimeout = 15000;
+const int kStartProbeInterval = 200;
+const int kCheckInterval = 10000;
+// Failed checks in a row before acting on them
+const int kMaxProbeFailures = 2;
+const int kMaxPrimaryFailures = 3;
+const int kDelayTimeout = 5000;
+const char kDelayUrl[] = "https://www.gstatic.com/generate_204";
+const int kMinRestartDelay = 2000;
+const int kMaxRestartDelay = 120000;
+// Long enough to keep the standby through a restart of the proxy
+const int kIdleTimeout = 30000;
+
+QString appDataFilePath(const QString &fileName)
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(appDataPath);
+    return appDataPath + "/" + fileName;
+}
+
+// System proxy server for an inbound, empty if it does not proxy
+QString proxyServer(const QJsonObject &inbound)
+{
+    QString type = inbound.value("type").toString();
+    int port = inbound.value("listen_port").toInt();
+    if (port <= 0 || (type != "mixed" && type != "http" && type != "socks"))
+        return QString();
+
+    QString host = inbound.value("listen").toString();
+    if (host.isEmpty() || host == "0.0.0.0" || host == "::")
+        host = "127.0.0.1";
+    else if (host.contains(':'))
+        host = "[" + host + "]";
+    QString server = QString("%1:%2").arg(host).arg(port);
+    return type == "socks" ? "socks=" + server : server;
+}
+
+// The inbound the core points the system proxy at
+QString systemProxyServer(const QJsonObject &config)
+{
+    const QJsonArray inbounds = config.value("inbounds").toArray();
+    for (const QJsonValue &value : inbounds) {
+        QJsonObject inbound = value.toObject();
+        if (inbound.value("set_system_proxy").toBool())
+            return proxyServer(inbound);
+    }
+    return QString();
+}
+
+// Prefers an HTTP capable inbound, every program understands those
+QString standbyServer(const QJsonObject &config)
+{
+    QString socks;
+    const QJsonArray inbounds = config.value("inbounds").toArray();
+    for (const QJsonValue &value : inbounds) {
+        QString server = proxyServer(value.toObject());
+        if (server.isEmpty())
+            continue;
+        if (!server.startsWith("socks="))
+            return server;
+        if (socks.isEmpty())
+            socks = server;
+    }
+    return socks;
+}
+
+// Same local addresses sing-box leaves out of the system proxy
+QString bypassList()
+{
+    QStringList hosts = {"localhost", "127.*", "10.*", "192.168.*"};
+    for (int i = 16; i < 32; ++i)
+        hosts << QString("172.%1.*").arg(i);
+    hosts << "<local>";
+    return hosts.join(';');
+}
+
+} // namespace
+
+HotStandby::HotStandby(ClashApi *primaryApi, QObject *parent)
+    : QObject{parent}
+    , m_primaryApi{primaryApi}
+    , m_restartDelay{kMinRestartDelay}
+{
+    m_proxyManager = new ProxyManager(this);
+    connect(m_proxyManager, &ProxyManager::proxyProcessStateChanged, this,
+            &HotStandby::onProcessStateChanged);
+
+    m_checkTimer = new QTimer(this);
+    connect(m_checkTimer, &QTimer::timeout, this, &HotStandby::check);
+
+    m_restartTimer = new QTimer(this);
+    m_restartTimer->setSingleShot(true);
+    connect(m_restartTimer, &QTimer::timeout, this, &HotStandby::launch);
+
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(kIdleTimeout);
+    connect(m_idleTimer, &QTimer::timeout, this, [this]() {
+        // Without a primary the standby is only worth keeping while it serves
+        if (m_state != Serving)
+            stop();
+    });
+}
+
+HotStandby::~HotStandby()
+{
+    stop();
+}
+
+void HotStandby::start(const QString &name, const QJsonObject &config, const QString &corePath)
+{
+    stop();
+    m_name = name;
+    m_config = ConfigIsolation::relocate(config, appDataFilePath("standby_cache.db"));
+    m_corePath = corePath;
+    m_server = standbyServer(m_config);
+    if (m_server.isEmpty()) {
+        emit message(tr("Hot standby %1 has no mixed, http or socks inbound to take over with.").arg(name));
+        return;
+    }
+    m_restartDelay = kMinRestartDelay;
+    launch();
+}
+
+void HotStandby::stop()
+{
+    m_checkTimer->stop();
+    m_restartTimer->stop();
+    m_idleTimer->stop();
+    if (m_probe) {
+        QTcpSocket *probe = m_probe;
+        m_probe = nullptr;
+        probe->disconnect(this);
+        probe->abort();
+        probe->deleteLater();
+    }
+    if (m_primaryCheck) {
+        QNetworkReply *reply = m_primaryCheck;
+        m_primaryCheck = nullptr;
+        reply->abort();
+    }
+    if (m_state == Serving)
+        WindowsProxy::clear();
+
+    m_stopping = true;
+    m_proxyManager->stopProxy();
+    m_stopping = false;
+    setState(Stopped);
+}
+
+HotStandby::State HotStandby::state() const
+{
+    return m_state;
+}
+
+QString HotStandby::name() const
+{
+    return m_name;
+}
+
+void HotStandby::setPrimary(const QJsonObject &config)
+{
+    m_idleTimer->stop();
+    m_primaryServer = systemProxyServer(config);
+    m_primarySelector = OutboundSelector::defaultSelector(config);
+    m_primaryFailures = 0;
+    if (m_primaryCheck) {
+        QNetworkReply *reply = m_primaryCheck;
+        m_primaryCheck = nullptr;
+        reply->abort();
+    }
+    if (m_state == Serving) {
+        // The new primary points the system proxy back at itself
+        setState(Ready);
+        emit handedBack();
+    }
+}
+
+void HotStandby::clearPrimary()
+{
+    // The system proxy server stays known, takeOver() follows an exit
+    m_primarySelector.clear();
+    m_primaryFailures = 0;
+    if (m_primaryCheck) {
+        QNetworkReply *reply = m_primaryCheck;
+        m_primaryCheck = nullptr;
+        reply->abort();
+    }
+    if (m_state != Stopped || m_restartTimer->isActive())
+        m_idleTimer->start();
+}
+
+bool HotStandby::takeOver(const QString &reason)
+{
+    if (m_state == Serving)
+        return true;
+    if (m_state != Ready)
+        return false;
+    if (m_primaryServer.isEmpty()) {
+        emit message(tr("The proxy does not set the system proxy, hot standby %1 cannot take over.")
+                         .arg(m_name));
+        return false;
+    }
+
+    WindowsProxy::set(m_server, bypassList());
+    setState(Serving);
+    emit tookOver(reason);
+    return true;
+}
+
+void HotStandby::stopServing()
+{
+    if (m_state == Serving)
+        setState(Ready);
+}
+
+void HotStandby::launch()
+{
+    // ProxyManager would stop on a modal warning, and retrying cannot help
+    if (!QFile::exists(m_corePath)) {
+        setState(Stopped);
+        emit message(tr("Hot standby %1: cannot find sing-box at %2.")
+                         .arg(m_name, QDir::toNativeSeparators(m_corePath)));
+        return;
+    }
+
+    QString filePath = appDataFilePath("standby_config.json");
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(QJsonDocument(m_config).toJson(QJsonDocument::Compact)) <= 0
+        || !file.commit()) {
+        scheduleRestart(tr("cannot write %1").arg(QDir::toNativeSeparators(filePath)));
+        return;
+    }
+
+    m_proxyManager->setCorePath(m_corePath);
+    m_proxyManager->setConfigFilePath(filePath);
+    m_probeFailures = 0;
+    setState(Starting);
+    m_proxyManager->startProxy();
+    // A start that failed right away has scheduled the restart already
+    if (m_state != Starting)
+        return;
+    if (m_proxyManager->proxyProcessState() == QProcess::NotRunning) {
+        scheduleRestart(tr("cannot start sing-box"));
+        return;
+    }
+    m_startClock.start();
+    m_checkTimer->start(kStartProbeInterval);
+}
+
+void HotStandby::scheduleRestart(const QString &reason)
+{
+    m_checkTimer->stop();
+    if (m_probe) {
+        QTcpSocket *probe = m_probe;
+        m_probe = nullptr;
+        probe->disconnect(this);
+        probe->abort();
+        probe->deleteLater();
+    }
+    if (m_state == Serving) {
+        // Nothing listens on the standby's port any more
+        WindowsProxy::clear();
+        emit message(tr("Hot standby %1 stopped while serving, the system proxy is cleared.").arg(m_name));
+    }
+
+    m_stopping = true;
+    m_proxyManager->stopProxy();
+    m_stopping = false;
+    setState(Stopped);
+
+    emit message(tr("Hot standby %1: %2, restarting in %3 s.")
+                     .arg(m_name, reason).arg(m_restartDelay / 1000));
+    m_restartTimer->start(m_restartDelay);
+    m_restartDelay = qMin(m_restartDelay * 2, kMaxRestartDelay);
+}
+
+void HotStandby::check()
+{
+    if (m_state == Starting && m_startClock.elapsed() > kStartTimeout) {
+        scheduleRestart(tr("did not open its inbound in time"));
+        return;
+    }
+    probeInbound();
+    if (m_state == Ready || m_state == Serving)
+        checkPrimary();
+}
+
+void HotStandby::probeInbound()
+{
+    if (m_probe) {
+        if (m_state == Starting)
+            return;
+        // Still connecting since the last check
+        QTcpSocket *probe = m_probe;
+        m_probe = nullptr;
+        probe->disconnect(this);
+        probe->abort();
+        probe->deleteLater();
+        if (++m_probeFailures >= kMaxProbeFailures) {
+            scheduleRestart(tr("stopped accepting connections"));
+            return;
+        }
+    }
+
+    // The core is up once its local inbound accepts connections
+    QNetworkProxy inbound = ThroughputBenchmark::localProxy(m_config);
+    m_probe = new QTcpSocket(this);
+    m_probe->setProxy(QNetworkProxy::NoProxy);
+    QTcpSocket *probe = m_probe;
+    connect(probe, &QTcpSocket::connected, this, [this, probe]() {
+        probe->disconnect(this);
+        probe->abort();
+        probe->deleteLater();
+        if (m_probe == probe)
+            m_probe = nullptr;
+        m_probeFailures = 0;
+        if (m_state == Starting) {
+            m_restartDelay = kMinRestartDelay;
+            m_checkTimer->start(kCheckInterval);
+            setState(Ready);
+            emit message(tr("Hot standby %1 is ready.").arg(m_name));
+        }
+    });
+    connect(probe, &QTcpSocket::errorOccurred, this, [this, probe]() {
+        probe->deleteLater();
+        if (m_probe != probe)
+            return;
+        m_probe = nullptr;
+        if (m_state != Starting && ++m_probeFailures >= kMaxProbeFailures)
+            scheduleRestart(tr("stopped accepting connections"));
+    });
+    probe->connectToHost(inbound.hostName(), inbound.port());
+}
+
+void HotStandby::checkPrimary()
+{
+    if (m_primaryCheck || m_primarySelector.isEmpty() || !m_primaryApi->isAvailable())
+        return;
+
+    // Tests the outbound the primary currently uses, through the primary
+    QNetworkReply *reply = m_primaryApi->delay(m_primarySelector, kDelayUrl, kDelayTimeout);
+    m_primaryCheck = reply;
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        if (m_primaryCheck != reply)
+            return;
+        m_primaryCheck = nullptr;
+
+        if (ClashApi::readObject(reply).contains("delay")) {
+            m_primaryFailures = 0;
+            if (m_state == Serving)
+                handBack();
+        } else if (++m_primaryFailures >= kMaxPrimaryFailures && m_state == Ready) {
+            takeOver(tr("%1 is unreachable").arg(m_primarySelector));
+        }
+    });
+}
+
+void HotStandby::handBack()
+{
+    WindowsProxy::set(m_primaryServer, bypassList());
+    setState(Ready);
+    emit handedBack();
+}
+
+void HotStandby::setState(State state)
+{
+    if (m_state == state)
+        return;
+    m_state = state;
+    emit stateChanged(state);
+}
+
+void HotStandby::onProcessStateChanged(int newState)
+{
+    if (newState != QProcess::NotRunning || m_stopping || m_state == Stopped)
+        return;
+    scheduleRestart(tr("sing-box exited"));
+}
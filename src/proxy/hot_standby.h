@@ -0,0 +1,96 @@
+#ifndef HOT_STANDBY_H
+#define HOT_STANDBY_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QObject>
+
+class ClashApi;
+class ProxyManager;
+
+QT_BEGIN_NAMESPACE
+class QNetworkReply;
+class QTcpSocket;
+class QTimer;
+QT_END_NAMESPACE
+
+// Keeps a second core running a fallback profile next to the proxy, so
+// traffic can move to it without a cold start. The standby gets free
+// loopback ports, its own Clash API and cache file, and never touches the
+// system proxy until it takes over. Its inbound is probed periodically and
+// the core is restarted when it dies. The primary's outbound is checked
+// through the primary's Clash API; when the checks keep failing, or the
+// primary core exits without being asked to, the system proxy is pointed
+// at the standby. Any program that accepts "run -c <file> -D <dir>" and
+// listens on the inbound port can stand in for the core.
+class HotStandby : public QObject
+{
+    Q_OBJECT
+public:
+    enum State {
+        Stopped,
+        Starting,
+        Ready,
+        Serving
+    };
+
+    explicit HotStandby(ClashApi *primaryApi, QObject *parent = nullptr);
+    ~HotStandby();
+
+    void start(const QString &name, const QJsonObject &config, const QString &corePath);
+    void stop();
+    State state() const;
+    QString name() const;
+
+    // The running primary. Clearing it stops the standby after a while
+    // unless a new primary comes up, so restarts keep the standby warm.
+    void setPrimary(const QJsonObject &config);
+    void clearPrimary();
+    // Points the system proxy at the standby, false if it is not ready or
+    // the primary does not set the system proxy
+    bool takeOver(const QString &reason);
+    // The caller has cleared the system proxy
+    void stopServing();
+
+signals:
+    void stateChanged(HotStandby::State state);
+    void tookOver(const QString &reason);
+    void handedBack();
+    void message(const QString &text);
+
+private slots:
+    void check();
+    void onProcessStateChanged(int newState);
+
+private:
+    void launch();
+    void scheduleRestart(const QString &reason);
+    void probeInbound();
+    void checkPrimary();
+    void handBack();
+    void setState(State state);
+
+    ProxyManager *m_proxyManager;
+    ClashApi *m_primaryApi;
+    QTimer *m_checkTimer;
+    QTimer *m_restartTimer;
+    QTimer *m_idleTimer;
+    QTcpSocket *m_probe = nullptr;
+    QNetworkReply *m_primaryCheck = nullptr;
+    QElapsedTimer m_startClock;
+
+    State m_state = Stopped;
+    bool m_stopping = false;
+    QString m_name;
+    QJsonObject m_config;
+    QString m_corePath;
+    // host:port strings for the system proxy
+    QString m_server;
+    QString m_primaryServer;
+    QString m_primarySelector;
+    int m_probeFailures = 0;
+    int m_primaryFailures = 0;
+    int m_restartDelay;
+};
+
+#endif // HOT_STANDBY_H
@@ -0,0 +1,313 @@
+#include "outbound_selector.h"
+
+#include <QJsonArray>
+#include <QNetworkReply>
+#include <QTimer>
+
+#include "clash_api.h"
+
+namespace {
+
+const int kDefaultInterval = 60;
+const int kDefaultMargin = 50;
+const int kDefaultMinimumDwell = 300;
+const int kStartDelay = 3000;
+const int kProbeTimeout = 5000;
+const int kMaxConcurrentProbes = 4;
+const int kConfirmRounds = 2;
+const double kAlpha = 0.3;
+// Losses count as this much latency when members are compared
+const double kLossPenalty = kProbeTimeout;
+const double kFailingLoss = 0.5;
+const char kDefaultProbeUrl[] = "https://www.gstatic.com/generate_204";
+// Members of these types do not carry traffic to a proxy server
+const QStringList kNonProxyTypes = {"direct", "block", "dns", "selector", "urltest"};
+
+} // namespace
+
+OutboundSelector::OutboundSelector(ClashApi *clashApi, QObject *parent)
+    : QObject{parent}
+    , m_clashApi{clashApi}
+    , m_probeUrl{kDefaultProbeUrl}
+    , m_margin{kDefaultMargin}
+    , m_minimumDwell{kDefaultMinimumDwell}
+{
+    m_timer = new QTimer(this);
+    m_timer->setInterval(kDefaultInterval * 1000);
+    connect(m_timer, &QTimer::timeout, this, &OutboundSelector::startRound);
+}
+
+QString OutboundSelector::defaultSelector(const QJsonObject &config)
+{
+    const QJsonArray outbounds = config.value("outbounds").toArray();
+    QString final = config.value("route").toObject().value("final").toString();
+    QString first;
+    for (const QJsonValue &value : outbounds) {
+        QJsonObject outbound = value.toObject();
+        if (outbound.value("type").toString() != "selector")
+            continue;
+        QString tag = outbound.value("tag").toString();
+        if (final.isEmpty() ? outbounds.first().toObject().value("tag").toString() == tag
+                            : final == tag)
+            return tag;
+        if (first.isEmpty())
+            first = tag;
+    }
+    return first;
+}
+
+void OutboundSelector::setSelector(const QString &selector)
+{
+    if (m_selector == selector)
+        return;
+    m_selector = selector;
+    m_stats.clear();
+    m_current.clear();
+    m_candidate.clear();
+    m_candidateRounds = 0;
+}
+
+QString OutboundSelector::selector() const
+{
+    return m_selector;
+}
+
+void OutboundSelector::setConfig(const QJsonObject &config)
+{
+    m_types.clear();
+    for (const QString &section : {QString("outbounds"), QString("endpoints")}) {
+        const QJsonArray outbounds = config.value(section).toArray();
+        for (const QJsonValue &value : outbounds) {
+            QJsonObject outbound = value.toObject();
+            m_types.insert(outbound.value("tag").toString(), outbound.value("type").toString());
+        }
+    }
+}
+
+void OutboundSelector::setInterval(int seconds)
+{
+    m_timer->setInterval(qMax(10, seconds) * 1000);
+}
+
+void OutboundSelector::setMargin(int milliseconds)
+{
+    m_margin = qMax(0, milliseconds);
+}
+
+void OutboundSelector::setMinimumDwell(int seconds)
+{
+    m_minimumDwell = qMax(0, seconds);
+}
+
+void OutboundSelector::setProbeUrl(const QString &url)
+{
+    m_probeUrl = url.isEmpty() ? QString(kDefaultProbeUrl) : url;
+}
+
+void OutboundSelector::setPassiveFailureRate(std::function<double(const QString &)> failureRate)
+{
+    m_passiveFailureRate = failureRate;
+}
+
+void OutboundSelector::start()
+{
+    stop();
+    if (m_selector.isEmpty() || !m_clashApi->isAvailable())
+        return;
+    m_sinceSwitch.start();
+    m_timer->start();
+    // Give the core a moment to open the controller
+    QTimer::singleShot(kStartDelay, this, [this, generation = m_generation]() {
+        if (generation == m_generation && m_timer->isActive())
+            startRound();
+    });
+}
+
+void OutboundSelector::stop()
+{
+    m_timer->stop();
+    ++m_generation;
+    m_roundActive = false;
+    m_pending.clear();
+    m_running = 0;
+    m_candidate.clear();
+    m_candidateRounds = 0;
+}
+
+bool OutboundSelector::isActive() const
+{
+    return m_timer->isActive();
+}
+
+QString OutboundSelector::current() const
+{
+    return m_current;
+}
+
+OutboundSelector::Stats OutboundSelector::stats(const QString &member) const
+{
+    return m_stats.value(member);
+}
+
+void OutboundSelector::startRound()
+{
+    if (m_roundActive)
+        return;
+    m_roundActive = true;
+
+    QNetworkReply *reply = m_clashApi->proxy(m_selector);
+    quint64 generation = m_generation;
+    connect(reply, &QNetworkReply::finished, this, [this, reply, generation]() {
+        reply->deleteLater();
+        if (generation != m_generation)
+            return;
+        QJsonObject proxy = ClashApi::readObject(reply);
+        if (proxy.isEmpty()) {
+            m_roundActive = false;
+            return;
+        }
+
+        QString now = proxy.value("now").toString();
+        // A change made elsewhere counts as a fresh choice and restarts the dwell
+        if (!m_current.isEmpty() && now != m_current) {
+            m_sinceSwitch.restart();
+            m_candidate.clear();
+            m_candidateRounds = 0;
+        }
+        m_current = now;
+
+        m_members.clear();
+        m_excluded.clear();
+        const QJsonArray all = proxy.value("all").toArray();
+        for (const QJsonValue &value : all) {
+            QString type = m_types.value(value.toString());
+            if (!type.isEmpty() && !kNonProxyTypes.contains(type))
+                m_members.append(value.toString());
+            else
+                m_excluded.append(value.toString());
+        }
+        for (auto it = m_stats.begin(); it != m_stats.end();) {
+            if (m_members.contains(it.key()))
+                ++it;
+            else
+                it = m_stats.erase(it);
+        }
+
+        m_pending = m_members;
+        m_running = 0;
+        if (m_pending.isEmpty()) {
+            m_roundActive = false;
+            return;
+        }
+        for (int i = 0; i < kMaxConcurrentProbes && !m_pending.isEmpty(); ++i)
+            probeNext();
+    });
+}
+
+void OutboundSelector::probeNext()
+{
+    QString member = m_pending.takeFirst();
+    ++m_running;
+
+    QNetworkReply *reply = m_clashApi->delay(member, m_probeUrl, kProbeTimeout);
+    quint64 generation = m_generation;
+    connect(reply, &QNetworkReply::finished, this, [this, reply, member, generation]() {
+        reply->deleteLater();
+        if (generation != m_generation)
+            return;
+        QJsonObject result = ClashApi::readObject(reply);
+        int delay = result.value("delay").toInt();
+        onProbeFinished(member, delay > 0, delay);
+    });
+}
+
+void OutboundSelector::onProbeFinished(const QString &member, bool ok, int delay)
+{
+    Stats &stats = m_stats[member];
+    if (ok)
+        stats.latency = stats.latency < 0 ? delay : kAlpha * delay + (1 - kAlpha) * stats.latency;
+    stats.loss = stats.samples == 0 ? (ok ? 0 : 1) : kAlpha * (ok ? 0 : 1) + (1 - kAlpha) * stats.loss;
+    ++stats.samples;
+
+    --m_running;
+    if (!m_pending.isEmpty())
+        probeNext();
+    else if (m_running == 0)
+        finishRound();
+}
+
+void OutboundSelector::finishRound()
+{
+    m_roundActive = false;
+
+    QString best;
+    for (const QString &member : std::as_const(m_members)) {
+        if (m_stats.value(member).latency < 0)
+            continue;
+        if (best.isEmpty() || score(member) < score(best))
+            best = member;
+    }
+
+    // Direct, block or a group picked by hand stays picked
+    if (best.isEmpty() || best == m_current || m_excluded.contains(m_current)) {
+        m_candidate.clear();
+        m_candidateRounds = 0;
+        emit roundFinished();
+        return;
+    }
+
+    bool currentFailing = isFailing(m_current) || !m_members.contains(m_current);
+    if (currentFailing && !isFailing(best)) {
+        switchTo(best);
+        emit roundFinished();
+        return;
+    }
+
+    if (score(best) + m_margin >= score(m_current)) {
+        m_candidate.clear();
+        m_candidateRounds = 0;
+        emit roundFinished();
+        return;
+    }
+
+    m_candidateRounds = best == m_candidate ? m_candidateRounds + 1 : 1;
+    m_candidate = best;
+    if (m_candidateRounds >= kConfirmRounds && m_sinceSwitch.elapsed() >= m_minimumDwell * 1000LL)
+        switchTo(best);
+    emit roundFinished();
+}
+
+double OutboundSelector::score(const QString &member) const
+{
+    Stats stats = m_stats.value(member);
+    if (stats.latency < 0)
+        return kLossPenalty * 2;
+    // Probes and real traffic see the same failures, do not count them twice
+    double loss = stats.loss;
+    if (m_passiveFailureRate)
+        loss = qMax(loss, m_passiveFailureRate(member));
+    return stats.latency + loss * kLossPenalty;
+}
+
+bool OutboundSelector::isFailing(const QString &member) const
+{
+    Stats stats = m_stats.value(member);
+    return stats.samples > 0 && (stats.latency < 0 || stats.loss >= kFailingLoss);
+}
+
+void OutboundSelector::switchTo(const QString &member)
+{
+    QString from = m_current;
+    QNetworkReply *reply = m_clashApi->selectProxy(m_selector, member);
+    quint64 generation = m_generation;
+    connect(reply, &QNetworkReply::finished, this, [this, reply, from, member, generation]() {
+        reply->deleteLater();
+        if (generation != m_generation || reply->error() != QNetworkReply::NoError)
+            return;
+        m_current = member;
+        m_candidate.clear();
+        m_candidateRounds = 0;
+        m_sinceSwitch.restart();
+        emit switched(m_selector, from, member);
+    });
+}
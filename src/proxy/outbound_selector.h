@@ -0,0 +1,102 @@
+#ifndef OUTBOUND_SELECTOR_H
+#define OUTBOUND_SELECTOR_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QStringList>
+
+#include <functional>
+
+class ClashApi;
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+// Keeps a selector outbound on its fastest member. Members are probed
+// through the clash API on a schedule, a few at a time, and the selector
+// is switched only when a candidate stays better than the current member
+// by the margin for several rounds and the current member has been kept
+// for the minimum dwell time. A failing current member is left at once.
+class OutboundSelector : public QObject
+{
+    Q_OBJECT
+public:
+    struct Stats
+    {
+        double latency = -1; // EWMA in ms, -1 until the first success
+        double loss = 0;     // EWMA of failed probes, 0..1
+        int samples = 0;
+    };
+
+    explicit OutboundSelector(ClashApi *clashApi, QObject *parent = nullptr);
+
+    // Selector the route falls through to, or the first one in the config
+    static QString defaultSelector(const QJsonObject &config);
+
+    void setSelector(const QString &selector);
+    QString selector() const;
+    // Types of the config's outbounds; only real proxies are probed and
+    // switched to, never direct, block, dns or another group
+    void setConfig(const QJsonObject &config);
+    void setInterval(int seconds);
+    void setMargin(int milliseconds);
+    void setMinimumDwell(int seconds);
+    void setProbeUrl(const QString &url);
+    // Failure rate (0..1) of real traffic through a member, weighed like
+    // probe loss, e.g. from the core's log
+    void setPassiveFailureRate(std::function<double(const QString &)> failureRate);
+
+    void start();
+    void stop();
+    bool isActive() const;
+
+    QString current() const;
+    Stats stats(const QString &member) const;
+
+signals:
+    void switched(const QString &selector, const QString &from, const QString &to);
+    void roundFinished();
+
+private slots:
+    void startRound();
+
+private:
+    void onSelectorReply();
+    void probeNext();
+    void onProbeFinished(const QString &member, bool ok, int delay);
+    void finishRound();
+    double score(const QString &member) const;
+    bool isFailing(const QString &member) const;
+    void switchTo(const QString &member);
+
+    ClashApi *m_clashApi;
+    QTimer *m_timer;
+    QString m_selector;
+    // Outbound and endpoint types by tag
+    QHash<QString, QString> m_types;
+    QString m_probeUrl;
+    std::function<double(const QString &)> m_passiveFailureRate;
+    int m_margin;
+    int m_minimumDwell;
+    bool m_roundActive = false;
+    // Bumped on stop() so replies from an older run are ignored
+    quint64 m_generation = 0;
+
+    QString m_current;
+    QStringList m_members;
+    // Members of the selector that are not proxies
+    QStringList m_excluded;
+    QStringList m_pending;
+    int m_running = 0;
+    QHash<QString, Stats> m_stats;
+
+    // Hysteresis state
+    QString m_candidate;
+    int m_candidateRounds = 0;
+    QElapsedTimer m_sinceSwitch;
+};
+
+#endif // OUTBOUND_SELECTOR_H
@@ -0,0 +1,29 @@
+#ifndef PROCESS_SAMPLER_H
+#define PROCESS_SAMPLER_H
+
+#include <QtGlobal>
+
+#include <memory>
+
+// Raw counters of a process at one point in time
+struct ProcessUsage
+{
+    qint64 cpuTime = 0; // user plus kernel time in ms
+    qint64 residentBytes = 0;
+    int handles = 0; // handles on Windows, open file descriptors elsewhere
+    int threads = 0;
+};
+
+// Reads the counters of another process. Each platform has its own
+// implementation, create() returns the one for the current system.
+class ProcessSampler
+{
+public:
+    virtual ~ProcessSampler() = default;
+
+    virtual bool sample(qint64 pid, ProcessUsage *usage) = 0;
+
+    static std::unique_ptr<ProcessSampler> create();
+};
+
+#endif // PROCESS_SAMPLER_H
@@ -0,0 +1,49 @@
+#include "process_sampler.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <unistd.h>
+
+namespace {
+
+// Reads /proc/<pid>/stat and counts /proc/<pid>/fd
+class ProcFsSampler : public ProcessSampler
+{
+public:
+    bool sample(qint64 pid, ProcessUsage *usage) override
+    {
+        QString directory = QString("/proc/%1").arg(pid);
+        QFile file(directory + "/stat");
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+        QByteArray stat = file.readAll();
+
+        // The command name may contain spaces, fields are counted after it
+        int nameEnd = stat.lastIndexOf(')');
+        if (nameEnd < 0)
+            return false;
+        const QList<QByteArray> fields = stat.mid(nameEnd + 2).split(' ');
+        // Fields 14, 15, 20 and 24 of proc(5), starting at field 3
+        if (fields.size() < 22)
+            return false;
+
+        static const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+        static const long pageSize = sysconf(_SC_PAGESIZE);
+        qint64 ticks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+        usage->cpuTime = ticks * 1000 / ticksPerSecond;
+        usage->threads = fields.at(17).toInt();
+        usage->residentBytes = fields.at(21).toLongLong() * pageSize;
+        usage->handles = QDir(directory + "/fd")
+                             .entryList(QDir::AllEntries | QDir::System | QDir::NoDotAndDotDot)
+                             .size();
+        return true;
+    }
+};
+
+} // namespace
+
+std::unique_ptr<ProcessSampler> ProcessSampler::create()
+{
+    return std::make_unique<ProcFsSampler>();
+}
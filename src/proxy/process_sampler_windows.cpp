@@ -0,0 +1,90 @@
+#include "process_sampler.h"
+
+#include <Windows.h>
+#include <Psapi.h>
+#include <TlHelp32.h>
+
+namespace {
+
+qint64 fileTimeToMilliseconds(const FILETIME &time)
+{
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return static_cast<qint64>(value.QuadPart / 10000);
+}
+
+// Keeps the process handle open between samples of the same process
+class WindowsProcessSampler : public ProcessSampler
+{
+public:
+    ~WindowsProcessSampler() override
+    {
+        closeHandle();
+    }
+
+    bool sample(qint64 pid, ProcessUsage *usage) override
+    {
+        if (pid != m_pid) {
+            closeHandle();
+            m_process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_VM_READ, FALSE,
+                                    static_cast<DWORD>(pid));
+            if (!m_process)
+                return false;
+            m_pid = pid;
+        }
+
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        if (!GetProcessTimes(m_process, &creationTime, &exitTime, &kernelTime, &userTime))
+            return false;
+        usage->cpuTime = fileTimeToMilliseconds(kernelTime) + fileTimeToMilliseconds(userTime);
+
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(m_process, &counters, sizeof(counters)))
+            usage->residentBytes = static_cast<qint64>(counters.WorkingSetSize);
+
+        DWORD handles = 0;
+        if (GetProcessHandleCount(m_process, &handles))
+            usage->handles = static_cast<int>(handles);
+
+        usage->threads = threadCount(static_cast<DWORD>(pid));
+        return true;
+    }
+
+private:
+    static int threadCount(DWORD pid)
+    {
+        HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+        if (snapshot == INVALID_HANDLE_VALUE)
+            return 0;
+        int threads = 0;
+        PROCESSENTRY32W entry;
+        entry.dwSize = sizeof(entry);
+        for (BOOL found = Process32FirstW(snapshot, &entry); found; found = Process32NextW(snapshot, &entry)) {
+            if (entry.th32ProcessID == pid) {
+                threads = static_cast<int>(entry.cntThreads);
+                break;
+            }
+        }
+        CloseHandle(snapshot);
+        return threads;
+    }
+
+    void closeHandle()
+    {
+        if (m_process)
+            CloseHandle(m_process);
+        m_process = nullptr;
+        m_pid = 0;
+    }
+
+    HANDLE m_process = nullptr;
+    qint64 m_pid = 0;
+};
+
+} // namespace
+
+std::unique_ptr<ProcessSampler> ProcessSampler::create()
+{
+    return std::make_unique<WindowsProcessSampler>();
+}
@@ -2,6 +2,7 @@
 
 #include <QCoreApplication>
 #include <QFile>
+#include <QFileInfo>
 #include <QMessageBox>
 
 #include "windows_proxy.h"
@@ -10,16 +11,20 @@ ProxyManager::ProxyManager(QObject *parent)
     : QObject{parent}
 {
     m_proxyProcess = new QProcess(this);
+    connect(m_proxyProcess, &QProcess::stateChanged, this,
+            &ProxyManager::emitProxyProcessStateChanged);
+    connect(m_proxyProcess, &QProcess::readyReadStandardError, this,
+            &ProxyManager::emitProxyProcessReadyReadStandardError);
 }
 
 void ProxyManager::startProxy()
 {
-    QString program = QCoreApplication::applicationDirPath() + "/sing-box.exe";
+    QString program = corePath();
     QFile file(program);
     if (!file.exists()) {
         QMessageBox::warning(nullptr, tr("Warning"),
                              tr("Can not find sing-box core!\n"
-                                "Please place \"sing-box.exe\" in\n") + QCoreApplication::applicationDirPath()
+                                "Please place \"sing-box.exe\" in\n") + QFileInfo(program).absolutePath()
                              );
     } else {
         if (m_configFilePath.isEmpty()) {
@@ -34,10 +39,6 @@ void ProxyManager::startProxy()
             QStringList arguments;
             arguments << "run" << "-c" << m_configFilePath << "-D" << QCoreApplication::applicationDirPath();
             m_proxyProcess->start(program, arguments);
-            connect(m_proxyProcess, &QProcess::stateChanged, this,
-                    &ProxyManager::emitProxyProcessStateChanged);
-            connect(m_proxyProcess, &QProcess::readyReadStandardError, this,
-                    &ProxyManager::emitProxyProcessReadyReadStandardError);
             emitProxyProcessStateChanged(QProcess::Running);
         }
     }
@@ -72,11 +73,28 @@ int ProxyManager::proxyProcessState() const
     return m_proxyProcess->state();
 }
 
+qint64 ProxyManager::proxyProcessId() const
+{
+    return m_proxyProcess->processId();
+}
+
 void ProxyManager::setConfigFilePath(const QString &filePath)
 {
     m_configFilePath = filePath;
 }
 
+void ProxyManager::setCorePath(const QString &corePath)
+{
+    m_corePath = corePath;
+}
+
+QString ProxyManager::corePath() const
+{
+    if (!m_corePath.isEmpty())
+        return m_corePath;
+    return QCoreApplication::applicationDirPath() + "/sing-box.exe";
+}
+
 void ProxyManager::emitProxyProcessStateChanged(int newState)
 {
 
@@ -17,8 +17,11 @@ public:
 
     QByteArray readProxyProcessAllStandardError();
     int proxyProcessState() const;
+    qint64 proxyProcessId() const;
 
     void setConfigFilePath(const QString &filePath);
+    void setCorePath(const QString &corePath);
+    QString corePath() const;
 
 signals:
     void proxyProcessStateChanged(int newState);
@@ -31,6 +34,7 @@ private slots:
 private:
     QProcess *m_proxyProcess = nullptr;
     QString m_configFilePath;
+    QString m_corePath;
 };
 
 #endif // PROXY_MANAGER_H
@@ -0,0 +1,120 @@
+#include "resource_monitor.h"
+
+#include <QThread>
+#include <QTimer>
+
+namespace {
+
+const int kSampleInterval = 1000;
+const int kHistorySize = 60 * 60;
+// Samples the growth check looks at, and what counts as a steady leak
+const int kGrowthWindow = 10 * 60;
+const double kMinGrowthPerMinute = 1024 * 1024;
+const double kMinGrowth = 32 * 1024 * 1024;
+const double kMinFit = 0.9;
+const qint64 kWarningInterval = 30 * 60 * 1000;
+
+} // namespace
+
+ResourceMonitor::ResourceMonitor(QObject *parent)
+    : QObject{parent}
+    , m_sampler{ProcessSampler::create()}
+    , m_history{kHistorySize}
+{
+    m_timer = new QTimer(this);
+    m_timer->setInterval(kSampleInterval);
+    connect(m_timer, &QTimer::timeout, this, &ResourceMonitor::sample);
+}
+
+ResourceMonitor::~ResourceMonitor() = default;
+
+void ResourceMonitor::start(qint64 pid)
+{
+    if (pid <= 0)
+        return;
+    if (pid != m_pid)
+        m_history.clear();
+    m_pid = pid;
+    m_lastUsage = ProcessUsage();
+    m_lastSample.invalidate();
+    m_timer->start();
+    sample();
+}
+
+void ResourceMonitor::stop()
+{
+    m_timer->stop();
+    m_pid = 0;
+    m_lastWarning.invalidate();
+}
+
+QList<ResourceSample> ResourceMonitor::history() const
+{
+    QList<ResourceSample> samples;
+    samples.reserve(m_history.count());
+    for (qsizetype i = m_history.firstIndex(); i <= m_history.lastIndex(); ++i)
+        samples.append(m_history.at(i));
+    return samples;
+}
+
+void ResourceMonitor::sample()
+{
+    ProcessUsage usage;
+    if (!m_sampler->sample(m_pid, &usage))
+        return;
+
+    ResourceSample sample;
+    sample.time = QDateTime::currentDateTime();
+    sample.residentBytes = usage.residentBytes;
+    sample.handles = usage.handles;
+    sample.threads = usage.threads;
+    // The first sample has nothing to compare CPU time against
+    if (m_lastSample.isValid()) {
+        qint64 elapsed = qMax<qint64>(1, m_lastSample.restart());
+        qint64 cpuTime = qMax<qint64>(0, usage.cpuTime - m_lastUsage.cpuTime);
+        sample.cpu = 100.0 * cpuTime / elapsed / qMax(1, QThread::idealThreadCount());
+    } else {
+        m_lastSample.start();
+    }
+    m_lastUsage = usage;
+
+    m_history.append(sample);
+    emit sampled(sample);
+    checkMemoryGrowth();
+}
+
+void ResourceMonitor::checkMemoryGrowth()
+{
+    if (m_history.count() < kGrowthWindow)
+        return;
+    if (m_lastWarning.isValid() && m_lastWarning.elapsed() < kWarningInterval)
+        return;
+
+    // Least squares fit of resident memory over the window
+    qsizetype first = m_history.lastIndex() - kGrowthWindow + 1;
+    QDateTime start = m_history.at(first).time;
+    double n = kGrowthWindow;
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0, sumYY = 0;
+    for (qsizetype i = first; i <= m_history.lastIndex(); ++i) {
+        double x = start.msecsTo(m_history.at(i).time) / 60000.0;
+        double y = m_history.at(i).residentBytes / 1048576.0;
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+        sumYY += y * y;
+    }
+    double varianceX = n * sumXX - sumX * sumX;
+    double varianceY = n * sumYY - sumY * sumY;
+    if (varianceX <= 0 || varianceY <= 0)
+        return;
+    double covariance = n * sumXY - sumX * sumY;
+    double slope = covariance / varianceX * 1048576.0; // bytes per minute
+    double fit = covariance * covariance / (varianceX * varianceY);
+    double growth = m_history.last().residentBytes - m_history.at(first).residentBytes;
+
+    if (slope >= kMinGrowthPerMinute && fit >= kMinFit && growth >= kMinGrowth) {
+        m_lastWarning.start();
+        emit memoryGrowing(static_cast<qint64>(slope));
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef RESOURCE_MONITOR_H
+#define RESOURCE_MONITOR_H
+
+#include <QContiguousCache>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+
+#include <memory>
+
+#include "process_sampler.h"
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+struct ResourceSample
+{
+    QDateTime time;
+    double cpu = 0; // percent of all cores
+    qint64 residentBytes = 0;
+    int handles = 0;
+    int threads = 0;
+};
+
+// Samples the core process once a second and keeps the last hour. A warning
+// is raised when resident memory has grown steadily for ten minutes.
+class ResourceMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ResourceMonitor(QObject *parent = nullptr);
+    ~ResourceMonitor();
+
+    void start(qint64 pid);
+    void stop();
+
+    QList<ResourceSample> history() const;
+
+signals:
+    void sampled(const ResourceSample &sample);
+    // Memory keeps growing at this rate
+    void memoryGrowing(qint64 bytesPerMinute);
+
+private slots:
+    void sample();
+
+private:
+    void checkMemoryGrowth();
+
+    std::unique_ptr<ProcessSampler> m_sampler;
+    QTimer *m_timer;
+    qint64 m_pid = 0;
+    ProcessUsage m_lastUsage;
+    QElapsedTimer m_lastSample;
+    QContiguousCache<ResourceSample> m_history;
+    QElapsedTimer m_lastWarning;
+};
+
+#endif // RESOURCE_MONITOR_H
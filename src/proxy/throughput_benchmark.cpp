@@ -0,0 +1,321 @@
+#include "throughput_benchmark.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+
+#include "clash_api.h"
+
+namespace {
+
+const int kDefaultConnections = 4;
+const int kDefaultDuration = 10000;
+// Pause before replacing a failed request, so a dead target is not hammered
+const int kRetryDelay = 250;
+
+QString resultsFilePath()
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(appDataPath);
+    return appDataPath + "/throughput.json";
+}
+
+// {profile: {outbound: result}}
+QJsonObject readResults()
+{
+    QFile file(resultsFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return QJsonObject();
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+} // namespace
+
+ThroughputBenchmark::ThroughputBenchmark(ClashApi *clashApi, QObject *parent)
+    : QObject{parent}
+    , m_clashApi{clashApi}
+    , m_connections{kDefaultConnections}
+    , m_duration{kDefaultDuration}
+{
+    m_deadline = new QTimer(this);
+    m_deadline->setSingleShot(true);
+    connect(m_deadline, &QTimer::timeout, this, &ThroughputBenchmark::finishMeasurement);
+}
+
+QNetworkProxy ThroughputBenchmark::localProxy(const QJsonObject &config)
+{
+    const QJsonArray inbounds = config.value("inbounds").toArray();
+    for (const QJsonValue &value : inbounds) {
+        QJsonObject inbound = value.toObject();
+        QString type = inbound.value("type").toString();
+        int port = inbound.value("listen_port").toInt();
+        if (port <= 0 || (type != "mixed" && type != "http" && type != "socks"))
+            continue;
+
+        QString host = inbound.value("listen").toString();
+        if (host.isEmpty() || host == "0.0.0.0")
+            host = "127.0.0.1";
+        else if (host == "::")
+            host = "::1";
+
+        QNetworkProxy proxy(type == "socks" ? QNetworkProxy::Socks5Proxy : QNetworkProxy::HttpProxy,
+                            host, static_cast<quint16>(port));
+        QJsonObject user = inbound.value("users").toArray().first().toObject();
+        if (!user.isEmpty()) {
+            proxy.setUser(user.value("username").toString());
+            proxy.setPassword(user.value("password").toString());
+        }
+        return proxy;
+    }
+    return QNetworkProxy(QNetworkProxy::NoProxy);
+}
+
+void ThroughputBenchmark::setProfile(const QString &profile)
+{
+    m_profile = profile;
+}
+
+void ThroughputBenchmark::setProxy(const QNetworkProxy &proxy)
+{
+    m_proxy = proxy;
+}
+
+void ThroughputBenchmark::setTarget(const QUrl &target)
+{
+    m_target = target;
+}
+
+void ThroughputBenchmark::setConnections(int connections)
+{
+    m_connections = qMax(1, connections);
+}
+
+void ThroughputBenchmark::setDuration(int milliseconds)
+{
+    m_duration = qMax(1000, milliseconds);
+}
+
+void ThroughputBenchmark::run(const QString &selector, const QStringList &outbounds)
+{
+    if (m_running || outbounds.isEmpty())
+        return;
+    m_running = true;
+    m_selector = selector;
+    m_queue = outbounds;
+    m_previous.clear();
+
+    // Remember the current member so the run leaves the selector as it was
+    QNetworkReply *reply = m_clashApi->proxy(m_selector);
+    quint64 generation = m_generation;
+    connect(reply, &QNetworkReply::finished, this, [this, reply, generation]() {
+        reply->deleteLater();
+        if (generation != m_generation)
+            return;
+        m_previous = ClashApi::readObject(reply).value("now").toString();
+        nextOutbound();
+    });
+}
+
+void ThroughputBenchmark::cancel()
+{
+    if (!m_running)
+        return;
+    ++m_generation;
+    m_queue.clear();
+    m_deadline->stop();
+    m_measuring = false;
+    if (m_networkManager) {
+        const QList<QNetworkReply *> replies = m_requestStarts.keys();
+        m_requestStarts.clear();
+        for (QNetworkReply *reply : replies)
+            reply->abort();
+        m_networkManager->deleteLater();
+        m_networkManager = nullptr;
+    }
+    finishRun();
+}
+
+bool ThroughputBenchmark::isRunning() const
+{
+    return m_running;
+}
+
+QHash<QString, ThroughputBenchmark::Result> ThroughputBenchmark::loadResults(const QString &profile)
+{
+    QHash<QString, Result> results;
+    const QJsonObject object = readResults().value(profile).toObject();
+    for (auto it = object.begin(); it != object.end(); ++it) {
+        QJsonObject value = it.value().toObject();
+        Result result;
+        result.outbound = it.key();
+        result.throughput = value.value("throughput").toDouble();
+        result.ttfb = value.value("ttfb").toDouble(-1);
+        result.jitter = value.value("jitter").toDouble();
+        result.bytes = value.value("bytes").toInteger();
+        result.requests = value.value("requests").toInt();
+        result.failures = value.value("failures").toInt();
+        result.finishedAt = QDateTime::fromString(value.value("finishedAt").toString(), Qt::ISODate);
+        results.insert(result.outbound, result);
+    }
+    return results;
+}
+
+void ThroughputBenchmark::nextOutbound()
+{
+    if (m_queue.isEmpty()) {
+        finishRun();
+        return;
+    }
+
+    m_result = Result();
+    m_result.outbound = m_queue.takeFirst();
+    emit outboundStarted(m_result.outbound);
+
+    QNetworkReply *reply = m_clashApi->selectProxy(m_selector, m_result.outbound);
+    quint64 generation = m_generation;
+    connect(reply, &QNetworkReply::finished, this, [this, reply, generation]() {
+        reply->deleteLater();
+        if (generation != m_generation)
+            return;
+        if (reply->error() != QNetworkReply::NoError) {
+            m_result.failures = 1;
+            m_result.finishedAt = QDateTime::currentDateTime();
+            emit outboundFinished(m_result);
+            nextOutbound();
+            return;
+        }
+        startMeasurement();
+    });
+}
+
+void ThroughputBenchmark::startMeasurement()
+{
+    // A fresh manager per outbound, kept-alive connections would still
+    // go through the previous member
+    m_networkManager = new QNetworkAccessManager(this);
+    m_networkManager->setProxy(m_proxy);
+    ++m_generation;
+    m_ttfbSamples = QList<QList<qint64>>(m_connections);
+    m_requestStarts.clear();
+
+    m_measuring = true;
+    m_clock.start();
+    m_deadline->start(m_duration);
+    for (int slot = 0; slot < m_connections; ++slot)
+        startRequest(slot);
+}
+
+void ThroughputBenchmark::startRequest(int slot)
+{
+    QNetworkRequest request(m_target);
+    request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+    request.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+    QNetworkReply *reply = m_networkManager->get(request);
+    m_requestStarts.insert(reply, m_clock.elapsed());
+    ++m_result.requests;
+
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply, slot]() {
+        if (!m_measuring)
+            return;
+        qint64 start = m_requestStarts.value(reply, -1);
+        if (start >= 0) {
+            m_ttfbSamples[slot].append(m_clock.elapsed() - start);
+            // Only the first chunk counts towards the time to first byte
+            m_requestStarts.insert(reply, -1);
+        }
+        m_result.bytes += reply->skip(reply->bytesAvailable());
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, reply, slot]() {
+        reply->deleteLater();
+        if (!m_measuring)
+            return;
+        m_requestStarts.remove(reply);
+        // Keep the connection count constant until the deadline
+        if (reply->error() == QNetworkReply::NoError) {
+            startRequest(slot);
+            return;
+        }
+        ++m_result.failures;
+        QTimer::singleShot(kRetryDelay, this, [this, slot, generation = m_generation]() {
+            if (m_measuring && generation == m_generation)
+                startRequest(slot);
+        });
+    });
+}
+
+void ThroughputBenchmark::finishMeasurement()
+{
+    m_measuring = false;
+    qint64 elapsed = qMax<qint64>(1, m_clock.elapsed());
+
+    const QList<QNetworkReply *> replies = m_requestStarts.keys();
+    m_requestStarts.clear();
+    for (QNetworkReply *reply : replies)
+        reply->abort();
+    m_networkManager->deleteLater();
+    m_networkManager = nullptr;
+
+    m_result.throughput = m_result.bytes * 1000.0 / elapsed;
+    double total = 0;
+    double variation = 0;
+    int samples = 0;
+    int steps = 0;
+    for (const QList<qint64> &slotSamples : std::as_const(m_ttfbSamples)) {
+        for (int i = 0; i < slotSamples.size(); ++i) {
+            total += slotSamples.at(i);
+            if (i > 0)
+                variation += qAbs(slotSamples.at(i) - slotSamples.at(i - 1));
+        }
+        samples += slotSamples.size();
+        steps += qMax(0, int(slotSamples.size()) - 1);
+    }
+    if (samples > 0)
+        m_result.ttfb = total / samples;
+    if (steps > 0)
+        m_result.jitter = variation / steps;
+    m_result.finishedAt = QDateTime::currentDateTime();
+
+    saveResult(m_result);
+    emit outboundFinished(m_result);
+    nextOutbound();
+}
+
+void ThroughputBenchmark::finishRun()
+{
+    if (!m_previous.isEmpty()) {
+        QNetworkReply *reply = m_clashApi->selectProxy(m_selector, m_previous);
+        connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
+    }
+    m_running = false;
+    emit finished();
+}
+
+void ThroughputBenchmark::saveResult(const Result &result) const
+{
+    QJsonObject value;
+    value.insert("throughput", result.throughput);
+    value.insert("ttfb", result.ttfb);
+    value.insert("jitter", result.jitter);
+    value.insert("bytes", result.bytes);
+    value.insert("requests", result.requests);
+    value.insert("failures", result.failures);
+    value.insert("finishedAt", result.finishedAt.toString(Qt::ISODate));
+
+    QJsonObject profiles = readResults();
+    QJsonObject results = profiles.value(m_profile).toObject();
+    results.insert(result.outbound, value);
+    profiles.insert(m_profile, results);
+
+    QSaveFile file(resultsFilePath());
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(profiles).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef THROUGHPUT_BENCHMARK_H
+#define THROUGHPUT_BENCHMARK_H
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QNetworkProxy>
+#include <QObject>
+#include <QStringList>
+#include <QUrl>
+
+class ClashApi;
+
+QT_BEGIN_NAMESPACE
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+QT_END_NAMESPACE
+
+// Measures how much bandwidth each member of a selector sustains. The
+// selector is pointed at one member at a time and parallel downloads of
+// the target go through the core's local inbound for a fixed duration.
+class ThroughputBenchmark : public QObject
+{
+    Q_OBJECT
+public:
+    struct Result
+    {
+        QString outbound;
+        double throughput = 0; // bytes per second
+        double ttfb = -1;      // mean time to first byte in ms
+        // Mean difference of consecutive ttfb samples of the same download
+        // slot in ms, slots run side by side and are not compared
+        double jitter = 0;
+        qint64 bytes = 0;
+        int requests = 0;
+        int failures = 0;
+        QDateTime finishedAt;
+    };
+
+    explicit ThroughputBenchmark(ClashApi *clashApi, QObject *parent = nullptr);
+
+    // Proxy for the first mixed, http or socks inbound of a config
+    static QNetworkProxy localProxy(const QJsonObject &config);
+
+    // Results are kept per profile, the same tag may be another server elsewhere
+    void setProfile(const QString &profile);
+    void setProxy(const QNetworkProxy &proxy);
+    void setTarget(const QUrl &target);
+    void setConnections(int connections);
+    void setDuration(int milliseconds);
+
+    // Benchmarks the outbounds one after another and restores the
+    // selector's previous member when done
+    void run(const QString &selector, const QStringList &outbounds);
+    void cancel();
+    bool isRunning() const;
+
+    // Last result of every outbound of the profile benchmarked so far
+    static QHash<QString, Result> loadResults(const QString &profile);
+
+signals:
+    void outboundStarted(const QString &outbound);
+    void outboundFinished(const ThroughputBenchmark::Result &result);
+    void finished();
+
+private:
+    void nextOutbound();
+    void startMeasurement();
+    void startRequest(int slot);
+    void finishMeasurement();
+    void finishRun();
+    void saveResult(const Result &result) const;
+
+    ClashApi *m_clashApi;
+    QString m_profile;
+    QNetworkProxy m_proxy;
+    QUrl m_target;
+    int m_connections;
+    int m_duration;
+
+    bool m_running = false;
+    bool m_measuring = false;
+    quint64 m_generation = 0;
+    QString m_selector;
+    QString m_previous;
+    QStringList m_queue;
+
+    // State of the outbound being measured
+    Result m_result;
+    QNetworkAccessManager *m_networkManager = nullptr;
+    QTimer *m_deadline;
+    QElapsedTimer m_clock;
+    QHash<QNetworkReply *, qint64> m_requestStarts;
+    // Time to first byte of every request, by download slot
+    QList<QList<qint64>> m_ttfbSamples;
+};
+
+#endif // THROUGHPUT_BENCHMARK_H
@@ -0,0 +1,151 @@
+#include "traffic_accounting.h"
+
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QNetworkReply>
+#include <QTimer>
+
+#include "clash_api.h"
+
+namespace {
+
+const int kPollInterval = 2000;
+const int kFlushInterval = 5 * 60 * 1000;
+
+} // namespace
+
+TrafficAccounting::TrafficAccounting(ClashApi *clashApi, QObject *parent)
+    : QObject{parent}
+    , m_clashApi{clashApi}
+{
+    m_store = new TrafficStore(this);
+
+    m_pollTimer = new QTimer(this);
+    m_pollTimer->setInterval(kPollInterval);
+    connect(m_pollTimer, &QTimer::timeout, this, &TrafficAccounting::poll);
+
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setInterval(kFlushInterval);
+    connect(m_flushTimer, &QTimer::timeout, m_store, &TrafficStore::flush);
+}
+
+void TrafficAccounting::start()
+{
+    if (!m_clashApi->isAvailable())
+        return;
+    m_connections.clear();
+    m_uploadTotal = 0;
+    m_downloadTotal = 0;
+    m_pollTimer->start();
+    m_flushTimer->start();
+}
+
+void TrafficAccounting::stop()
+{
+    m_pollTimer->stop();
+    m_flushTimer->stop();
+    m_connections.clear();
+    m_store->flush();
+}
+
+TrafficStore *TrafficAccounting::store() const
+{
+    return m_store;
+}
+
+void TrafficAccounting::poll()
+{
+    // Skip a tick rather than stacking requests on a slow core
+    if (m_polling)
+        return;
+    m_polling = true;
+
+    QNetworkReply *reply = m_clashApi->get("/connections");
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
+        m_polling = false;
+        if (!m_pollTimer->isActive())
+            return;
+        QJsonObject snapshot = ClashApi::readObject(reply);
+        if (!snapshot.isEmpty())
+            processSnapshot(snapshot);
+    });
+}
+
+void TrafficAccounting::processSnapshot(const QJsonObject &snapshot)
+{
+    QDateTime now = QDateTime::currentDateTimeUtc();
+    QHash<QString, Connection> current;
+    const QJsonArray connections = snapshot.value("connections").toArray();
+    current.reserve(connections.size());
+    quint64 countedUpload = 0;
+    quint64 countedDownload = 0;
+
+    for (const QJsonValue &value : connections) {
+        QJsonObject connection = value.toObject();
+        QString id = connection.value("id").toString();
+        Connection counters;
+        counters.upload = static_cast<quint64>(connection.value("upload").toDouble());
+        counters.download = static_cast<quint64>(connection.value("download").toDouble());
+
+        QJsonObject metadata = connection.value("metadata").toObject();
+        counters.domain = metadata.value("host").toString();
+        if (counters.domain.isEmpty())
+            counters.domain = metadata.value("destinationIP").toString();
+        counters.process = QFileInfo(metadata.value("processPath").toString()).fileName();
+        if (counters.process.isEmpty())
+            counters.process = tr("unknown");
+        // The chain lists the outbound that carried the connection first
+        counters.outbound = connection.value("chains").toArray().first().toString();
+
+        // Counters only grow, a smaller value means the id was reused
+        Connection previous = m_connections.take(id);
+        quint64 upload = counters.upload >= previous.upload ? counters.upload - previous.upload : counters.upload;
+        quint64 download = counters.download >= previous.download ? counters.download - previous.download
+                                                                  : counters.download;
+        current.insert(id, counters);
+        countedUpload += upload;
+        countedDownload += download;
+        if (upload == 0 && download == 0)
+            continue;
+
+        m_store->add(TrafficStore::Domain, counters.domain, upload, download, now);
+        m_store->add(TrafficStore::Process, counters.process, upload, download, now);
+        m_store->add(TrafficStore::Outbound, counters.outbound, upload, download, now);
+    }
+
+    // What is left in the table closed since the previous snapshot. The
+    // part of the core's totals not seen on open connections is what they
+    // moved in their last moments
+    quint64 uploadTotal = static_cast<quint64>(snapshot.value("uploadTotal").toDouble());
+    quint64 downloadTotal = static_cast<quint64>(snapshot.value("downloadTotal").toDouble());
+    if (!m_connections.isEmpty() && m_uploadTotal > 0 && uploadTotal >= m_uploadTotal
+        && downloadTotal >= m_downloadTotal) {
+        quint64 closedUpload = uploadTotal - m_uploadTotal;
+        quint64 closedDownload = downloadTotal - m_downloadTotal;
+        closedUpload = closedUpload > countedUpload ? closedUpload - countedUpload : 0;
+        closedDownload = closedDownload > countedDownload ? closedDownload - countedDownload : 0;
+
+        quint64 weightUpload = 0;
+        quint64 weightDownload = 0;
+        for (const Connection &closed : std::as_const(m_connections)) {
+            weightUpload += closed.upload;
+            weightDownload += closed.download;
+        }
+        for (const Connection &closed : std::as_const(m_connections)) {
+            quint64 upload = weightUpload > 0 ? quint64(double(closedUpload) * closed.upload / weightUpload) : 0;
+            quint64 download = weightDownload > 0 ? quint64(double(closedDownload) * closed.download / weightDownload)
+                                                  : 0;
+            if (upload == 0 && download == 0)
+                continue;
+            m_store->add(TrafficStore::Domain, closed.domain, upload, download, now);
+            m_store->add(TrafficStore::Process, closed.process, upload, download, now);
+            m_store->add(TrafficStore::Outbound, closed.outbound, upload, download, now);
+        }
+    }
+    m_uploadTotal = uploadTotal;
+    m_downloadTotal = downloadTotal;
+
+    m_connections.swap(current);
+    emit updated();
+}
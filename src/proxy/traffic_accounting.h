@@ -0,0 +1,62 @@
+#ifndef TRAFFIC_ACCOUNTING_H
+#define TRAFFIC_ACCOUNTING_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+
+#include "traffic_store.h"
+
+class ClashApi;
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+// Polls the core's /connections and charges the bytes each connection
+// moved since the previous snapshot to its domain, process and outbound.
+// Connections are matched by id, so only the difference is counted. Bytes
+// a connection moved after its last snapshot show up only in the core's
+// totals, and are charged to the connections that closed in proportion to
+// their last known totals.
+class TrafficAccounting : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TrafficAccounting(ClashApi *clashApi, QObject *parent = nullptr);
+
+    void start();
+    void stop();
+
+    TrafficStore *store() const;
+
+signals:
+    void updated();
+
+private slots:
+    void poll();
+
+private:
+    struct Connection
+    {
+        quint64 upload = 0;
+        quint64 download = 0;
+        QString domain;
+        QString process;
+        QString outbound;
+    };
+
+    void processSnapshot(const QJsonObject &snapshot);
+
+    ClashApi *m_clashApi;
+    TrafficStore *m_store;
+    QTimer *m_pollTimer;
+    QTimer *m_flushTimer;
+    bool m_polling = false;
+    QHash<QString, Connection> m_connections;
+    // Core totals of the previous snapshot, zero before the first one
+    quint64 m_uploadTotal = 0;
+    quint64 m_downloadTotal = 0;
+};
+
+#endif // TRAFFIC_ACCOUNTING_H
@@ -0,0 +1,255 @@
+#include "traffic_store.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimeZone>
+
+#include <algorithm>
+
+namespace {
+
+const quint32 kMagic = 0x51534254; // "QSBT"
+const quint8 kVersion = 1;
+const quint8 kKeyRecord = 'K';
+const quint8 kBucketRecord = 'B';
+const int kKeepMonths = 12;
+// Month files above this size are rewritten with one record per bucket
+const qint64 kCompactSize = 1024 * 1024;
+
+quint32 hourOf(const QDateTime &time)
+{
+    return static_cast<quint32>(time.toSecsSinceEpoch() / 3600);
+}
+
+} // namespace
+
+TrafficStore::TrafficStore(QObject *parent)
+    : QObject{parent}
+{
+    m_directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/traffic";
+    QDir().mkpath(m_directory);
+    pruneOldFiles();
+}
+
+TrafficStore::~TrafficStore()
+{
+    flush();
+}
+
+void TrafficStore::add(Kind kind, const QString &key, quint64 upload, quint64 download,
+                       const QDateTime &time)
+{
+    if (upload == 0 && download == 0)
+        return;
+    Bucket &bucket = m_pending[BucketKey{hourOf(time), static_cast<quint8>(kind), key}];
+    bucket.upload += upload;
+    bucket.download += download;
+}
+
+void TrafficStore::flush()
+{
+    if (m_pending.isEmpty())
+        return;
+
+    QHash<QString, QList<QPair<BucketKey, Bucket>>> files;
+    for (auto it = m_pending.cbegin(); it != m_pending.cend(); ++it)
+        files[monthFilePath(it.key().hour)].append(qMakePair(it.key(), it.value()));
+    m_pending.clear();
+
+    for (auto it = files.cbegin(); it != files.cend(); ++it)
+        appendToFile(it.key(), it.value());
+}
+
+QList<TrafficStore::Entry> TrafficStore::top(Kind kind, const QDateTime &from, const QDateTime &to,
+                                             int count) const
+{
+    quint32 fromHour = hourOf(from);
+    quint32 toHour = hourOf(to);
+    QHash<QString, Entry> totals;
+    auto addBuckets = [&](const QHash<BucketKey, Bucket> &buckets) {
+        for (auto it = buckets.cbegin(); it != buckets.cend(); ++it) {
+            const BucketKey &key = it.key();
+            if (key.kind != kind || key.hour < fromHour || key.hour > toHour)
+                continue;
+            Entry &entry = totals[key.key];
+            entry.upload += it.value().upload;
+            entry.download += it.value().download;
+        }
+    };
+
+    // Only the month files the range touches
+    QDate month = from.toUTC().date();
+    month.setDate(month.year(), month.month(), 1);
+    QDate lastMonth = to.toUTC().date();
+    while (month <= lastMonth) {
+        QString filePath = QString("%1/%2.bin").arg(m_directory, month.toString("yyyy-MM"));
+        if (QFile::exists(filePath))
+            addBuckets(monthFile(filePath).buckets);
+        month = month.addMonths(1);
+    }
+    addBuckets(m_pending);
+
+    QList<Entry> entries;
+    entries.reserve(totals.size());
+    for (auto it = totals.begin(); it != totals.end(); ++it) {
+        it.value().key = it.key();
+        entries.append(it.value());
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.upload + a.download > b.upload + b.download;
+    });
+    if (count > 0 && entries.size() > count)
+        entries.resize(count);
+    return entries;
+}
+
+QString TrafficStore::monthFilePath(quint32 hour) const
+{
+    QDateTime time = QDateTime::fromSecsSinceEpoch(qint64(hour) * 3600, QTimeZone::UTC);
+    return QString("%1/%2.bin").arg(m_directory, time.toString("yyyy-MM"));
+}
+
+TrafficStore::MonthFile &TrafficStore::monthFile(const QString &filePath) const
+{
+    // Only this store writes the files, a size mismatch means one was
+    // removed or replaced behind its back
+    auto it = m_months.find(filePath);
+    if (it == m_months.end() || it.value().size != QFileInfo(filePath).size()) {
+        MonthFile month;
+        month.size = readFile(filePath, &month);
+        it = m_months.insert(filePath, month);
+    }
+    return it.value();
+}
+
+qint64 TrafficStore::readFile(const QString &filePath, MonthFile *month)
+{
+    qint64 validSize = 0;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return validSize;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint8 version = 0;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != kMagic || version != kVersion)
+        return validSize;
+    validSize = file.pos();
+
+    QHash<quint32, QString> keys;
+    while (!in.atEnd()) {
+        quint8 type = 0;
+        in >> type;
+        if (type == kKeyRecord) {
+            quint32 id = 0;
+            QString key;
+            in >> id >> key;
+            if (in.status() != QDataStream::Ok)
+                break;
+            keys.insert(id, key);
+            month->keyIds.insert(key, id);
+        } else if (type == kBucketRecord) {
+            quint32 hour = 0;
+            quint8 kind = 0;
+            quint32 id = 0;
+            quint64 upload = 0;
+            quint64 download = 0;
+            in >> hour >> kind >> id >> upload >> download;
+            if (in.status() != QDataStream::Ok)
+                break;
+            Bucket &bucket = month->buckets[BucketKey{hour, kind, keys.value(id)}];
+            bucket.upload += upload;
+            bucket.download += download;
+            ++month->records;
+        } else {
+            break;
+        }
+        validSize = file.pos();
+    }
+    return validSize;
+}
+
+void TrafficStore::appendToFile(const QString &filePath, const QList<QPair<BucketKey, Bucket>> &buckets)
+{
+    MonthFile &month = monthFile(filePath);
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadWrite))
+        return;
+    // Drop a record torn by an earlier crash, or a file that is not ours
+    if (file.size() != month.size)
+        file.resize(month.size);
+    file.seek(month.size);
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    if (month.size == 0)
+        out << kMagic << kVersion;
+
+    for (const auto &pair : buckets) {
+        const BucketKey &key = pair.first;
+        auto id = month.keyIds.constFind(key.key);
+        if (id == month.keyIds.cend()) {
+            id = month.keyIds.insert(key.key, static_cast<quint32>(month.keyIds.size()));
+            out << kKeyRecord << id.value() << key.key;
+        }
+        out << kBucketRecord << key.hour << key.kind << id.value()
+            << pair.second.upload << pair.second.download;
+
+        Bucket &bucket = month.buckets[key];
+        bucket.upload += pair.second.upload;
+        bucket.download += pair.second.download;
+        ++month.records;
+    }
+    file.close();
+    month.size = file.size();
+
+    // Every flush adds a delta per active bucket, fold them once they
+    // clearly outnumber the buckets
+    if (month.size > kCompactSize && month.records > 2 * month.buckets.size())
+        compactFile(filePath, month);
+}
+
+void TrafficStore::compactFile(const QString &filePath, MonthFile &month)
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kMagic << kVersion;
+
+    QHash<QString, quint32> keyIds;
+    for (auto it = month.buckets.cbegin(); it != month.buckets.cend(); ++it) {
+        const BucketKey &key = it.key();
+        auto id = keyIds.constFind(key.key);
+        if (id == keyIds.cend()) {
+            id = keyIds.insert(key.key, static_cast<quint32>(keyIds.size()));
+            out << kKeyRecord << id.value() << key.key;
+        }
+        out << kBucketRecord << key.hour << key.kind << id.value() << it.value().upload << it.value().download;
+    }
+    if (!file.commit())
+        return;
+
+    month.keyIds = keyIds;
+    month.records = month.buckets.size();
+    month.size = QFileInfo(filePath).size();
+}
+
+void TrafficStore::pruneOldFiles()
+{
+    QString oldest = QDate::currentDate().addMonths(-kKeepMonths).toString("yyyy-MM");
+    const QStringList files = QDir(m_directory).entryList({"*.bin"}, QDir::Files);
+    for (const QString &name : files) {
+        if (name.left(7) < oldest)
+            QFile::remove(m_directory + "/" + name);
+    }
+}
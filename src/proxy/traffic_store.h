@@ -0,0 +1,87 @@
+#ifndef TRAFFIC_STORE_H
+#define TRAFFIC_STORE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+// Hourly traffic totals per domain, process and outbound. Each month is
+// an append-only binary file in AppData/traffic holding key definitions
+// and bucket deltas. A month is read once and kept summed in memory, and
+// its file is rewritten with one record per bucket once it grows large.
+class TrafficStore : public QObject
+{
+    Q_OBJECT
+public:
+    enum Kind {
+        Domain,
+        Process,
+        Outbound,
+        KindCount
+    };
+
+    struct Entry
+    {
+        QString key;
+        quint64 upload = 0;
+        quint64 download = 0;
+    };
+
+    explicit TrafficStore(QObject *parent = nullptr);
+    ~TrafficStore();
+
+    void add(Kind kind, const QString &key, quint64 upload, quint64 download,
+             const QDateTime &time = QDateTime::currentDateTimeUtc());
+    // Appends everything added since the last flush
+    void flush();
+
+    // Largest totals between from and to, unflushed data included
+    QList<Entry> top(Kind kind, const QDateTime &from, const QDateTime &to, int count) const;
+
+private:
+    struct Bucket
+    {
+        quint64 upload = 0;
+        quint64 download = 0;
+    };
+    // Hour since the epoch, kind and key of a pending bucket
+    struct BucketKey
+    {
+        quint32 hour;
+        quint8 kind;
+        QString key;
+        bool operator==(const BucketKey &other) const
+        {
+            return hour == other.hour && kind == other.kind && key == other.key;
+        }
+    };
+    friend size_t qHash(const BucketKey &key, size_t seed)
+    {
+        return qHashMulti(seed, key.hour, key.kind, key.key);
+    }
+
+    // Summed contents of a month file
+    struct MonthFile
+    {
+        qint64 size = 0;
+        int records = 0;
+        QHash<QString, quint32> keyIds;
+        QHash<BucketKey, Bucket> buckets;
+    };
+
+    QString monthFilePath(quint32 hour) const;
+    // Returns the cached month, reading the file if it changed on disk
+    MonthFile &monthFile(const QString &filePath) const;
+    // Reads a month file and returns the size of its intact part
+    static qint64 readFile(const QString &filePath, MonthFile *month);
+    void appendToFile(const QString &filePath, const QList<QPair<BucketKey, Bucket>> &buckets);
+    void compactFile(const QString &filePath, MonthFile &month);
+    void pruneOldFiles();
+
+    QString m_directory;
+    QHash<BucketKey, Bucket> m_pending;
+    mutable QHash<QString, MonthFile> m_months;
+};
+
+#endif // TRAFFIC_STORE_H
@@ -0,0 +1,177 @@
+#include "route_test_dialog.h"
+#include "ui_route_test_dialog.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileDialog>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+namespace {
+
+enum Column {
+    OutboundColumn,
+    RuleColumn,
+    CountColumn,
+    ExampleColumn,
+    ColumnCount
+};
+
+struct ListResult
+{
+    QList<RouteMatch> matches;
+    qint64 elapsed = 0;
+};
+
+} // namespace
+
+RouteTestDialog::RouteTestDialog(const QJsonObject &config, QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::RouteTestDialog)
+    , m_evaluator(std::make_shared<RouteEvaluator>(config))
+{
+    ui->setupUi(this);
+
+    ui->resultTable->setColumnCount(ColumnCount);
+    ui->resultTable->setHorizontalHeaderLabels({tr("Outbound"), tr("Rule"), tr("Count"), tr("Example")});
+    ui->resultTable->horizontalHeader()->setSectionResizeMode(RuleColumn, QHeaderView::Stretch);
+
+    ui->statusLabel->setText(tr("%n rule(s), final outbound: %1", nullptr, m_evaluator->ruleCount())
+                                 .arg(m_evaluator->finalOutbound()));
+}
+
+RouteTestDialog::~RouteTestDialog()
+{
+    delete ui;
+}
+
+void RouteTestDialog::on_testButton_clicked()
+{
+    QString input = ui->queryEdit->text().trimmed();
+    if (input.isEmpty())
+        return;
+
+    RouteQuery query = RouteEvaluator::parseQuery(input);
+    if (query.domain.isEmpty() && query.address.isNull()) {
+        ui->resultLabel->setText(tr("Enter a domain, an IP address, host:port or a URL."));
+        return;
+    }
+
+    RouteMatch match = m_evaluator->evaluate(query);
+    QString text = tr("%1 goes to <b>%2</b> by %3.")
+                       .arg(input.toHtmlEscaped(), match.outbound.toHtmlEscaped(),
+                            ruleText(match.ruleIndex).toHtmlEscaped());
+    if (!match.skippedRules.isEmpty()) {
+        QStringList skipped;
+        for (int ruleIndex : std::as_const(match.skippedRules))
+            skipped.append(ruleText(ruleIndex));
+        text += "<br>" + tr("Not evaluated before it: %1").arg(skipped.join("; ").toHtmlEscaped());
+    }
+    if (!query.domain.isEmpty())
+        text += "<br>" + tr("The domain is not resolved, ip_cidr rules only match IP addresses.");
+    ui->resultLabel->setText(text);
+}
+
+void RouteTestDialog::on_loadListButton_clicked()
+{
+    QString filePath = QFileDialog::getOpenFileName(this, tr("Test destinations from file"), QDir::homePath(),
+                                                    tr("Text files (*.txt *.csv *.list);;All files (*)"));
+    if (filePath.isEmpty())
+        return;
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, tr("Warning"), tr("Cannot read %1.").arg(QDir::toNativeSeparators(filePath)));
+        return;
+    }
+
+    // One destination per line, the first column of a CSV file
+    QStringList inputs;
+    while (!file.atEnd()) {
+        QString line = QString::fromUtf8(file.readLine()).section(',', 0, 0).trimmed();
+        if (!line.isEmpty() && !line.startsWith('#'))
+            inputs.append(line);
+    }
+    if (inputs.isEmpty()) {
+        ui->statusLabel->setText(tr("The file has no destinations."));
+        return;
+    }
+
+    ui->loadListButton->setEnabled(false);
+    ui->statusLabel->setText(tr("Testing %n destination(s)...", nullptr, inputs.size()));
+
+    std::shared_ptr<const RouteEvaluator> evaluator = m_evaluator;
+    auto *watcher = new QFutureWatcher<ListResult>(this);
+    connect(watcher, &QFutureWatcher<ListResult>::finished, this, [this, watcher, inputs]() {
+        watcher->deleteLater();
+        ListResult result = watcher->result();
+        showListResults(inputs, result.matches, result.elapsed);
+        ui->loadListButton->setEnabled(true);
+    });
+    watcher->setFuture(QtConcurrent::run([evaluator, inputs]() {
+        ListResult result;
+        QElapsedTimer timer;
+        timer.start();
+        result.matches = evaluator->evaluateAll(inputs);
+        result.elapsed = timer.elapsed();
+        return result;
+    }));
+}
+
+void RouteTestDialog::showListResults(const QStringList &inputs, const QList<RouteMatch> &matches,
+                                      qint64 elapsed)
+{
+    struct Group
+    {
+        QString outbound;
+        int ruleIndex;
+        int count;
+        QString example;
+    };
+
+    // One row per outbound and rule
+    QList<Group> groups;
+    QHash<QPair<QString, int>, qsizetype> groupIndex;
+    for (qsizetype i = 0; i < matches.size(); ++i) {
+        const RouteMatch &match = matches.at(i);
+        QPair<QString, int> key(match.outbound, match.ruleIndex);
+        auto it = groupIndex.constFind(key);
+        if (it == groupIndex.constEnd()) {
+            groupIndex.insert(key, groups.size());
+            groups.append(Group{match.outbound, match.ruleIndex, 1, inputs.at(i)});
+        } else {
+            ++groups[*it].count;
+        }
+    }
+    std::sort(groups.begin(), groups.end(), [](const Group &a, const Group &b) {
+        return a.count > b.count;
+    });
+
+    ui->resultTable->setRowCount(groups.size());
+    for (int row = 0; row < groups.size(); ++row) {
+        const Group &group = groups.at(row);
+        auto *countItem = new QTableWidgetItem(QString::number(group.count));
+        countItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        ui->resultTable->setItem(row, OutboundColumn, new QTableWidgetItem(group.outbound));
+        ui->resultTable->setItem(row, RuleColumn, new QTableWidgetItem(ruleText(group.ruleIndex)));
+        ui->resultTable->setItem(row, CountColumn, countItem);
+        ui->resultTable->setItem(row, ExampleColumn, new QTableWidgetItem(group.example));
+    }
+    ui->resultTable->resizeColumnToContents(OutboundColumn);
+    ui->resultTable->resizeColumnToContents(CountColumn);
+
+    ui->statusLabel->setText(tr("Tested %n destination(s) in %1 ms.", nullptr, matches.size()).arg(elapsed));
+}
+
+QString RouteTestDialog::ruleText(int ruleIndex) const
+{
+    if (ruleIndex < 0)
+        return tr("route.final");
+    return tr("rule #%1 (%2)").arg(ruleIndex + 1).arg(m_evaluator->describeRule(ruleIndex));
+}
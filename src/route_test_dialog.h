@@ -0,0 +1,36 @@
+#ifndef ROUTE_TEST_DIALOG_H
+#define ROUTE_TEST_DIALOG_H
+
+#include <QDialog>
+#include <QJsonObject>
+
+#include <memory>
+
+#include "route_evaluator.h"
+
+namespace Ui {
+class RouteTestDialog;
+}
+
+class RouteTestDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit RouteTestDialog(const QJsonObject &config, QWidget *parent = nullptr);
+    ~RouteTestDialog();
+
+private slots:
+    void on_testButton_clicked();
+    void on_loadListButton_clicked();
+
+private:
+    void showListResults(const QStringList &inputs, const QList<RouteMatch> &matches, qint64 elapsed);
+    QString ruleText(int ruleIndex) const;
+
+    Ui::RouteTestDialog *ui;
+    // Shared with the worker of a list test, which may outlive the dialog
+    std::shared_ptr<const RouteEvaluator> m_evaluator;
+};
+
+#endif // ROUTE_TEST_DIALOG_H
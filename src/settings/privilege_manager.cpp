@@ -6,6 +6,8 @@
 
 #include <Windows.h>
 
+#include "settings_store.h"
+
 PrivilegeManager::PrivilegeManager(QObject *parent)
     : QObject{parent}
 {}
@@ -48,6 +50,8 @@ void PrivilegeManager::restartProgram()
 {
     QString appPath = QCoreApplication::applicationFilePath();
 
+    // The new instance reads settings before this one has quit
+    SettingsStore::instance()->sync();
     qApp->quit();
     QProcess::startDetached(appPath);
 }
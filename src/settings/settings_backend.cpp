@@ -0,0 +1,70 @@
+#include "settings_backend.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QScopedPointer>
+
+QSettingsBackend::QSettingsBackend()
+{}
+
+QSettingsBackend::QSettingsBackend(const QString &iniFilePath)
+    : m_iniFilePath{iniFilePath}
+{}
+
+QVariantMap QSettingsBackend::load()
+{
+    QScopedPointer<QSettings> settings(m_iniFilePath.isEmpty()
+                                           ? new QSettings()
+                                           : new QSettings(m_iniFilePath, QSettings::IniFormat));
+    QVariantMap values;
+    const QStringList keys = settings->allKeys();
+    for (const QString &key : keys) {
+        values.insert(key, settings->value(key));
+    }
+    return values;
+}
+
+void QSettingsBackend::save(const QVariantMap &changed, const QStringList &removed)
+{
+    QScopedPointer<QSettings> settings(m_iniFilePath.isEmpty()
+                                           ? new QSettings()
+                                           : new QSettings(m_iniFilePath, QSettings::IniFormat));
+    for (const QString &key : removed) {
+        settings->remove(key);
+    }
+    for (auto it = changed.constBegin(); it != changed.constEnd(); ++it) {
+        settings->setValue(it.key(), it.value());
+    }
+    settings->sync();
+}
+
+JsonSettingsBackend::JsonSettingsBackend(const QString &filePath)
+    : m_filePath{filePath}
+{}
+
+QVariantMap JsonSettingsBackend::load()
+{
+    QFile file(m_filePath);
+    if (file.open(QIODevice::ReadOnly)) {
+        m_values = QJsonDocument::fromJson(file.readAll()).object().toVariantMap();
+    }
+    return m_values;
+}
+
+void JsonSettingsBackend::save(const QVariantMap &changed, const QStringList &removed)
+{
+    for (const QString &key : removed) {
+        m_values.remove(key);
+    }
+    for (auto it = changed.constBegin(); it != changed.constEnd(); ++it) {
+        m_values.insert(it.key(), it.value());
+    }
+
+    QSaveFile file(m_filePath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(QJsonObject::fromVariantMap(m_values)).toJson());
+        file.commit();
+    }
+}
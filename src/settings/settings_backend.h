@@ -0,0 +1,49 @@
+#ifndef SETTINGS_BACKEND_H
+#define SETTINGS_BACKEND_H
+
+#include <QSettings>
+#include <QStringList>
+#include <QVariantMap>
+
+// Persistent storage behind SettingsStore. Keys are flat, with "/"
+// separating groups, the same as QSettings uses.
+class SettingsBackend
+{
+public:
+    virtual ~SettingsBackend() = default;
+
+    virtual QVariantMap load() = 0;
+    // Removed keys are deleted before changed keys are written
+    virtual void save(const QVariantMap &changed, const QStringList &removed) = 0;
+};
+
+// Registry on Windows (NativeFormat) or an INI file (IniFormat)
+class QSettingsBackend : public SettingsBackend
+{
+public:
+    // Application default location, i.e. the registry on Windows
+    QSettingsBackend();
+    explicit QSettingsBackend(const QString &iniFilePath);
+
+    QVariantMap load() override;
+    void save(const QVariantMap &changed, const QStringList &removed) override;
+
+private:
+    QString m_iniFilePath;
+};
+
+// Single JSON document, rewritten as a whole on every save
+class JsonSettingsBackend : public SettingsBackend
+{
+public:
+    explicit JsonSettingsBackend(const QString &filePath);
+
+    QVariantMap load() override;
+    void save(const QVariantMap &changed, const QStringList &removed) override;
+
+private:
+    QString m_filePath;
+    QVariantMap m_values;
+};
+
+#endif // SETTINGS_BACKEND_H
@@ -4,44 +4,40 @@
 #include <QDir>
 #include <QSettings>
 
+#include "settings_store.h"
+
 SettingsManager::SettingsManager(QObject *parent)
     : QObject{parent}
 {}
 
 QString SettingsManager::lastOpenedFilePath()
 {
-    QSettings settings;
-    return settings.value("lastOpenedFilePath").toString();
+    return SettingsStore::instance()->value("lastOpenedFilePath").toString();
 }
 
 void SettingsManager::setLastOpenedFilePath(const QString &filePath)
 {
-    QSettings settings;
-    settings.setValue("lastOpenedFilePath", filePath);
+    SettingsStore::instance()->setValue("lastOpenedFilePath", filePath);
 }
 
 int SettingsManager::configIndex()
 {
-    QSettings settings;
-    return settings.value("configIndex").toInt();
+    return SettingsStore::instance()->value("configIndex").toInt();
 }
 
 void SettingsManager::setConfigIndex(int index)
 {
-    QSettings settings;
-    settings.setValue("configIndex", index);
+    SettingsStore::instance()->setValue("configIndex", index);
 }
 
 bool SettingsManager::autoRun()
 {
-    QSettings settings;
-    return settings.value("autoRun", false).toBool();
+    return SettingsStore::instance()->value("autoRun", false).toBool();
 }
 
 void SettingsManager::setAutoRun(bool checked)
 {
-    QSettings settings;
-    settings.setValue("autoRun", checked);
+    SettingsStore::instance()->setValue("autoRun", checked);
 }
 
 void SettingsManager::setAppAutoRun(bool enabled)
@@ -60,26 +56,173 @@ void SettingsManager::setAppAutoRun(bool enabled)
 
 bool SettingsManager::runAsAdmin()
 {
-    QSettings settings;
-    return settings.value("runAsAdmin", false).toBool();
+    return SettingsStore::instance()->value("runAsAdmin", false).toBool();
 }
 
 void SettingsManager::setRunAsAdmin(bool checked)
 {
-    QSettings settings;
-    settings.setValue("runAsAdmin", checked);
+    SettingsStore::instance()->setValue("runAsAdmin", checked);
+}
+
+bool SettingsManager::checkConfigWithCore()
+{
+    return SettingsStore::instance()->value("checkConfigWithCore", true).toBool();
+}
+
+void SettingsManager::setCheckConfigWithCore(bool checked)
+{
+    SettingsStore::instance()->setValue("checkConfigWithCore", checked);
+}
+
+bool SettingsManager::autoSelectOutbound()
+{
+    return SettingsStore::instance()->value("autoSelectOutbound", false).toBool();
+}
+
+void SettingsManager::setAutoSelectOutbound(bool checked)
+{
+    SettingsStore::instance()->setValue("autoSelectOutbound", checked);
+}
+
+int SettingsManager::autoSelectMargin()
+{
+    return SettingsStore::instance()->value("autoSelectMargin", 50).toInt();
+}
+
+void SettingsManager::setAutoSelectMargin(int milliseconds)
+{
+    SettingsStore::instance()->setValue("autoSelectMargin", milliseconds);
+}
+
+bool SettingsManager::dropConnectionsOnNetworkChange()
+{
+    return SettingsStore::instance()->value("dropConnectionsOnNetworkChange", false).toBool();
+}
+
+void SettingsManager::setDropConnectionsOnNetworkChange(bool checked)
+{
+    SettingsStore::instance()->setValue("dropConnectionsOnNetworkChange", checked);
+}
+
+int SettingsManager::logLineLimit()
+{
+    return SettingsStore::instance()->value("logLineLimit", 500).toInt();
+}
+
+void SettingsManager::setLogLineLimit(int linesPerSecond)
+{
+    SettingsStore::instance()->setValue("logLineLimit", linesPerSecond);
+}
+
+bool SettingsManager::lowerLogLevelWhenThrottled()
+{
+    return SettingsStore::instance()->value("lowerLogLevelWhenThrottled", false).toBool();
+}
+
+void SettingsManager::setLowerLogLevelWhenThrottled(bool checked)
+{
+    SettingsStore::instance()->setValue("lowerLogLevelWhenThrottled", checked);
+}
+
+QString SettingsManager::hotStandbyProfile()
+{
+    return SettingsStore::instance()->value("hotStandbyProfile", QString()).toString();
+}
+
+void SettingsManager::setHotStandbyProfile(const QString &id)
+{
+    SettingsStore::instance()->setValue("hotStandbyProfile", id);
+}
+
+int SettingsManager::metricsPort()
+{
+    return SettingsStore::instance()->value("metricsPort", 0).toInt();
+}
+
+void SettingsManager::setMetricsPort(int port)
+{
+    SettingsStore::instance()->setValue("metricsPort", port);
+}
+
+QString SettingsManager::benchmarkTarget()
+{
+    // No third party server is downloaded from unless the user picks it
+    return SettingsStore::instance()->value("benchmarkTarget", QString()).toString();
+}
+
+void SettingsManager::setBenchmarkTarget(const QString &url)
+{
+    SettingsStore::instance()->setValue("benchmarkTarget", url);
+}
+
+QStringList SettingsManager::dnsServerOrder(const QString &profile)
+{
+    return SettingsStore::instance()->value("dnsServerOrder/" + profile).toStringList();
+}
+
+void SettingsManager::setDnsServerOrder(const QString &profile, const QStringList &tags)
+{
+    if (tags.isEmpty())
+        SettingsStore::instance()->remove("dnsServerOrder/" + profile);
+    else
+        SettingsStore::instance()->setValue("dnsServerOrder/" + profile, tags);
+}
+
+QString SettingsManager::coreVersion()
+{
+    return SettingsStore::instance()->value("coreVersion").toString();
+}
+
+void SettingsManager::setCoreVersion(const QString &version)
+{
+    if (version.isEmpty())
+        SettingsStore::instance()->remove("coreVersion");
+    else
+        SettingsStore::instance()->setValue("coreVersion", version);
+}
+
+bool SettingsManager::subscriptionVerifyTls(const QString &host)
+{
+    return SettingsStore::instance()->value("subscriptionTls/" + host + "/verify", true).toBool();
+}
+
+void SettingsManager::setSubscriptionVerifyTls(const QString &host, bool checked)
+{
+    SettingsStore::instance()->setValue("subscriptionTls/" + host + "/verify", checked);
+}
+
+QStringList SettingsManager::subscriptionPins(const QString &host)
+{
+    return SettingsStore::instance()->value("subscriptionTls/" + host + "/pins").toStringList();
+}
+
+void SettingsManager::setSubscriptionPins(const QString &host, const QStringList &pins)
+{
+    if (pins.isEmpty())
+        SettingsStore::instance()->remove("subscriptionTls/" + host + "/pins");
+    else
+        SettingsStore::instance()->setValue("subscriptionTls/" + host + "/pins", pins);
+}
+
+QString SettingsManager::subscriptionCaFile(const QString &host)
+{
+    return SettingsStore::instance()->value("subscriptionTls/" + host + "/caFile").toString();
+}
+
+void SettingsManager::setSubscriptionCaFile(const QString &host, const QString &filePath)
+{
+    if (filePath.isEmpty())
+        SettingsStore::instance()->remove("subscriptionTls/" + host + "/caFile");
+    else
+        SettingsStore::instance()->setValue("subscriptionTls/" + host + "/caFile", filePath);
 }
 
 void SettingsManager::removeConfig()
 {
-    QSettings settings;
-    settings.beginWriteArray("Config");
-    settings.remove("");
-    settings.endArray();
+    SettingsStore::instance()->remove("Config");
 }
 
 void SettingsManager::clearAllSettings()
 {
-    QSettings settings;
-    settings.clear();
+    SettingsStore::instance()->clear();
 }
@@ -2,6 +2,7 @@
 #define SETTINGS_MANAGER_H
 
 #include <QObject>
+#include <QStringList>
 
 class SettingsManager : public QObject
 {
@@ -22,6 +23,58 @@ public:
     bool runAsAdmin();
     void setRunAsAdmin(bool checked);
 
+    // Run "sing-box check" on every config before it is applied
+    bool checkConfigWithCore();
+    void setCheckConfigWithCore(bool checked);
+
+    // Keep the selector outbound on its fastest member
+    bool autoSelectOutbound();
+    void setAutoSelectOutbound(bool checked);
+    // How much faster (ms) another member must be before switching
+    int autoSelectMargin();
+    void setAutoSelectMargin(int milliseconds);
+
+    // Close the core's connections when the network changes or the
+    // machine wakes up, instead of waiting for them to time out
+    bool dropConnectionsOnNetworkChange();
+    void setDropConnectionsOnNetworkChange(bool checked);
+
+    // Core log lines per second before low levels are hidden, 0 for no limit
+    int logLineLimit();
+    void setLogLineLimit(int linesPerSecond);
+    // After throttling, run the core at info level instead of debug or trace
+    bool lowerLogLevelWhenThrottled();
+    void setLowerLogLevelWhenThrottled(bool checked);
+
+    // Profile kept running as a hot standby next to the proxy, empty for none
+    QString hotStandbyProfile();
+    void setHotStandbyProfile(const QString &id);
+
+    // Loopback port serving OpenMetrics at /metrics, 0 when off
+    int metricsPort();
+    void setMetricsPort(int port);
+
+    // Download used by the throughput benchmark
+    QString benchmarkTarget();
+    void setBenchmarkTarget(const QString &url);
+
+    // Tags of dns.servers to move to the front of a profile's launch config
+    QStringList dnsServerOrder(const QString &profile);
+    void setDnsServerOrder(const QString &profile, const QStringList &tags);
+
+    // Installed sing-box version used unless a profile pins another one
+    QString coreVersion();
+    void setCoreVersion(const QString &version);
+
+    // TLS of subscription downloads from a host: verify the server, pin its
+    // public keys (base64 SHA-256 of the SPKI) and trust an extra CA file
+    bool subscriptionVerifyTls(const QString &host);
+    void setSubscriptionVerifyTls(const QString &host, bool checked);
+    QStringList subscriptionPins(const QString &host);
+    void setSubscriptionPins(const QString &host, const QStringList &pins);
+    QString subscriptionCaFile(const QString &host);
+    void setSubscriptionCaFile(const QString &host, const QString &filePath);
+
     void removeConfig();
     void clearAllSettings();
 };
@@ -0,0 +1,136 @@
+#include "settings_store.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTimer>
+
+namespace {
+
+// Coalesces bursts such as rewriting the whole config list
+const int kSyncDelay = 300;
+
+std::unique_ptr<SettingsBackend> &pendingBackend()
+{
+    static std::unique_ptr<SettingsBackend> backend;
+    return backend;
+}
+
+} // namespace
+
+SettingsStore *SettingsStore::instance()
+{
+    static SettingsStore *store = [] {
+        std::unique_ptr<SettingsBackend> backend = std::move(pendingBackend());
+        if (!backend)
+            backend = createDefaultBackend();
+        return new SettingsStore(std::move(backend), QCoreApplication::instance());
+    }();
+    return store;
+}
+
+void SettingsStore::setBackend(std::unique_ptr<SettingsBackend> backend)
+{
+    pendingBackend() = std::move(backend);
+}
+
+SettingsStore::SettingsStore(std::unique_ptr<SettingsBackend> backend, QObject *parent)
+    : QObject{parent}
+    , m_backend{std::move(backend)}
+{
+    m_values = m_backend->load();
+
+    m_syncTimer = new QTimer(this);
+    m_syncTimer->setSingleShot(true);
+    m_syncTimer->setInterval(kSyncDelay);
+    connect(m_syncTimer, &QTimer::timeout, this, &SettingsStore::sync);
+    if (QCoreApplication::instance()) {
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                this, &SettingsStore::sync);
+    }
+}
+
+SettingsStore::~SettingsStore()
+{
+    sync();
+}
+
+QVariant SettingsStore::value(const QString &key, const QVariant &defaultValue) const
+{
+    return m_values.value(key, defaultValue);
+}
+
+void SettingsStore::setValue(const QString &key, const QVariant &value)
+{
+    auto it = m_values.constFind(key);
+    if (it != m_values.constEnd() && it.value() == value)
+        return;
+
+    m_values.insert(key, value);
+    m_removedKeys.remove(key);
+    m_dirtyKeys.insert(key);
+    scheduleSync();
+    emit valueChanged(key, value);
+}
+
+bool SettingsStore::contains(const QString &key) const
+{
+    return m_values.contains(key);
+}
+
+void SettingsStore::remove(const QString &key)
+{
+    QString prefix = key + "/";
+    QStringList removed;
+    for (auto it = m_values.constBegin(); it != m_values.constEnd(); ++it) {
+        if (key.isEmpty() || it.key() == key || it.key().startsWith(prefix))
+            removed.append(it.key());
+    }
+
+    for (const QString &removedKey : removed) {
+        m_values.remove(removedKey);
+        m_dirtyKeys.remove(removedKey);
+        m_removedKeys.insert(removedKey);
+        emit valueChanged(removedKey, QVariant());
+    }
+    if (!removed.isEmpty())
+        scheduleSync();
+}
+
+void SettingsStore::clear()
+{
+    remove(QString());
+}
+
+void SettingsStore::sync()
+{
+    m_syncTimer->stop();
+    if (m_dirtyKeys.isEmpty() && m_removedKeys.isEmpty())
+        return;
+
+    QVariantMap changed;
+    for (const QString &key : std::as_const(m_dirtyKeys)) {
+        changed.insert(key, m_values.value(key));
+    }
+    QStringList removed(m_removedKeys.cbegin(), m_removedKeys.cend());
+    m_dirtyKeys.clear();
+    m_removedKeys.clear();
+
+    m_backend->save(changed, removed);
+}
+
+std::unique_ptr<SettingsBackend> SettingsStore::createDefaultBackend()
+{
+    QString basePath = QCoreApplication::applicationDirPath() + "/"
+                       + QCoreApplication::applicationName();
+    if (QFile::exists(basePath + ".ini"))
+        return std::make_unique<QSettingsBackend>(basePath + ".ini");
+    if (QFile::exists(basePath + ".json"))
+        return std::make_unique<JsonSettingsBackend>(basePath + ".json");
+    return std::make_unique<QSettingsBackend>();
+}
+
+void SettingsStore::scheduleSync()
+{
+    if (!m_syncTimer->isActive())
+        m_syncTimer->start();
+}
@@ -0,0 +1,57 @@
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <QObject>
+#include <QSet>
+#include <QVariantMap>
+
+#include <memory>
+
+#include "settings_backend.h"
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+// In-memory copy of the application settings, loaded once.
+// Reads never touch the backend. Writes update memory immediately and
+// are flushed together after a short delay, so a burst of changes
+// costs one registry or file round trip. Use from the GUI thread only.
+class SettingsStore : public QObject
+{
+    Q_OBJECT
+public:
+    static SettingsStore *instance();
+    // Must be called before the first instance() call to take effect
+    static void setBackend(std::unique_ptr<SettingsBackend> backend);
+
+    ~SettingsStore();
+
+    QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const;
+    void setValue(const QString &key, const QVariant &value);
+    bool contains(const QString &key) const;
+    // Removes the key and every key below it, like QSettings::remove()
+    void remove(const QString &key);
+    void clear();
+
+    // Write pending changes now
+    void sync();
+
+signals:
+    // Emitted for changed and removed keys, removed keys report an invalid value
+    void valueChanged(const QString &key, const QVariant &value);
+
+private:
+    explicit SettingsStore(std::unique_ptr<SettingsBackend> backend, QObject *parent = nullptr);
+    // Portable INI or JSON file next to the executable, otherwise the registry
+    static std::unique_ptr<SettingsBackend> createDefaultBackend();
+    void scheduleSync();
+
+    std::unique_ptr<SettingsBackend> m_backend;
+    QVariantMap m_values;
+    QSet<QString> m_dirtyKeys;
+    QSet<QString> m_removedKeys;
+    QTimer *m_syncTimer;
+};
+
+#endif // SETTINGS_STORE_H
@@ -13,13 +13,29 @@ SettingsDialog::SettingsDialog(ConfigManager *configManager, QWidget *parent)
     , ui(new Ui::SettingsDialog)
 {
     ui->setupUi(this);
-    setFixedSize(400, 200);
+    setFixedSize(400, 345);
 
     SettingsManager settingsManager;
     m_autoRun = settingsManager.autoRun();
     m_runAsAdmin = settingsManager.runAsAdmin();
     ui->autoRunCheckBox->setChecked(m_autoRun);
     ui->runAsAdminCheckBox->setChecked(m_runAsAdmin);
+    ui->checkConfigCheckBox->setChecked(settingsManager.checkConfigWithCore());
+    ui->autoSelectCheckBox->setChecked(settingsManager.autoSelectOutbound());
+    ui->autoSelectMarginSpinBox->setValue(settingsManager.autoSelectMargin());
+    ui->autoSelectMarginSpinBox->setEnabled(settingsManager.autoSelectOutbound());
+    ui->dropConnectionsCheckBox->setChecked(settingsManager.dropConnectionsOnNetworkChange());
+    ui->logLineLimitSpinBox->setValue(settingsManager.logLineLimit());
+    ui->lowerLogLevelCheckBox->setChecked(settingsManager.lowerLogLevelWhenThrottled());
+    ui->lowerLogLevelCheckBox->setEnabled(settingsManager.logLineLimit() > 0);
+
+    ProfileStore *profiles = m_configManager->profileStore();
+    ui->hotStandbyComboBox->addItem(tr("None"), QString());
+    for (int i = 0; i < profiles->count(); ++i)
+        ui->hotStandbyComboBox->addItem(profiles->at(i).name(), profiles->at(i).id());
+    int current = ui->hotStandbyComboBox->findData(settingsManager.hotStandbyProfile());
+    ui->hotStandbyComboBox->setCurrentIndex(qMax(0, current));
+    ui->metricsPortSpinBox->setValue(settingsManager.metricsPort());
 }
 
 SettingsDialog::~SettingsDialog()
@@ -102,3 +118,53 @@ void SettingsDialog::on_runAsAdminCheckBox_clicked(bool checked)
         }
     }
 }
+
+void SettingsDialog::on_checkConfigCheckBox_clicked(bool checked)
+{
+    SettingsManager settingsManager;
+    settingsManager.setCheckConfigWithCore(checked);
+}
+
+void SettingsDialog::on_autoSelectCheckBox_clicked(bool checked)
+{
+    SettingsManager settingsManager;
+    settingsManager.setAutoSelectOutbound(checked);
+    ui->autoSelectMarginSpinBox->setEnabled(checked);
+}
+
+void SettingsDialog::on_autoSelectMarginSpinBox_valueChanged(int value)
+{
+    SettingsManager settingsManager;
+    settingsManager.setAutoSelectMargin(value);
+}
+
+void SettingsDialog::on_dropConnectionsCheckBox_clicked(bool checked)
+{
+    SettingsManager settingsManager;
+    settingsManager.setDropConnectionsOnNetworkChange(checked);
+}
+
+void SettingsDialog::on_logLineLimitSpinBox_valueChanged(int value)
+{
+    SettingsManager settingsManager;
+    settingsManager.setLogLineLimit(value);
+    ui->lowerLogLevelCheckBox->setEnabled(value > 0);
+}
+
+void SettingsDialog::on_lowerLogLevelCheckBox_clicked(bool checked)
+{
+    SettingsManager settingsManager;
+    settingsManager.setLowerLogLevelWhenThrottled(checked);
+}
+
+void SettingsDialog::on_hotStandbyComboBox_activated(int index)
+{
+    SettingsManager settingsManager;
+    settingsManager.setHotStandbyProfile(ui->hotStandbyComboBox->itemData(index).toString());
+}
+
+void SettingsDialog::on_metricsPortSpinBox_valueChanged(int value)
+{
+    SettingsManager settingsManager;
+    settingsManager.setMetricsPort(value);
+}
@@ -21,6 +21,14 @@ private slots:
     void on_clearDataButton_clicked();
     void on_autoRunCheckBox_clicked(bool checked);
     void on_runAsAdminCheckBox_clicked(bool checked);
+    void on_checkConfigCheckBox_clicked(bool checked);
+    void on_autoSelectCheckBox_clicked(bool checked);
+    void on_autoSelectMarginSpinBox_valueChanged(int value);
+    void on_dropConnectionsCheckBox_clicked(bool checked);
+    void on_logLineLimitSpinBox_valueChanged(int value);
+    void on_lowerLogLevelCheckBox_clicked(bool checked);
+    void on_hotStandbyComboBox_activated(int index);
+    void on_metricsPortSpinBox_valueChanged(int value);
 
 private:
     Ui::SettingsDialog *ui;
@@ -0,0 +1,99 @@
+#include "subscription_tls_dialog.h"
+#include "ui_subscription_tls_dialog.h"
+
+#include <QDir>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QUrl>
+
+#include "settings_manager.h"
+
+SubscriptionTlsDialog::SubscriptionTlsDialog(SubscriptionTls *subscriptionTls, const QString &url,
+                                             QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::SubscriptionTlsDialog)
+    , m_subscriptionTls(subscriptionTls)
+    , m_host(QUrl(url).host())
+{
+    ui->setupUi(this);
+    if (!m_host.isEmpty())
+        setWindowTitle(tr("%1 - %2").arg(windowTitle(), m_host));
+
+    SubscriptionTls::Options options = m_subscriptionTls->options(m_host);
+    ui->verifyCheckBox->setChecked(options.verify);
+    ui->caFileEdit->setText(QDir::toNativeSeparators(options.caFile));
+    ui->pinsEdit->setPlainText(options.pins.join("\n"));
+
+    m_currentKey = m_subscriptionTls->lastPublicKey(m_host);
+    if (m_currentKey.isEmpty()) {
+        ui->currentKeyLabel->setText(tr("The server's key is known after the next download."));
+        ui->pinCurrentButton->setEnabled(false);
+    } else {
+        ui->currentKeyLabel->setText(tr("Server key: %1").arg(m_currentKey));
+    }
+}
+
+SubscriptionTlsDialog::~SubscriptionTlsDialog()
+{
+    delete ui;
+}
+
+void SubscriptionTlsDialog::accept()
+{
+    SubscriptionTls::Options options;
+    options.verify = ui->verifyCheckBox->isChecked();
+    options.caFile = QDir::fromNativeSeparators(ui->caFileEdit->text().trimmed());
+
+    const QStringList lines = ui->pinsEdit->toPlainText().split('\n', Qt::SkipEmptyParts);
+    for (const QString &line : lines) {
+        // Accept the "pin-sha256=" form of HPKP headers as well
+        QString pin = line.trimmed().remove("pin-sha256=").remove('"');
+        if (pin.isEmpty())
+            continue;
+        if (!SubscriptionTls::isValidPin(pin)) {
+            QMessageBox::warning(this, tr("Warning"),
+                                 tr("\"%1\" is not a base64 SHA-256 hash.").arg(pin));
+            return;
+        }
+        if (!options.pins.contains(pin))
+            options.pins.append(pin);
+    }
+
+    if (!options.caFile.isEmpty()) {
+        QString error;
+        if (SubscriptionTls::loadCertificates(options.caFile, &error).isEmpty()) {
+            QMessageBox::warning(this, tr("Warning"), error);
+            return;
+        }
+    }
+    if (!options.verify && options.pins.isEmpty()
+        && QMessageBox::question(this, tr("Question"),
+                                 tr("Without verification or pinned keys anyone on the path "
+                                    "can replace the config. Continue?")) != QMessageBox::Yes)
+        return;
+
+    SettingsManager settingsManager;
+    settingsManager.setSubscriptionVerifyTls(m_host, options.verify);
+    settingsManager.setSubscriptionPins(m_host, options.pins);
+    settingsManager.setSubscriptionCaFile(m_host, options.caFile);
+    m_subscriptionTls->setOptions(m_host, options);
+    QDialog::accept();
+}
+
+void SubscriptionTlsDialog::on_browseButton_clicked()
+{
+    QString filePath = QFileDialog::getOpenFileName(this, tr("CA certificate"), QDir::homePath(),
+                                                    tr("Certificates (*.pem *.crt *.cer *.der)"));
+    if (!filePath.isEmpty())
+        ui->caFileEdit->setText(QDir::toNativeSeparators(filePath));
+}
+
+void SubscriptionTlsDialog::on_pinCurrentButton_clicked()
+{
+    QString pins = ui->pinsEdit->toPlainText();
+    if (pins.contains(m_currentKey))
+        return;
+    if (!pins.isEmpty() && !pins.endsWith('\n'))
+        pins += '\n';
+    ui->pinsEdit->setPlainText(pins + m_currentKey);
+}
@@ -0,0 +1,36 @@
+#ifndef SUBSCRIPTION_TLS_DIALOG_H
+#define SUBSCRIPTION_TLS_DIALOG_H
+
+#include <QDialog>
+
+#include "subscription_tls.h"
+
+namespace Ui {
+class SubscriptionTlsDialog;
+}
+
+class SubscriptionTlsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit SubscriptionTlsDialog(SubscriptionTls *subscriptionTls, const QString &url,
+                                   QWidget *parent = nullptr);
+    ~SubscriptionTlsDialog();
+
+public slots:
+    void accept() override;
+
+private slots:
+    void on_browseButton_clicked();
+    void on_pinCurrentButton_clicked();
+
+private:
+    Ui::SubscriptionTlsDialog *ui;
+    SubscriptionTls *m_subscriptionTls;
+    // The settings apply to the host of the subscription only
+    QString m_host;
+    QString m_currentKey;
+};
+
+#endif // SUBSCRIPTION_TLS_DIALOG_H
@@ -0,0 +1,82 @@
+#include "traffic_dialog.h"
+#include "ui_traffic_dialog.h"
+
+#include <QHeaderView>
+#include <QLocale>
+#include <QTimer>
+
+#include "traffic_accounting.h"
+
+namespace {
+
+const int kTopCount = 20;
+const int kRefreshInterval = 10000;
+
+enum Column {
+    KeyColumn,
+    UploadColumn,
+    DownloadColumn,
+    TotalColumn,
+    ColumnCount
+};
+
+} // namespace
+
+TrafficDialog::TrafficDialog(TrafficAccounting *accounting, QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::TrafficDialog)
+    , m_accounting(accounting)
+{
+    ui->setupUi(this);
+
+    ui->trafficTable->setColumnCount(ColumnCount);
+    ui->trafficTable->setHorizontalHeaderLabels({tr("Name"), tr("Upload"), tr("Download"), tr("Total")});
+    ui->trafficTable->horizontalHeader()->setSectionResizeMode(KeyColumn, QHeaderView::Stretch);
+
+    connect(ui->kindComboBox, &QComboBox::currentIndexChanged, this, &TrafficDialog::refresh);
+    connect(ui->periodComboBox, &QComboBox::currentIndexChanged, this, &TrafficDialog::refresh);
+
+    // Month files are read on every refresh, so not on every poll
+    QTimer *refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(kRefreshInterval);
+    connect(refreshTimer, &QTimer::timeout, this, &TrafficDialog::refresh);
+    refreshTimer->start();
+
+    refresh();
+}
+
+TrafficDialog::~TrafficDialog()
+{
+    delete ui;
+}
+
+void TrafficDialog::refresh()
+{
+    static const int periodHours[] = {1, 24, 7 * 24, 30 * 24};
+    QDateTime to = QDateTime::currentDateTimeUtc();
+    QDateTime from = to.addSecs(-3600LL * (periodHours[ui->periodComboBox->currentIndex()] - 1));
+
+    auto kind = static_cast<TrafficStore::Kind>(ui->kindComboBox->currentIndex());
+    const QList<TrafficStore::Entry> entries = m_accounting->store()->top(kind, from, to, 0);
+
+    QLocale locale;
+    quint64 upload = 0;
+    quint64 download = 0;
+    int rows = qMin<int>(entries.size(), kTopCount);
+    ui->trafficTable->setRowCount(rows);
+    for (int row = 0; row < entries.size(); ++row) {
+        const TrafficStore::Entry &entry = entries.at(row);
+        upload += entry.upload;
+        download += entry.download;
+        if (row >= rows)
+            continue;
+        ui->trafficTable->setItem(row, KeyColumn, new QTableWidgetItem(entry.key));
+        ui->trafficTable->setItem(row, UploadColumn, new QTableWidgetItem(locale.formattedDataSize(entry.upload)));
+        ui->trafficTable->setItem(row, DownloadColumn, new QTableWidgetItem(locale.formattedDataSize(entry.download)));
+        ui->trafficTable->setItem(row, TotalColumn,
+                                  new QTableWidgetItem(locale.formattedDataSize(entry.upload + entry.download)));
+    }
+
+    ui->totalLabel->setText(tr("%1 up, %2 down in total")
+                                .arg(locale.formattedDataSize(upload), locale.formattedDataSize(download)));
+}
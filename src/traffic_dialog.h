@@ -0,0 +1,28 @@
+#ifndef TRAFFIC_DIALOG_H
+#define TRAFFIC_DIALOG_H
+
+#include <QDialog>
+
+class TrafficAccounting;
+
+namespace Ui {
+class TrafficDialog;
+}
+
+class TrafficDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit TrafficDialog(TrafficAccounting *accounting, QWidget *parent = nullptr);
+    ~TrafficDialog();
+
+private slots:
+    void refresh();
+
+private:
+    Ui::TrafficDialog *ui;
+    TrafficAccounting *m_accounting;
+};
+
+#endif // TRAFFIC_DIALOG_H
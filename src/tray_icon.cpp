@@ -36,6 +36,11 @@ bool TrayIcon::isVisible() const
     return m_trayIcon->isVisible();
 }
 
+void TrayIcon::showMessage(const QString &title, const QString &message)
+{
+    m_trayIcon->showMessage(title, message, QSystemTrayIcon::Warning);
+}
+
 void TrayIcon::setMenuEnabled(bool proxy_enabled)
 {
     m_enableProxyAction->setEnabled(!proxy_enabled);
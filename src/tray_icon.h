@@ -19,6 +19,7 @@ public:
     void show();
     void setIcon(const QIcon &icon);
     bool isVisible() const;
+    void showMessage(const QString &title, const QString &message);
 
 public slots:
     // According to the status of proxy,
@@ -0,0 +1,183 @@
+#include "log_governor.h"
+
+#include <cstring>
+
+namespace {
+
+const char *const kLevelNames[] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL", "PANIC"};
+const int kLevelCount = 7;
+// The level comes before the message, after an optional timestamp
+const int kLevelScanLength = 64;
+const qint64 kWindow = 1000;
+// A line that never ends is shown as it is
+const int kMaxPending = 64 * 1024;
+
+} // namespace
+
+LogGovernor::LogGovernor(QObject *parent)
+    : QObject{parent}
+{
+    m_windowClock.start();
+}
+
+void LogGovernor::setLimit(int linesPerSecond)
+{
+    m_limit = qMax(0, linesPerSecond);
+    if (m_limit == 0 && isThrottling()) {
+        m_minimumLevel = Trace;
+        emit throttlingChanged(false);
+    }
+}
+
+QByteArray LogGovernor::filter(const QByteArray &data)
+{
+    QByteArray input = m_pending.isEmpty() ? data : m_pending + data;
+    m_pending.clear();
+
+    QByteArray output;
+    output.reserve(input.size());
+    const char *line = input.constData();
+    const char *end = line + input.size();
+    while (line < end) {
+        const char *newline = static_cast<const char *>(std::memchr(line, '\n', end - line));
+        if (!newline) {
+            m_pending = QByteArray(line, end - line);
+            break;
+        }
+        const char *next = newline + 1;
+        countLine();
+
+        // Only a throttled log pays for finding the level
+        if (m_minimumLevel == Trace) {
+            m_keepingLine = true;
+        } else {
+            Level level = lineLevel(line, newline);
+            if (level != Unknown)
+                m_keepingLine = level >= m_minimumLevel;
+        }
+        if (m_keepingLine) {
+            output.append(line, next - line);
+            ++m_windowKept;
+        } else {
+            ++m_droppedLines;
+        }
+        line = next;
+    }
+
+    if (m_pending.size() > kMaxPending) {
+        output.append(m_pending);
+        m_pending.clear();
+    }
+    return output;
+}
+
+QByteArray LogGovernor::flush()
+{
+    QByteArray rest = m_pending;
+    m_pending.clear();
+    return rest;
+}
+
+void LogGovernor::reset()
+{
+    m_pending.clear();
+    m_windowLines = 0;
+    m_windowKept = 0;
+    m_lineRate = 0;
+    m_droppedLines = 0;
+    m_keepingLine = true;
+    m_windowClock.restart();
+    if (isThrottling()) {
+        m_minimumLevel = Trace;
+        emit throttlingChanged(false);
+    }
+}
+
+bool LogGovernor::isThrottling() const
+{
+    return m_minimumLevel > Trace;
+}
+
+LogGovernor::Level LogGovernor::minimumLevel() const
+{
+    return m_minimumLevel;
+}
+
+int LogGovernor::lineRate() const
+{
+    return m_lineRate;
+}
+
+qint64 LogGovernor::droppedLines() const
+{
+    return m_droppedLines;
+}
+
+LogGovernor::Level LogGovernor::lineLevel(const char *begin, const char *end)
+{
+    if (end - begin > kLevelScanLength)
+        end = begin + kLevelScanLength;
+
+    const char *p = begin;
+    while (p < end) {
+        if (*p == '\033') {
+            // Skip a color sequence, e.g. ESC[36m
+            ++p;
+            if (p < end && *p == '[') {
+                ++p;
+                while (p < end && (*p < '@' || *p > '~'))
+                    ++p;
+            }
+            if (p < end)
+                ++p;
+            continue;
+        }
+        if (*p < 'A' || *p > 'Z') {
+            ++p;
+            continue;
+        }
+
+        const char *word = p;
+        while (p < end && *p >= 'A' && *p <= 'Z')
+            ++p;
+        size_t length = p - word;
+        for (int i = 0; i < kLevelCount; ++i) {
+            if (std::strlen(kLevelNames[i]) == length && std::memcmp(word, kLevelNames[i], length) == 0)
+                return Level(i);
+        }
+    }
+    return Unknown;
+}
+
+QString LogGovernor::levelName(Level level)
+{
+    if (level < 0 || level >= kLevelCount)
+        return QString();
+    return QString::fromLatin1(kLevelNames[level]).toLower();
+}
+
+void LogGovernor::countLine()
+{
+    ++m_windowLines;
+    qint64 elapsed = m_windowClock.elapsed();
+    if (elapsed >= kWindow) {
+        m_lineRate = int(qint64(m_windowLines) * 1000 / elapsed);
+        int keptRate = int(qint64(m_windowKept) * 1000 / elapsed);
+        Level before = m_minimumLevel;
+        if (isThrottling()) {
+            if (m_lineRate < m_limit / 2)
+                m_minimumLevel = Trace;
+            else if (keptRate > m_limit && m_minimumLevel < Warn)
+                m_minimumLevel = Level(m_minimumLevel + 1);
+        }
+        m_windowLines = 0;
+        m_windowKept = 0;
+        m_windowClock.restart();
+        if (m_minimumLevel != before)
+            emit throttlingChanged(isThrottling());
+    } else if (m_limit > 0 && !isThrottling() && m_windowLines > m_limit) {
+        // No need to wait for the second to end
+        m_minimumLevel = Info;
+        emit throttlingChanged(true);
+    }
+}
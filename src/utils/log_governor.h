@@ -0,0 +1,69 @@
+#ifndef LOG_GOVERNOR_H
+#define LOG_GOVERNOR_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+
+// Keeps a flooding core log from eating the CPU. Raw output is split into
+// lines and counted before anything is decoded; once more lines than the
+// limit arrive per second, trace and debug lines are dropped, and info
+// lines too if that is not enough. Throttling ends when the rate falls
+// below half the limit for a second.
+class LogGovernor : public QObject
+{
+    Q_OBJECT
+public:
+    enum Level {
+        Trace,
+        Debug,
+        Info,
+        Warn,
+        Error,
+        Fatal,
+        Panic,
+        Unknown
+    };
+
+    explicit LogGovernor(QObject *parent = nullptr);
+
+    // Lines per second, 0 keeps every line
+    void setLimit(int linesPerSecond);
+    // Complete lines worth showing, a trailing partial line waits for the
+    // next chunk
+    QByteArray filter(const QByteArray &data);
+    // Whatever is left over when the core exits
+    QByteArray flush();
+    void reset();
+
+    bool isThrottling() const;
+    // Lines shown at or above this level while throttling
+    Level minimumLevel() const;
+    // Lines per second over the last full second
+    int lineRate() const;
+    qint64 droppedLines() const;
+
+    // Level of a sing-box log line, with or without colors and timestamps
+    static Level lineLevel(const char *begin, const char *end);
+    static QString levelName(Level level);
+
+signals:
+    // Also emitted when throttling moves up a level
+    void throttlingChanged(bool throttling);
+
+private:
+    void countLine();
+
+    QByteArray m_pending;
+    QElapsedTimer m_windowClock;
+    int m_limit = 0;
+    int m_windowLines = 0;
+    int m_windowKept = 0;
+    int m_lineRate = 0;
+    qint64 m_droppedLines = 0;
+    Level m_minimumLevel = Trace;
+    // Lines without a level continue the previous one, e.g. a stack trace
+    bool m_keepingLine = true;
+};
+
+#endif // LOG_GOVERNOR_H
@@ -0,0 +1,259 @@
+#include "log_parser.h"
+
+#include <cstring>
+
+namespace {
+
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Reads exactly count digits
+bool readDigits(const char *&p, const char *end, int count, int *value)
+{
+    if (end - p < count)
+        return false;
+    int result = 0;
+    for (int i = 0; i < count; ++i) {
+        if (!isDigit(p[i]))
+            return false;
+        result = result * 10 + (p[i] - '0');
+    }
+    p += count;
+    *value = result;
+    return true;
+}
+
+bool skip(const char *&p, const char *end, char c)
+{
+    if (p >= end || *p != c)
+        return false;
+    ++p;
+    return true;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+qint64 daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    const qint64 era = (year >= 0 ? year : year - 399) / 400;
+    const int yearOfEra = year - era * 400;
+    const int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// "+0800 2024-05-01 12:00:00 "
+bool readTimestamp(const char *&p, const char *end, qint64 *time)
+{
+    const char *q = p;
+    int sign = *q == '-' ? -1 : 1;
+    int zoneHours, zoneMinutes, year, month, day, hour, minute, second;
+    if (!(skip(q, end, '+') || skip(q, end, '-'))
+        || !readDigits(q, end, 2, &zoneHours) || !readDigits(q, end, 2, &zoneMinutes)
+        || !skip(q, end, ' ')
+        || !readDigits(q, end, 4, &year) || !skip(q, end, '-')
+        || !readDigits(q, end, 2, &month) || !skip(q, end, '-')
+        || !readDigits(q, end, 2, &day) || !skip(q, end, ' ')
+        || !readDigits(q, end, 2, &hour) || !skip(q, end, ':')
+        || !readDigits(q, end, 2, &minute) || !skip(q, end, ':')
+        || !readDigits(q, end, 2, &second))
+        return false;
+
+    qint64 seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second
+                     - sign * (zoneHours * 3600 + zoneMinutes * 60);
+    *time = seconds * 1000;
+    p = q;
+    return true;
+}
+
+void skipSpaces(const char *&p, const char *end)
+{
+    while (p < end && *p == ' ')
+        ++p;
+}
+
+bool startsWith(QByteArrayView text, const char *prefix, QByteArrayView *rest)
+{
+    if (!text.startsWith(prefix))
+        return false;
+    *rest = text.sliced(std::strlen(prefix));
+    return true;
+}
+
+// Errors sing-box reports when a connection could not be established,
+// as opposed to one that broke or was closed later
+bool isSetupError(QByteArrayView message)
+{
+    static const char *const markers[] = {
+        "open outbound connection", "dial tcp", "dial udp", "handshake", "connect: ",
+        "no such host", "reality verification", "certificate",
+    };
+    for (const char *marker : markers) {
+        if (message.contains(QByteArrayView(marker)))
+            return true;
+    }
+    return false;
+}
+
+// "outbound/vless[proxy]" into "outbound/vless" and "proxy"
+void splitTag(QByteArrayView text, QByteArrayView *name, QByteArrayView *tag)
+{
+    qsizetype open = text.indexOf('[');
+    if (open > 0 && text.endsWith(']')) {
+        *name = text.first(open);
+        *tag = text.sliced(open + 1, text.size() - open - 2);
+    } else {
+        *name = text;
+        *tag = QByteArrayView();
+    }
+}
+
+} // namespace
+
+bool LogParser::parse(const char *begin, const char *end, Buffer *buffer, LogLine *line)
+{
+    // Colors would get in the way of every field
+    buffer->clear();
+    buffer->reserve(end - begin);
+    const char *p = begin;
+    while (p < end) {
+        const char *escape = static_cast<const char *>(std::memchr(p, '\033', end - p));
+        const char *stop = escape ? escape : end;
+        buffer->append(p, stop - p);
+        if (!escape)
+            break;
+        p = escape + 1;
+        if (p < end && *p == '[') {
+            ++p;
+            while (p < end && (*p < '@' || *p > '~'))
+                ++p;
+        }
+        if (p < end)
+            ++p;
+    }
+    while (!buffer->isEmpty() && (buffer->last() == '\r' || buffer->last() == '\n'))
+        buffer->removeLast();
+
+    *line = LogLine();
+    p = buffer->constData();
+    end = p + buffer->size();
+
+    if (p < end && (*p == '+' || *p == '-')) {
+        if (!readTimestamp(p, end, &line->time))
+            return false;
+        skipSpaces(p, end);
+    }
+
+    const char *word = p;
+    while (p < end && *p >= 'A' && *p <= 'Z')
+        ++p;
+    line->level = LogGovernor::lineLevel(word, p);
+    if (line->level == LogGovernor::Unknown)
+        return false;
+
+    // "INFO[0012]" counts seconds since the core started
+    if (p < end && *p == '[' && line->time < 0) {
+        const char *q = p + 1;
+        qint64 seconds = 0;
+        while (q < end && isDigit(*q))
+            seconds = seconds * 10 + (*q++ - '0');
+        if (q < end && *q == ']' && q > p + 1) {
+            line->time = seconds * 1000;
+            line->relativeTime = true;
+            p = q + 1;
+        }
+    }
+    skipSpaces(p, end);
+
+    // "[3890458393 12ms]"
+    if (p < end && *p == '[') {
+        const char *q = p + 1;
+        quint64 id = 0;
+        while (q < end && isDigit(*q))
+            id = id * 10 + (*q++ - '0');
+        const char *close = static_cast<const char *>(std::memchr(q, ']', end - q));
+        if (q > p + 1 && close && q < close && *q == ' ') {
+            line->connection = quint32(id);
+            line->duration = parseDuration(QByteArrayView(q + 1, close));
+            p = close + 1;
+            skipSpaces(p, end);
+        }
+    }
+
+    // "component: message", the first ": " ends the component
+    QByteArrayView rest(p, end);
+    qsizetype colon = rest.indexOf(": ");
+    if (colon > 0 && !rest.first(colon).contains(' ')) {
+        splitTag(rest.first(colon), &line->component, &line->tag);
+        line->message = rest.sliced(colon + 2);
+    } else {
+        line->message = rest;
+    }
+
+    QByteArrayView destination;
+    if (startsWith(line->message, "inbound connection to ", &destination)
+        || startsWith(line->message, "inbound packet connection to ", &destination)) {
+        line->event = LogLine::InboundConnection;
+        line->destination = destination;
+    } else if (startsWith(line->message, "outbound connection to ", &destination)
+               || startsWith(line->message, "outbound packet connection to ", &destination)) {
+        line->event = LogLine::OutboundConnection;
+        line->destination = destination;
+    } else if (line->level >= LogGovernor::Error && line->connection != 0) {
+        line->event = isSetupError(line->message) ? LogLine::SetupFailure : LogLine::Failure;
+        qsizetype at = line->message.indexOf("outbound/");
+        if (at >= 0) {
+            QByteArrayView mention = line->message.sliced(at);
+            qsizetype open = mention.indexOf('[');
+            qsizetype close = mention.indexOf(']');
+            if (open > 0 && close > open)
+                line->outbound = mention.sliced(open + 1, close - open - 1);
+        }
+    }
+    return true;
+}
+
+qint64 LogParser::parseDuration(QByteArrayView text)
+{
+    double total = 0;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    if (p == end)
+        return -1;
+
+    while (p < end) {
+        const char *start = p;
+        while (p < end && (isDigit(*p) || *p == '.'))
+            ++p;
+        bool ok = false;
+        double value = QByteArrayView(start, p).toDouble(&ok);
+        if (!ok)
+            return -1;
+
+        QByteArrayView unit(p, end);
+        if (unit.startsWith("ms")) {
+            p += 2;
+        } else if (unit.startsWith("us") || unit.startsWith("ns")) {
+            value /= unit.startsWith("us") ? 1000 : 1000000;
+            p += 2;
+        } else if (unit.startsWith("\xc2\xb5s")) {
+            value /= 1000;
+            p += 3;
+        } else if (unit.startsWith('h')) {
+            value *= 3600000;
+            ++p;
+        } else if (unit.startsWith('m')) {
+            value *= 60000;
+            ++p;
+        } else if (unit.startsWith('s')) {
+            value *= 1000;
+            ++p;
+        } else {
+            return -1;
+        }
+        total += value;
+    }
+    return qint64(total + 0.5);
+}
@@ -0,0 +1,55 @@
+#ifndef LOG_PARSER_H
+#define LOG_PARSER_H
+
+#include <QByteArrayView>
+#include <QVarLengthArray>
+
+#include "log_governor.h"
+
+// One sing-box log line, e.g.
+// "+0800 2024-05-01 12:00:00 INFO [3890458393 12ms] outbound/vless[proxy]: outbound connection to example.com:443"
+// The views point into the buffer given to LogParser::parse().
+struct LogLine
+{
+    enum Event {
+        Other,
+        InboundConnection,
+        OutboundConnection,
+        // An error about a connection, e.g. a reset while transferring
+        Failure,
+        // An error while dialing or in the handshake with the server, the
+        // outbound itself did not work
+        SetupFailure
+    };
+
+    // ms since the epoch, or since the core started when relativeTime
+    qint64 time = -1;
+    bool relativeTime = false;
+    LogGovernor::Level level = LogGovernor::Unknown;
+    Event event = Other;
+    quint32 connection = 0;
+    // ms since the connection started, -1 without a connection
+    qint64 duration = -1;
+    QByteArrayView component;   // "outbound/vless"
+    QByteArrayView tag;         // "proxy"
+    // Outbound named in the message of a failure, "using outbound/vless[proxy]"
+    QByteArrayView outbound;
+    QByteArrayView destination; // "example.com:443"
+    QByteArrayView message;
+};
+
+// Splits log lines into fields with plain byte scanning, no QString is
+// built on the way
+class LogParser
+{
+public:
+    using Buffer = QVarLengthArray<char, 512>;
+
+    // Copies the line without its color sequences into buffer and parses
+    // it, false if it does not look like a sing-box log line
+    static bool parse(const char *begin, const char *end, Buffer *buffer, LogLine *line);
+    // Go duration, e.g. "150ms", "1.5s" or "1m2s", -1 if it is not one
+    static qint64 parseDuration(QByteArrayView text);
+};
+
+#endif // LOG_PARSER_H
@@ -0,0 +1,295 @@
+#include "log_table.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "log_parser.h"
+
+namespace {
+
+// A line that never ends is not a log line
+const int kMaxPending = 64 * 1024;
+
+} // namespace
+
+LogTable::LogTable(int capacity)
+    : m_capacity{qMax(1, capacity)}
+    , m_compactAt{4 * m_capacity}
+{
+}
+
+int LogTable::feed(const QByteArray &data)
+{
+    QByteArray input = m_pending.isEmpty() ? data : m_pending + data;
+    m_pending.clear();
+
+    LogParser::Buffer buffer;
+    LogLine line;
+    int added = 0;
+    const char *p = input.constData();
+    const char *end = p + input.size();
+    while (p < end) {
+        const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (!newline) {
+            if (end - p <= kMaxPending)
+                m_pending = QByteArray(p, end - p);
+            break;
+        }
+        if (LogParser::parse(p, newline, &buffer, &line)) {
+            append(line);
+            ++added;
+        }
+        p = newline + 1;
+    }
+    return added;
+}
+
+void LogTable::clear()
+{
+    m_records.clear();
+    m_first = 0;
+    m_pending.clear();
+    m_strings.clear();
+    m_stringIds.clear();
+    m_compactAt = 4 * m_capacity;
+    m_connections.clear();
+    m_sequence = 0;
+}
+
+int LogTable::size() const
+{
+    return int(m_records.size());
+}
+
+const LogRecord &LogTable::at(int index) const
+{
+    return m_records[(m_first + index) % m_records.size()];
+}
+
+QString LogTable::string(int index) const
+{
+    if (index < 0 || index >= m_strings.size())
+        return QString();
+    return QString::fromUtf8(m_strings.at(index));
+}
+
+int LogTable::connectionCount() const
+{
+    return m_connections.size();
+}
+
+QString LogTable::outboundOf(quint32 connection) const
+{
+    return string(m_connections.value(connection).outbound);
+}
+
+QList<LogRecord> LogTable::select(const Query &query, int limit) const
+{
+    QList<LogRecord> records;
+    int tag = -1;
+    if (!query.tag.isEmpty()) {
+        tag = find(query.tag);
+        if (tag < 0)
+            return records;
+    }
+    QByteArray destination = query.destination.toUtf8();
+
+    for (int i = size() - 1; i >= 0 && records.size() < limit; --i) {
+        const LogRecord &record = at(i);
+        if (record.level < query.minimumLevel
+            || (query.connection != 0 && record.connection != query.connection)
+            || (tag >= 0 && record.tag != tag))
+            continue;
+        if (!destination.isEmpty()
+            && (record.destination < 0 || !m_strings.at(record.destination).contains(destination)))
+            continue;
+        records.append(record);
+    }
+    return records;
+}
+
+QList<LogTable::Group> LogTable::group(Field field) const
+{
+    struct Totals
+    {
+        int connections = 0;
+        int failures = 0;
+        std::vector<int> setups;
+    };
+
+    QHash<int, Totals> totals;
+    for (const Connection &connection : m_connections) {
+        int key = field == Outbound ? connection.outbound
+                  : field == Inbound ? connection.inbound
+                                     : connection.destination;
+        if (key < 0)
+            continue;
+        Totals &total = totals[key];
+        ++total.connections;
+        if (connection.failed)
+            ++total.failures;
+        if (connection.setup >= 0)
+            total.setups.push_back(connection.setup);
+    }
+
+    QList<Group> groups;
+    groups.reserve(totals.size());
+    for (auto it = totals.begin(); it != totals.end(); ++it) {
+        Group group;
+        group.key = string(it.key());
+        group.connections = it->connections;
+        group.failures = it->failures;
+        std::vector<int> &setups = it->setups;
+        if (!setups.empty()) {
+            auto middle = setups.begin() + setups.size() / 2;
+            std::nth_element(setups.begin(), middle, setups.end());
+            group.medianSetup = *middle;
+        }
+        groups.append(group);
+    }
+    std::sort(groups.begin(), groups.end(), [](const Group &a, const Group &b) {
+        if (a.connections != b.connections)
+            return a.connections > b.connections;
+        return a.key < b.key;
+    });
+    return groups;
+}
+
+void LogTable::append(const LogLine &line)
+{
+    LogRecord record;
+    record.time = line.time;
+    record.duration = line.duration >= 0 ? qint32(qMin<qint64>(line.duration, INT_MAX)) : -1;
+    record.connection = line.connection;
+    record.level = quint8(line.level);
+    record.event = quint8(line.event);
+    record.component = intern(line.component);
+    record.tag = intern(line.tag);
+    record.destination = intern(line.destination);
+    if (line.event == LogLine::Failure || line.event == LogLine::SetupFailure)
+        record.message = intern(line.message);
+
+    if (size() < m_capacity) {
+        m_records.push_back(record);
+    } else {
+        m_records[m_first] = record;
+        m_first = (m_first + 1) % m_capacity;
+    }
+
+    if (record.connection != 0)
+        track(line, record);
+    if (m_strings.size() > m_compactAt)
+        compact();
+}
+
+void LogTable::track(const LogLine &line, const LogRecord &record)
+{
+    auto it = m_connections.find(record.connection);
+    if (it == m_connections.end()) {
+        it = m_connections.insert(record.connection, Connection());
+        it->sequence = ++m_sequence;
+    }
+
+    Connection &connection = *it;
+    switch (line.event) {
+    case LogLine::InboundConnection:
+        connection.inbound = record.tag;
+        if (connection.destination < 0)
+            connection.destination = record.destination;
+        break;
+    case LogLine::OutboundConnection:
+        connection.outbound = record.tag;
+        connection.setup = record.duration;
+        if (connection.destination < 0)
+            connection.destination = record.destination;
+        break;
+    case LogLine::Failure:
+    case LogLine::SetupFailure:
+        connection.failed = true;
+        if (connection.outbound < 0)
+            connection.outbound = intern(line.outbound);
+        break;
+    default:
+        break;
+    }
+
+    if (m_connections.size() > m_capacity)
+        pruneConnections();
+}
+
+int LogTable::intern(QByteArrayView text)
+{
+    if (text.isEmpty())
+        return -1;
+    auto it = m_stringIds.constFind(QByteArray::fromRawData(text.data(), text.size()));
+    if (it != m_stringIds.constEnd())
+        return *it;
+
+    QByteArray copy(text.data(), text.size());
+    int id = m_strings.size();
+    m_strings.append(copy);
+    m_stringIds.insert(copy, id);
+    return id;
+}
+
+int LogTable::find(const QString &text) const
+{
+    return m_stringIds.value(text.toUtf8(), -1);
+}
+
+void LogTable::compact()
+{
+    QList<QByteArray> strings;
+    QHash<QByteArray, int> ids;
+    auto remap = [&](int &index) {
+        if (index < 0)
+            return;
+        const QByteArray &text = m_strings.at(index);
+        auto it = ids.constFind(text);
+        if (it != ids.constEnd()) {
+            index = *it;
+            return;
+        }
+        int id = strings.size();
+        strings.append(text);
+        ids.insert(text, id);
+        index = id;
+    };
+
+    for (LogRecord &record : m_records) {
+        remap(record.component);
+        remap(record.tag);
+        remap(record.destination);
+        remap(record.message);
+    }
+    for (Connection &connection : m_connections) {
+        remap(connection.inbound);
+        remap(connection.outbound);
+        remap(connection.destination);
+    }
+
+    m_strings = strings;
+    m_stringIds = ids;
+    // Do not compact again before the pool has grown a good deal
+    m_compactAt = qMax(4 * m_capacity, 2 * int(m_strings.size()));
+}
+
+void LogTable::pruneConnections()
+{
+    // Keep the newer half
+    std::vector<qint64> sequences;
+    sequences.reserve(m_connections.size());
+    for (const Connection &connection : std::as_const(m_connections))
+        sequences.push_back(connection.sequence);
+    auto middle = sequences.begin() + sequences.size() / 2;
+    std::nth_element(sequences.begin(), middle, sequences.end());
+    qint64 oldest = *middle;
+
+    for (auto it = m_connections.begin(); it != m_connections.end();) {
+        if (it->sequence < oldest)
+            it = m_connections.erase(it);
+        else
+            ++it;
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef LOG_TABLE_H
+#define LOG_TABLE_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <vector>
+
+#include "log_governor.h"
+
+struct LogLine;
+
+struct LogRecord
+{
+    // See LogLine, strings are indexes for LogTable::string(), -1 if missing
+    qint64 time = -1;
+    qint32 duration = -1;
+    quint32 connection = 0;
+    quint8 level = LogGovernor::Unknown;
+    quint8 event = 0;
+    int component = -1;
+    int tag = -1;
+    int destination = -1;
+    // Kept for failures only
+    int message = -1;
+};
+
+// The most recent core log lines as typed records, with the connections
+// they belong to. Strings are stored once and records refer to them by
+// index, so a table of a few ten thousand lines stays small.
+class LogTable
+{
+public:
+    enum Field {
+        Outbound,
+        Inbound,
+        Destination
+    };
+
+    struct Group
+    {
+        QString key;
+        int connections = 0;
+        int failures = 0;
+        // Median ms from the start of a connection to its outbound, -1 if unknown
+        int medianSetup = -1;
+    };
+
+    struct Query
+    {
+        LogGovernor::Level minimumLevel = LogGovernor::Trace;
+        quint32 connection = 0;
+        // Exact component tag and part of the destination, empty for any
+        QString tag;
+        QString destination;
+    };
+
+    explicit LogTable(int capacity = 50000);
+
+    // Raw core output, a line may continue in the next chunk. Returns the
+    // number of records added.
+    int feed(const QByteArray &data);
+    void clear();
+
+    int size() const;
+    // 0 is the oldest record
+    const LogRecord &at(int index) const;
+    QString string(int index) const;
+    int connectionCount() const;
+    // Outbound of a connection the table still knows, empty otherwise
+    QString outboundOf(quint32 connection) const;
+
+    // Newest first
+    QList<LogRecord> select(const Query &query, int limit) const;
+    // Connections by outbound, inbound or destination, busiest first
+    QList<Group> group(Field field) const;
+
+private:
+    struct Connection
+    {
+        int inbound = -1;
+        int outbound = -1;
+        int destination = -1;
+        qint32 setup = -1;
+        bool failed = false;
+        qint64 sequence = 0;
+    };
+
+    void append(const LogLine &line);
+    void track(const LogLine &line, const LogRecord &record);
+    int intern(QByteArrayView text);
+    int find(const QString &text) const;
+    // Drops strings no record or connection refers to any more
+    void compact();
+    void pruneConnections();
+
+    int m_capacity;
+    std::vector<LogRecord> m_records;
+    int m_first = 0;
+    QByteArray m_pending;
+
+    QList<QByteArray> m_strings;
+    QHash<QByteArray, int> m_stringIds;
+    int m_compactAt;
+
+    QHash<quint32, Connection> m_connections;
+    qint64 m_sequence = 0;
+};
+
+#endif // LOG_TABLE_H
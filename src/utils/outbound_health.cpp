@@ -0,0 +1,179 @@
+#include "outbound_health.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "log_parser.h"
+#include "log_table.h"
+
+namespace {
+
+const qint64 kSlotLength = 10000;
+// Fewer attempts say little about a node
+const int kMinAttempts = 10;
+const int kMaxFailedConnections = 1024;
+
+} // namespace
+
+OutboundHealth::OutboundHealth()
+{
+    m_clock.start();
+}
+
+void OutboundHealth::consume(const LogTable &table, int added)
+{
+    qint64 now = currentSlot();
+    for (int i = qMax(0, table.size() - added); i < table.size(); ++i) {
+        const LogRecord &record = table.at(i);
+        if (record.event == LogLine::OutboundConnection) {
+            QString outbound = table.string(record.tag);
+            if (outbound.isEmpty())
+                continue;
+            Slot &current = slot(outbound);
+            ++current.attempts;
+            if (record.duration >= 0) {
+                quint16 &count = current.setups[bucket(record.duration)];
+                if (count < 0xffff)
+                    ++count;
+            }
+        } else if (record.event == LogLine::SetupFailure) {
+            // A broken transfer says more about the destination than the
+            // outbound, only dial and handshake errors count.
+            // A connection often logs more than one error on its way down
+            if (record.connection == 0 || m_failed.contains(record.connection))
+                continue;
+            QString outbound = table.outboundOf(record.connection);
+            if (outbound.isEmpty())
+                continue;
+            m_failed.insert(record.connection, now);
+            Slot &current = slot(outbound);
+            ++current.failures;
+            if (record.duration >= 0) {
+                quint16 &count = current.failureTimes[bucket(record.duration)];
+                if (count < 0xffff)
+                    ++count;
+            }
+        }
+    }
+
+    if (m_failed.size() > kMaxFailedConnections) {
+        for (auto it = m_failed.begin(); it != m_failed.end();) {
+            if (it.value() <= now - kSlotCount)
+                it = m_failed.erase(it);
+            else
+                ++it;
+        }
+    }
+}
+
+void OutboundHealth::clear()
+{
+    m_outbounds.clear();
+    m_failed.clear();
+}
+
+OutboundHealth::Health OutboundHealth::health(const QString &outbound) const
+{
+    auto it = m_outbounds.constFind(outbound);
+    if (it == m_outbounds.constEnd()) {
+        Health health;
+        health.outbound = outbound;
+        return health;
+    }
+    return summarize(outbound, *it);
+}
+
+QList<OutboundHealth::Health> OutboundHealth::all() const
+{
+    QList<Health> list;
+    for (auto it = m_outbounds.constBegin(); it != m_outbounds.constEnd(); ++it) {
+        Health health = summarize(it.key(), it.value());
+        if (health.attempts > 0 || health.failures > 0)
+            list.append(health);
+    }
+    std::sort(list.begin(), list.end(), [](const Health &a, const Health &b) {
+        if (a.failureRate != b.failureRate)
+            return a.failureRate > b.failureRate;
+        return a.attempts > b.attempts;
+    });
+    return list;
+}
+
+double OutboundHealth::failureRate(const QString &outbound) const
+{
+    Health current = health(outbound);
+    return current.score < 0 ? 0 : current.failureRate;
+}
+
+OutboundHealth::Slot &OutboundHealth::slot(const QString &outbound)
+{
+    qint64 number = currentSlot();
+    Slot &current = m_outbounds[outbound].slots[number % kSlotCount];
+    if (current.number != number) {
+        current = Slot();
+        current.number = number;
+    }
+    return current;
+}
+
+OutboundHealth::Health OutboundHealth::summarize(const QString &outbound, const Outbound &slots) const
+{
+    Health health;
+    health.outbound = outbound;
+
+    qint64 now = currentSlot();
+    std::array<int, kBucketCount> setups = {};
+    std::array<int, kBucketCount> failureTimes = {};
+    int setupCount = 0;
+    int failureCount = 0;
+    for (const Slot &current : slots.slots) {
+        if (current.number < 0 || current.number <= now - kSlotCount)
+            continue;
+        health.attempts += current.attempts;
+        health.failures += current.failures;
+        for (int i = 0; i < kBucketCount; ++i) {
+            setups[i] += current.setups[i];
+            setupCount += current.setups[i];
+            failureTimes[i] += current.failureTimes[i];
+            failureCount += current.failureTimes[i];
+        }
+    }
+
+    // Failures without attempt lines say nothing about the rate
+    if (health.attempts > 0)
+        health.failureRate = qMin(1.0, double(health.failures) / health.attempts);
+    health.medianSetup = quantile(setups, setupCount, 0.5);
+    health.slowSetup = quantile(setups, setupCount, 0.9);
+    health.medianFailure = quantile(failureTimes, failureCount, 0.5);
+    if (health.attempts >= kMinAttempts)
+        health.score = qRound(100 * (1 - health.failureRate));
+    return health;
+}
+
+int OutboundHealth::bucket(qint32 milliseconds)
+{
+    // Half powers of two, about 40% wide
+    if (milliseconds <= 0)
+        return 0;
+    int index = int(2 * std::log2(double(milliseconds))) + 1;
+    return qBound(0, index, kBucketCount - 1);
+}
+
+int OutboundHealth::quantile(const std::array<int, kBucketCount> &buckets, int count, double q)
+{
+    if (count == 0)
+        return -1;
+    double target = q * count;
+    int seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        seen += buckets[i];
+        if (seen >= target && buckets[i] > 0)
+            return i == 0 ? 0 : qRound(std::pow(2.0, i / 2.0));
+    }
+    return qRound(std::pow(2.0, (kBucketCount - 1) / 2.0));
+}
+
+qint64 OutboundHealth::currentSlot() const
+{
+    return m_clock.elapsed() / kSlotLength;
+}
@@ -0,0 +1,80 @@
+#ifndef OUTBOUND_HEALTH_H
+#define OUTBOUND_HEALTH_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <array>
+
+class LogTable;
+
+// Passive health of outbounds from what the core logs anyway. Every
+// "outbound connection" line counts as an attempt of its outbound and a
+// connection with a dial or handshake error as a failure, so a degraded
+// node shows up without probe traffic. Counts and a log scale latency histogram are kept
+// per 10 s slot over the last 5 minutes.
+class OutboundHealth
+{
+public:
+    struct Health
+    {
+        QString outbound;
+        int attempts = 0;
+        int failures = 0;
+        // -1 without attempt lines to relate the failures to
+        double failureRate = -1;
+        // ms from the start of a connection to its dial, -1 without samples
+        int medianSetup = -1;
+        int slowSetup = -1; // 90th percentile
+        // ms until a failing connection gave up
+        int medianFailure = -1;
+        // 0..100, -1 until there are enough attempts to tell
+        int score = -1;
+    };
+
+    OutboundHealth();
+
+    // Looks at the newest records of the table, call after every feed
+    // that kept the info lines
+    void consume(const LogTable &table, int added);
+    void clear();
+
+    Health health(const QString &outbound) const;
+    // Worst score first
+    QList<Health> all() const;
+    // 0..1, 0 while there are too few attempts to tell
+    double failureRate(const QString &outbound) const;
+
+private:
+    static const int kSlotCount = 30;
+    static const int kBucketCount = 40;
+
+    struct Slot
+    {
+        qint64 number = -1;
+        int attempts = 0;
+        int failures = 0;
+        std::array<quint16, kBucketCount> setups = {};
+        std::array<quint16, kBucketCount> failureTimes = {};
+    };
+
+    struct Outbound
+    {
+        std::array<Slot, kSlotCount> slots;
+    };
+
+    Slot &slot(const QString &outbound);
+    Health summarize(const QString &outbound, const Outbound &slots) const;
+    static int bucket(qint32 milliseconds);
+    static int quantile(const std::array<int, kBucketCount> &buckets, int count, double q);
+    qint64 currentSlot() const;
+
+    QElapsedTimer m_clock;
+    QHash<QString, Outbound> m_outbounds;
+    // Connections already counted as failed, with their slot
+    QHash<quint32, qint64> m_failed;
+};
+
+#endif // OUTBOUND_HEALTH_H
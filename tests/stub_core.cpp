@@ -0,0 +1,34 @@
+// Stands in for sing-box in tests: "run -c <file> -D <dir>" listens on the
+// listen_port of the first inbound and accepts connections until killed.
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const QStringList arguments = app.arguments();
+    qsizetype config = arguments.indexOf("-c");
+    if (arguments.value(1) != "run" || config < 0)
+        return 1;
+    QFile file(arguments.value(config + 1));
+    if (!file.open(QIODevice::ReadOnly))
+        return 1;
+    QJsonObject inbound = QJsonDocument::fromJson(file.readAll())
+                              .object().value("inbounds").toArray().first().toObject();
+
+    QTcpServer server;
+    if (!server.listen(QHostAddress::LocalHost, quint16(inbound.value("listen_port").toInt())))
+        return 1;
+    QObject::connect(&server, &QTcpServer::newConnection, &server, [&server]() {
+        while (QTcpSocket *socket = server.nextPendingConnection())
+            QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    });
+    return app.exec();
+}
@@ -0,0 +1,99 @@
+#include <QJsonArray>
+#include <QNetworkDatagram>
+#include <QSignalSpy>
+#include <QTest>
+#include <QUdpSocket>
+
+#include "dns_benchmark.h"
+
+class TestDnsBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void measuresDirectServers();
+    void keepsDetourServersInPlace();
+
+private:
+    QJsonObject config() const;
+
+    // Stub resolver answering every query with NOERROR
+    QUdpSocket m_resolver;
+    int m_queries = 0;
+};
+
+void TestDnsBenchmark::initTestCase()
+{
+    QVERIFY(m_resolver.bind(QHostAddress::LocalHost, 0));
+    connect(&m_resolver, &QUdpSocket::readyRead, this, [this]() {
+        while (m_resolver.hasPendingDatagrams()) {
+            QNetworkDatagram query = m_resolver.receiveDatagram();
+            QByteArray answer = query.data();
+            if (answer.size() < 12)
+                continue;
+            ++m_queries;
+            answer[2] = char(answer.at(2) | 0x80); // QR
+            answer[3] = 0;                          // RCODE NOERROR
+            m_resolver.writeDatagram(query.makeReply(answer));
+        }
+    });
+}
+
+void TestDnsBenchmark::measuresDirectServers()
+{
+    QList<DnsServer> servers = DnsBenchmark::servers(config());
+    QCOMPARE(servers.size(), 3);
+    QVERIFY(servers.at(0).isTestable());
+    QCOMPARE(servers.at(1).detour, QString("proxy"));
+    QVERIFY(!servers.at(1).isTestable());
+    QVERIFY(!servers.at(2).isTestable());
+
+    DnsBenchmark benchmark;
+    benchmark.setQueryCount(10);
+    benchmark.setConcurrency(2);
+    QList<DnsBenchmark::Result> results;
+    connect(&benchmark, &DnsBenchmark::serverFinished, this,
+            [&results](const DnsBenchmark::Result &result) { results.append(result); });
+    QSignalSpy finished(&benchmark, &DnsBenchmark::finished);
+    m_queries = 0;
+    benchmark.run(servers);
+    QVERIFY(finished.wait(10000));
+
+    QCOMPARE(results.size(), 3);
+    QCOMPARE(results.at(0).tag, QString("stub"));
+    QCOMPARE(results.at(0).sent, 10);
+    QCOMPARE(results.at(0).failures, 0);
+    QVERIFY(results.at(0).p50 >= 0);
+    QVERIFY(results.at(0).p99 >= results.at(0).p50);
+    // The detour server never reached the stub
+    QCOMPARE(results.at(1).sent, 0);
+    QCOMPARE(results.at(2).sent, 0);
+    QCOMPARE(m_queries, 10);
+}
+
+void TestDnsBenchmark::keepsDetourServersInPlace()
+{
+    QJsonObject launchConfig = config();
+    DnsBenchmark::reorderServers(launchConfig, {"remote", "local", "stub"});
+
+    QStringList tags;
+    const QJsonArray servers = launchConfig.value("dns").toObject().value("servers").toArray();
+    for (const QJsonValue &server : servers)
+        tags.append(server.toObject().value("tag").toString());
+    QCOMPARE(tags, QStringList({"local", "stub", "remote"}));
+}
+
+QJsonObject TestDnsBenchmark::config() const
+{
+    QString address = QString("udp://127.0.0.1:%1").arg(m_resolver.localPort());
+    QJsonArray servers{
+        QJsonObject{{"tag", "stub"}, {"address", address}},
+        QJsonObject{{"tag", "remote"}, {"address", address}, {"detour", "proxy"}},
+        QJsonObject{{"tag", "local"}, {"address", "local"}},
+    };
+    return QJsonObject{{"dns", QJsonObject{{"servers", servers}}}};
+}
+
+QTEST_GUILESS_MAIN(TestDnsBenchmark)
+#include "tst_dns_benchmark.moc"
@@ -0,0 +1,89 @@
+#include <QJsonArray>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+
+#include "clash_api.h"
+#include "config_isolation.h"
+#include "hot_standby.h"
+
+class TestHotStandby : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void relocatesPortsAndApi();
+    void startsWithStubCore();
+    void reportsMissingCore();
+
+private:
+    QJsonObject config() const;
+};
+
+void TestHotStandby::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestHotStandby::relocatesPortsAndApi()
+{
+    QJsonObject relocated = ConfigIsolation::relocate(config(), "standby_cache.db");
+
+    const QJsonArray inbounds = relocated.value("inbounds").toArray();
+    QCOMPARE(inbounds.size(), 1);
+    QJsonObject mixed = inbounds.first().toObject();
+    QCOMPARE(mixed.value("type").toString(), QString("mixed"));
+    QVERIFY(!mixed.contains("set_system_proxy"));
+    QVERIFY(mixed.value("listen_port").toInt() > 0);
+    QVERIFY(mixed.value("listen_port").toInt() != 2080);
+
+    QJsonObject clashApi = relocated.value("experimental").toObject().value("clash_api").toObject();
+    QVERIFY(!clashApi.value("external_controller").toString().isEmpty());
+    QVERIFY(clashApi.value("external_controller").toString() != "127.0.0.1:9090");
+    QVERIFY(!relocated.value("log").toObject().contains("output"));
+}
+
+void TestHotStandby::startsWithStubCore()
+{
+    ClashApi primaryApi;
+    HotStandby standby(&primaryApi);
+    standby.start("stub", config(), STUB_CORE_PATH);
+    QTRY_VERIFY_WITH_TIMEOUT(standby.state() == HotStandby::Ready, 10000);
+
+    standby.stop();
+    QVERIFY(standby.state() == HotStandby::Stopped);
+}
+
+void TestHotStandby::reportsMissingCore()
+{
+    ClashApi primaryApi;
+    HotStandby standby(&primaryApi);
+    QSignalSpy messages(&standby, &HotStandby::message);
+    standby.start("missing", config(), "missing/sing-box");
+
+    QVERIFY(standby.state() == HotStandby::Stopped);
+    QCOMPARE(messages.size(), 1);
+    QVERIFY(messages.first().first().toString().contains("cannot find sing-box"));
+}
+
+QJsonObject TestHotStandby::config() const
+{
+    QJsonArray inbounds{
+        QJsonObject{{"type", "tun"}, {"tag", "tun-in"}},
+        QJsonObject{{"type", "mixed"}, {"tag", "mixed-in"}, {"listen", "127.0.0.1"},
+                    {"listen_port", 2080}, {"set_system_proxy", true}},
+    };
+    QJsonObject experimental{
+        {"clash_api", QJsonObject{{"external_controller", "127.0.0.1:9090"}}},
+    };
+    return QJsonObject{
+        {"log", QJsonObject{{"output", "box.log"}}},
+        {"inbounds", inbounds},
+        {"outbounds", QJsonArray{QJsonObject{{"type", "direct"}, {"tag", "direct"}}}},
+        {"experimental", experimental},
+    };
+}
+
+QTEST_GUILESS_MAIN(TestHotStandby)
+#include "tst_hot_standby.moc"
@@ -0,0 +1,84 @@
+#include <QJsonArray>
+#include <QTest>
+
+#include "route_evaluator.h"
+
+class TestRouteEvaluator : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesAnyListedRuleSet();
+    void matchesDomainRegex();
+    void skipsUnreadableRegex();
+    void fallsBackToDirect();
+};
+
+namespace {
+
+QJsonObject inlineRuleSet(const QString &tag, const QString &suffix)
+{
+    QJsonArray rules{QJsonObject{{"domain_suffix", suffix}}};
+    return QJsonObject{{"type", "inline"}, {"tag", tag}, {"rules", rules}};
+}
+
+QJsonObject config(const QJsonArray &rules)
+{
+    QJsonObject route{
+        {"rule_set", QJsonArray{inlineRuleSet("set-a", "a.com"), inlineRuleSet("set-b", "b.com")}},
+        {"rules", rules},
+        {"final", "proxy"},
+    };
+    return QJsonObject{{"route", route}};
+}
+
+} // namespace
+
+void TestRouteEvaluator::matchesAnyListedRuleSet()
+{
+    RouteEvaluator evaluator(config({
+        QJsonObject{{"rule_set", QJsonArray{"set-a", "set-b"}}, {"outbound", "direct"}},
+    }));
+
+    QCOMPARE(evaluator.evaluate("www.a.com").outbound, QString("direct"));
+    QCOMPARE(evaluator.evaluate("b.com:443").outbound, QString("direct"));
+    RouteMatch match = evaluator.evaluate("c.com");
+    QCOMPARE(match.ruleIndex, -1);
+    QCOMPARE(match.outbound, QString("proxy"));
+    QVERIFY(match.skippedRules.isEmpty());
+}
+
+void TestRouteEvaluator::matchesDomainRegex()
+{
+    RouteEvaluator evaluator(config({
+        QJsonObject{{"domain_regex", "^cdn\\d+\\.example\\.net$"}, {"outbound", "direct"}},
+    }));
+
+    QCOMPARE(evaluator.evaluate("cdn12.example.net").outbound, QString("direct"));
+    QCOMPARE(evaluator.evaluate("cdn.example.net").outbound, QString("proxy"));
+}
+
+void TestRouteEvaluator::skipsUnreadableRegex()
+{
+    RouteEvaluator evaluator(config({
+        QJsonObject{{"domain_regex", "(unclosed"}, {"outbound", "direct"}},
+    }));
+
+    RouteMatch match = evaluator.evaluate("unclosed");
+    QCOMPARE(match.outbound, QString("proxy"));
+    QCOMPARE(match.skippedRules, QList<int>{0});
+    QVERIFY(evaluator.describeRule(0).contains("not evaluated"));
+}
+
+void TestRouteEvaluator::fallsBackToDirect()
+{
+    // Neither route.final nor outbounds, sing-box accepts that
+    RouteEvaluator evaluator(QJsonObject{{"route", QJsonObject{{"rules", QJsonArray()}}}});
+
+    RouteMatch match = evaluator.evaluate("example.com");
+    QCOMPARE(match.ruleIndex, -1);
+    QCOMPARE(match.outbound, QString("direct"));
+}
+
+QTEST_GUILESS_MAIN(TestRouteEvaluator)
+#include "tst_route_evaluator.moc"
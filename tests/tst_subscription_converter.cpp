@@ -0,0 +1,48 @@
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTest>
+
+#include "subscription_converter.h"
+
+class TestSubscriptionConverter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void survivesMalformedFlow_data();
+    void survivesMalformedFlow();
+};
+
+void TestSubscriptionConverter::survivesMalformedFlow_data()
+{
+    QTest::addColumn<QByteArray>("line");
+
+    QTest::newRow("map closed by ]") << QByteArray("  - {name: bad, type: ss, server: a.com, port: 1]");
+    QTest::newRow("list closed by }") << QByteArray("  - {name: bad, type: ss, alpn: [h2}, server: a.com}");
+    QTest::newRow("unterminated map") << QByteArray("  - {name: bad, type: ss, server: a.com");
+    QTest::newRow("unterminated list") << QByteArray("  - {name: bad, alpn: [h2, h3");
+    QTest::newRow("stray brackets") << QByteArray("  - {]}]}");
+}
+
+void TestSubscriptionConverter::survivesMalformedFlow()
+{
+    QFETCH(QByteArray, line);
+
+    QByteArray yaml = "proxies:\n" + line + "\n"
+                      "  - {name: good, type: ss, server: b.com, port: 8388, cipher: aes-128-gcm, password: x}\n";
+    QByteArray config;
+    QStringList warnings;
+    QString error;
+    // Must return at all, the good node is still converted
+    QVERIFY2(SubscriptionConverter::convert(yaml, &config, &warnings, &error), qPrintable(error));
+
+    QStringList tags;
+    const QJsonArray outbounds = QJsonDocument::fromJson(config).object().value("outbounds").toArray();
+    for (const QJsonValue &outbound : outbounds)
+        tags.append(outbound.toObject().value("tag").toString());
+    QVERIFY(tags.contains("good"));
+}
+
+QTEST_GUILESS_MAIN(TestSubscriptionConverter)
+#include "tst_subscription_converter.moc"
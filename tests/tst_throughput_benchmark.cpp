@@ -0,0 +1,107 @@
+#include <QFile>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+
+#include "clash_api.h"
+#include "local_http_target.h"
+#include "throughput_benchmark.h"
+
+class TestThroughputBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void measuresEveryOutbound();
+    void keepsResultsPerProfile();
+
+private:
+    void removeResults();
+    // Runs the benchmark over outbounds, false if it did not finish
+    bool run(const QString &profile, const QStringList &outbounds,
+             QList<ThroughputBenchmark::Result> *results);
+
+    // Stands in for the clash API, answers every request with 200
+    LocalHttpTarget m_controller;
+    LocalHttpTarget m_target;
+};
+
+void TestThroughputBenchmark::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_controller.listen());
+    QVERIFY(m_target.listen());
+}
+
+void TestThroughputBenchmark::init()
+{
+    removeResults();
+}
+
+void TestThroughputBenchmark::cleanup()
+{
+    removeResults();
+}
+
+void TestThroughputBenchmark::removeResults()
+{
+    QString appDataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QFile::remove(appDataPath + "/throughput.json");
+}
+
+bool TestThroughputBenchmark::run(const QString &profile, const QStringList &outbounds,
+                                  QList<ThroughputBenchmark::Result> *results)
+{
+    ClashApi clashApi;
+    clashApi.setController(m_controller.url().authority(), QString());
+
+    ThroughputBenchmark benchmark(&clashApi);
+    benchmark.setProfile(profile);
+    benchmark.setProxy(QNetworkProxy(QNetworkProxy::NoProxy));
+    benchmark.setTarget(m_target.url("/bytes/262144"));
+    benchmark.setConnections(2);
+    benchmark.setDuration(1000);
+
+    connect(&benchmark, &ThroughputBenchmark::outboundFinished, this,
+            [results](const ThroughputBenchmark::Result &result) { results->append(result); });
+    QSignalSpy finished(&benchmark, &ThroughputBenchmark::finished);
+    benchmark.run("proxy", outbounds);
+    return finished.wait(10000) && !benchmark.isRunning();
+}
+
+void TestThroughputBenchmark::measuresEveryOutbound()
+{
+    QList<ThroughputBenchmark::Result> results;
+    QVERIFY(run("test", {"a", "b"}, &results));
+
+    QCOMPARE(results.size(), 2);
+    for (const ThroughputBenchmark::Result &result : std::as_const(results)) {
+        QCOMPARE(result.failures, 0);
+        QVERIFY(result.bytes > 0);
+        QVERIFY(result.throughput > 0);
+        QVERIFY(result.ttfb >= 0);
+        QVERIFY(result.jitter >= 0);
+    }
+    QCOMPARE(results.at(0).outbound, QString("a"));
+    QCOMPARE(results.at(1).outbound, QString("b"));
+}
+
+void TestThroughputBenchmark::keepsResultsPerProfile()
+{
+    QList<ThroughputBenchmark::Result> results;
+    QVERIFY(run("first", {"a"}, &results));
+    QVERIFY(run("second", {"b"}, &results));
+
+    QHash<QString, ThroughputBenchmark::Result> first = ThroughputBenchmark::loadResults("first");
+    QCOMPARE(first.keys(), QList<QString>{"a"});
+    QVERIFY(first.value("a").bytes > 0);
+    // The second run added its profile without touching the first one
+    QCOMPARE(ThroughputBenchmark::loadResults("second").keys(), QList<QString>{"b"});
+    QVERIFY(ThroughputBenchmark::loadResults("other").isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TestThroughputBenchmark)
+#include "tst_throughput_benchmark.moc"